@@ -67,9 +67,12 @@ constexpr auto kSharedMediaLimit = 100;
 constexpr auto kFeedMessagesLimit = 50;
 constexpr auto kReadFeaturedSetsTimeout = TimeMs(1000);
 constexpr auto kFileLoaderQueueStopTimeout = TimeMs(5000);
+constexpr auto kFileLoaderThreadsCount = 0; // One for each core.
 constexpr auto kFeedReadTimeout = TimeMs(1000);
 constexpr auto kStickersByEmojiInvalidateTimeout = TimeMs(60 * 60 * 1000);
 constexpr auto kNotifySettingSaveTimeout = TimeMs(1000);
+constexpr auto kPeersRequestLimit = 100;
+constexpr auto kLastParticipantsCacheLifetime = TimeMs(30 * 1000);
 
 using SimpleFileLocationId = Data::SimpleFileLocationId;
 using DocumentFileLocationId = Data::DocumentFileLocationId;
@@ -163,7 +166,39 @@ ApiWrap::ApiWrap(not_null<AuthSession*> session)
 , _webPagesTimer([=] { resolveWebPages(); })
 , _draftsSaveTimer([=] { saveDraftsToCloud(); })
 , _featuredSetsReadTimer([=] { readFeaturedSets(); })
-, _fileLoader(std::make_unique<TaskQueue>(kFileLoaderQueueStopTimeout))
+, _fileLoader(std::make_unique<TaskQueue>(
+	kFileLoaderQueueStopTimeout,
+	kFileLoaderThreadsCount))
+, _fullPeerRequests(
+	"full_peer",
+	{ 0, 1 },
+	[=](std::vector<not_null<PeerData*>> &&peers) {
+		return sendFullPeerRequest(peers.front());
+	})
+, _userRequests(
+	"users.getUsers",
+	{ kSmallDelayMs, kPeersRequestLimit },
+	[=](std::vector<not_null<PeerData*>> &&users) {
+		return sendUsersRequest(std::move(users));
+	})
+, _chatRequests(
+	"messages.getChats",
+	{ kSmallDelayMs, kPeersRequestLimit },
+	[=](std::vector<not_null<PeerData*>> &&chats) {
+		return sendChatsRequest(std::move(chats));
+	})
+, _channelRequests(
+	"channels.getChannels",
+	{ kSmallDelayMs, kPeersRequestLimit },
+	[=](std::vector<not_null<PeerData*>> &&channels) {
+		return sendChannelsRequest(std::move(channels));
+	})
+, _lastParticipantsRequests(
+	"channels.getParticipants",
+	{ 0, 1, kLastParticipantsCacheLifetime },
+	[=](std::vector<not_null<ChannelData*>> &&channels) {
+		return sendLastParticipantsRequest(channels.front());
+	})
 , _feedReadTimer([=] { readFeeds(); })
 , _proxyPromotionTimer([=] { refreshProxyPromotion(); })
 , _updateNotifySettingsTimer([=] { sendNotifySettingsUpdates(); }) {
@@ -805,32 +840,35 @@ void ApiWrap::changeDialogUnreadMark(
 }
 
 void ApiWrap::requestFullPeer(PeerData *peer) {
-	if (!peer || _fullPeerRequests.contains(peer)) return;
+	if (peer) {
+		_fullPeerRequests.request(peer);
+	}
+}
 
-	auto sendRequest = [this, peer] {
-		auto failHandler = [this, peer](const RPCError &error) {
-			_fullPeerRequests.remove(peer);
-		};
-		if (auto user = peer->asUser()) {
-			return request(MTPusers_GetFullUser(
-				user->inputUser
-			)).done([this, user](const MTPUserFull &result, mtpRequestId requestId) {
-				gotUserFull(user, result, requestId);
-			}).fail(failHandler).send();
-		} else if (auto chat = peer->asChat()) {
-			return request(MTPmessages_GetFullChat(chat->inputChat)).done([this, peer](const MTPmessages_ChatFull &result, mtpRequestId requestId) {
-				gotChatFull(peer, result, requestId);
-			}).fail(failHandler).send();
-		} else if (auto channel = peer->asChannel()) {
-			return request(MTPchannels_GetFullChannel(channel->inputChannel)).done([this, peer](const MTPmessages_ChatFull &result, mtpRequestId requestId) {
-				gotChatFull(peer, result, requestId);
-			}).fail(failHandler).send();
-		}
-		return 0;
+mtpRequestId ApiWrap::sendFullPeerRequest(not_null<PeerData*> peer) {
+	const auto failHandler = [=](const RPCError &error, mtpRequestId requestId) {
+		_fullPeerRequests.fail(requestId);
 	};
-	if (auto requestId = sendRequest()) {
-		_fullPeerRequests.insert(peer, requestId);
+	if (const auto user = peer->asUser()) {
+		return request(MTPusers_GetFullUser(
+			user->inputUser
+		)).done([=](const MTPUserFull &result, mtpRequestId requestId) {
+			gotUserFull(user, result, requestId);
+		}).fail(failHandler).send();
+	} else if (const auto chat = peer->asChat()) {
+		return request(MTPmessages_GetFullChat(
+			chat->inputChat
+		)).done([=](const MTPmessages_ChatFull &result, mtpRequestId requestId) {
+			gotChatFull(peer, result, requestId);
+		}).fail(failHandler).send();
+	} else if (const auto channel = peer->asChannel()) {
+		return request(MTPchannels_GetFullChannel(
+			channel->inputChannel
+		)).done([=](const MTPmessages_ChatFull &result, mtpRequestId requestId) {
+			gotChatFull(peer, result, requestId);
+		}).fail(failHandler).send();
 	}
+	return 0;
 }
 
 void ApiWrap::processFullPeer(PeerData *peer, const MTPmessages_ChatFull &result) {
@@ -978,10 +1016,7 @@ void ApiWrap::gotChatFull(PeerData *peer, const MTPmessages_ChatFull &result, mt
 	}
 
 	if (req) {
-		auto i = _fullPeerRequests.find(peer);
-		if (i != _fullPeerRequests.cend() && i.value() == req) {
-			_fullPeerRequests.erase(i);
-		}
+		_fullPeerRequests.done(req);
 	}
 	if (badVersion) {
 		if (const auto chat = peer->asChat()) {
@@ -1025,63 +1060,108 @@ void ApiWrap::gotUserFull(UserData *user, const MTPUserFull &result, mtpRequestI
 	user->fullUpdated();
 
 	if (req) {
-		auto i = _fullPeerRequests.find(user);
-		if (i != _fullPeerRequests.cend() && i.value() == req) {
-			_fullPeerRequests.erase(i);
-		}
+		_fullPeerRequests.done(req);
 	}
 	fullPeerUpdated().notify(user);
 }
 
 void ApiWrap::requestPeer(PeerData *peer) {
-	if (!peer || _fullPeerRequests.contains(peer) || _peerRequests.contains(peer)) return;
+	if (!peer || _fullPeerRequests.requested(peer)) {
+		return;
+	} else if (peer->isUser()) {
+		_userRequests.request(peer);
+	} else if (peer->isChat()) {
+		_chatRequests.request(peer);
+	} else if (peer->isChannel()) {
+		_channelRequests.request(peer);
+	}
+}
+
+mtpRequestId ApiWrap::sendUsersRequest(
+		std::vector<not_null<PeerData*>> &&users) {
+	auto inputs = QVector<MTPInputUser>();
+	inputs.reserve(users.size());
+	for (const auto peer : users) {
+		inputs.push_back(peer->asUser()->inputUser);
+	}
+	return request(MTPusers_GetUsers(
+		MTP_vector<MTPInputUser>(inputs)
+	)).done([=](const MTPVector<MTPUser> &result, mtpRequestId requestId) {
+		_userRequests.done(requestId);
+		App::feedUsers(result);
+	}).fail([=](const RPCError &error, mtpRequestId requestId) {
+		_userRequests.fail(requestId);
+	}).send();
+}
 
-	auto sendRequest = [this, peer] {
-		auto failHandler = [this, peer](const RPCError &error) {
-			_peerRequests.remove(peer);
-		};
-		auto chatHandler = [this, peer](const MTPmessages_Chats &result) {
-			_peerRequests.remove(peer);
-
-			if (auto chats = Api::getChatsFromMessagesChats(result)) {
-				auto &v = chats->v;
-				bool badVersion = false;
-				if (const auto chat = peer->asChat()) {
-					badVersion = !v.isEmpty()
-						&& (v[0].type() == mtpc_chat)
-						&& (v[0].c_chat().vversion.v < chat->version);
-				} else if (const auto channel = peer->asChannel()) {
-					badVersion = !v.isEmpty()
-						&& (v[0].type() == mtpc_channel)
-						&& (v[0].c_channel().vversion.v < channel->version);
+mtpRequestId ApiWrap::sendChatsRequest(
+		std::vector<not_null<PeerData*>> &&chats) {
+	auto inputs = QVector<MTPint>();
+	inputs.reserve(chats.size());
+	for (const auto peer : chats) {
+		inputs.push_back(peer->asChat()->inputChat);
+	}
+	return request(MTPmessages_GetChats(
+		MTP_vector<MTPint>(inputs)
+	)).done([=](const MTPmessages_Chats &result, mtpRequestId requestId) {
+		gotPeerChats(_chatRequests, result, requestId);
+	}).fail([=](const RPCError &error, mtpRequestId requestId) {
+		_chatRequests.fail(requestId);
+	}).send();
+}
+
+mtpRequestId ApiWrap::sendChannelsRequest(
+		std::vector<not_null<PeerData*>> &&channels) {
+	auto inputs = QVector<MTPInputChannel>();
+	inputs.reserve(channels.size());
+	for (const auto peer : channels) {
+		inputs.push_back(peer->asChannel()->inputChannel);
+	}
+	return request(MTPchannels_GetChannels(
+		MTP_vector<MTPInputChannel>(inputs)
+	)).done([=](const MTPmessages_Chats &result, mtpRequestId requestId) {
+		gotPeerChats(_channelRequests, result, requestId);
+	}).fail([=](const RPCError &error, mtpRequestId requestId) {
+		_channelRequests.fail(requestId);
+	}).send();
+}
+
+void ApiWrap::gotPeerChats(
+		PeerBatcher &batcher,
+		const MTPmessages_Chats &result,
+		mtpRequestId requestId) {
+	batcher.done(requestId);
+
+	const auto chats = Api::getChatsFromMessagesChats(result);
+	if (!chats) {
+		return;
+	}
+
+	// If the server sent us an older version than we already have
+	// we accept its version and request the peer once again.
+	auto outdated = std::vector<not_null<PeerData*>>();
+	for (const auto &chat : chats->v) {
+		if (chat.type() == mtpc_chat) {
+			const auto &data = chat.c_chat();
+			if (const auto peer = App::chatLoaded(data.vid.v)) {
+				if (data.vversion.v < peer->version) {
+					peer->version = data.vversion.v;
+					outdated.push_back(peer);
 				}
-				auto chat = App::feedChats(*chats);
-				if (chat == peer) {
-					if (badVersion) {
-						if (auto chat = peer->asChat()) {
-							chat->version = v[0].c_chat().vversion.v;
-						} else if (auto channel = peer->asChannel()) {
-							channel->version = v[0].c_channel().vversion.v;
-						}
-						requestPeer(peer);
-					}
+			}
+		} else if (chat.type() == mtpc_channel) {
+			const auto &data = chat.c_channel();
+			if (const auto peer = App::channelLoaded(data.vid.v)) {
+				if (data.vversion.v < peer->version) {
+					peer->version = data.vversion.v;
+					outdated.push_back(peer);
 				}
 			}
-		};
-		if (auto user = peer->asUser()) {
-			return request(MTPusers_GetUsers(MTP_vector<MTPInputUser>(1, user->inputUser))).done([this, user](const MTPVector<MTPUser> &result) {
-				_peerRequests.remove(user);
-				App::feedUsers(result);
-			}).fail(failHandler).send();
-		} else if (auto chat = peer->asChat()) {
-			return request(MTPmessages_GetChats(MTP_vector<MTPint>(1, chat->inputChat))).done(chatHandler).fail(failHandler).send();
-		} else if (auto channel = peer->asChannel()) {
-			return request(MTPchannels_GetChannels(MTP_vector<MTPInputChannel>(1, channel->inputChannel))).done(chatHandler).fail(failHandler).send();
 		}
-		return 0;
-	};
-	if (auto requestId = sendRequest()) {
-		_peerRequests.insert(peer, requestId);
+	}
+	App::feedChats(*chats);
+	for (const auto peer : outdated) {
+		requestPeer(peer);
 	}
 }
 
@@ -1145,55 +1225,31 @@ void ApiWrap::markMediaRead(not_null<HistoryItem*> item) {
 }
 
 void ApiWrap::requestPeers(const QList<PeerData*> &peers) {
-	QVector<MTPint> chats;
-	QVector<MTPInputChannel> channels;
-	QVector<MTPInputUser> users;
-	chats.reserve(peers.size());
-	channels.reserve(peers.size());
-	users.reserve(peers.size());
-	for (QList<PeerData*>::const_iterator i = peers.cbegin(), e = peers.cend(); i != e; ++i) {
-		if (!*i || _fullPeerRequests.contains(*i) || _peerRequests.contains(*i)) continue;
-		if ((*i)->isUser()) {
-			users.push_back((*i)->asUser()->inputUser);
-		} else if ((*i)->isChat()) {
-			chats.push_back((*i)->asChat()->inputChat);
-		} else if ((*i)->isChannel()) {
-			channels.push_back((*i)->asChannel()->inputChannel);
-		}
-	}
-	auto handleChats = [=](const MTPmessages_Chats &result) {
-		if (auto chats = Api::getChatsFromMessagesChats(result)) {
-			App::feedChats(*chats);
-		}
-	};
-	if (!chats.isEmpty()) {
-		request(MTPmessages_GetChats(MTP_vector<MTPint>(chats))).done(handleChats).send();
-	}
-	if (!channels.isEmpty()) {
-		request(MTPchannels_GetChannels(MTP_vector<MTPInputChannel>(channels))).done(handleChats).send();
-	}
-	if (!users.isEmpty()) {
-		request(MTPusers_GetUsers(MTP_vector<MTPInputUser>(users))).done([=](const MTPVector<MTPUser> &result) {
-			App::feedUsers(result);
-		}).send();
+	for (const auto peer : peers) {
+		requestPeer(peer);
 	}
 }
 
 void ApiWrap::requestLastParticipants(not_null<ChannelData*> channel) {
-	if (!channel->isMegagroup() || _participantsRequests.contains(channel)) {
-		return;
+	if (channel->isMegagroup()) {
+		_lastParticipantsRequests.request(channel);
 	}
+}
 
+mtpRequestId ApiWrap::sendLastParticipantsRequest(
+		not_null<ChannelData*> channel) {
 	const auto offset = 0;
 	const auto participantsHash = 0;
-	const auto requestId = request(MTPchannels_GetParticipants(
+	return request(MTPchannels_GetParticipants(
 		channel->inputChannel,
 		MTP_channelParticipantsRecent(),
 		MTP_int(offset),
 		MTP_int(Global::ChatSizeMax()),
 		MTP_int(participantsHash)
-	)).done([this, channel](const MTPchannels_ChannelParticipants &result) {
-		_participantsRequests.remove(channel);
+	)).done([=](
+			const MTPchannels_ChannelParticipants &result,
+			mtpRequestId requestId) {
+		_lastParticipantsRequests.done(requestId);
 		parseChannelParticipants(channel, result, [&](
 				int availableCount,
 				const QVector<MTPChannelParticipant> &list) {
@@ -1202,11 +1258,9 @@ void ApiWrap::requestLastParticipants(not_null<ChannelData*> channel) {
 				availableCount,
 				list);
 		});
-	}).fail([this, channel](const RPCError &error) {
-		_participantsRequests.remove(channel);
+	}).fail([=](const RPCError &error, mtpRequestId requestId) {
+		_lastParticipantsRequests.fail(requestId);
 	}).send();
-
-	_participantsRequests.insert(channel, requestId);
 }
 
 void ApiWrap::requestBots(not_null<ChannelData*> channel) {
@@ -2390,6 +2444,8 @@ void ApiWrap::resolveWebPages() {
 
 void ApiWrap::requestParticipantsCountDelayed(
 		not_null<ChannelData*> channel) {
+	// The members have changed, the cached answer is outdated.
+	_lastParticipantsRequests.forget(channel);
 	_participantsCountRequestTimer.call(
 		kReloadChannelMembersTimeout,
 		[=] { channel->updateFullForced(); });
@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/flat_set.h"
 #include "core/single_timer.h"
 #include "mtproto/sender.h"
+#include "mtproto/request_batcher.h"
 #include "chat_helpers/stickers.h"
 #include "data/data_messages.h"
 
@@ -409,6 +410,18 @@ private:
 		not_null<Data::Feed*> feed,
 		const MTPmessages_Dialogs &dialogs);
 
+	mtpRequestId sendFullPeerRequest(not_null<PeerData*> peer);
+	mtpRequestId sendUsersRequest(std::vector<not_null<PeerData*>> &&users);
+	mtpRequestId sendChatsRequest(std::vector<not_null<PeerData*>> &&chats);
+	mtpRequestId sendChannelsRequest(
+		std::vector<not_null<PeerData*>> &&channels);
+	void gotPeerChats(
+		MTP::RequestBatcher<not_null<PeerData*>> &batcher,
+		const MTPmessages_Chats &result,
+		mtpRequestId requestId);
+	mtpRequestId sendLastParticipantsRequest(
+		not_null<ChannelData*> channel);
+
 	void gotChatFull(PeerData *peer, const MTPmessages_ChatFull &result, mtpRequestId req);
 	void gotUserFull(UserData *user, const MTPUserFull &result, mtpRequestId req);
 	void applyLastParticipantsList(
@@ -566,11 +579,15 @@ private:
 	QMap<ChannelData*, MessageDataRequests> _channelMessageDataRequests;
 	SingleQueuedInvokation _messageDataResolveDelayed;
 
+	using PeerBatcher = MTP::RequestBatcher<not_null<PeerData*>>;
+	PeerBatcher _fullPeerRequests;
+	PeerBatcher _userRequests;
+	PeerBatcher _chatRequests;
+	PeerBatcher _channelRequests;
+	MTP::RequestBatcher<not_null<ChannelData*>> _lastParticipantsRequests;
+
 	using PeerRequests = QMap<PeerData*, mtpRequestId>;
-	PeerRequests _fullPeerRequests;
-	PeerRequests _peerRequests;
 
-	PeerRequests _participantsRequests;
 	PeerRequests _botsRequests;
 	PeerRequests _adminsRequests;
 	base::DelayedCallTimer _participantsCountRequestTimer;
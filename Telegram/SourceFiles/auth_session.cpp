@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/file_upload.h"
 #include "storage/localstorage.h"
 #include "storage/storage_facade.h"
+#include "storage/storage_shared_media.h"
 #include "storage/serialize_common.h"
 #include "data/data_session.h"
 #include "window/notifications_manager.h"
@@ -326,6 +327,24 @@ AuthSession::AuthSession(const MTPUser &user)
 	_saveDataTimer.setCallback([=] {
 		Local::writeUserSettings();
 	});
+	_saveSharedMediaTimer.setCallback([=] {
+		Local::WriteSharedMediaCounts(_storage->sharedMediaCounts());
+	});
+	_storage->restore(Local::ReadSharedMediaCounts());
+	rpl::merge(
+		_storage->sharedMediaSliceUpdated(
+		) | rpl::map([] { return rpl::empty_value(); }),
+		_storage->sharedMediaOneRemoved(
+		) | rpl::map([] { return rpl::empty_value(); }),
+		_storage->sharedMediaAllRemoved(
+		) | rpl::map([] { return rpl::empty_value(); }),
+		_storage->sharedMediaBottomInvalidated(
+		) | rpl::map([] { return rpl::empty_value(); })
+	) | rpl::start_with_next([=] {
+		if (!_saveSharedMediaTimer.isActive()) {
+			_saveSharedMediaTimer.callOnce(kSaveSharedMediaDelay);
+		}
+	}, _lifetime);
 	Messenger::Instance().passcodeLockChanges(
 	) | rpl::start_with_next([=] {
 		_shouldLockAt = 0;
@@ -429,4 +448,11 @@ not_null<Support::Templates*> AuthSession::supportTemplates() const {
 	return _supportTemplates.get();
 }
 
+void AuthSession::saveSharedMediaCountsNow() {
+	if (_saveSharedMediaTimer.isActive()) {
+		_saveSharedMediaTimer.cancel();
+		Local::WriteSharedMediaCounts(_storage->sharedMediaCounts());
+	}
+}
+
 AuthSession::~AuthSession() = default;
@@ -267,6 +267,10 @@ public:
 	}
 	void saveSettingsDelayed(TimeMs delay = kDefaultSaveDelay);
 
+	// Writes the pending shared media counts right away. Called only on a
+	// normal shutdown, on logout the local storage is wiped instead.
+	void saveSharedMediaCountsNow();
+
 	ApiWrap &api() {
 		return *_api;
 	}
@@ -289,10 +293,12 @@ public:
 
 private:
 	static constexpr auto kDefaultSaveDelay = TimeMs(1000);
+	static constexpr auto kSaveSharedMediaDelay = TimeMs(5000);
 
 	const not_null<UserData*> _user;
 	AuthSessionSettings _settings;
 	base::Timer _saveDataTimer;
+	base::Timer _saveSharedMediaTimer;
 
 	TimeMs _shouldLockAt = 0;
 	base::Timer _autoLockTimer;
@@ -0,0 +1,102 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace base {
+namespace benchmark {
+
+// Headless benchmarks, built in the Benchmarks target together with
+// base/benchmarks_main.cpp and the application sources.
+//
+// Each case is a scripted scenario split into named steps. Every step
+// runs once for warm up and then a fixed amount of samples, reporting
+// the minimum and median time, the median allocations count per run and,
+// where the heap can be tracked, the median peak of the heap in use.
+// Cases must be deterministic: fixed fixtures, no network and no wall
+// clock dependent logic, so that the numbers can be compared with
+// a stored baseline.
+
+struct StepResult {
+	std::string name;
+	int64 minimum = 0; // mcs
+	int64 median = 0; // mcs
+	int64 allocations = 0;
+	int64 allocatedBytes = 0;
+	int64 peakHeapBytes = -1; // Above the heap in use before the run.
+	std::vector<std::pair<std::string, int64>> counters;
+};
+
+class Runner {
+public:
+	Runner(std::string caseName, int samples);
+
+	void step(const std::string &name, Fn<void()> method);
+
+	// Attaches a custom value to the last finished step.
+	void counter(const std::string &name, int64 value);
+
+	const std::vector<StepResult> &results() const {
+		return _results;
+	}
+
+private:
+	std::string _caseName;
+	int _samples = 0;
+	std::vector<StepResult> _results;
+
+};
+
+using Method = void(*)(Runner &runner);
+
+struct Case {
+	const char *name = nullptr;
+	Method method = nullptr;
+};
+
+bool Register(const char *name, Method method);
+const std::vector<Case> &Cases();
+
+// Implemented in base/benchmarks_main.cpp by replacing operator new.
+int64 AllocationsCount();
+int64 AllocatedBytes();
+
+// Implemented in base/benchmarks_main.cpp by replacing malloc and free,
+// so that QImage buffers and other C allocations are seen as well.
+// Only on Linux, HeapTracked() returns false elsewhere.
+bool HeapTracked();
+int64 HeapBytes();
+int64 HeapPeakBytes();
+void ResetHeapPeak();
+
+// Prevents the optimizer from throwing away a computed value:
+// all of its bytes are read through a volatile pointer.
+template <typename Value>
+inline void KeepAlive(const Value &value) {
+	static volatile unsigned char sink = 0;
+	const auto bytes = reinterpret_cast<const volatile unsigned char*>(
+		&value);
+	for (auto i = std::size_t(0); i != sizeof(Value); ++i) {
+		sink = sink ^ bytes[i];
+	}
+}
+
+} // namespace benchmark
+} // namespace base
+
+#define TDESKTOP_BENCHMARK(Name) \
+static void Benchmark_##Name(base::benchmark::Runner &runner); \
+static const auto BenchmarkRegistered_##Name = base::benchmark::Register( \
+	#Name, \
+	&Benchmark_##Name); \
+static void Benchmark_##Name(base::benchmark::Runner &runner)
@@ -0,0 +1,445 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/benchmark.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QJsonArray>
+#include <QtGui/QGuiApplication>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <new>
+
+#ifdef Q_OS_LINUX
+#include <malloc.h>
+#include <unistd.h>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *pointer);
+} // extern "C"
+#endif // Q_OS_LINUX
+
+#ifdef Q_OS_WIN
+#include <malloc.h>
+#endif // Q_OS_WIN
+
+namespace {
+
+constexpr auto kDefaultSamples = 9;
+constexpr auto kDefaultTolerance = 0.15;
+
+std::atomic<int64> Allocations = 0;
+std::atomic<int64> Allocated = 0;
+std::atomic<int64> HeapInUse = 0;
+std::atomic<int64> HeapPeak = 0;
+
+std::vector<base::benchmark::Case> &CasesList() {
+	static auto result = std::vector<base::benchmark::Case>();
+	return result;
+}
+
+int64 Now() {
+	using namespace std::chrono;
+	return duration_cast<microseconds>(
+		steady_clock::now().time_since_epoch()).count();
+}
+
+QString StepKey(const std::string &caseName, const std::string &stepName) {
+	return QString::fromStdString(caseName + '/' + stepName);
+}
+
+QJsonObject Serialize(
+		const std::string &caseName,
+		const base::benchmark::StepResult &result) {
+	auto object = QJsonObject();
+	object.insert("name", StepKey(caseName, result.name));
+	object.insert("minimum", double(result.minimum));
+	object.insert("median", double(result.median));
+	object.insert("allocations", double(result.allocations));
+	object.insert("allocated", double(result.allocatedBytes));
+	if (result.peakHeapBytes >= 0) {
+		object.insert("peak", double(result.peakHeapBytes));
+	}
+	for (const auto &[name, value] : result.counters) {
+		object.insert(QString::fromStdString(name), double(value));
+	}
+	return object;
+}
+
+std::map<QString, QJsonObject> ReadBaseline(const QString &path) {
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		std::cout << "Could not open baseline '"
+			<< path.toStdString()
+			<< "'." << std::endl;
+		return {};
+	}
+	auto error = QJsonParseError();
+	const auto document = QJsonDocument::fromJson(file.readAll(), &error);
+	if (error.error != QJsonParseError::NoError) {
+		std::cout << "Could not parse baseline '"
+			<< path.toStdString()
+			<< "': "
+			<< error.errorString().toStdString() << std::endl;
+		return {};
+	}
+	auto result = std::map<QString, QJsonObject>();
+	for (const auto &value : document.object().value("steps").toArray()) {
+		const auto object = value.toObject();
+		result.emplace(object.value("name").toString(), object);
+	}
+	return result;
+}
+
+bool WriteResults(const QString &path, const QJsonArray &steps) {
+	auto object = QJsonObject();
+	object.insert("steps", steps);
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		std::cout << "Could not write '"
+			<< path.toStdString()
+			<< "'." << std::endl;
+		return false;
+	}
+	file.write(QJsonDocument(object).toJson(QJsonDocument::Indented));
+	return true;
+}
+
+#ifdef Q_OS_LINUX
+
+void *HeapAllocated(void *result) {
+	if (result) {
+		const auto now = (HeapInUse += malloc_usable_size(result));
+		auto peak = HeapPeak.load();
+		while (now > peak && !HeapPeak.compare_exchange_weak(peak, now)) {
+		}
+	}
+	return result;
+}
+
+void HeapFreed(void *pointer) {
+	if (pointer) {
+		HeapInUse -= malloc_usable_size(pointer);
+	}
+}
+
+#endif // Q_OS_LINUX
+
+} // namespace
+
+#ifdef Q_OS_LINUX
+
+extern "C" {
+
+void *malloc(size_t size) {
+	return HeapAllocated(__libc_malloc(size));
+}
+
+void *calloc(size_t count, size_t size) {
+	return HeapAllocated(__libc_calloc(count, size));
+}
+
+void *realloc(void *pointer, size_t size) {
+	const auto was = pointer ? malloc_usable_size(pointer) : size_t(0);
+	const auto result = __libc_realloc(pointer, size);
+	if (result || !size) {
+		HeapInUse -= was;
+		HeapAllocated(result);
+	}
+	return result;
+}
+
+void *memalign(size_t alignment, size_t size) {
+	return HeapAllocated(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void **result, size_t alignment, size_t size) {
+	*result = HeapAllocated(__libc_memalign(alignment, size));
+	return *result ? 0 : ENOMEM;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+	return HeapAllocated(__libc_memalign(alignment, size));
+}
+
+void *valloc(size_t size) {
+	const auto page = size_t(sysconf(_SC_PAGESIZE));
+	return HeapAllocated(__libc_memalign(page, size));
+}
+
+void *pvalloc(size_t size) {
+	const auto page = size_t(sysconf(_SC_PAGESIZE));
+	const auto rounded = ((size + page - 1) / page) * page;
+	return HeapAllocated(__libc_memalign(page, rounded ? rounded : page));
+}
+
+void free(void *pointer) {
+	HeapFreed(pointer);
+	__libc_free(pointer);
+}
+
+} // extern "C"
+
+#endif // Q_OS_LINUX
+
+void *operator new(std::size_t size) {
+	++Allocations;
+	Allocated += size;
+	if (const auto result = std::malloc(size ? size : 1)) {
+		return result;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t size) noexcept {
+	std::free(pointer);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+	++Allocations;
+	Allocated += size;
+	const auto align = std::max(
+		static_cast<std::size_t>(alignment),
+		sizeof(void*));
+#ifdef Q_OS_WIN
+	if (const auto result = _aligned_malloc(size ? size : 1, align)) {
+		return result;
+	}
+#else // Q_OS_WIN
+	auto result = (void*)nullptr;
+	if (!posix_memalign(&result, align, size ? size : 1)) {
+		return result;
+	}
+#endif // Q_OS_WIN
+	throw std::bad_alloc();
+}
+
+void operator delete(void *pointer, std::align_val_t alignment) noexcept {
+#ifdef Q_OS_WIN
+	_aligned_free(pointer);
+#else // Q_OS_WIN
+	std::free(pointer);
+#endif // Q_OS_WIN
+}
+
+void operator delete(
+		void *pointer,
+		std::size_t size,
+		std::align_val_t alignment) noexcept {
+	operator delete(pointer, alignment);
+}
+
+namespace base {
+namespace benchmark {
+
+Runner::Runner(std::string caseName, int samples)
+: _caseName(std::move(caseName))
+, _samples(samples) {
+}
+
+void Runner::step(const std::string &name, Fn<void()> method) {
+	Expects(_samples > 0);
+
+	method();
+
+	auto durations = std::vector<int64>();
+	auto allocations = std::vector<int64>();
+	auto allocated = std::vector<int64>();
+	auto peaks = std::vector<int64>();
+	for (auto i = 0; i != _samples; ++i) {
+		const auto allocationsWas = AllocationsCount();
+		const auto allocatedWas = AllocatedBytes();
+		const auto heapWas = HeapBytes();
+		ResetHeapPeak();
+		const auto start = Now();
+		method();
+		durations.push_back(Now() - start);
+		allocations.push_back(AllocationsCount() - allocationsWas);
+		allocated.push_back(AllocatedBytes() - allocatedWas);
+		peaks.push_back(HeapPeakBytes() - heapWas);
+	}
+	const auto median = [](std::vector<int64> &values) {
+		ranges::sort(values);
+		return values[values.size() / 2];
+	};
+	auto result = StepResult();
+	result.name = name;
+	result.minimum = *ranges::min_element(durations);
+	result.median = median(durations);
+	result.allocations = median(allocations);
+	result.allocatedBytes = median(allocated);
+	if (HeapTracked()) {
+		result.peakHeapBytes = median(peaks);
+	}
+	_results.push_back(result);
+
+	std::cout << std::left << std::setw(48) << (_caseName + '/' + name)
+		<< std::right
+		<< std::setw(12) << result.median << " mcs"
+		<< std::setw(12) << result.minimum << " mcs (min)"
+		<< std::setw(10) << result.allocations << " allocs";
+	if (result.peakHeapBytes >= 0) {
+		std::cout << std::setw(12) << result.peakHeapBytes << " peak bytes";
+	}
+	std::cout << std::endl;
+}
+
+void Runner::counter(const std::string &name, int64 value) {
+	Expects(!_results.empty());
+
+	_results.back().counters.emplace_back(name, value);
+
+	std::cout << std::left << std::setw(48) << ("  " + name)
+		<< std::right
+		<< std::setw(12) << value
+		<< std::endl;
+}
+
+bool Register(const char *name, Method method) {
+	CasesList().push_back({ name, method });
+	return true;
+}
+
+const std::vector<Case> &Cases() {
+	return CasesList();
+}
+
+int64 AllocationsCount() {
+	return Allocations.load();
+}
+
+int64 AllocatedBytes() {
+	return Allocated.load();
+}
+
+bool HeapTracked() {
+#ifdef Q_OS_LINUX
+	return true;
+#else // Q_OS_LINUX
+	return false;
+#endif // Q_OS_LINUX
+}
+
+int64 HeapBytes() {
+	return HeapInUse.load();
+}
+
+int64 HeapPeakBytes() {
+	return HeapPeak.load();
+}
+
+void ResetHeapPeak() {
+	HeapPeak = HeapInUse.load();
+}
+
+} // namespace benchmark
+} // namespace base
+
+// Usage: Benchmarks [--filter <text>] [--samples <count>]
+//   [--output <results.json>]
+//   [--baseline <results.json> [--tolerance <fraction>]]
+//
+// With a baseline the exit code is non zero if any step became slower
+// than the tolerance allows, started to allocate more or to hold more
+// heap at its peak than the tolerance allows.
+int main(int argc, char *argv[]) {
+	// Images and fonts need a gui application, use "-platform offscreen".
+	QGuiApplication application(argc, argv);
+
+	auto filter = QString();
+	auto output = QString();
+	auto baselinePath = QString();
+	auto samples = kDefaultSamples;
+	auto tolerance = kDefaultTolerance;
+	const auto arguments = application.arguments();
+	for (auto i = 1; i < arguments.size(); ++i) {
+		const auto &argument = arguments[i];
+		const auto hasValue = (i + 1 < arguments.size());
+		if (argument == "--filter" && hasValue) {
+			filter = arguments[++i];
+		} else if (argument == "--samples" && hasValue) {
+			samples = std::max(arguments[++i].toInt(), 1);
+		} else if (argument == "--output" && hasValue) {
+			output = arguments[++i];
+		} else if (argument == "--baseline" && hasValue) {
+			baselinePath = arguments[++i];
+		} else if (argument == "--tolerance" && hasValue) {
+			tolerance = arguments[++i].toDouble();
+		}
+	}
+
+	auto cases = base::benchmark::Cases();
+	ranges::sort(cases, [](const auto &a, const auto &b) {
+		return strcmp(a.name, b.name) < 0;
+	});
+
+	auto steps = QJsonArray();
+	const auto baseline = baselinePath.isEmpty()
+		? std::map<QString, QJsonObject>()
+		: ReadBaseline(baselinePath);
+	auto regressions = 0;
+	for (const auto &entry : cases) {
+		if (!filter.isEmpty()
+			&& !QString::fromLatin1(entry.name).contains(filter)) {
+			continue;
+		}
+		auto runner = base::benchmark::Runner(entry.name, samples);
+		entry.method(runner);
+		for (const auto &result : runner.results()) {
+			steps.push_back(Serialize(entry.name, result));
+
+			const auto i = baseline.find(StepKey(entry.name, result.name));
+			if (i == end(baseline)) {
+				continue;
+			}
+			const auto median = int64(i->second.value("median").toDouble());
+			const auto allocations = int64(
+				i->second.value("allocations").toDouble());
+			if (result.median > median * (1. + tolerance)) {
+				std::cout << "REGRESSION: " << entry.name << '/' << result.name
+					<< " median " << median << " -> " << result.median
+					<< " mcs" << std::endl;
+				++regressions;
+			}
+			if (result.allocations > allocations) {
+				std::cout << "REGRESSION: " << entry.name << '/' << result.name
+					<< " allocations " << allocations
+					<< " -> " << result.allocations << std::endl;
+				++regressions;
+			}
+			const auto peak = int64(i->second.value("peak").toDouble(-1));
+			if (peak >= 0
+				&& result.peakHeapBytes > peak * (1. + tolerance)) {
+				std::cout << "REGRESSION: " << entry.name << '/' << result.name
+					<< " peak heap " << peak
+					<< " -> " << result.peakHeapBytes << " bytes" << std::endl;
+				++regressions;
+			}
+		}
+	}
+	if (!output.isEmpty() && !WriteResults(output, steps)) {
+		return -1;
+	}
+	return regressions ? 1 : 0;
+}
@@ -7,6 +7,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "base/concurrent_timer.h"
 
+#include "base/timer_wheel.h"
+
 #include <QtCore/QThread>
 #include <QtCore/QCoreApplication>
 
@@ -75,7 +77,7 @@ CancelTimerEvent::CancelTimerEvent() : QEvent(kCancelTimerEvent) {
 
 } // namespace
 
-class TimerObject : public QObject {
+class TimerObject : public QObject, private TimerWheelEntry {
 public:
 	TimerObject(
 		not_null<QThread*> thread,
@@ -86,6 +88,7 @@ protected:
 	bool event(QEvent *e) override;
 
 private:
+	void timerFired() override;
 	void callDelayed(not_null<CallDelayedEvent*> e);
 	void callNow();
 	void cancel();
@@ -93,7 +96,6 @@ private:
 
 	FnMut<void()> _next;
 	Fn<void()> _adjust;
-	int _timerId = 0;
 
 };
 
@@ -101,7 +103,8 @@ TimerObject::TimerObject(
 		not_null<QThread*> thread,
 		not_null<QObject*> adjuster,
 		Fn<void()> adjust)
-: _adjust(std::move(adjust)) {
+: TimerWheelEntry(thread)
+, _adjust(std::move(adjust)) {
 	moveToThread(thread);
 	connect(
 		adjuster,
@@ -120,9 +123,6 @@ bool TimerObject::event(QEvent *e) {
 	case kCancelTimerEvent:
 		cancel();
 		return true;
-	case QEvent::Timer:
-		callNow();
-		return true;
 	}
 	return QObject::event(e);
 }
@@ -134,16 +134,18 @@ void TimerObject::callDelayed(not_null<CallDelayedEvent*> e) {
 	const auto type = e->type();
 	_next = e->takeMethod();
 	if (timeout > 0) {
-		_timerId = startTimer(timeout, type);
+		schedule(timeout, type);
 	} else {
 		base::take(_next)();
 	}
 }
 
+void TimerObject::timerFired() {
+	callNow();
+}
+
 void TimerObject::cancel() {
-	if (const auto id = base::take(_timerId)) {
-		killTimer(id);
-	}
+	unschedule();
 	_next = nullptr;
 }
 
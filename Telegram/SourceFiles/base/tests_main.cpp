@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 int (*TestForkedMethod)()/* = nullptr*/;
 
+#ifndef TDESKTOP_APP_TESTS
 namespace base {
 namespace assertion {
 
@@ -22,6 +23,7 @@ void log(const char *message, const char *file, int line) {
 
 } // namespace assertion
 } // namespace base
+#endif // !TDESKTOP_APP_TESTS
 
 namespace Catch {
 
@@ -7,84 +7,62 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "base/timer.h"
 
-#include <QtCore/QTimerEvent>
-
 namespace base {
-namespace {
 
-QObject *TimersAdjuster() {
-	static QObject adjuster;
-	return &adjuster;
-}
+class DelayedCallTimer::Call final : public details::TimerWheelEntry {
+public:
+	Call(
+		not_null<DelayedCallTimer*> owner,
+		int id,
+		FnMut<void()> callback);
+
+	FnMut<void()> takeCallback();
 
-} // namespace
+private:
+	void timerFired() override;
+
+	const not_null<DelayedCallTimer*> _owner;
+	const int _id = 0;
+	FnMut<void()> _callback;
+
+};
 
 Timer::Timer(
 	not_null<QThread*> thread,
 	Fn<void()> callback)
-: Timer(std::move(callback)) {
-	moveToThread(thread);
+: TimerWheelEntry(thread)
+, _callback(std::move(callback))
+, _type(Qt::PreciseTimer) {
+	setRepeat(Repeat::Interval);
 }
 
 Timer::Timer(Fn<void()> callback)
-: QObject(nullptr)
-, _callback(std::move(callback))
-, _type(Qt::PreciseTimer)
-, _adjusted(false) {
+: _callback(std::move(callback))
+, _type(Qt::PreciseTimer) {
 	setRepeat(Repeat::Interval);
-	connect(
-		TimersAdjuster(),
-		&QObject::destroyed,
-		this,
-		[this] { adjust(); },
-		Qt::QueuedConnection);
 }
 
 void Timer::start(TimeMs timeout, Qt::TimerType type, Repeat repeat) {
-	cancel();
-
 	_type = type;
 	setRepeat(repeat);
-	_adjusted = false;
 	setTimeout(timeout);
-	_timerId = startTimer(_timeout, _type);
-	if (_timerId) {
-		_next = crl::time() + _timeout;
-	} else {
-		_next = 0;
-	}
+	schedule(_timeout, _type);
 }
 
 void Timer::cancel() {
-	if (isActive()) {
-		killTimer(base::take(_timerId));
-	}
+	unschedule();
 }
 
 TimeMs Timer::remainingTime() const {
 	if (!isActive()) {
 		return -1;
 	}
-	auto now = crl::time();
-	return (_next > now) ? (_next - now) : TimeMs(0);
+	const auto now = crl::time();
+	return (deadline() > now) ? (deadline() - now) : TimeMs(0);
 }
 
 void Timer::Adjust() {
-	QObject emitter;
-	connect(
-		&emitter,
-		&QObject::destroyed,
-		TimersAdjuster(),
-		&QObject::destroyed);
-}
-
-void Timer::adjust() {
-	auto remaining = remainingTime();
-	if (remaining >= 0) {
-		cancel();
-		_timerId = startTimer(remaining, _type);
-		_adjusted = true;
-	}
+	details::AdjustTimerWheels();
 }
 
 void Timer::setTimeout(TimeMs timeout) {
@@ -97,15 +75,9 @@ int Timer::timeout() const {
 	return _timeout;
 }
 
-void Timer::timerEvent(QTimerEvent *e) {
+void Timer::timerFired() {
 	if (repeat() == Repeat::Interval) {
-		if (_adjusted) {
-			start(_timeout, _type, repeat());
-		} else {
-			_next = crl::time() + _timeout;
-		}
-	} else {
-		cancel();
+		scheduleNext(_timeout, _type);
 	}
 
 	if (_callback) {
@@ -113,6 +85,27 @@ void Timer::timerEvent(QTimerEvent *e) {
 	}
 }
 
+DelayedCallTimer::Call::Call(
+	not_null<DelayedCallTimer*> owner,
+	int id,
+	FnMut<void()> callback)
+: _owner(owner)
+, _id(id)
+, _callback(std::move(callback)) {
+}
+
+FnMut<void()> DelayedCallTimer::Call::takeCallback() {
+	return base::take(_callback);
+}
+
+void DelayedCallTimer::Call::timerFired() {
+	_owner->fired(_id);
+}
+
+DelayedCallTimer::DelayedCallTimer() = default;
+
+DelayedCallTimer::~DelayedCallTimer() = default;
+
 int DelayedCallTimer::call(
 		TimeMs timeout,
 		FnMut<void()> callback,
@@ -122,28 +115,27 @@ int DelayedCallTimer::call(
 	if (!callback) {
 		return 0;
 	}
-	auto timerId = startTimer(static_cast<int>(timeout), type);
-	if (timerId) {
-		_callbacks.emplace(timerId, std::move(callback));
+	if (++_lastCallId <= 0) {
+		_lastCallId = 1;
 	}
-	return timerId;
+	const auto id = _lastCallId;
+	auto call = std::make_unique<Call>(this, id, std::move(callback));
+	call->schedule(timeout, type);
+	_calls.emplace(id, std::move(call));
+	return id;
 }
 
 void DelayedCallTimer::cancel(int callId) {
 	if (callId) {
-		killTimer(callId);
-		_callbacks.remove(callId);
+		_calls.remove(callId);
 	}
 }
 
-void DelayedCallTimer::timerEvent(QTimerEvent *e) {
-	auto timerId = e->timerId();
-	killTimer(timerId);
-
-	auto it = _callbacks.find(timerId);
-	if (it != _callbacks.end()) {
-		auto callback = std::move(it->second);
-		_callbacks.erase(it);
+void DelayedCallTimer::fired(int callId) {
+	const auto i = _calls.find(callId);
+	if (i != _calls.end()) {
+		auto callback = i->second->takeCallback();
+		_calls.erase(i);
 
 		callback();
 	}
@@ -7,15 +7,18 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
-#include <QtCore/QObject>
 #include <QtCore/QThread>
 #include "base/observer.h"
 #include "base/flat_map.h"
+#include "base/timer_wheel.h"
 
 namespace base {
 
-class Timer final : private QObject {
+// Timers are driven by the timer wheel of their owner thread, they must
+// be started and cancelled only on that thread.
+class Timer final : private details::TimerWheelEntry {
 public:
+	// Owned by the given thread, the current one by default.
 	explicit Timer(
 		not_null<QThread*> thread,
 		Fn<void()> callback = nullptr);
@@ -47,7 +50,7 @@ public:
 	}
 
 	bool isActive() const {
-		return (_timerId != 0);
+		return scheduled();
 	}
 
 	void cancel();
@@ -55,16 +58,13 @@ public:
 
 	static void Adjust();
 
-protected:
-	void timerEvent(QTimerEvent *e) override;
-
 private:
 	enum class Repeat : unsigned {
 		Interval   = 0,
 		SingleShot = 1,
 	};
 	void start(TimeMs timeout, Qt::TimerType type, Repeat repeat);
-	void adjust();
+	void timerFired() override;
 
 	void setTimeout(TimeMs timeout);
 	int timeout() const;
@@ -77,18 +77,20 @@ private:
 	}
 
 	Fn<void()> _callback;
-	TimeMs _next = 0;
 	int _timeout = 0;
-	int _timerId = 0;
 
 	Qt::TimerType _type : 2;
-	bool _adjusted : 1;
 	unsigned _repeat : 1;
 
 };
 
-class DelayedCallTimer final : private QObject {
+class DelayedCallTimer final {
 public:
+	DelayedCallTimer();
+	DelayedCallTimer(const DelayedCallTimer &other) = delete;
+	DelayedCallTimer &operator=(const DelayedCallTimer &other) = delete;
+	~DelayedCallTimer();
+
 	int call(TimeMs timeout, FnMut<void()> callback) {
 		return call(
 			timeout,
@@ -102,11 +104,12 @@ public:
 		Qt::TimerType type);
 	void cancel(int callId);
 
-protected:
-	void timerEvent(QTimerEvent *e) override;
-
 private:
-	base::flat_map<int, FnMut<void()>> _callbacks;
+	class Call;
+	void fired(int callId);
+
+	base::flat_map<int, std::unique_ptr<Call>> _calls;
+	int _lastCallId = 0;
 
 };
 
@@ -0,0 +1,453 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/timer_wheel.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QTimerEvent>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace base {
+namespace details {
+namespace {
+
+constexpr auto kSlotsCount = TimerWheel::kSlotsCount;
+constexpr auto kLevelBits = TimerWheel::kLevelBits;
+constexpr auto kLevelsCount = TimerWheel::kLevelsCount;
+constexpr auto kRange = TimerWheel::kRange;
+constexpr auto kSlotMask = TimeMs(kSlotsCount - 1);
+constexpr auto kMaxCoarseGranularity = TimeMs(1024);
+constexpr auto kUnleveled = -1;
+constexpr auto kAdjustEvent = QEvent::Type(QEvent::User + 1);
+
+class WheelTimer;
+
+// Timers of all the threads, AdjustTimerWheels() posts to each of them.
+std::mutex &TimersMutex() {
+	static auto result = std::mutex();
+	return result;
+}
+
+std::vector<WheelTimer*> &Timers() {
+	static auto result = std::vector<WheelTimer*>();
+	return result;
+}
+
+TimeMs RoundDeadline(TimeMs deadline, TimeMs timeout, Qt::TimerType type) {
+	if (type == Qt::PreciseTimer) {
+		return deadline;
+	}
+	const auto slack = std::min(timeout / 20, kMaxCoarseGranularity);
+	auto granularity = TimeMs(1);
+	while (granularity * 2 <= slack) {
+		granularity *= 2;
+	}
+	return ((deadline + granularity - 1) / granularity) * granularity;
+}
+
+int LowestBit(uint64 value) {
+	Expects(value != 0);
+
+	auto result = 0;
+	while (!(value & 0xFFU)) {
+		value >>= 8;
+		result += 8;
+	}
+	while (!(value & 1U)) {
+		value >>= 1;
+		++result;
+	}
+	return result;
+}
+
+// Drives the wheel of one thread with a single precise Qt timer.
+class WheelTimer final : public QObject {
+public:
+	explicit WheelTimer(Fn<void()> advance);
+	~WheelTimer();
+
+	void arm(TimeMs wake);
+
+protected:
+	bool event(QEvent *e) override;
+	void timerEvent(QTimerEvent *e) override;
+
+private:
+	void stop();
+
+	const Fn<void()> _advance;
+	int _timerId = 0;
+
+};
+
+WheelTimer::WheelTimer(Fn<void()> advance) : _advance(std::move(advance)) {
+	std::lock_guard<std::mutex> lock(TimersMutex());
+	Timers().push_back(this);
+}
+
+WheelTimer::~WheelTimer() {
+	{
+		std::lock_guard<std::mutex> lock(TimersMutex());
+		auto &timers = Timers();
+		timers.erase(std::remove(begin(timers), end(timers), this), end(timers));
+	}
+	stop();
+}
+
+void WheelTimer::arm(TimeMs wake) {
+	stop();
+	if (wake < 0) {
+		return;
+	}
+	const auto timeout = std::clamp(
+		wake - crl::time(),
+		TimeMs(0),
+		TimeMs(std::numeric_limits<int>::max()));
+	_timerId = startTimer(int(timeout), Qt::PreciseTimer);
+}
+
+void WheelTimer::stop() {
+	if (const auto id = base::take(_timerId)) {
+		killTimer(id);
+	}
+}
+
+bool WheelTimer::event(QEvent *e) {
+	if (e->type() == kAdjustEvent) {
+		_advance();
+		return true;
+	}
+	return QObject::event(e);
+}
+
+void WheelTimer::timerEvent(QTimerEvent *e) {
+	_advance();
+}
+
+struct ThreadWheel {
+	ThreadWheel();
+
+	// The wheel is destroyed first, it doesn't arm the timer then.
+	WheelTimer timer;
+	TimerWheel wheel;
+};
+
+ThreadWheel::ThreadWheel()
+: timer([this] { wheel.advance(); })
+, wheel(
+	[]() -> TimeMs { return crl::time(); },
+	[this](TimeMs wake) { timer.arm(wake); }) {
+}
+
+} // namespace
+
+TimerWheel::TimerWheel(Clock clock, Arm arm)
+: _clock(clock)
+, _arm(std::move(arm))
+, _current(_clock()) {
+	_due.level = kUnleveled;
+	for (auto level = 0; level != kLevelsCount; ++level) {
+		for (auto index = 0; index != kSlotsCount; ++index) {
+			auto &slot = _levels[level].slots[index];
+			slot.level = level;
+			slot.index = index;
+		}
+	}
+}
+
+TimerWheel::~TimerWheel() {
+	// The thread is finishing, its timers won't be fired anymore.
+	while (const auto entry = _due.first) {
+		unlink(entry);
+	}
+	for (auto &level : _levels) {
+		for (auto &slot : level.slots) {
+			while (const auto entry = slot.first) {
+				unlink(entry);
+			}
+		}
+	}
+}
+
+TimerWheel &TimerWheel::Current() {
+	static thread_local ThreadWheel result;
+	return result.wheel;
+}
+
+void TimerWheel::schedule(
+		not_null<TimerWheelEntry*> entry,
+		TimeMs deadline) {
+	if (entry->_slot) {
+		unlink(entry);
+	}
+	if (!_scheduled && !_advancing) {
+		// Nothing to cascade, the wheel may jump to the current time.
+		accumulate_max(_current, now());
+	}
+	entry->_wheel = this;
+	entry->_deadline = deadline;
+	if (deadline <= _current) {
+		link(entry, &_due);
+	} else {
+		insert(entry, _current + 1);
+	}
+	if (!_advancing) {
+		rearm();
+	}
+}
+
+void TimerWheel::unschedule(not_null<TimerWheelEntry*> entry) {
+	if (entry->_slot) {
+		unlink(entry);
+	}
+	if (!_scheduled && !_advancing) {
+		rearm();
+	}
+}
+
+void TimerWheel::advance() {
+	_armedWake = -1;
+	advanceTill(now());
+	rearm();
+}
+
+void TimerWheel::insert(
+		not_null<TimerWheelEntry*> entry,
+		TimeMs earliest) {
+	const auto expires = std::max(entry->_deadline, earliest);
+	const auto delta = std::min(expires - _current, kRange - 1);
+	auto level = 0;
+	while (delta >= (TimeMs(1) << (kLevelBits * (level + 1)))) {
+		++level;
+	}
+	const auto at = _current + delta;
+	const auto index = int((at >> (kLevelBits * level)) & kSlotMask);
+	link(entry, &_levels[level].slots[index]);
+}
+
+void TimerWheel::link(
+		not_null<TimerWheelEntry*> entry,
+		not_null<TimerWheelSlot*> slot) {
+	Expects(entry->_slot == nullptr);
+
+	entry->_slot = slot;
+	entry->_previous = nullptr;
+	entry->_next = slot->first;
+	if (slot->first) {
+		slot->first->_previous = entry;
+	}
+	slot->first = entry;
+	if (slot->level != kUnleveled) {
+		_levels[slot->level].occupied |= (uint64(1) << slot->index);
+	}
+	++_scheduled;
+}
+
+void TimerWheel::unlink(not_null<TimerWheelEntry*> entry) {
+	Expects(entry->_slot != nullptr);
+
+	const auto slot = entry->_slot;
+	if (entry->_previous) {
+		entry->_previous->_next = entry->_next;
+	} else {
+		slot->first = entry->_next;
+	}
+	if (entry->_next) {
+		entry->_next->_previous = entry->_previous;
+	}
+	entry->_slot = nullptr;
+	entry->_previous = entry->_next = nullptr;
+	if (!slot->first && slot->level != kUnleveled) {
+		_levels[slot->level].occupied &= ~(uint64(1) << slot->index);
+	}
+	--_scheduled;
+}
+
+TimerWheelEntry *TimerWheel::detach(not_null<TimerWheelSlot*> slot) {
+	const auto result = base::take(slot->first);
+	for (auto entry = result; entry; entry = entry->_next) {
+		entry->_slot = nullptr;
+		--_scheduled;
+	}
+	_levels[slot->level].occupied &= ~(uint64(1) << slot->index);
+	return result;
+}
+
+void TimerWheel::advanceTill(TimeMs now) {
+	_advancing = true;
+	fire(&_due);
+	while (_current < now) {
+		const auto next = _current + 1;
+		if (!(next & kSlotMask)) {
+			_current = next;
+			cascade(1);
+			fire(&_levels[0].slots[0]);
+			continue;
+		}
+
+		// Skip the empty slots up to the end of the lowest level.
+		const auto from = int(next & kSlotMask);
+		const auto occupied = (_levels[0].occupied >> from) << from;
+		if (!occupied) {
+			_current = std::min(_current | kSlotMask, now);
+			continue;
+		}
+		const auto target = (_current & ~kSlotMask) + LowestBit(occupied);
+		if (target > now) {
+			_current = now;
+			break;
+		}
+		_current = target;
+		fire(&_levels[0].slots[target & kSlotMask]);
+	}
+	_advancing = false;
+}
+
+void TimerWheel::cascade(int level) {
+	if (level >= kLevelsCount) {
+		return;
+	}
+	const auto index = int((_current >> (kLevelBits * level)) & kSlotMask);
+	auto entry = detach(&_levels[level].slots[index]);
+	while (entry) {
+		const auto next = entry->_next;
+		entry->_previous = entry->_next = nullptr;
+
+		// The entries due right now go to the slot fired in this tick.
+		insert(entry, _current);
+		entry = next;
+	}
+	if (!index) {
+		cascade(level + 1);
+	}
+}
+
+void TimerWheel::fire(not_null<TimerWheelSlot*> slot) {
+	if (!slot->first) {
+		return;
+	}
+
+	// Callbacks may cancel other entries of the same slot.
+	auto firing = TimerWheelSlot();
+	firing.level = kUnleveled;
+	firing.first = slot->first;
+	for (auto entry = slot->first; entry; entry = entry->_next) {
+		entry->_slot = &firing;
+	}
+	slot->first = nullptr;
+	if (slot->level != kUnleveled) {
+		_levels[slot->level].occupied &= ~(uint64(1) << slot->index);
+	}
+
+	while (const auto entry = firing.first) {
+		unlink(entry);
+		entry->timerFired();
+	}
+}
+
+TimeMs TimerWheel::nextWake() const {
+	if (!_scheduled) {
+		return -1;
+	} else if (_due.first) {
+		return _current;
+	}
+	auto result = std::numeric_limits<TimeMs>::max();
+	for (auto level = 0; level != kLevelsCount; ++level) {
+		const auto occupied = _levels[level].occupied;
+		if (!occupied) {
+			continue;
+		}
+		// Slots of the level are visited in the order index + 1, ...,
+		// 63, 0, ..., index, the current one is 64 slots away.
+		const auto shift = kLevelBits * level;
+		const auto index = int((_current >> shift) & kSlotMask);
+		const auto rotate = index + 1;
+		const auto rotated = (rotate == kSlotsCount)
+			? occupied
+			: ((occupied >> rotate) | (occupied << (kSlotsCount - rotate)));
+		const auto distance = LowestBit(rotated) + 1;
+		const auto wake = ((_current >> shift) + distance) << shift;
+		accumulate_min(result, wake);
+	}
+	return result;
+}
+
+void TimerWheel::rearm() {
+	const auto wake = nextWake();
+	if (wake >= 0 && _armedWake >= 0 && _armedWake <= wake) {
+		return;
+	}
+	_armedWake = wake;
+	_arm(wake);
+}
+
+TimerWheelEntry::TimerWheelEntry()
+: _thread(QThread::currentThread()) {
+}
+
+TimerWheelEntry::TimerWheelEntry(not_null<QThread*> thread)
+: _thread(thread) {
+}
+
+TimerWheelEntry::TimerWheelEntry(not_null<TimerWheel*> wheel)
+: _wheel(wheel) {
+}
+
+TimerWheelEntry::~TimerWheelEntry() {
+	unschedule();
+}
+
+TimerWheel &TimerWheelEntry::wheel() {
+	Expects(!_thread || QThread::currentThread() == _thread);
+
+	if (!_wheel) {
+		_wheel = &TimerWheel::Current();
+	}
+	return *_wheel;
+}
+
+void TimerWheelEntry::schedule(TimeMs timeout, Qt::TimerType type) {
+	Expects(timeout >= 0);
+
+	auto &wheel = this->wheel();
+	const auto deadline = RoundDeadline(
+		wheel.now() + timeout,
+		timeout,
+		type);
+	wheel.schedule(this, deadline);
+}
+
+void TimerWheelEntry::scheduleNext(TimeMs timeout, Qt::TimerType type) {
+	Expects(timeout >= 0);
+
+	auto &wheel = this->wheel();
+	const auto now = wheel.now();
+	const auto next = _deadline + timeout;
+	const auto deadline = RoundDeadline(
+		(next >= now) ? next : (now + timeout),
+		timeout,
+		type);
+	wheel.schedule(this, deadline);
+}
+
+void TimerWheelEntry::unschedule() {
+	if (_slot) {
+		wheel().unschedule(this);
+	}
+}
+
+void AdjustTimerWheels() {
+	std::lock_guard<std::mutex> lock(TimersMutex());
+	for (const auto timer : Timers()) {
+		QCoreApplication::postEvent(timer, new QEvent(kAdjustEvent));
+	}
+}
+
+} // namespace details
+} // namespace base
@@ -0,0 +1,154 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+#include <QtCore/QThread>
+
+#include <array>
+
+namespace base {
+namespace details {
+
+class TimerWheel;
+
+struct TimerWheelSlot;
+
+// An entry is fired by the timer wheel of its owner thread and all of
+// its methods must be called from that thread.
+class TimerWheelEntry {
+public:
+	// Owned by the current thread.
+	TimerWheelEntry();
+
+	// Owned by the given thread, it may be constructed on another one.
+	explicit TimerWheelEntry(not_null<QThread*> thread);
+
+	// Fired by the given wheel, not bound to any thread.
+	explicit TimerWheelEntry(not_null<TimerWheel*> wheel);
+
+	TimerWheelEntry(const TimerWheelEntry &other) = delete;
+	TimerWheelEntry &operator=(const TimerWheelEntry &other) = delete;
+
+	// Coarse timers may fire up to 5% later to be fired together.
+	void schedule(TimeMs timeout, Qt::TimerType type);
+	void unschedule();
+
+	// For interval timers, called from timerFired(). The next deadline
+	// is counted from the previous one, so that the interval doesn't
+	// drift by the time it takes to fire. If it is already in the past,
+	// as after a system sleep, it is counted from the current time.
+	void scheduleNext(TimeMs timeout, Qt::TimerType type);
+
+	bool scheduled() const {
+		return (_slot != nullptr);
+	}
+
+	// In the wheel clock units, valid only while scheduled.
+	TimeMs deadline() const {
+		return _deadline;
+	}
+
+protected:
+	virtual ~TimerWheelEntry();
+
+	virtual void timerFired() = 0;
+
+private:
+	friend class TimerWheel;
+
+	TimerWheel &wheel();
+
+	QThread *_thread = nullptr;
+	TimerWheel *_wheel = nullptr;
+	TimerWheelSlot *_slot = nullptr;
+	TimerWheelEntry *_previous = nullptr;
+	TimerWheelEntry *_next = nullptr;
+	TimeMs _deadline = 0;
+
+};
+
+struct TimerWheelSlot {
+	TimerWheelEntry *first = nullptr;
+	int level = 0;
+	int index = 0;
+};
+
+// Hierarchical timer wheel. Scheduling and unscheduling an entry is
+// O(1) and entries due in the same millisecond are fired together.
+//
+// Every thread has one wheel, returned by Current(), that uses
+// crl::time() and is driven by a single Qt timer. Other wheels can use
+// any clock, the arm callback receives the clock value at which
+// advance() should be called next or -1 if nothing is scheduled.
+class TimerWheel final {
+public:
+	using Clock = TimeMs(*)();
+	using Arm = Fn<void(TimeMs wake)>;
+
+	TimerWheel(Clock clock, Arm arm);
+	TimerWheel(const TimerWheel &other) = delete;
+	TimerWheel &operator=(const TimerWheel &other) = delete;
+	~TimerWheel();
+
+	static TimerWheel &Current();
+
+	TimeMs now() const {
+		return _clock();
+	}
+
+	void schedule(not_null<TimerWheelEntry*> entry, TimeMs deadline);
+	void unschedule(not_null<TimerWheelEntry*> entry);
+
+	// Fires everything that is due by now() and re-arms.
+	void advance();
+
+	// Four levels of 64 slots with a 1 ms tick cover about 4.6 hours,
+	// longer timeouts are parked in the last slot and cascaded again.
+	static constexpr auto kLevelBits = 6;
+	static constexpr auto kSlotsCount = (1 << kLevelBits);
+	static constexpr auto kLevelsCount = 4;
+	static constexpr auto kRange = (TimeMs(1) << (kLevelBits * kLevelsCount));
+
+private:
+	struct Level {
+		std::array<TimerWheelSlot, kSlotsCount> slots;
+		uint64 occupied = 0;
+	};
+
+	void insert(not_null<TimerWheelEntry*> entry, TimeMs earliest);
+	void link(
+		not_null<TimerWheelEntry*> entry,
+		not_null<TimerWheelSlot*> slot);
+	void unlink(not_null<TimerWheelEntry*> entry);
+	TimerWheelEntry *detach(not_null<TimerWheelSlot*> slot);
+
+	void advanceTill(TimeMs now);
+	void cascade(int level);
+	void fire(not_null<TimerWheelSlot*> slot);
+	TimeMs nextWake() const;
+	void rearm();
+
+	const Clock _clock;
+	const Arm _arm;
+
+	std::array<Level, kLevelsCount> _levels;
+	TimerWheelSlot _due; // Scheduled for an already processed tick.
+	TimeMs _current = 0;
+	TimeMs _armedWake = -1;
+	int _scheduled = 0;
+	bool _advancing = false;
+
+};
+
+// Re-arms the wheels of all threads, for example after a system sleep.
+void AdjustTimerWheels();
+
+} // namespace details
+} // namespace base
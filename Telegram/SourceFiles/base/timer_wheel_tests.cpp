@@ -0,0 +1,264 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/timer_wheel.h"
+
+using base::details::TimerWheel;
+using base::details::TimerWheelEntry;
+
+namespace {
+
+constexpr auto kStart = TimeMs(1000);
+constexpr auto kMaxAdvances = 100000;
+
+TimeMs Now = 0;
+
+TimeMs Clock() {
+	return Now;
+}
+
+class Entry final : public TimerWheelEntry {
+public:
+	explicit Entry(not_null<TimerWheel*> wheel) : TimerWheelEntry(wheel) {
+	}
+
+	std::vector<TimeMs> firedAt;
+	Fn<void()> callback;
+
+private:
+	void timerFired() override {
+		firedAt.push_back(Now);
+		if (callback) {
+			callback();
+		}
+	}
+
+};
+
+// Moves the clock the way the Qt timer would: to the armed wake time,
+// "lateness" milliseconds later, and advances the wheel there.
+class Driver {
+public:
+	Driver() : wheel(&Clock, [this](TimeMs wake) { _wake = wake; }) {
+	}
+
+	TimeMs wake() const {
+		return _wake;
+	}
+
+	void runTill(TimeMs till, TimeMs lateness = 0) {
+		auto advances = 0;
+		while (_wake >= 0 && _wake + lateness <= till) {
+			REQUIRE(++advances < kMaxAdvances);
+			Now = std::max(Now, _wake + lateness);
+			wheel.advance();
+		}
+		Now = std::max(Now, till);
+	}
+
+	TimerWheel wheel;
+
+private:
+	TimeMs _wake = -1;
+
+};
+
+} // namespace
+
+TEST_CASE("timer wheel fires entries at their deadlines", "[base::TimerWheel]") {
+	Now = kStart;
+	auto driver = Driver();
+	const auto range = TimerWheel::kRange;
+
+	SECTION("on every level and on the level boundaries") {
+		const auto timeouts = std::vector<TimeMs>{
+			0, 1, 2, 63, 64, 65, 100, 4095, 4096, 4097, 5000,
+			262143, 262144, 262145, 300000,
+			range - 1, range, range + 1,
+		};
+		auto entries = std::vector<std::unique_ptr<Entry>>();
+		for (const auto timeout : timeouts) {
+			entries.push_back(std::make_unique<Entry>(&driver.wheel));
+			entries.back()->schedule(timeout, Qt::PreciseTimer);
+			REQUIRE(entries.back()->deadline() == kStart + timeout);
+		}
+		driver.runTill(kStart + 2 * range);
+		for (auto i = 0; i != int(timeouts.size()); ++i) {
+			const auto &entry = entries[i];
+			REQUIRE(!entry->scheduled());
+			REQUIRE(entry->firedAt.size() == 1);
+			REQUIRE(entry->firedAt.front() == kStart + timeouts[i]);
+		}
+		REQUIRE(driver.wake() < 0);
+	}
+
+	SECTION("after the wheel range the deadlines are clamped and cascaded") {
+		const auto timeouts = std::vector<TimeMs>{
+			2 * range - 1,
+			3 * range + 12345,
+			10 * 60 * 60 * 1000, // 10 hours.
+		};
+		auto entries = std::vector<std::unique_ptr<Entry>>();
+		for (const auto timeout : timeouts) {
+			entries.push_back(std::make_unique<Entry>(&driver.wheel));
+			entries.back()->schedule(timeout, Qt::PreciseTimer);
+		}
+		driver.runTill(kStart + range);
+		for (const auto &entry : entries) {
+			REQUIRE(entry->scheduled());
+			REQUIRE(entry->firedAt.empty());
+		}
+		driver.runTill(kStart + 4 * range);
+		for (auto i = 0; i != int(timeouts.size()); ++i) {
+			const auto &entry = entries[i];
+			REQUIRE(entry->firedAt.size() == 1);
+			REQUIRE(entry->firedAt.front() == kStart + timeouts[i]);
+		}
+	}
+
+	SECTION("late timer events fire everything that is due") {
+		auto first = Entry(&driver.wheel);
+		auto second = Entry(&driver.wheel);
+		auto third = Entry(&driver.wheel);
+		first.schedule(10, Qt::PreciseTimer);
+		second.schedule(700, Qt::PreciseTimer);
+		third.schedule(5000, Qt::PreciseTimer);
+		Now = kStart + 1000;
+		driver.wheel.advance();
+		REQUIRE(first.firedAt == std::vector<TimeMs>{ kStart + 1000 });
+		REQUIRE(second.firedAt == std::vector<TimeMs>{ kStart + 1000 });
+		REQUIRE(third.firedAt.empty());
+		driver.runTill(kStart + 5000);
+		REQUIRE(third.firedAt == std::vector<TimeMs>{ kStart + 5000 });
+	}
+}
+
+TEST_CASE("timer wheel rounds coarse deadlines", "[base::TimerWheel]") {
+	Now = 1024;
+	auto driver = Driver();
+
+	SECTION("coarse deadlines are late by at most 5%") {
+		auto entry = Entry(&driver.wheel);
+		for (auto timeout = TimeMs(0); timeout < 100000; timeout += 37) {
+			entry.schedule(timeout, Qt::CoarseTimer);
+			const auto exact = Now + timeout;
+			REQUIRE(entry.deadline() >= exact);
+			REQUIRE(entry.deadline() - exact <= timeout / 20);
+		}
+		entry.schedule(10000, Qt::PreciseTimer);
+		REQUIRE(entry.deadline() == Now + 10000);
+	}
+
+	SECTION("close coarse deadlines are fired together") {
+		auto first = Entry(&driver.wheel);
+		auto second = Entry(&driver.wheel);
+		auto precise = Entry(&driver.wheel);
+		first.schedule(10000, Qt::CoarseTimer);
+		second.schedule(10100, Qt::CoarseTimer);
+		precise.schedule(10000, Qt::PreciseTimer);
+		REQUIRE(first.deadline() == 11264);
+		REQUIRE(second.deadline() == 11264);
+		REQUIRE(precise.deadline() == 11024);
+
+		driver.runTill(11263);
+		REQUIRE(precise.firedAt == std::vector<TimeMs>{ 11024 });
+		REQUIRE(first.firedAt.empty());
+		REQUIRE(second.firedAt.empty());
+		REQUIRE(driver.wake() == 11264);
+
+		driver.runTill(11264);
+		REQUIRE(first.firedAt == std::vector<TimeMs>{ 11264 });
+		REQUIRE(second.firedAt == std::vector<TimeMs>{ 11264 });
+	}
+}
+
+TEST_CASE("timer wheel callbacks may change the wheel", "[base::TimerWheel]") {
+	Now = kStart;
+	auto driver = Driver();
+
+	SECTION("an entry due in the same tick can be cancelled") {
+		auto first = Entry(&driver.wheel);
+		auto second = Entry(&driver.wheel);
+		first.callback = [&] { second.unschedule(); };
+		second.callback = [&] { first.unschedule(); };
+		first.schedule(100, Qt::PreciseTimer);
+		second.schedule(100, Qt::PreciseTimer);
+		driver.runTill(kStart + 1000);
+		REQUIRE(first.firedAt.size() + second.firedAt.size() == 1);
+		REQUIRE(!first.scheduled());
+		REQUIRE(!second.scheduled());
+	}
+
+	SECTION("an entry due in the same tick can be destroyed") {
+		auto first = std::make_unique<Entry>(&driver.wheel);
+		auto second = std::make_unique<Entry>(&driver.wheel);
+		auto firedCount = 0;
+		first->callback = [&] { ++firedCount; second = nullptr; };
+		second->callback = [&] { ++firedCount; first = nullptr; };
+		first->schedule(100, Qt::PreciseTimer);
+		second->schedule(100, Qt::PreciseTimer);
+		driver.runTill(kStart + 1000);
+		REQUIRE(firedCount == 1);
+		REQUIRE(!first != !second);
+	}
+
+	SECTION("a later entry can be cancelled") {
+		auto first = Entry(&driver.wheel);
+		auto second = Entry(&driver.wheel);
+		first.callback = [&] { second.unschedule(); };
+		first.schedule(100, Qt::PreciseTimer);
+		second.schedule(5000, Qt::PreciseTimer);
+		driver.runTill(kStart + 10000);
+		REQUIRE(first.firedAt.size() == 1);
+		REQUIRE(second.firedAt.empty());
+		REQUIRE(driver.wake() < 0);
+	}
+
+	SECTION("an entry rescheduled with zero timeout fires in the next event") {
+		auto entry = Entry(&driver.wheel);
+		entry.callback = [&] {
+			if (entry.firedAt.size() < 3) {
+				entry.schedule(0, Qt::PreciseTimer);
+			}
+		};
+		entry.schedule(100, Qt::PreciseTimer);
+		Now = kStart + 100;
+		driver.wheel.advance();
+		REQUIRE(entry.firedAt.size() == 1);
+		REQUIRE(entry.scheduled());
+		REQUIRE(driver.wake() == Now);
+		driver.runTill(Now);
+		REQUIRE(entry.firedAt.size() == 3);
+		REQUIRE(!entry.scheduled());
+	}
+}
+
+TEST_CASE("timer wheel interval entries don't drift", "[base::TimerWheel]") {
+	Now = kStart;
+	auto driver = Driver();
+	auto entry = Entry(&driver.wheel);
+	entry.callback = [&] { entry.scheduleNext(100, Qt::PreciseTimer); };
+	entry.schedule(100, Qt::PreciseTimer);
+
+	SECTION("late events re-arm from the previous deadline") {
+		driver.runTill(kStart + 1000, 7);
+		REQUIRE(entry.firedAt.size() == 9);
+		for (auto i = 0; i != 9; ++i) {
+			REQUIRE(entry.firedAt[i] == kStart + (i + 1) * 100 + 7);
+		}
+		REQUIRE(entry.deadline() == kStart + 1000);
+	}
+
+	SECTION("missed intervals are skipped") {
+		Now = kStart + 550;
+		driver.wheel.advance();
+		REQUIRE(entry.firedAt.size() == 1);
+		REQUIRE(entry.deadline() == kStart + 650);
+	}
+}
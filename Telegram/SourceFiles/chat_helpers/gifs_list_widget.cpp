@@ -166,6 +166,14 @@ void GifsListWidget::visibleTopBottomUpdated(
 	if (top != getVisibleTop()) {
 		_lastScrolled = getms();
 	}
+
+	// Preload one screen ahead in the scroll direction.
+	const auto height = getVisibleBottom() - getVisibleTop();
+	if (getVisibleTop() > top) {
+		preloadRows(getVisibleBottom(), getVisibleBottom() + height);
+	} else if (getVisibleTop() < top) {
+		preloadRows(getVisibleTop() - height, getVisibleTop());
+	}
 	checkLoadMore();
 }
 
@@ -610,10 +618,27 @@ void GifsListWidget::layoutInlineRow(Row &row, int fullWidth) {
 }
 
 void GifsListWidget::preloadImages() {
+	// Only the rows that will be visible and the next screen of them,
+	// the rest is preloaded while scrolling.
+	const auto height = std::max(
+		getVisibleBottom() - getVisibleTop(),
+		minimalHeight());
+	preloadRows(getVisibleTop(), getVisibleTop() + 2 * height);
+}
+
+void GifsListWidget::preloadRows(int from, int till) {
+	auto top = st::stickerPanPadding;
 	for (auto row = 0, rows = _rows.size(); row != rows; ++row) {
-		for (auto col = 0, cols = _rows[row].items.size(); col != cols; ++col) {
-			_rows[row].items[col]->preload();
+		if (top >= till) {
+			break;
 		}
+		auto &inlineRow = _rows[row];
+		if (top + inlineRow.height > from) {
+			for (auto col = 0, cols = inlineRow.items.size(); col != cols; ++col) {
+				inlineRow.items[col]->preload();
+			}
+		}
+		top += inlineRow.height;
 	}
 }
 
@@ -0,0 +1,276 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "chat_helpers/sticker_thumbnails.h"
+
+#include "data/data_document.h"
+#include "ui/paint_profiler.h"
+
+namespace ChatHelpers {
+namespace {
+
+// Pages are about that size in device pixels, so the atlas takes
+// at most kMaxPages * 4 MB whatever the cell size is.
+constexpr auto kPageSize = 1024;
+constexpr auto kMaxPages = 4;
+constexpr auto kMaxDecodesInFlight = 4;
+
+QImage PrepareThumbnail(QByteArray bytes, const QString &path, QSize size) {
+	if (bytes.isEmpty()) {
+		QFile file(path);
+		if (!file.open(QIODevice::ReadOnly)) {
+			return QImage();
+		}
+		bytes = file.readAll();
+	}
+	auto image = App::readImage(std::move(bytes), nullptr, false);
+	if (image.isNull()) {
+		return image;
+	}
+	if (image.size() != size) {
+		image = image.scaled(
+			size,
+			Qt::IgnoreAspectRatio,
+			Qt::SmoothTransformation);
+	}
+	return std::move(image).convertToFormat(
+		QImage::Format_ARGB32_Premultiplied);
+}
+
+} // namespace
+
+StickerThumbnails::StickerThumbnails(Fn<void()> updated)
+: _updated(std::move(updated)) {
+}
+
+StickerThumbnails::~StickerThumbnails() = default;
+
+void StickerThumbnails::setCellSize(QSize size) {
+	const auto factor = cIntRetinaFactor();
+	if (_cellSize == size && _factor == factor) {
+		return;
+	}
+	_cellSize = size;
+	_factor = factor;
+	clear();
+
+	const auto cell = _cellSize * _factor;
+	_cellsPerRow = std::max(kPageSize / std::max(cell.width(), 1), 1);
+	const auto rows = std::max(kPageSize / std::max(cell.height(), 1), 1);
+	_cellsPerPage = _cellsPerRow * rows;
+}
+
+void StickerThumbnails::clear() {
+	_pages.clear();
+	_cells.clear();
+	_freeCells.clear();
+	_cellByDocument.clear();
+	_queue.clear();
+	_requested.clear();
+
+	// Decodes already started are ignored when they finish.
+	++_generation;
+}
+
+bool StickerThumbnails::canPaint(not_null<DocumentData*> document) const {
+	return (_cellsPerPage > 0)
+		&& document->sticker()
+		&& !document->hasGoodStickerThumb()
+		&& !_failed.contains(document->id);
+}
+
+bool StickerThumbnails::paint(
+		Painter &p,
+		QPoint position,
+		int outerWidth,
+		not_null<DocumentData*> document,
+		QSize size) {
+	if (!canPaint(document)) {
+		return false;
+	}
+	const auto i = _cellByDocument.find(document->id);
+	if (i == _cellByDocument.end()) {
+		Ui::PaintProfiler::Count("sticker thumbnail misses");
+		request(document, size, true);
+
+		// Until it is decoded an already loaded image is painted as before.
+		const auto image = document->getStickerThumb();
+		return !image || !image->loaded();
+	}
+	const auto index = i->second;
+	auto &cell = _cells[index];
+	cell.lastUsed = ++_lastUsed;
+	p.drawPixmapLeft(
+		QRect(position, cell.size / _factor),
+		outerWidth,
+		_pages[index / _cellsPerPage],
+		cellRect(index, cell.size));
+	return true;
+}
+
+bool StickerThumbnails::prefetch(
+		not_null<DocumentData*> document,
+		QSize size) {
+	if (!canPaint(document)) {
+		return false;
+	} else if (!_cellByDocument.contains(document->id)) {
+		request(document, size, false);
+	}
+	return true;
+}
+
+void StickerThumbnails::cancelQueued() {
+	for (const auto &task : _queue) {
+		_requested.remove(task.id);
+	}
+	_queue.clear();
+}
+
+void StickerThumbnails::request(
+		not_null<DocumentData*> document,
+		QSize size,
+		bool urgent) {
+	const auto id = document->id;
+	if (_requested.contains(id)) {
+		if (urgent) {
+			const auto i = ranges::find(_queue, id, &Task::id);
+			if (i != end(_queue) && i != begin(_queue)) {
+				auto task = std::move(*i);
+				_queue.erase(i);
+				_queue.push_front(std::move(task));
+			}
+		}
+		return;
+	} else if (!document->loaded()) {
+		document->automaticLoad(document->stickerSetOrigin(), nullptr);
+		return;
+	}
+	auto task = Task();
+	task.id = id;
+	task.bytes = document->data();
+	if (task.bytes.isEmpty()) {
+		task.path = document->filepath();
+		if (task.path.isEmpty()) {
+			_failed.insert(id);
+			return;
+		}
+	}
+	task.size = size * _factor;
+	if (urgent) {
+		_queue.push_front(std::move(task));
+	} else {
+		_queue.push_back(std::move(task));
+	}
+	_requested.insert(id);
+	startDecodes();
+}
+
+void StickerThumbnails::startDecodes() {
+	while (_decoding < kMaxDecodesInFlight && !_queue.empty()) {
+		auto task = std::move(_queue.front());
+		_queue.pop_front();
+		++_decoding;
+		crl::async([
+			=,
+			weak = base::make_weak(this),
+			generation = _generation,
+			task = std::move(task)
+		]() mutable {
+			auto image = PrepareThumbnail(
+				std::move(task.bytes),
+				task.path,
+				task.size);
+			crl::on_main(weak, [
+				=,
+				id = task.id,
+				image = std::move(image)
+			]() mutable {
+				decoded(generation, id, std::move(image));
+			});
+		});
+	}
+}
+
+void StickerThumbnails::decoded(
+		int generation,
+		DocumentId id,
+		QImage &&image) {
+	--_decoding;
+	if (generation == _generation) {
+		_requested.remove(id);
+		if (image.isNull()) {
+			_failed.insert(id);
+		} else {
+			insert(id, std::move(image));
+		}
+		_updated();
+	}
+	startDecodes();
+}
+
+void StickerThumbnails::insert(DocumentId id, QImage &&image) {
+	const auto cell = _cellSize * _factor;
+	if (image.width() > cell.width() || image.height() > cell.height()) {
+		_failed.insert(id);
+		return;
+	}
+	const auto index = takeCell();
+	auto &entry = _cells[index];
+	if (entry.id) {
+		_cellByDocument.remove(entry.id);
+	}
+	entry.id = id;
+	entry.size = image.size();
+	entry.lastUsed = ++_lastUsed;
+	_cellByDocument.emplace(id, index);
+
+	QPainter p(&_pages[index / _cellsPerPage]);
+	p.setCompositionMode(QPainter::CompositionMode_Source);
+	const auto rect = cellRect(index, cell);
+	p.fillRect(rect, Qt::transparent);
+	p.drawImage(rect.topLeft(), image);
+}
+
+int StickerThumbnails::takeCell() {
+	if (_freeCells.empty() && int(_pages.size()) < kMaxPages) {
+		const auto cell = _cellSize * _factor;
+		const auto rows = _cellsPerPage / _cellsPerRow;
+		auto page = QPixmap(
+			_cellsPerRow * cell.width(),
+			rows * cell.height());
+		page.fill(Qt::transparent);
+		_pages.push_back(std::move(page));
+
+		const auto from = int(_cells.size());
+		_cells.resize(from + _cellsPerPage);
+		for (auto i = from + _cellsPerPage; i != from;) {
+			_freeCells.push_back(--i);
+		}
+	}
+	if (!_freeCells.empty()) {
+		const auto result = _freeCells.back();
+		_freeCells.pop_back();
+		return result;
+	}
+	const auto i = ranges::min_element(
+		_cells,
+		ranges::less(),
+		&Cell::lastUsed);
+	return int(i - begin(_cells));
+}
+
+QRect StickerThumbnails::cellRect(int index, QSize size) const {
+	const auto cell = _cellSize * _factor;
+	const auto inPage = index % _cellsPerPage;
+	return QRect(
+		QPoint(
+			(inPage % _cellsPerRow) * cell.width(),
+			(inPage / _cellsPerRow) * cell.height()),
+		size);
+}
+
+} // namespace ChatHelpers
@@ -0,0 +1,93 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/weak_ptr.h"
+
+namespace ChatHelpers {
+
+// Bounded cache of the scaled sticker thumbnails of one panel.
+//
+// Stickers without a good thumbnail are decoded and scaled on worker
+// threads and packed into a few atlas pixmaps for the current scale,
+// least recently painted ones are evicted. So opening a panel with
+// many sets doesn't decode them all on the main thread and doesn't
+// keep a separate pixmap for each of them.
+class StickerThumbnails : public base::has_weak_ptr {
+public:
+	explicit StickerThumbnails(Fn<void()> updated);
+	StickerThumbnails(const StickerThumbnails &other) = delete;
+	StickerThumbnails &operator=(const StickerThumbnails &other) = delete;
+	~StickerThumbnails();
+
+	// All the thumbnails are dropped when the size or the scale changes.
+	void setCellSize(QSize size);
+
+	// Returns false if the sticker should be painted the usual way.
+	// Otherwise paints it if it is ready or requests it and counts
+	// a miss in Ui::PaintProfiler, the updated callback is called
+	// when it is decoded. While it is requested false is returned
+	// if the usual sticker image is already loaded.
+	bool paint(
+		Painter &p,
+		QPoint position,
+		int outerWidth,
+		not_null<DocumentData*> document,
+		QSize size);
+
+	// Returns false if the sticker should be loaded the usual way.
+	// Otherwise requests it after everything already requested.
+	bool prefetch(not_null<DocumentData*> document, QSize size);
+
+	// Forgets the requests that were not started yet.
+	void cancelQueued();
+
+private:
+	struct Cell {
+		DocumentId id = 0;
+		QSize size; // In device pixels.
+		int64 lastUsed = 0;
+	};
+	struct Task {
+		DocumentId id = 0;
+		QByteArray bytes;
+		QString path;
+		QSize size; // In device pixels.
+	};
+
+	bool canPaint(not_null<DocumentData*> document) const;
+	void request(not_null<DocumentData*> document, QSize size, bool urgent);
+	void startDecodes();
+	void decoded(int generation, DocumentId id, QImage &&image);
+	void insert(DocumentId id, QImage &&image);
+	int takeCell();
+	QRect cellRect(int index, QSize size) const;
+	void clear();
+
+	const Fn<void()> _updated;
+
+	QSize _cellSize;
+	int _factor = 0;
+	int _cellsPerRow = 0;
+	int _cellsPerPage = 0;
+
+	std::vector<QPixmap> _pages;
+	std::vector<Cell> _cells;
+	std::vector<int> _freeCells;
+	base::flat_map<DocumentId, int> _cellByDocument;
+	int64 _lastUsed = 0;
+
+	std::deque<Task> _queue;
+	base::flat_set<DocumentId> _requested;
+	base::flat_set<DocumentId> _failed;
+	int _generation = 0;
+	int _decoding = 0;
+
+};
+
+} // namespace ChatHelpers
@@ -689,7 +689,7 @@ std::vector<not_null<DocumentData*>> GetListByEmoji(
 		TimeId date = 0;
 	};
 	auto result = std::vector<StickerWithDate>();
-	auto &sets = Auth().data().stickerSetsRef();
+	const auto &sets = Auth().data().stickerSets();
 	auto setsToRequest = base::flat_map<uint64, uint64>();
 
 	const auto add = [&](not_null<DocumentData*> document, TimeId date) {
@@ -759,42 +759,53 @@ std::vector<not_null<DocumentData*>> GetListByEmoji(
 			}
 		}
 	}
-	const auto addList = [&](const Order &order, MTPDstickerSet::Flag skip) {
-		for (const auto setId : order) {
-			auto it = sets.find(setId);
-			if (it == sets.cend() || (it->flags & skip)) {
-				continue;
-			}
-			if (it->emoji.isEmpty()) {
-				setsToRequest.emplace(it->id, it->access);
-				it->flags |= MTPDstickerSet_ClientFlag::f_not_loaded;
-				continue;
-			}
-			auto i = it->emoji.constFind(original);
-			if (i == it->emoji.cend()) {
-				continue;
-			}
-			const auto my = (it->flags & MTPDstickerSet::Flag::f_installed_date);
-			result.reserve(result.size() + i->size());
-			for (const auto document : *i) {
-				const auto installDate = my ? it->installDate : TimeId(0);
-				const auto date = (installDate > 1)
-					? installDate
-					: my
-					? CreateMySortKey()
-					: CreateFeaturedSortKey(document);
-				add(document, date);
+	// Only the sets having this emoji are visited, in the sets order.
+	auto &index = Auth().data().stickersIndex();
+	const auto skip = MTPDstickerSet::Flag::f_archived;
+	const auto notLoaded = MTPDstickerSet_ClientFlag::f_not_loaded;
+	auto setsToMark = std::vector<uint64>();
+	for (const auto setId : index.installedSetsWithoutEmoji()) {
+		const auto it = sets.constFind(setId);
+		if (it != sets.cend() && !(it->flags & skip)) {
+			setsToRequest.emplace(it->id, it->access);
+			if (!(it->flags & notLoaded)) {
+				setsToMark.push_back(it->id);
 			}
 		}
-	};
-
-	addList(
-		Auth().data().stickerSetsOrder(),
-		MTPDstickerSet::Flag::f_archived);
-	//addList(
-	//	Auth().data().featuredStickerSetsOrder(),
-	//	MTPDstickerSet::Flag::f_installed_date);
+	}
+	for (const auto setId : index.installedSetsByEmoji(original)) {
+		const auto it = sets.constFind(setId);
+		if (it == sets.cend() || (it->flags & skip)) {
+			continue;
+		}
+		auto i = it->emoji.constFind(original);
+		if (i == it->emoji.cend()) {
+			continue;
+		}
+		const auto my = (it->flags & MTPDstickerSet::Flag::f_installed_date);
+		result.reserve(result.size() + i->size());
+		for (const auto document : *i) {
+			const auto installDate = my ? it->installDate : TimeId(0);
+			const auto date = (installDate > 1)
+				? installDate
+				: my
+				? CreateMySortKey()
+				: CreateFeaturedSortKey(document);
+			add(document, date);
+		}
+	}
 
+	if (!setsToMark.empty()) {
+		// Changing the sets makes the index refresh on the next lookup,
+		// so they are changed only when some flag is really missing.
+		auto &changed = Auth().data().stickerSetsRef();
+		for (const auto setId : setsToMark) {
+			const auto it = changed.find(setId);
+			if (it != changed.end()) {
+				it->flags |= notLoaded;
+			}
+		}
+	}
 	if (!setsToRequest.empty()) {
 		for (const auto [setId, accessHash] : setsToRequest) {
 			Auth().api().scheduleStickerSetRequest(setId, accessHash);
@@ -0,0 +1,114 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "chat_helpers/stickers_index.h"
+
+namespace Stickers {
+namespace {
+
+bool IsSpecial(const Set &set) {
+	return (set.flags & MTPDstickerSet_ClientFlag::f_special);
+}
+
+} // namespace
+
+Index::Index(not_null<const Sets*> sets, not_null<const Order*> order)
+: _sets(sets)
+, _order(order) {
+}
+
+void Index::setsChanged() {
+	_setsChanged = true;
+}
+
+void Index::orderChanged() {
+	_orderChanged = true;
+}
+
+std::vector<uint64> Index::installedSetsByEmoji(not_null<EmojiPtr> emoji) {
+	refresh();
+	return _search.installedByEmoji(emoji);
+}
+
+std::vector<uint64> Index::installedSetsWithoutEmoji() {
+	refresh();
+	return _search.installedWithoutEmoji();
+}
+
+base::flat_set<uint64> Index::setsByQuery(const QString &query) {
+	const auto words = TextUtilities::PrepareSearchWords(query);
+	if (words.isEmpty()) {
+		return {};
+	}
+	refresh();
+	return _search.byWords(words);
+}
+
+void Index::refresh() {
+	if (base::take(_setsChanged)) {
+		refreshSets();
+	}
+	if (base::take(_orderChanged)) {
+		_search.setOrder(*_order);
+	}
+}
+
+void Index::refreshSets() {
+	// Both containers are sorted by the set id.
+	auto entry = begin(_entries);
+	for (auto i = _sets->cbegin(), e = _sets->cend(); i != e; ++i) {
+		while (entry != end(_entries) && entry->first < i.key()) {
+			entry = remove(entry);
+		}
+		if (entry != end(_entries) && entry->first == i.key()) {
+			const auto &indexed = entry->second;
+			if (indexed.emoji.isSharedWith(i->emoji)
+				&& indexed.title == i->title
+				&& indexed.shortName == i->shortName
+				&& indexed.special == IsSpecial(*i)) {
+				++entry;
+				continue;
+			}
+			entry = remove(entry);
+		}
+		entry = std::next(add(entry, *i));
+	}
+	while (entry != end(_entries)) {
+		entry = remove(entry);
+	}
+}
+
+auto Index::add(Entries::iterator hint, const Set &set)
+-> Entries::iterator {
+	auto indexed = Indexed();
+	indexed.emoji = set.emoji;
+	indexed.title = set.title;
+	indexed.shortName = set.shortName;
+	indexed.special = IsSpecial(set);
+
+	auto entry = SearchIndex::Entry();
+	for (auto i = set.emoji.cbegin(), e = set.emoji.cend(); i != e; ++i) {
+		if (!i->isEmpty()) {
+			entry.emoji.push_back(i.key());
+		}
+	}
+	entry.emojiLoaded = !set.emoji.isEmpty();
+	if (!indexed.special) {
+		entry.words = TextUtilities::PrepareSearchWords(
+			set.title + ' ' + set.shortName);
+	}
+	_search.update(set.id, std::move(entry));
+
+	return _entries.emplace_hint(hint, set.id, std::move(indexed));
+}
+
+auto Index::remove(Entries::iterator i) -> Entries::iterator {
+	_search.remove(i->first);
+	return _entries.erase(i);
+}
+
+} // namespace Stickers
@@ -0,0 +1,63 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "chat_helpers/stickers.h"
+#include "chat_helpers/stickers_search_index.h"
+
+namespace Stickers {
+
+// Index of the sticker sets by emoji and by title words.
+//
+// Sets are changed in place from many places, so Data::Session marks
+// the sets or the order changed on each non-const access to them.
+// The next lookup after that reindexes only the sets that differ from
+// their indexed copies: the emoji maps are implicitly shared, so any
+// change to the emoji of a set detaches it from the copy.
+class Index {
+public:
+	Index(not_null<const Sets*> sets, not_null<const Order*> order);
+
+	void setsChanged();
+	void orderChanged();
+
+	// Installed sets having stickers for the original emoji
+	// and installed sets without the emoji map loaded yet.
+	// Both are sorted the same way the sets order is.
+	std::vector<uint64> installedSetsByEmoji(not_null<EmojiPtr> emoji);
+	std::vector<uint64> installedSetsWithoutEmoji();
+
+	// Not special sets with a title or a short name word
+	// starting with each of the query words.
+	base::flat_set<uint64> setsByQuery(const QString &query);
+
+private:
+	struct Indexed {
+		ByEmojiMap emoji;
+		QString title;
+		QString shortName;
+		bool special = false;
+	};
+	using Entries = std::map<uint64, Indexed>;
+
+	void refresh();
+	void refreshSets();
+	Entries::iterator add(Entries::iterator hint, const Set &set);
+	Entries::iterator remove(Entries::iterator i);
+
+	const not_null<const Sets*> _sets;
+	const not_null<const Order*> _order;
+	bool _setsChanged = true;
+	bool _orderChanged = true;
+
+	Entries _entries;
+	SearchIndex _search;
+
+};
+
+} // namespace Stickers
@@ -681,7 +681,8 @@ StickersListWidget::StickersListWidget(QWidget *parent, not_null<Window::Control
 , _addText(lang(lng_stickers_featured_add).toUpper())
 , _addWidth(st::stickersTrendingAdd.font->width(_addText))
 , _settings(this, lang(lng_stickers_you_have))
-, _searchRequestTimer([=] { sendSearchRequest(); }) {
+, _searchRequestTimer([=] { sendSearchRequest(); })
+, _thumbnails([=] { update(); }) {
 	setMouseTracking(true);
 	setAttribute(Qt::WA_OpaquePaintEvent);
 
@@ -717,6 +718,43 @@ void StickersListWidget::visibleTopBottomUpdated(
 		readVisibleSets();
 	}
 	validateSelectedIcon(ValidateIconAnimations::Full);
+
+	// Decode one screen ahead in the scroll direction.
+	const auto height = getVisibleBottom() - getVisibleTop();
+	if (getVisibleTop() > top) {
+		prefetchThumbnails(getVisibleBottom(), getVisibleBottom() + height);
+	} else if (getVisibleTop() < top) {
+		prefetchThumbnails(getVisibleTop() - height, getVisibleTop());
+	}
+}
+
+void StickersListWidget::prefetchThumbnails(int from, int till) {
+	_thumbnails.cancelQueued();
+
+	auto &sets = shownSets();
+	enumerateSections([&](const SectionInfo &info) {
+		if (info.rowsBottom <= from) {
+			return true;
+		} else if (info.rowsTop >= till) {
+			return false;
+		}
+		auto &set = sets[info.section];
+		const auto count = set.externalLayout
+			? std::min(info.count, _columnCount)
+			: info.count;
+		const auto fromRow = floorclamp(from - info.rowsTop, _singleSize.height(), 0, info.rowsCount);
+		const auto tillRow = ceilclamp(till - info.rowsTop, _singleSize.height(), 0, info.rowsCount);
+		const auto tillIndex = std::min(tillRow * _columnCount, count);
+		for (auto index = fromRow * _columnCount; index < tillIndex; ++index) {
+			const auto document = set.pack[index];
+			if (!document->sticker()) {
+				continue;
+			} else if (!_thumbnails.prefetch(document, stickerSize(document))) {
+				document->checkStickerThumb();
+			}
+		}
+		return true;
+	});
 }
 
 void StickersListWidget::readVisibleSets() {
@@ -824,6 +862,7 @@ int StickersListWidget::countDesiredHeight(int newWidth) {
 		- rowsRight
 		- st::buttonRadius;
 	_singleSize = QSize(singleWidth, singleWidth);
+	_thumbnails.setCellSize(_singleSize);
 	setColumnCount(columnCount);
 
 	auto visibleHeight = minimalHeight();
@@ -966,34 +1005,14 @@ void StickersListWidget::refreshSearchRows(
 }
 
 void StickersListWidget::fillLocalSearchRows(const QString &query) {
-	const auto searchWordsList = TextUtilities::PrepareSearchWords(query);
-	if (searchWordsList.isEmpty()) {
+	const auto found = Auth().data().stickersIndex().setsByQuery(query);
+	if (found.empty()) {
 		return;
 	}
-	auto searchWordInTitle = [](
-			const QStringList &titleWords,
-			const QString &searchWord) {
-		for (const auto &titleWord : titleWords) {
-			if (titleWord.startsWith(searchWord)) {
-				return true;
-			}
-		}
-		return false;
-	};
-	auto allSearchWordsInTitle = [&](
-			const QStringList &titleWords) {
-		for (const auto &searchWord : searchWordsList) {
-			if (!searchWordInTitle(titleWords, searchWord)) {
-				return false;
-			}
-		}
-		return true;
-	};
-
 	const auto &sets = Auth().data().stickerSets();
-	for (const auto &[setId, titleWords] : _searchIndex) {
-		if (allSearchWordsInTitle(titleWords)) {
-			if (const auto it = sets.find(setId); it != sets.end()) {
+	for (const auto &set : _mySets) {
+		if (found.contains(set.id)) {
+			if (const auto it = sets.find(set.id); it != sets.end()) {
 				addSearchRow(&*it);
 			}
 		}
@@ -1322,25 +1341,25 @@ void StickersListWidget::paintSticker(Painter &p, Set &set, int y, int index, bo
 		App::roundRect(p, QRect(tl, _singleSize), st::emojiPanHover, StickerHoverCorners);
 	}
 
-	document->checkStickerThumb();
-
-	auto coef = qMin((_singleSize.width() - st::buttonRadius * 2) / float64(document->dimensions.width()), (_singleSize.height() - st::buttonRadius * 2) / float64(document->dimensions.height()));
-	if (coef > 1) coef = 1;
-	auto w = qMax(qRound(coef * document->dimensions.width()), 1);
-	auto h = qMax(qRound(coef * document->dimensions.height()), 1);
+	const auto size = stickerSize(document);
+	const auto w = size.width();
+	const auto h = size.height();
 	auto ppos = pos + QPoint((_singleSize.width() - w) / 2, (_singleSize.height() - h) / 2);
-	if (const auto image = document->getStickerThumb()) {
-		if (image->loaded()) {
-			p.drawPixmapLeft(
-				ppos,
-				width(),
-				image->pixSingle(
-					document->stickerSetOrigin(),
-					w,
-					h,
-					w,
-					h,
-					ImageRoundRadius::None));
+	if (!_thumbnails.paint(p, ppos, width(), document, size)) {
+		document->checkStickerThumb();
+		if (const auto image = document->getStickerThumb()) {
+			if (image->loaded()) {
+				p.drawPixmapLeft(
+					ppos,
+					width(),
+					image->pixSingle(
+						document->stickerSetOrigin(),
+						w,
+						h,
+						w,
+						h,
+						ImageRoundRadius::None));
+			}
 		}
 	}
 
@@ -1354,6 +1373,15 @@ void StickersListWidget::paintSticker(Painter &p, Set &set, int y, int index, bo
 	}
 }
 
+QSize StickersListWidget::stickerSize(
+		not_null<DocumentData*> document) const {
+	auto coef = qMin((_singleSize.width() - st::buttonRadius * 2) / float64(document->dimensions.width()), (_singleSize.height() - st::buttonRadius * 2) / float64(document->dimensions.height()));
+	if (coef > 1) coef = 1;
+	return QSize(
+		qMax(qRound(coef * document->dimensions.width()), 1),
+		qMax(qRound(coef * document->dimensions.height()), 1));
+}
+
 int StickersListWidget::stickersRight() const {
 	return stickersLeft() + (_columnCount * _singleSize.width());
 }
@@ -1715,8 +1743,6 @@ void StickersListWidget::refreshStickers() {
 }
 
 void StickersListWidget::refreshSearchSets() {
-	refreshSearchIndex();
-
 	const auto &sets = Auth().data().stickerSets();
 	for (auto &set : _searchSets) {
 		if (const auto it = sets.find(set.id); it != sets.end()) {
@@ -1732,18 +1758,6 @@ void StickersListWidget::refreshSearchSets() {
 	}
 }
 
-void StickersListWidget::refreshSearchIndex() {
-	_searchIndex.clear();
-	for (const auto &set : _mySets) {
-		if (set.flags & MTPDstickerSet_ClientFlag::f_special) {
-			continue;
-		}
-		const auto string = set.title + ' ' + set.shortName;
-		const auto list = TextUtilities::PrepareSearchWords(string);
-		_searchIndex.emplace_back(set.id, list);
-	}
-}
-
 void StickersListWidget::refreshSettingsVisibility() {
 	const auto visible = (_section == Section::Stickers) && _mySets.empty();
 	_settings->setVisible(visible);
@@ -1769,7 +1783,9 @@ void StickersListWidget::preloadImages() {
 			const auto document = sets[i].pack[j];
 			if (!document || !document->sticker()) continue;
 
-			document->checkStickerThumb();
+			if (!_thumbnails.prefetch(document, stickerSize(document))) {
+				document->checkStickerThumb();
+			}
 		}
 		if (k > _columnCount * (_columnCount + 1)) break;
 	}
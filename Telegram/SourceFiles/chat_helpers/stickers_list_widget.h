@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "chat_helpers/tabbed_selector.h"
 #include "chat_helpers/stickers.h"
+#include "chat_helpers/sticker_thumbnails.h"
 #include "base/variant.h"
 #include "base/timer.h"
 
@@ -172,7 +173,6 @@ private:
 		uint64 setId,
 		const MTPInputStickerSet &input);
 	void refreshSearchSets();
-	void refreshSearchIndex();
 
 	bool setHasTitle(const Set &set) const;
 	bool stickerHasDeleteButton(const Set &set, int index) const;
@@ -208,6 +208,8 @@ private:
 	void paintStickers(Painter &p, QRect clip);
 	void paintMegagroupEmptySet(Painter &p, int y, bool buttonSelected, TimeMs ms);
 	void paintSticker(Painter &p, Set &set, int y, int index, bool selected, bool deleteSelected);
+	QSize stickerSize(not_null<DocumentData*> document) const;
+	void prefetchThumbnails(int from, int till);
 	void paintEmptySearchResults(Painter &p);
 
 	int stickersRight() const;
@@ -285,8 +287,8 @@ private:
 	bool _previewShown = false;
 
 	std::map<QString, std::vector<uint64>> _searchCache;
-	std::vector<std::pair<uint64, QStringList>> _searchIndex;
 	base::Timer _searchRequestTimer;
+	StickerThumbnails _thumbnails;
 	QString _searchQuery, _searchNextQuery;
 	mtpRequestId _searchRequestId = 0;
 
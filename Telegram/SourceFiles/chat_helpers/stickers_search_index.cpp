@@ -0,0 +1,113 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "chat_helpers/stickers_search_index.h"
+
+#include <range/v3/algorithm/sort.hpp>
+#include <range/v3/view/all.hpp>
+#include <range/v3/view/transform.hpp>
+#include <range/v3/to_container.hpp>
+
+namespace Stickers {
+
+void SearchIndex::update(uint64 id, Entry &&entry) {
+	remove(id);
+	for (const auto emoji : entry.emoji) {
+		_byEmoji[emoji].insert(id);
+	}
+	if (!entry.emojiLoaded) {
+		_withoutEmoji.insert(id);
+	}
+	for (const auto &word : entry.words) {
+		_byWord.emplace(word, id);
+	}
+	_entries.emplace(id, std::move(entry));
+}
+
+void SearchIndex::remove(uint64 id) {
+	const auto i = _entries.find(id);
+	if (i == end(_entries)) {
+		return;
+	}
+	const auto &entry = i->second;
+	for (const auto emoji : entry.emoji) {
+		const auto j = _byEmoji.find(emoji);
+		if (j != end(_byEmoji)) {
+			j->second.remove(id);
+			if (j->second.empty()) {
+				_byEmoji.erase(j);
+			}
+		}
+	}
+	_withoutEmoji.remove(id);
+	for (const auto &word : entry.words) {
+		_byWord.erase({ word, id });
+	}
+	_entries.erase(i);
+}
+
+void SearchIndex::setOrder(const QList<uint64> &order) {
+	_orderPositions.clear();
+	for (auto i = 0, count = int(order.size()); i != count; ++i) {
+		_orderPositions.emplace(order[i], i);
+	}
+}
+
+std::vector<uint64> SearchIndex::installedByEmoji(Emoji emoji) const {
+	const auto i = _byEmoji.find(emoji);
+	return (i != end(_byEmoji))
+		? installedSorted(i->second)
+		: std::vector<uint64>();
+}
+
+std::vector<uint64> SearchIndex::installedWithoutEmoji() const {
+	return installedSorted(_withoutEmoji);
+}
+
+base::flat_set<uint64> SearchIndex::byWords(const QStringList &words) const {
+	if (words.isEmpty()) {
+		return {};
+	}
+	auto result = base::flat_set<uint64>();
+	auto first = true;
+	for (const auto &word : words) {
+		auto found = base::flat_set<uint64>();
+		for (auto i = _byWord.lower_bound({ word, 0 })
+			; i != end(_byWord) && i->first.startsWith(word)
+			; ++i) {
+			if (first || result.contains(i->second)) {
+				found.insert(i->second);
+			}
+		}
+		result = std::move(found);
+		first = false;
+		if (result.empty()) {
+			break;
+		}
+	}
+	return result;
+}
+
+std::vector<uint64> SearchIndex::installedSorted(
+		const base::flat_set<uint64> &ids) const {
+	auto positions = std::vector<std::pair<int, uint64>>();
+	positions.reserve(ids.size());
+	for (const auto id : ids) {
+		const auto i = _orderPositions.find(id);
+		if (i != end(_orderPositions)) {
+			positions.emplace_back(i->second, id);
+		}
+	}
+	ranges::sort(positions);
+	return ranges::view::all(
+		positions
+	) | ranges::view::transform([](const std::pair<int, uint64> &pair) {
+		return pair.second;
+	}) | ranges::to_vector;
+}
+
+} // namespace Stickers
@@ -0,0 +1,66 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+#include "base/flat_set.h"
+
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace Ui {
+namespace Emoji {
+class One;
+} // namespace Emoji
+} // namespace Ui
+
+namespace Stickers {
+
+// Sets by emoji and by search words, updated one set at a time.
+// The search words are prepared by the caller.
+class SearchIndex final {
+public:
+	using Emoji = const Ui::Emoji::One*;
+
+	struct Entry {
+		std::vector<Emoji> emoji;
+		bool emojiLoaded = false;
+		QStringList words;
+	};
+
+	// Replaces everything indexed for the set before.
+	void update(uint64 id, Entry &&entry);
+	void remove(uint64 id);
+	void setOrder(const QList<uint64> &order);
+
+	// Sets from the order having stickers for the emoji
+	// and sets from the order without the emoji loaded yet.
+	// Both are sorted the same way the order is.
+	std::vector<uint64> installedByEmoji(Emoji emoji) const;
+	std::vector<uint64> installedWithoutEmoji() const;
+
+	// Sets with a word starting with each of the query words.
+	base::flat_set<uint64> byWords(const QStringList &words) const;
+
+private:
+	std::vector<uint64> installedSorted(
+		const base::flat_set<uint64> &ids) const;
+
+	std::map<uint64, Entry> _entries;
+	std::map<Emoji, base::flat_set<uint64>> _byEmoji;
+	std::set<std::pair<QString, uint64>> _byWord;
+	base::flat_set<uint64> _withoutEmoji;
+	std::map<uint64, int> _orderPositions;
+
+};
+
+} // namespace Stickers
@@ -0,0 +1,117 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "chat_helpers/stickers_search_index.h"
+
+using namespace Stickers;
+
+namespace {
+
+using Ids = std::vector<uint64>;
+
+// The index only compares the emoji pointers.
+char EmojiStorage[4];
+
+SearchIndex::Emoji Emoji(int index) {
+	return reinterpret_cast<SearchIndex::Emoji>(&EmojiStorage[index]);
+}
+
+SearchIndex::Entry Loaded(
+		std::vector<SearchIndex::Emoji> emoji,
+		QStringList words) {
+	auto result = SearchIndex::Entry();
+	result.emoji = std::move(emoji);
+	result.emojiLoaded = true;
+	result.words = std::move(words);
+	return result;
+}
+
+Ids Search(const SearchIndex &index, const QStringList &words) {
+	const auto found = index.byWords(words);
+	return Ids(found.begin(), found.end());
+}
+
+} // namespace
+
+TEST_CASE("sets are found by emoji", "[Stickers::Index]") {
+	auto index = SearchIndex();
+	index.update(1, Loaded({ Emoji(0), Emoji(1) }, {}));
+	index.update(2, Loaded({ Emoji(1) }, {}));
+	index.update(3, SearchIndex::Entry());
+	index.setOrder({ 3, 2, 1 });
+
+	SECTION("sorted by the order") {
+		REQUIRE(index.installedByEmoji(Emoji(0)) == (Ids{ 1 }));
+		REQUIRE(index.installedByEmoji(Emoji(1)) == (Ids{ 2, 1 }));
+		REQUIRE(index.installedByEmoji(Emoji(2)).empty());
+		REQUIRE(index.installedWithoutEmoji() == (Ids{ 3 }));
+
+		index.setOrder({ 1, 2 });
+		REQUIRE(index.installedByEmoji(Emoji(1)) == (Ids{ 1, 2 }));
+		REQUIRE(index.installedWithoutEmoji().empty());
+	}
+
+	SECTION("added and removed") {
+		index.update(4, Loaded({ Emoji(1) }, {}));
+		index.setOrder({ 4, 3, 2, 1 });
+		REQUIRE(index.installedByEmoji(Emoji(1)) == (Ids{ 4, 2, 1 }));
+
+		index.remove(1);
+		index.remove(5);
+		REQUIRE(index.installedByEmoji(Emoji(0)).empty());
+		REQUIRE(index.installedByEmoji(Emoji(1)) == (Ids{ 4, 2 }));
+	}
+
+	SECTION("updated when the emoji are loaded") {
+		index.update(3, Loaded({ Emoji(2) }, {}));
+		REQUIRE(index.installedWithoutEmoji().empty());
+		REQUIRE(index.installedByEmoji(Emoji(2)) == (Ids{ 3 }));
+
+		index.update(2, Loaded({ Emoji(0) }, {}));
+		REQUIRE(index.installedByEmoji(Emoji(1)) == (Ids{ 1 }));
+		REQUIRE(index.installedByEmoji(Emoji(0)) == (Ids{ 2, 1 }));
+	}
+}
+
+TEST_CASE("sets are found by words", "[Stickers::Index]") {
+	auto index = SearchIndex();
+	index.update(1, Loaded({}, { "funny", "cats" }));
+	index.update(2, Loaded({}, { "cat", "faces" }));
+	index.update(3, Loaded({}, { "dogs" }));
+
+	SECTION("by a prefix of a word") {
+		REQUIRE(Search(index, { "cat" }) == (Ids{ 1, 2 }));
+		REQUIRE(Search(index, { "cats" }) == (Ids{ 1 }));
+		REQUIRE(Search(index, { "f" }) == (Ids{ 1, 2 }));
+		REQUIRE(Search(index, { "d" }) == (Ids{ 3 }));
+		REQUIRE(Search(index, { "ats" }).empty());
+		REQUIRE(Search(index, {}).empty());
+	}
+
+	SECTION("by all the query words") {
+		REQUIRE(Search(index, { "cat", "fa" }) == (Ids{ 2 }));
+		REQUIRE(Search(index, { "fu", "cat" }) == (Ids{ 1 }));
+		REQUIRE(Search(index, { "dogs", "cat" }).empty());
+	}
+
+	SECTION("added, removed and renamed") {
+		index.update(4, Loaded({}, { "catalog" }));
+		REQUIRE(Search(index, { "cat" }) == (Ids{ 1, 2, 4 }));
+
+		index.remove(1);
+		REQUIRE(Search(index, { "cat" }) == (Ids{ 2, 4 }));
+		REQUIRE(Search(index, { "funny" }).empty());
+
+		index.update(2, Loaded({}, { "angry", "dogs" }));
+		REQUIRE(Search(index, { "cat" }) == (Ids{ 4 }));
+		REQUIRE(Search(index, { "faces" }).empty());
+		REQUIRE(Search(index, { "dogs" }) == (Ids{ 2, 3 }));
+		REQUIRE(Search(index, { "an" }) == (Ids{ 2 }));
+	}
+}
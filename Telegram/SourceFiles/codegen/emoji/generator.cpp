@@ -15,6 +15,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtGui/QPainter>
 #include <QtCore/QDir>
 
+#include <array>
+
 #ifdef SUPPORT_IMAGE_GENERATION
 Q_IMPORT_PLUGIN(QWebpPlugin)
 #ifdef Q_OS_MAC
@@ -169,6 +171,7 @@ Generator::Generator(const Options &options) : project_(Project)
 	outputPath_ = dir.absolutePath() + "/emoji";
 	spritePath_ = dir.absolutePath() + "/emoji";
 	suggestionsPath_ = dir.absolutePath() + "/emoji_suggestions_data";
+	findReferencePath_ = dir.absolutePath() + "/emoji_find_reference";
 }
 
 int Generator::generate() {
@@ -194,6 +197,9 @@ int Generator::generate() {
 	if (!writeSuggestionsHeader()) {
 		return -1;
 	}
+	if (!writeFindReference()) {
+		return -1;
+	}
 
 	return 0;
 }
@@ -602,41 +608,265 @@ const std::vector<std::pair<QString, int>> ReplacementPairs = {\n";
 	{ qsl(\"" << what << "\"), " << index << " },\n";
 	}
 	source_->stream() << "\
-};\n\
+};\n";
+
+	return writeFindTable(source_.get(), "FindReplace", data_.replaces);
+}
+
+bool Generator::writeFind() {
+	return writeFindTable(source_.get(), "Find", data_.map, true);
+}
+
+bool Generator::writeFindReference() {
+	auto header = std::make_unique<common::CppFile>(findReferencePath_ + ".h", project_);
+	header->include("QtCore/QString").include("vector").newline();
+	header->pushNamespace("Ui").pushNamespace("Emoji").pushNamespace("internal").pushNamespace("reference");
+	header->stream() << "\
 \n\
-int FindReplaceIndex(const QChar *start, const QChar *end, int *outLength) {\n\
-	auto ch = start;\n\
+// Not a part of the application, only the tests link this source.\n\
+//\n\
+// Find*Table() are generated the same way the matchers in emoji.cpp are,\n\
+// Find*Tree() are the previous switch based matchers, they return the\n\
+// emoji index + 1 or 0. The keys are all the matched strings.\n\
+\n\
+int FindTable(const QChar *start, const QChar *end, int *outLength = nullptr);\n\
+int FindTree(const QChar *start, const QChar *end, int *outLength = nullptr);\n\
+std::vector<QString> FindKeys();\n\
+\n\
+int FindReplaceTable(const QChar *start, const QChar *end, int *outLength = nullptr);\n\
+int FindReplaceTree(const QChar *start, const QChar *end, int *outLength = nullptr);\n\
+std::vector<QString> FindReplaceKeys();\n\
 \n";
-
-	if (!writeFindFromDictionary(data_.replaces)) {
+	if (!header->finalize()) {
 		return false;
 	}
 
-	source_->stream() << "\
+	auto source = std::make_unique<common::CppFile>(findReferencePath_ + ".cpp", project_);
+	source->include("algorithm").include("iterator").newline();
+	source->pushNamespace("Ui").pushNamespace("Emoji").pushNamespace("internal").pushNamespace("reference").pushNamespace();
+	source->stream() << "\
+\n\
+using uint32 = unsigned int;\n\
+\n\
+constexpr auto kPostfix = static_cast<ushort>(0xFE0F);\n\
+\n\
+std::vector<QString> CollectKeys(const ushort *data, const ushort *lengths, int count) {\n\
+	auto result = std::vector<QString>();\n\
+	result.reserve(count);\n\
+	for (auto i = 0; i != count; ++i) {\n\
+		result.emplace_back(reinterpret_cast<const QChar*>(data), lengths[i]);\n\
+		data += lengths[i];\n\
+	}\n\
+	return result;\n\
 }\n";
-
-	return true;
+	if (!writeFindReference(source.get(), "Find", data_.map, true)
+		|| !writeFindReference(source.get(), "FindReplace", data_.replaces, false)) {
+		return false;
+	}
+	source->popNamespace().newline();
+	source->stream() << "\
+int FindTable(const QChar *start, const QChar *end, int *outLength) {\n\
+	return FindIndex(start, end, outLength);\n\
+}\n\
+\n\
+int FindTree(const QChar *start, const QChar *end, int *outLength) {\n\
+	return FindTreeIndex(start, end, outLength);\n\
+}\n\
+\n\
+std::vector<QString> FindKeys() {\n\
+	return CollectKeys(FindKeysData, FindKeysLengths, int(std::size(FindKeysLengths)));\n\
+}\n\
+\n\
+int FindReplaceTable(const QChar *start, const QChar *end, int *outLength) {\n\
+	return FindReplaceIndex(start, end, outLength);\n\
+}\n\
+\n\
+int FindReplaceTree(const QChar *start, const QChar *end, int *outLength) {\n\
+	return FindReplaceTreeIndex(start, end, outLength);\n\
+}\n\
+\n\
+std::vector<QString> FindReplaceKeys() {\n\
+	return CollectKeys(FindReplaceKeysData, FindReplaceKeysLengths, int(std::size(FindReplaceKeysLengths)));\n\
+}\n\
+\n";
+	return source->finalize();
 }
 
-bool Generator::writeFind() {
-	source_->stream() << "\
-\n\
-int FindIndex(const QChar *start, const QChar *end, int *outLength) {\n\
+bool Generator::writeFindReference(common::CppFile *source, const QString &name, const std::map<QString, int, std::greater<QString>> &dictionary, bool skipPostfixes) {
+	if (!writeFindTable(source, name, dictionary, skipPostfixes)) {
+		return false;
+	}
+
+	source->stream() << "\
+int " << name << "TreeIndex(const QChar *start, const QChar *end, int *outLength) {\n\
 	auto ch = start;\n\
 \n";
+	if (!writeFindFromDictionary(source, dictionary, skipPostfixes)) {
+		return false;
+	}
+	source->stream() << "\
+}\n\
+\n\
+const ushort " << name << "KeysData[] = {";
+	startBinary();
+	for (const auto &[key, index] : dictionary) {
+		if (!writeStringBinary(source, key)) {
+			return false;
+		}
+	}
+	source->stream() << " };\n\
+\n\
+const ushort " << name << "KeysLengths[] = {";
+	startBinary();
+	for (const auto &[key, index] : dictionary) {
+		writeIntBinary(source, key.size());
+	}
+	source->stream() << " };\n\
+\n";
+	return true;
+}
 
-	if (!writeFindFromDictionary(data_.map, true)) {
+// Writes the dictionary as a trie in compressed sparse row form:
+// the edges of node N are [NameEdgesFrom[N], NameEdgesFrom[N + 1]),
+// sorted by character, so each step is a short binary search.
+// The first character is filtered by two 256-bit masks before that,
+// so plain text is rejected after a single table lookup.
+bool Generator::writeFindTable(common::CppFile *source, const QString &name, const std::map<QString, int, std::greater<QString>> &dictionary, bool skipPostfixes) {
+	struct Node {
+		std::map<ushort, int> children;
+		int result = 0;
+	};
+	auto nodes = std::vector<Node>(1);
+	auto lowMask = std::array<uint32, 8>();
+	auto highMask = std::array<uint32, 8>();
+	for (const auto &[key, index] : dictionary) {
+		if (key.isEmpty()) {
+			logDataError() << "empty key in " << name.toStdString() << " dictionary.";
+			return false;
+		}
+		const auto first = key[0].unicode();
+		if (first < 0x100) {
+			lowMask[first >> 5] |= (1U << (first & 0x1F));
+		} else {
+			highMask[(first >> 8) >> 5] |= (1U << ((first >> 8) & 0x1F));
+		}
+		auto node = 0;
+		for (const auto ch : key) {
+			const auto [i, inserted] = nodes[node].children.emplace(
+				ch.unicode(),
+				int(nodes.size()));
+			const auto next = i->second;
+			if (inserted) {
+				nodes.emplace_back();
+			}
+			node = next;
+		}
+		nodes[node].result = index + 1;
+	}
+
+	auto edgesCount = 0;
+	for (const auto &node : nodes) {
+		edgesCount += int(node.children.size());
+	}
+	if (nodes.size() >= std::numeric_limits<ushort>::max()
+		|| edgesCount >= std::numeric_limits<ushort>::max()) {
+		logDataError() << "Too many " << name.toStdString() << " trie elements.";
 		return false;
 	}
 
-	source_->stream() << "\
+	source->stream() << "\
+\n\
+const uint32 " << name << "FirstLow[] = {";
+	startBinary();
+	for (const auto mask : lowMask) {
+		writeUintBinary(source, mask);
+	}
+	source->stream() << " };\n\
+\n\
+const uint32 " << name << "FirstHigh[] = {";
+	startBinary();
+	for (const auto mask : highMask) {
+		writeUintBinary(source, mask);
+	}
+	source->stream() << " };\n\
+\n\
+const ushort " << name << "EdgesFrom[] = {";
+	startBinary();
+	auto edgesFrom = 0;
+	for (const auto &node : nodes) {
+		writeIntBinary(source, edgesFrom);
+		edgesFrom += int(node.children.size());
+	}
+	writeIntBinary(source, edgesFrom);
+	source->stream() << " };\n\
+\n\
+const ushort " << name << "EdgeChars[] = {";
+	startBinary();
+	for (const auto &node : nodes) {
+		for (const auto &[ch, target] : node.children) {
+			writeUintBinary(source, ch);
+		}
+	}
+	source->stream() << " };\n\
+\n\
+const ushort " << name << "EdgeTargets[] = {";
+	startBinary();
+	for (const auto &node : nodes) {
+		for (const auto &[ch, target] : node.children) {
+			writeIntBinary(source, target);
+		}
+	}
+	source->stream() << " };\n\
+\n\
+const ushort " << name << "Results[] = {";
+	startBinary();
+	for (const auto &node : nodes) {
+		writeIntBinary(source, node.result);
+	}
+	source->stream() << " };\n\
+\n\
+int " << name << "Index(const QChar *start, const QChar *end, int *outLength) {\n\
+	if (start == end) {\n\
+		return 0;\n\
+	}\n\
+	const auto first = start->unicode();\n\
+	const auto filter = (first < 0x100) ? first : (first >> 8);\n\
+	const auto mask = (first < 0x100) ? " << name << "FirstLow : " << name << "FirstHigh;\n\
+	if (!(mask[filter >> 5] & (1U << (filter & 0x1F)))) {\n\
+		return 0;\n\
+	}\n\
+\n\
+	auto result = 0;\n\
+	auto node = 0;\n\
+	for (auto ch = start; ch != end;) {\n\
+		const auto code = ch->unicode();\n\
+		const auto from = " << name << "EdgeChars + " << name << "EdgesFrom[node];\n\
+		const auto till = " << name << "EdgeChars + " << name << "EdgesFrom[node + 1];\n\
+		const auto found = std::lower_bound(from, till, code);\n\
+		if (found == till || *found != code) {\n\
+			break;\n\
+		}\n\
+		node = " << name << "EdgeTargets[found - " << name << "EdgeChars];\n";
+	if (skipPostfixes) {
+		source->stream() << "\
+		if (++ch != end && ch->unicode() == kPostfix) ++ch;\n";
+	} else {
+		source->stream() << "\
+		++ch;\n";
+	}
+	source->stream() << "\
+		if (const auto index = " << name << "Results[node]) {\n\
+			result = index;\n\
+			if (outLength) *outLength = (ch - start);\n\
+		}\n\
+	}\n\
+	return result;\n\
 }\n\
 \n";
-
 	return true;
 }
 
-bool Generator::writeFindFromDictionary(const std::map<QString, int, std::greater<QString>> &dictionary, bool skipPostfixes) {
+bool Generator::writeFindFromDictionary(common::CppFile *source, const std::map<QString, int, std::greater<QString>> &dictionary, bool skipPostfixes) {
 	auto tabs = [](int size) {
 		return QString(size, '\t');
 	};
@@ -659,16 +889,16 @@ bool Generator::writeFindFromDictionary(const std::map<QString, int, std::greate
 	auto tabsUsed = 1;
 	auto lengthsCounted = std::map<QString, bool>();
 
-	auto writeSkipPostfix = [this, &tabs, skipPostfixes](int tabsCount) {
+	auto writeSkipPostfix = [source, &tabs, skipPostfixes](int tabsCount) {
 		if (skipPostfixes) {
-			source_->stream() << tabs(tabsCount) << "if (++ch != end && ch->unicode() == kPostfix) ++ch;\n";
+			source->stream() << tabs(tabsCount) << "if (++ch != end && ch->unicode() == kPostfix) ++ch;\n";
 		} else {
-			source_->stream() << tabs(tabsCount) << "++ch;\n";
+			source->stream() << tabs(tabsCount) << "++ch;\n";
 		}
 	};
 
 	// Returns true if at least one check was finished.
-	auto finishChecksTillKey = [this, &chars, &checkTypes, &tabsUsed, tabs](const QString &key) {
+	auto finishChecksTillKey = [source, &chars, &checkTypes, &tabsUsed, tabs](const QString &key) {
 		auto result = false;
 		while (!chars.isEmpty() && key.midRef(0, chars.size()) != chars) {
 			result = true;
@@ -679,10 +909,10 @@ bool Generator::writeFindFromDictionary(const std::map<QString, int, std::greate
 			if (wasType == UsedCheckType::Switch || wasType == UsedCheckType::If) {
 				--tabsUsed;
 				if (wasType == UsedCheckType::Switch) {
-					source_->stream() << tabs(tabsUsed) << "break;\n";
+					source->stream() << tabs(tabsUsed) << "break;\n";
 				}
 				if ((!chars.isEmpty() && key.midRef(0, chars.size()) != chars) || key == chars) {
-					source_->stream() << tabs(tabsUsed) << "}\n";
+					source->stream() << tabs(tabsUsed) << "}\n";
 				}
 			}
 		}
@@ -715,7 +945,7 @@ bool Generator::writeFindFromDictionary(const std::map<QString, int, std::greate
 			if (dictionary.find(partialKey) != dictionary.cend()) {
 				if (lengthsCounted.find(partialKey) == lengthsCounted.cend()) {
 					lengthsCounted.insert(std::make_pair(partialKey, true));
-					source_->stream() << tabs(tabsUsed) << "if (outLength) *outLength = (ch - start);\n";
+					source->stream() << tabs(tabsUsed) << "if (outLength) *outLength = (ch - start);\n";
 				}
 			}
 
@@ -725,13 +955,13 @@ bool Generator::writeFindFromDictionary(const std::map<QString, int, std::greate
 			if (weContinueOldSwitch) {
 				weContinueOldSwitch = false;
 			} else if (!usedIfForCheck) {
-				source_->stream() << tabs(tabsUsed) << "if (ch != end) switch (ch->unicode()) {\n";
+				source->stream() << tabs(tabsUsed) << "if (ch != end) switch (ch->unicode()) {\n";
 			}
 			if (usedIfForCheck) {
-				source_->stream() << tabs(tabsUsed) << "if (ch != end && ch->unicode() == " << keyCharString << ") {\n";
+				source->stream() << tabs(tabsUsed) << "if (ch != end && ch->unicode() == " << keyCharString << ") {\n";
 				checkTypes.push_back(UsedCheckType::If);
 			} else {
-				source_->stream() << tabs(tabsUsed) << "case " << keyCharString << ":\n";
+				source->stream() << tabs(tabsUsed) << "case " << keyCharString << ":\n";
 				checkTypes.push_back(UsedCheckType::Switch);
 			}
 			writeSkipPostfix(++tabsUsed);
@@ -739,18 +969,18 @@ bool Generator::writeFindFromDictionary(const std::map<QString, int, std::greate
 		}
 		if (lengthsCounted.find(key) == lengthsCounted.cend()) {
 			lengthsCounted.insert(std::make_pair(key, true));
-			source_->stream() << tabs(tabsUsed) << "if (outLength) *outLength = (ch - start);\n";
+			source->stream() << tabs(tabsUsed) << "if (outLength) *outLength = (ch - start);\n";
 		}
 
 		// While IsReplaceEdge() currently is always true we just return the value.
-		//source_->stream() << tabs(1 + chars.size()) << "if (ch + " << chars.size() << " == end || IsReplaceEdge(*(ch + " << chars.size() << ")) || (ch + " << chars.size() << ")->unicode() == ' ') {\n";
-		//source_->stream() << tabs(1 + chars.size()) << "\treturn &Items[" << item.second << "];\n";
-		//source_->stream() << tabs(1 + chars.size()) << "}\n";
-		source_->stream() << tabs(tabsUsed) << "return " << (item.second + 1) << ";\n";
+		//source->stream() << tabs(1 + chars.size()) << "if (ch + " << chars.size() << " == end || IsReplaceEdge(*(ch + " << chars.size() << ")) || (ch + " << chars.size() << ")->unicode() == ' ') {\n";
+		//source->stream() << tabs(1 + chars.size()) << "\treturn &Items[" << item.second << "];\n";
+		//source->stream() << tabs(1 + chars.size()) << "}\n";
+		source->stream() << tabs(tabsUsed) << "return " << (item.second + 1) << ";\n";
 	}
 	finishChecksTillKey(QString());
 
-	source_->stream() << "\
+	source->stream() << "\
 \n\
 	return 0;\n";
 	return true;
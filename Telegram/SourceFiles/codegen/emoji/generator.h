@@ -48,7 +48,10 @@ private:
 	bool writeGetSections();
 	bool writeFindReplace();
 	bool writeFind();
-	bool writeFindFromDictionary(const std::map<QString, int, std::greater<QString>> &dictionary, bool skipPostfixes = false);
+	bool writeFindTable(common::CppFile *source, const QString &name, const std::map<QString, int, std::greater<QString>> &dictionary, bool skipPostfixes = false);
+	bool writeFindFromDictionary(common::CppFile *source, const std::map<QString, int, std::greater<QString>> &dictionary, bool skipPostfixes = false);
+	bool writeFindReference();
+	bool writeFindReference(common::CppFile *source, const QString &name, const std::map<QString, int, std::greater<QString>> &dictionary, bool skipPostfixes);
 	bool writeGetReplacements();
 	void startBinary();
 	bool writeStringBinary(common::CppFile *source, const QString &string);
@@ -69,6 +72,8 @@ private:
 	std::unique_ptr<common::CppFile> suggestionsSource_;
 	Replaces replaces_;
 
+	QString findReferencePath_;
+
 	int _binaryFullLength = 0;
 	int _binaryCount = 0;
 
@@ -0,0 +1,61 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/stats.h"
+
+namespace Core {
+namespace Stats {
+namespace {
+
+struct Registered {
+	const char *name = nullptr;
+	Source source;
+};
+
+std::vector<Registered> &Sources() {
+	static auto result = std::vector<Registered>();
+	return result;
+}
+
+} // namespace
+
+bool Register(const char *section, Source source) {
+	Expects(section != nullptr);
+	Expects(source != nullptr);
+
+	Sources().push_back({ section, std::move(source) });
+	return true;
+}
+
+std::vector<Section> Collect() {
+	auto result = std::vector<Section>();
+	for (const auto &[name, source] : Sources()) {
+		result.push_back({ name, source() });
+	}
+	ranges::sort(result, [](const Section &a, const Section &b) {
+		return strcmp(a.name, b.name) < 0;
+	});
+	return result;
+}
+
+void WriteToLog() {
+	for (const auto &section : Collect()) {
+		for (const auto &row : section.rows) {
+			auto values = QStringList();
+			for (const auto &[name, value] : row.values) {
+				values.push_back(qsl("%1 %2").arg(name).arg(value));
+			}
+			const auto title = row.name.isEmpty()
+				? QString::fromLatin1(section.name)
+				: (QString::fromLatin1(section.name) + ' ' + row.name);
+			LOG(("Stats: %1 - %2.").arg(title).arg(values.join(", ")));
+		}
+	}
+}
+
+} // namespace Stats
+} // namespace Core
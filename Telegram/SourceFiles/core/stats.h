@@ -0,0 +1,47 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Core {
+namespace Stats {
+
+// Debug counters of all the subsystems, written to the log together
+// by the "stats" settings code. Each subsystem registers its source
+// once, from a static initializer in its own translation unit:
+//
+// const auto StatsRegistered = Core::Stats::Register("images", [] {
+//     return std::vector<Core::Stats::Row>{ ... };
+// });
+
+struct Value {
+	const char *name = nullptr; // Static storage duration.
+	int64 value = 0;
+};
+
+struct Row {
+	QString name; // Empty if the section has only one row.
+	std::vector<Value> values;
+};
+
+// Thread: Main. Sources are invoked only from the main thread.
+using Source = Fn<std::vector<Row>()>;
+
+struct Section {
+	const char *name = nullptr;
+	std::vector<Row> rows;
+};
+
+// Thread: Any, before the main loop has started.
+bool Register(const char *section, Source source);
+
+// Thread: Main. Sections are sorted by name.
+std::vector<Section> Collect();
+void WriteToLog();
+
+} // namespace Stats
+} // namespace Core
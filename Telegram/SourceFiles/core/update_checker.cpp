@@ -26,10 +26,12 @@ extern "C" {
 #include <openssl/pem.h>
 #include <openssl/bio.h>
 #include <openssl/err.h>
+#include <openssl/sha.h>
 } // extern "C"
 
 #ifdef Q_OS_WIN // use Lzma SDK for win
 #include <LzmaLib.h>
+#include <LzmaDec.h>
 #else // Q_OS_WIN
 #include <lzma.h>
 #endif // else of Q_OS_WIN
@@ -41,6 +43,7 @@ constexpr auto kUpdaterTimeout = 10 * TimeMs(1000);
 constexpr auto kMaxResponseSize = 1024 * 1024;
 constexpr auto kMaxUpdateSize = 256 * 1024 * 1024;
 constexpr auto kChunkSize = 128 * 1024;
+constexpr auto kUnpackChunkSize = 1024 * 1024;
 
 #ifdef TDESKTOP_DISABLE_AUTOUPDATE
 bool UpdaterIsDisabled = true;
@@ -353,9 +356,358 @@ QString ExtractFilename(const QString &url) {
 	return QString();
 }
 
+// Counts the SHA1 of everything after the signature and the SHA1 in the
+// header, reading the file chunk by chunk, and compares it with the one
+// from the header. Nothing is unpacked before it is checked.
+bool CheckUpdateHash(
+		QFile &input,
+		bytes::const_span hashedHeader,
+		bytes::const_span sha1) {
+	auto context = SHA_CTX();
+	SHA1_Init(&context);
+	SHA1_Update(&context, hashedHeader.data(), hashedHeader.size());
+	auto buffer = bytes::vector(kUnpackChunkSize);
+	while (!input.atEnd()) {
+		const auto read = input.read(
+			reinterpret_cast<char*>(buffer.data()),
+			buffer.size());
+		if (read <= 0) {
+			LOG(("Update Error: could not read the update file."));
+			return false;
+		}
+		SHA1_Update(&context, buffer.data(), read);
+	}
+	auto counted = bytes::vector(SHA_DIGEST_LENGTH);
+	SHA1_Final(reinterpret_cast<uchar*>(counted.data()), &context);
+	if (bytes::compare(counted, sha1) != 0) {
+		LOG(("Update Error: bad SHA1 hash of update file!"));
+		return false;
+	}
+	return true;
+}
+
+// The names come from the signed update, still a name leading outside
+// of the temp folder could overwrite any file, so it is not accepted.
+QString UnpackedFilePath(const QString &folder, const QString &name) {
+	if (name.isEmpty() || name.contains(':') || QDir::isAbsolutePath(name)) {
+		return QString();
+	}
+	const auto base = QDir::cleanPath(folder) + '/';
+	const auto result = QDir::cleanPath(base + name);
+	return result.startsWith(base) ? result : QString();
+}
+
+// Gives out the decompressed update while reading the compressed file
+// chunk by chunk, so that neither the compressed nor the decompressed
+// update is kept in memory as a whole.
+//
+// The bytes are hashed again while they are read, because the file
+// could be changed after CheckUpdateHash() has read it.
+class UnpackDevice : public QIODevice {
+public:
+	UnpackDevice(QFile &input, bytes::const_span hashedHeader);
+	UnpackDevice(const UnpackDevice &other) = delete;
+	UnpackDevice &operator=(const UnpackDevice &other) = delete;
+	~UnpackDevice();
+
+	bool start(bytes::const_span props, int64 uncompressedSize);
+
+	// Checks that all the data was read.
+	bool finish();
+
+	// Reads the rest of the file and compares the hash of the read bytes.
+	bool checkHash(bytes::const_span sha1);
+
+	bool isSequential() const override;
+
+protected:
+	qint64 readData(char *data, qint64 maxlen) override;
+	qint64 writeData(const char *data, qint64 len) override;
+
+private:
+	bool readInput();
+	qint64 decompress(char *data, qint64 maxlen);
+
+	QFile &_input;
+	SHA_CTX _hash;
+	bytes::vector _buffer;
+	int _bufferOffset = 0;
+	int _bufferSize = 0;
+	int64 _uncompressedSize = 0;
+	int64 _produced = 0;
+	bool _inputFinished = false;
+	bool _streamFinished = false;
+
+#ifdef Q_OS_WIN
+	CLzmaDec _decoder;
+	bool _decoderAllocated = false;
+#else // Q_OS_WIN
+	lzma_stream _stream = LZMA_STREAM_INIT;
+#endif // Q_OS_WIN
+
+};
+
+#ifdef Q_OS_WIN
+// Templates match both the old and the new ISzAlloc callback signatures.
+template <typename Allocator>
+void *LzmaAlloc(Allocator, size_t size) {
+	return malloc(size);
+}
+
+template <typename Allocator>
+void LzmaFree(Allocator, void *address) {
+	free(address);
+}
+
+ISzAlloc LzmaAllocator = { LzmaAlloc, LzmaFree };
+#endif // Q_OS_WIN
+
+UnpackDevice::UnpackDevice(QFile &input, bytes::const_span hashedHeader)
+: _input(input)
+, _buffer(kUnpackChunkSize) {
+	SHA1_Init(&_hash);
+	SHA1_Update(&_hash, hashedHeader.data(), hashedHeader.size());
+}
+
+UnpackDevice::~UnpackDevice() {
+#ifdef Q_OS_WIN
+	if (_decoderAllocated) {
+		LzmaDec_Free(&_decoder, &LzmaAllocator);
+	}
+#else // Q_OS_WIN
+	lzma_end(&_stream);
+#endif // Q_OS_WIN
+}
+
+bool UnpackDevice::start(
+		bytes::const_span props,
+		int64 uncompressedSize) {
+	_uncompressedSize = uncompressedSize;
+
+#ifdef Q_OS_WIN
+	LzmaDec_Construct(&_decoder);
+	const auto result = LzmaDec_Allocate(
+		&_decoder,
+		reinterpret_cast<const uchar*>(props.data()),
+		props.size(),
+		&LzmaAllocator);
+	if (result != SZ_OK) {
+		LOG(("Update Error: could not init lzma decoder, code: %1"
+			).arg(result));
+		return false;
+	}
+	_decoderAllocated = true;
+	LzmaDec_Init(&_decoder);
+#else // Q_OS_WIN
+	const auto ret = lzma_stream_decoder(
+		&_stream,
+		UINT64_MAX,
+		LZMA_CONCATENATED);
+	if (ret != LZMA_OK) {
+		const char *msg;
+		switch (ret) {
+		case LZMA_MEM_ERROR: msg = "Memory allocation failed"; break;
+		case LZMA_OPTIONS_ERROR: msg = "Specified preset is not supported"; break;
+		case LZMA_UNSUPPORTED_CHECK: msg = "Specified integrity check is not supported"; break;
+		default: msg = "Unknown error, possibly a bug"; break;
+		}
+		LOG(("Error initializing the decoder: %1 (error code %2)").arg(msg).arg(ret));
+		return false;
+	}
+#endif // Q_OS_WIN
+
+	return open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+bool UnpackDevice::isSequential() const {
+	return true;
+}
+
+bool UnpackDevice::readInput() {
+	const auto read = _input.read(
+		reinterpret_cast<char*>(_buffer.data()),
+		_buffer.size());
+	if (read < 0) {
+		LOG(("Update Error: could not read the update file."));
+		return false;
+	}
+	SHA1_Update(&_hash, _buffer.data(), read);
+	_bufferOffset = 0;
+	_bufferSize = int(read);
+	_inputFinished = (read < qint64(_buffer.size())) || _input.atEnd();
+	return true;
+}
+
+qint64 UnpackDevice::readData(char *data, qint64 maxlen) {
+	auto produced = qint64(0);
+	while (produced < maxlen && !_streamFinished) {
+		if (_bufferOffset == _bufferSize && !_inputFinished) {
+			if (!readInput()) {
+				return -1;
+			}
+		}
+		const auto result = decompress(data + produced, maxlen - produced);
+		if (result < 0) {
+			return -1;
+		} else if (!result
+			&& !_streamFinished
+			&& _bufferOffset == _bufferSize
+			&& _inputFinished) {
+			LOG(("Update Error: compressed data is truncated, "
+				"%1 of %2 bytes decompressed."
+				).arg(_produced
+				).arg(_uncompressedSize));
+			return -1;
+		}
+		produced += result;
+	}
+	return produced;
+}
+
+qint64 UnpackDevice::decompress(char *data, qint64 maxlen) {
+	const auto available = _bufferSize - _bufferOffset;
+	const auto input = reinterpret_cast<const uchar*>(
+		_buffer.data() + _bufferOffset);
+
+#ifdef Q_OS_WIN
+	const auto left = _uncompressedSize - _produced;
+	auto outputLength = SizeT(std::min(maxlen, left));
+	auto inputLength = SizeT(available);
+	auto status = ELzmaStatus();
+	const auto result = LzmaDec_DecodeToBuf(
+		&_decoder,
+		reinterpret_cast<uchar*>(data),
+		&outputLength,
+		input,
+		&inputLength,
+		LZMA_FINISH_ANY,
+		&status);
+	if (result != SZ_OK) {
+		LOG(("Update Error: could not uncompress lzma, code: %1"
+			).arg(result));
+		return -1;
+	}
+	_bufferOffset += int(inputLength);
+	_produced += outputLength;
+	if (_produced == _uncompressedSize
+		|| status == LZMA_STATUS_FINISHED_WITH_MARK) {
+		_streamFinished = true;
+	}
+	return qint64(outputLength);
+#else // Q_OS_WIN
+	_stream.next_in = input;
+	_stream.avail_in = available;
+	_stream.next_out = reinterpret_cast<uint8_t*>(data);
+	_stream.avail_out = maxlen;
+
+	const auto res = lzma_code(
+		&_stream,
+		_inputFinished ? LZMA_FINISH : LZMA_RUN);
+	const auto result = qint64(maxlen - _stream.avail_out);
+	_bufferOffset += int(available - _stream.avail_in);
+	_produced += result;
+	if (res == LZMA_STREAM_END) {
+		_streamFinished = true;
+	} else if (res != LZMA_OK && !(res == LZMA_BUF_ERROR && result > 0)) {
+		const char *msg;
+		switch (res) {
+		case LZMA_MEM_ERROR: msg = "Memory allocation failed"; break;
+		case LZMA_FORMAT_ERROR: msg = "The input data is not in the .xz format"; break;
+		case LZMA_OPTIONS_ERROR: msg = "Unsupported compression options"; break;
+		case LZMA_DATA_ERROR: msg = "Compressed file is corrupt"; break;
+		case LZMA_BUF_ERROR: msg = "Compressed data is truncated or otherwise corrupt"; break;
+		default: msg = "Unknown error, possibly a bug"; break;
+		}
+		LOG(("Error in decompression: %1 (error code %2)").arg(msg).arg(res));
+		return -1;
+	}
+	return result;
+#endif // Q_OS_WIN
+}
+
+qint64 UnpackDevice::writeData(const char *data, qint64 len) {
+	return -1;
+}
+
+bool UnpackDevice::finish() {
+	auto tail = char();
+	if (read(&tail, 1) != 0) {
+		LOG(("Update Error: "
+			"unexpected data after the files in the update."));
+		return false;
+	} else if (_produced != _uncompressedSize) {
+		LOG(("Error in decompression, %1 bytes of %2 whole."
+			).arg(_produced
+			).arg(_uncompressedSize));
+		return false;
+	}
+#ifndef Q_OS_WIN
+	if (_bufferOffset != _bufferSize || !_inputFinished) {
+		LOG(("Error in decompression, bytes left after the stream end."));
+		return false;
+	}
+#endif // Q_OS_WIN
+	return true;
+}
+
+bool UnpackDevice::checkHash(bytes::const_span sha1) {
+	while (!_input.atEnd()) {
+		const auto read = _input.read(
+			reinterpret_cast<char*>(_buffer.data()),
+			_buffer.size());
+		if (read <= 0) {
+			LOG(("Update Error: could not read the update file."));
+			return false;
+		}
+		SHA1_Update(&_hash, _buffer.data(), read);
+	}
+	auto counted = bytes::vector(SHA_DIGEST_LENGTH);
+	SHA1_Final(reinterpret_cast<uchar*>(counted.data()), &_hash);
+	if (bytes::compare(counted, sha1) != 0) {
+		LOG(("Update Error: update file has changed while unpacking!"));
+		return false;
+	}
+	return true;
+}
+
+bool WriteUnpackedFile(
+		QDataStream &stream,
+		const QString &path,
+		quint32 size) {
+	QFile f(path);
+	if (!QDir().mkpath(QFileInfo(f).absolutePath())) {
+		LOG(("Update Error: cant mkpath for file '%1'").arg(path));
+		return false;
+	}
+	if (!f.open(QIODevice::WriteOnly)) {
+		LOG(("Update Error: cant open file '%1' for writing").arg(path));
+		return false;
+	}
+	auto buffer = bytes::vector(std::min(size, quint32(kUnpackChunkSize)));
+	for (auto left = size; left != 0;) {
+		const auto chunk = std::min(left, quint32(buffer.size()));
+		const auto read = stream.readRawData(
+			reinterpret_cast<char*>(buffer.data()),
+			chunk);
+		if (read != chunk) {
+			LOG(("Update Error: cant read file '%1' from downloaded stream"
+				).arg(path));
+			return false;
+		}
+		const auto written = f.write(
+			reinterpret_cast<const char*>(buffer.data()),
+			chunk);
+		if (written != chunk) {
+			LOG(("Update Error: cant write file '%1', desiredSize: %2, write result: %3").arg(path).arg(chunk).arg(written));
+			return false;
+		}
+		left -= chunk;
+	}
+	return true;
+}
+
 bool UnpackUpdate(const QString &filepath) {
 	QFile input(filepath);
-	QByteArray packed;
 	if (!input.open(QIODevice::ReadOnly)) {
 		LOG(("Update Error: cant read updates file!"));
 		return false;
@@ -367,13 +719,11 @@ bool UnpackUpdate(const QString &filepath) {
 	const int32 hSigLen = 128, hShaLen = 20, hPropsLen = 0, hOriginalSizeLen = sizeof(int32), hSize = hSigLen + hShaLen + hOriginalSizeLen; // header
 #endif // Q_OS_WIN
 
-	QByteArray compressed = input.readAll();
-	int32 compressedLen = compressed.size() - hSize;
-	if (compressedLen <= 0) {
-		LOG(("Update Error: bad compressed size: %1").arg(compressed.size()));
+	const auto header = input.read(hSize);
+	if (header.size() != hSize || input.size() <= hSize) {
+		LOG(("Update Error: bad compressed size: %1").arg(input.size()));
 		return false;
 	}
-	input.close();
 
 	QString tempDirPath = cWorkingDir() + qsl("tupdates/temp"), readyFilePath = cWorkingDir() + qsl("tupdates/temp/ready");
 	psDeleteDir(tempDirPath);
@@ -384,19 +734,14 @@ bool UnpackUpdate(const QString &filepath) {
 		return false;
 	}
 
-	uchar sha1Buffer[20];
-	bool goodSha1 = !memcmp(compressed.constData() + hSigLen, hashSha1(compressed.constData() + hSigLen + hShaLen, compressedLen + hPropsLen + hOriginalSizeLen, sha1Buffer), hShaLen);
-	if (!goodSha1) {
-		LOG(("Update Error: bad SHA1 hash of update file!"));
-		return false;
-	}
-
+	// The signature is checked for the SHA1 from the header and the SHA1
+	// itself is checked for the whole file before unpacking.
 	RSA *pbKey = PEM_read_bio_RSAPublicKey(BIO_new_mem_buf(const_cast<char*>(AppBetaVersion ? UpdatesPublicBetaKey : UpdatesPublicKey), -1), 0, 0, 0);
 	if (!pbKey) {
 		LOG(("Update Error: cant read public rsa key!"));
 		return false;
 	}
-	if (RSA_verify(NID_sha1, (const uchar*)(compressed.constData() + hSigLen), hShaLen, (const uchar*)(compressed.constData()), hSigLen, pbKey) != 1) { // verify signature
+	if (RSA_verify(NID_sha1, (const uchar*)(header.constData() + hSigLen), hShaLen, (const uchar*)(header.constData()), hSigLen, pbKey) != 1) { // verify signature
 		RSA_free(pbKey);
 
 		// try other public key, if we update from beta to stable or vice versa
@@ -405,7 +750,7 @@ bool UnpackUpdate(const QString &filepath) {
 			LOG(("Update Error: cant read public rsa key!"));
 			return false;
 		}
-		if (RSA_verify(NID_sha1, (const uchar*)(compressed.constData() + hSigLen), hShaLen, (const uchar*)(compressed.constData()), hSigLen, pbKey) != 1) { // verify signature
+		if (RSA_verify(NID_sha1, (const uchar*)(header.constData() + hSigLen), hShaLen, (const uchar*)(header.constData()), hSigLen, pbKey) != 1) { // verify signature
 			RSA_free(pbKey);
 			LOG(("Update Error: bad RSA signature of update file!"));
 			return false;
@@ -413,76 +758,43 @@ bool UnpackUpdate(const QString &filepath) {
 	}
 	RSA_free(pbKey);
 
-	QByteArray uncompressed;
-
 	int32 uncompressedLen;
-	memcpy(&uncompressedLen, compressed.constData() + hSigLen + hShaLen + hPropsLen, hOriginalSizeLen);
-	uncompressed.resize(uncompressedLen);
+	memcpy(&uncompressedLen, header.constData() + hSigLen + hShaLen + hPropsLen, hOriginalSizeLen);
 
-	size_t resultLen = uncompressed.size();
-#ifdef Q_OS_WIN // use Lzma SDK for win
-	SizeT srcLen = compressedLen;
-	int uncompressRes = LzmaUncompress((uchar*)uncompressed.data(), &resultLen, (const uchar*)(compressed.constData() + hSize), &srcLen, (const uchar*)(compressed.constData() + hSigLen + hShaLen), LZMA_PROPS_SIZE);
-	if (uncompressRes != SZ_OK) {
-		LOG(("Update Error: could not uncompress lzma, code: %1").arg(uncompressRes));
+	const auto headerBytes = bytes::make_span(header);
+	if (!CheckUpdateHash(
+			input,
+			headerBytes.subspan(hSigLen + hShaLen),
+			headerBytes.subspan(hSigLen, hShaLen))) {
 		return false;
-	}
-#else // Q_OS_WIN
-	lzma_stream stream = LZMA_STREAM_INIT;
-
-	lzma_ret ret = lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED);
-	if (ret != LZMA_OK) {
-		const char *msg;
-		switch (ret) {
-		case LZMA_MEM_ERROR: msg = "Memory allocation failed"; break;
-		case LZMA_OPTIONS_ERROR: msg = "Specified preset is not supported"; break;
-		case LZMA_UNSUPPORTED_CHECK: msg = "Specified integrity check is not supported"; break;
-		default: msg = "Unknown error, possibly a bug"; break;
-		}
-		LOG(("Error initializing the decoder: %1 (error code %2)").arg(msg).arg(ret));
+	} else if (!input.seek(hSize)) {
+		LOG(("Update Error: could not seek in the update file."));
 		return false;
 	}
-
-	stream.avail_in = compressedLen;
-	stream.next_in = (uint8_t*)(compressed.constData() + hSize);
-	stream.avail_out = resultLen;
-	stream.next_out = (uint8_t*)uncompressed.data();
-
-	lzma_ret res = lzma_code(&stream, LZMA_FINISH);
-	if (stream.avail_in) {
-		LOG(("Error in decompression, %1 bytes left in _in of %2 whole.").arg(stream.avail_in).arg(compressedLen));
-		return false;
-	} else if (stream.avail_out) {
-		LOG(("Error in decompression, %1 bytes free left in _out of %2 whole.").arg(stream.avail_out).arg(resultLen));
+	UnpackDevice device(input, headerBytes.subspan(hSigLen + hShaLen));
+	if (uncompressedLen <= 0
+		|| !device.start(
+			headerBytes.subspan(hSigLen + hShaLen, hPropsLen),
+			uncompressedLen)) {
 		return false;
 	}
-	lzma_end(&stream);
-	if (res != LZMA_OK && res != LZMA_STREAM_END) {
-		const char *msg;
-		switch (res) {
-		case LZMA_MEM_ERROR: msg = "Memory allocation failed"; break;
-		case LZMA_FORMAT_ERROR: msg = "The input data is not in the .xz format"; break;
-		case LZMA_OPTIONS_ERROR: msg = "Unsupported compression options"; break;
-		case LZMA_DATA_ERROR: msg = "Compressed file is corrupt"; break;
-		case LZMA_BUF_ERROR: msg = "Compressed data is truncated or otherwise corrupt"; break;
-		default: msg = "Unknown error, possibly a bug"; break;
-		}
-		LOG(("Error in decompression: %1 (error code %2)").arg(msg).arg(res));
+
+	const auto failed = [&] {
+		psDeleteDir(tempDirPath);
 		return false;
-	}
-#endif // Q_OS_WIN
+	};
 
 	tempDir.mkdir(tempDir.absolutePath());
 
 	quint32 version;
 	{
-		QDataStream stream(uncompressed);
+		QDataStream stream(&device);
 		stream.setVersion(QDataStream::Qt_5_1);
 
 		stream >> version;
 		if (stream.status() != QDataStream::Ok) {
 			LOG(("Update Error: cant read version from downloaded stream, status: %1").arg(stream.status()));
-			return false;
+			return failed();
 		}
 
 		quint64 alphaVersion = 0;
@@ -490,67 +802,71 @@ bool UnpackUpdate(const QString &filepath) {
 			stream >> alphaVersion;
 			if (stream.status() != QDataStream::Ok) {
 				LOG(("Update Error: cant read alpha version from downloaded stream, status: %1").arg(stream.status()));
-				return false;
+				return failed();
 			}
 			if (!cAlphaVersion() || alphaVersion <= cAlphaVersion()) {
 				LOG(("Update Error: downloaded alpha version %1 is not greater, than mine %2").arg(alphaVersion).arg(cAlphaVersion()));
-				return false;
+				return failed();
 			}
 		} else if (int32(version) <= AppVersion) {
 			LOG(("Update Error: downloaded version %1 is not greater, than mine %2").arg(version).arg(AppVersion));
-			return false;
+			return failed();
 		}
 
 		quint32 filesCount;
 		stream >> filesCount;
 		if (stream.status() != QDataStream::Ok) {
 			LOG(("Update Error: cant read files count from downloaded stream, status: %1").arg(stream.status()));
-			return false;
+			return failed();
 		}
 		if (!filesCount) {
 			LOG(("Update Error: update is empty!"));
-			return false;
+			return failed();
 		}
 		for (uint32 i = 0; i < filesCount; ++i) {
 			QString relativeName;
 			quint32 fileSize;
-			QByteArray fileInnerData;
-			bool executable = false;
+			quint32 fileInnerSize; // QByteArray serialized size.
 
-			stream >> relativeName >> fileSize >> fileInnerData;
-#if defined Q_OS_MAC || defined Q_OS_LINUX
-			stream >> executable;
-#endif // Q_OS_MAC || Q_OS_LINUX
+			stream >> relativeName >> fileSize >> fileInnerSize;
 			if (stream.status() != QDataStream::Ok) {
 				LOG(("Update Error: cant read file from downloaded stream, status: %1").arg(stream.status()));
-				return false;
+				return failed();
 			}
-			if (fileSize != quint32(fileInnerData.size())) {
-				LOG(("Update Error: bad file size %1 not matching data size %2").arg(fileSize).arg(fileInnerData.size()));
-				return false;
+			if (fileSize != fileInnerSize) {
+				LOG(("Update Error: bad file size %1 not matching data size %2").arg(fileSize).arg(fileInnerSize));
+				return failed();
 			}
 
-			QFile f(tempDirPath + '/' + relativeName);
-			if (!QDir().mkpath(QFileInfo(f).absolutePath())) {
-				LOG(("Update Error: cant mkpath for file '%1'").arg(tempDirPath + '/' + relativeName));
-				return false;
+			const auto path = UnpackedFilePath(tempDirPath, relativeName);
+			if (path.isEmpty()) {
+				LOG(("Update Error: bad file name '%1' in the update."
+					).arg(relativeName));
+				return failed();
 			}
-			if (!f.open(QIODevice::WriteOnly)) {
-				LOG(("Update Error: cant open file '%1' for writing").arg(tempDirPath + '/' + relativeName));
-				return false;
+
+			// The executable flag follows the file data.
+			if (!WriteUnpackedFile(stream, path, fileSize)) {
+				return failed();
 			}
-			auto writtenBytes = f.write(fileInnerData);
-			if (writtenBytes != fileSize) {
-				f.close();
-				LOG(("Update Error: cant write file '%1', desiredSize: %2, write result: %3").arg(tempDirPath + '/' + relativeName).arg(fileSize).arg(writtenBytes));
-				return false;
+#if defined Q_OS_MAC || defined Q_OS_LINUX
+			bool executable = false;
+			stream >> executable;
+			if (stream.status() != QDataStream::Ok) {
+				LOG(("Update Error: cant read file from downloaded stream, status: %1").arg(stream.status()));
+				return failed();
 			}
-			f.close();
 			if (executable) {
+				QFile f(path);
 				QFileDevice::Permissions p = f.permissions();
 				p |= QFileDevice::ExeOwner | QFileDevice::ExeUser | QFileDevice::ExeGroup | QFileDevice::ExeOther;
 				f.setPermissions(p);
 			}
+#endif // Q_OS_MAC || Q_OS_LINUX
+		}
+		if (!device.finish()
+			|| !device.checkHash(headerBytes.subspan(hSigLen, hShaLen))) {
+			return failed();
 		}
 
 		// create tdata/version file
@@ -606,11 +606,7 @@ void DocumentData::performActionOnLoad() {
 		if (loaded()) {
 			auto state = Media::Player::mixer()->currentState(AudioMsgId::Type::Song);
 			if (state.id == AudioMsgId(this, _actionOnLoadMsgId) && !Media::Player::IsStoppedOrStopping(state.state)) {
-				if (Media::Player::IsPaused(state.state) || state.state == State::Pausing) {
-					Media::Player::mixer()->resume(state.id);
-				} else {
-					Media::Player::mixer()->pause(state.id);
-				}
+				// Already playing from the parts loaded so far.
 			} else if (Media::Player::IsStopped(state.state)) {
 				auto song = AudioMsgId(this, _actionOnLoadMsgId);
 				Media::Player::mixer()->play(song);
@@ -683,6 +679,10 @@ QString DocumentData::loadingFilePath() const {
 	return loading() ? _loader->fileName() : QString();
 }
 
+std::shared_ptr<Media::Streaming::SparseFile> DocumentData::stream() const {
+	return loading() ? _loader->stream() : nullptr;
+}
+
 bool DocumentData::displayLoading() const {
 	return loading()
 		? (!_loader->loadingLocal() || !_loader->autoLoading())
@@ -1110,6 +1110,10 @@ Storage::Cache::Key DocumentData::cacheKey() const {
 	}
 }
 
+Storage::Cache::Key DocumentData::waveformCacheKey() const {
+	return Data::VoiceWaveformCacheKey(_dc, id);
+}
+
 uint8 DocumentData::cacheTag() const {
 	if (type == StickerDocument) {
 		return Data::kStickerCacheTag;
@@ -15,6 +15,12 @@ struct Key;
 } // namespace Cache
 } // namespace Storage
 
+namespace Media {
+namespace Streaming {
+class SparseFile;
+} // namespace Streaming
+} // namespace Media
+
 class AuthSession;
 class mtpFileLoader;
 
@@ -94,6 +100,7 @@ public:
 	bool loading() const;
 	QString loadingFilePath() const;
 	bool displayLoading() const;
+	std::shared_ptr<Media::Streaming::SparseFile> stream() const;
 	void save(
 		Data::FileOrigin origin,
 		const QString &toFile,
@@ -182,6 +189,7 @@ public:
 	MediaKey mediaKey() const;
 	Storage::Cache::Key cacheKey() const;
 	uint8 cacheTag() const;
+	Storage::Cache::Key waveformCacheKey() const;
 
 	static QString ComposeNameString(
 		const QString &filename,
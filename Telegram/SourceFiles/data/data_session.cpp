@@ -71,6 +71,7 @@ Session::Session(not_null<AuthSession*> session)
 , _cache(Messenger::Instance().databases().get(
 	Local::cachePath(),
 	Local::cacheSettings()))
+, _stickersIndex(&_stickerSets, &_stickerSetsOrder)
 , _groups(this)
 , _unmuteByFinishedTimer([=] { unmuteByFinished(); }) {
 	_cache->open(Local::cacheKey());
@@ -511,6 +512,9 @@ rpl::producer<FeedUpdate> Session::feedUpdated() const {
 }
 
 void Session::notifyStickersUpdated() {
+	// The sets could be changed after taking a reference to them.
+	_stickersIndex.setsChanged();
+	_stickersIndex.orderChanged();
 	_stickersUpdated.fire({});
 }
 
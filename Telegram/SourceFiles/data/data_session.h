@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "storage/storage_databases.h"
 #include "chat_helpers/stickers.h"
+#include "chat_helpers/stickers_index.h"
 #include "dialogs/dialogs_key.h"
 #include "data/data_groups.h"
 #include "base/timer.h"
@@ -194,12 +195,14 @@ public:
 		return _stickerSets;
 	}
 	Stickers::Sets &stickerSetsRef() {
+		_stickersIndex.setsChanged();
 		return _stickerSets;
 	}
 	const Stickers::Order &stickerSetsOrder() const {
 		return _stickerSetsOrder;
 	}
 	Stickers::Order &stickerSetsOrderRef() {
+		_stickersIndex.orderChanged();
 		return _stickerSetsOrder;
 	}
 	const Stickers::Order &featuredStickerSetsOrder() const {
@@ -214,6 +217,9 @@ public:
 	Stickers::Order &archivedStickerSetsOrderRef() {
 		return _archivedStickerSetsOrder;
 	}
+	Stickers::Index &stickersIndex() {
+		return _stickersIndex;
+	}
 	const Stickers::SavedGifs &savedGifs() const {
 		return _savedGifs;
 	}
@@ -577,6 +583,7 @@ private:
 	Stickers::Order _featuredStickerSetsOrder;
 	Stickers::Order _archivedStickerSetsOrder;
 	Stickers::SavedGifs _savedGifs;
+	Stickers::Index _stickersIndex;
 
 	std::unordered_map<
 		PhotoId,
@@ -177,6 +177,7 @@ SparseIdsSliceBuilder::SparseIdsSliceBuilder(
 
 bool SparseIdsSliceBuilder::applyInitial(
 		const Storage::SparseIdsListResult &result) {
+	applyCountRestored(result.count, result.countRestored);
 	mergeSliceData(
 		result.count,
 		result.messageIds,
@@ -196,9 +197,19 @@ bool SparseIdsSliceBuilder::applyUpdate(
 			_ids.empty() ? _key : _ids.front(),
 			_ids.empty() ? _key : _ids.back()
 		});
+	if (!update.count && _fullCountRestored) {
+		// The list has changed, so the restored count is not valid anymore.
+		_fullCount = std::nullopt;
+		_fullCountRestored = false;
+		if (!needMergeMessages) {
+			checkInsufficient();
+			return true;
+		}
+	}
 	if (!needMergeMessages && !update.count) {
 		return false;
 	}
+	applyCountRestored(update.count, update.countRestored);
 	auto skippedBefore = (update.range.from == 0)
 		? 0
 		: std::optional<int> {};
@@ -247,6 +258,7 @@ bool SparseIdsSliceBuilder::removeAll() {
 	_ids = {};
 	_range = { 0, ServerMaxMsgId };
 	_fullCount = 0;
+	_fullCountRestored = false;
 	_skippedBefore = 0;
 	_skippedAfter = 0;
 	return true;
@@ -254,6 +266,7 @@ bool SparseIdsSliceBuilder::removeAll() {
 
 bool SparseIdsSliceBuilder::invalidateBottom() {
 	_fullCount = _skippedAfter = std::nullopt;
+	_fullCountRestored = false;
 	if (_range.till == ServerMaxMsgId) {
 		_range.till = _ids.empty() ? _range.from : _ids.back();
 	}
@@ -265,6 +278,18 @@ void SparseIdsSliceBuilder::checkInsufficient() {
 	sliceToLimits();
 }
 
+void SparseIdsSliceBuilder::applyCountRestored(
+		std::optional<int> count,
+		bool restored) {
+	if (count) {
+		_fullCountRestored = restored;
+	}
+}
+
+bool SparseIdsSliceBuilder::needMessagesCount() const {
+	return !_fullCount;
+}
+
 void SparseIdsSliceBuilder::mergeSliceData(
 		std::optional<int> count,
 		const base::flat_set<MsgId> &messageIds,
@@ -335,7 +360,7 @@ void SparseIdsSliceBuilder::fillSkippedAndSliceToLimits() {
 
 void SparseIdsSliceBuilder::sliceToLimits() {
 	if (!_key) {
-		if (!_fullCount) {
+		if (needMessagesCount()) {
 			requestMessagesCount();
 		}
 		return;
@@ -364,7 +389,7 @@ void SparseIdsSliceBuilder::sliceToLimits() {
 		requestedSomething = true;
 		requestMessages(RequestDirection::After);
 	}
-	if (!_fullCount && !requestedSomething) {
+	if (needMessagesCount() && !requestedSomething) {
 		requestMessagesCount();
 	}
 }
@@ -379,6 +404,7 @@ void SparseIdsSliceBuilder::requestMessages(
 		}
 		return { _ids.back(), Data::LoadDirection::After };
 	};
+
 	_insufficientAround.fire(requestAroundData());
 }
 
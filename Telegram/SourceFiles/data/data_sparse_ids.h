@@ -196,6 +196,8 @@ private:
 	};
 	void requestMessages(RequestDirection direction);
 	void requestMessagesCount();
+	bool needMessagesCount() const;
+	void applyCountRestored(std::optional<int> count, bool restored);
 	void fillSkippedAndSliceToLimits();
 	void sliceToLimits();
 
@@ -211,6 +213,11 @@ private:
 	std::optional<int> _fullCount;
 	std::optional<int> _skippedBefore;
 	std::optional<int> _skippedAfter;
+
+	// A count restored from the local cache is trusted until a slice
+	// update without a count shows that the list has changed.
+	bool _fullCountRestored = false;
+
 	int _limitBefore = 0;
 	int _limitAfter = 0;
 
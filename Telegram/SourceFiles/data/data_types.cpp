@@ -17,6 +17,8 @@ namespace {
 
 constexpr auto kDocumentCacheTag = 0x0000000000000100ULL;
 constexpr auto kDocumentCacheMask = 0x00000000000000FFULL;
+constexpr auto kVoiceWaveformCacheTag = 0x0000000000000200ULL;
+constexpr auto kVoiceWaveformCacheMask = 0x00000000000000FFULL;
 constexpr auto kStorageCacheTag = 0x0000010000000000ULL;
 constexpr auto kStorageCacheMask = 0x000000FFFFFFFFFFULL;
 constexpr auto kWebDocumentCacheTag = 0x0000020000000000ULL;
@@ -35,6 +37,14 @@ Storage::Cache::Key DocumentCacheKey(int32 dcId, uint64 id) {
 	};
 }
 
+Storage::Cache::Key VoiceWaveformCacheKey(int32 dcId, uint64 id) {
+	return Storage::Cache::Key{
+		Data::kVoiceWaveformCacheTag
+			| (uint64(dcId) & Data::kVoiceWaveformCacheMask),
+		id
+	};
+}
+
 Storage::Cache::Key StorageCacheKey(const StorageImageLocation &location) {
 	const auto dcId = uint64(location.dc()) & 0xFFULL;
 	return Storage::Cache::Key{
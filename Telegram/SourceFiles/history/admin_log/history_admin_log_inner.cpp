@@ -1093,7 +1093,7 @@ void InnerWidget::savePhotoToFile(PhotoData *photo) {
 		filedialogDefaultName(qsl("photo"), qsl(".jpg")),
 		crl::guard(this, [=](const QString &result) {
 			if (!result.isEmpty()) {
-				photo->full->pix(Data::FileOrigin()).toImage().save(result, "JPG");
+				photo->full->original().save(result, "JPG");
 			}
 		}));
 }
@@ -1105,7 +1105,7 @@ void InnerWidget::saveDocumentToFile(DocumentData *document) {
 void InnerWidget::copyContextImage(PhotoData *photo) {
 	if (!photo || !photo->date || !photo->loaded()) return;
 
-	QApplication::clipboard()->setPixmap(photo->full->pix(Data::FileOrigin()));
+	QApplication::clipboard()->setImage(photo->full->original());
 }
 
 void InnerWidget::copySelectedText() {
@@ -0,0 +1,152 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/benchmark.h"
+
+#include "ui/text/text_entity.h"
+
+namespace {
+
+constexpr auto kHistorySize = 10000;
+constexpr auto kSliceSize = 100;
+constexpr auto kChatsCount = 20;
+constexpr auto kChatSize = 50;
+constexpr auto kSendersCount = 7;
+
+struct FixtureMessage {
+	const char *text = nullptr; // UTF-8
+	int boldLength = 0; // Bold entity at the start, as sent by server.
+};
+
+// A fixed corpus of typical group chat messages: short replies, links,
+// mentions, hashtags, commands, emoji and a few languages. The history
+// is built by going through it in order, so every run sees the same data.
+const FixtureMessage kCorpus[] = {
+	{ "ok" },
+	{ "Good morning everyone!" },
+	{ "Meeting moved to 10:30, see you in the usual room", 7 },
+	{ "@durov thanks, will check it today" },
+	{ "https://telegram.org/blog/ has the changelog for this release" },
+	{ "lol \xF0\x9F\x98\x82\xF0\x9F\x98\x82\xF0\x9F\x98\x82" },
+	{ "Can somebody send me the build log? /start does not work for me" },
+	{ "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82! \xD0\x9A\xD0\xB0\xD0\xBA \xD0\xB4\xD0\xB5\xD0\xBB\xD0\xB0?" },
+	{ "#release notes are pinned, please read them before asking", 8 },
+	{ "mail me at someone@example.com if the link is broken" },
+	{ "\xE4\xBD\xA0\xE5\xA5\xBD\xEF\xBC\x8C\xE6\x98\x8E\xE5\xA4\xA9\xE8\xA7\x81 \xF0\x9F\x91\x8B" },
+	{ "yes" },
+	{ "I think the problem is in the proxy settings, try to disable it and restart the app. If it still does not connect, send the logs from Settings > Advanced > Export logs." },
+	{ "\xD9\x85\xD8\xB1\xD8\xAD\xD8\xA8\xD8\xA7 \xE2\x9D\xA4\xEF\xB8\x8F" },
+	{ "see github.com/telegramdesktop/tdesktop/issues for known bugs" },
+	{ "Important: do not share your login code with anyone", 10 },
+	{ "\xF0\x9F\x91\x8D" },
+	{ "what version are you on? #question" },
+	{ "Works now, thank you @support_bot" },
+	{ "Voice chat at 8 pm, link: t.me/joinchat/AAAAAEtest" },
+};
+
+// A messages.messages answer in the wire format, the way it comes from
+// the server, so that reading it costs what response handling costs.
+mtpBuffer BuildAnswer(int firstId, int count) {
+	auto messages = QVector<MTPMessage>();
+	messages.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		const auto id = firstId + i;
+		const auto &fixture = kCorpus[id % base::array_size(kCorpus)];
+		auto entities = QVector<MTPMessageEntity>();
+		if (fixture.boldLength) {
+			entities.push_back(MTP_messageEntityBold(
+				MTP_int(0),
+				MTP_int(fixture.boldLength)));
+		}
+		const auto flags = MTPDmessage::Flag::f_from_id
+			| MTPDmessage::Flag::f_entities;
+		messages.push_back(MTP_message(
+			MTP_flags(flags),
+			MTP_int(id),
+			MTP_int(1 + (id % kSendersCount)),
+			MTP_peerUser(MTP_int(777)),
+			MTPMessageFwdHeader(),
+			MTPint(),
+			MTPint(),
+			MTP_int(1500000000 + id * 60),
+			MTP_string(QString::fromUtf8(fixture.text)),
+			MTPMessageMedia(),
+			MTPReplyMarkup(),
+			MTP_vector<MTPMessageEntity>(entities),
+			MTPint(),
+			MTPint(),
+			MTPstring(),
+			MTPlong()));
+	}
+	auto result = mtpBuffer();
+	MTP_messages_messages(
+		MTP_vector<MTPMessage>(messages),
+		MTP_vector<MTPChat>(0),
+		MTP_vector<MTPUser>(0)).write(result);
+	return result;
+}
+
+MTPmessages_Messages Unpack(const mtpBuffer &answer) {
+	auto result = MTPmessages_Messages();
+	auto from = answer.constData();
+	result.read(from, from + answer.size());
+	return result;
+}
+
+// What HistoryItem does with each message text before it is laid out.
+int PrepareTexts(const MTPmessages_Messages &slice) {
+	auto result = 0;
+	const auto &data = slice.c_messages_messages();
+	for (const auto &message : data.vmessages.v) {
+		const auto &fields = message.c_message();
+		auto text = TextWithEntities{
+			TextUtilities::Clean(qs(fields.vmessage)),
+			TextUtilities::EntitiesFromMTP(fields.ventities.v)
+		};
+		TextUtilities::ParseEntities(
+			text,
+			TextParseLinks | TextParseMentions | TextParseHashtags);
+		result += text.entities.size();
+	}
+	return result;
+}
+
+} // namespace
+
+// Only the answers unpacking and the text entities parsing are measured:
+// History, HistoryInner and Dialogs::IndexedList are not covered: History
+// is created by Data::Session, Entry::updateChatListSortPosition() reads
+// Auth().settings() and IndexedList reorders pins through Auth().data().
+TDESKTOP_BENCHMARK(history_texts) {
+	const auto history = BuildAnswer(1, kHistorySize);
+	auto slices = std::vector<mtpBuffer>();
+	for (auto i = 0; i != kHistorySize / kSliceSize; ++i) {
+		slices.push_back(BuildAnswer(1 + i * kSliceSize, kSliceSize));
+	}
+	auto chats = std::vector<mtpBuffer>();
+	for (auto i = 0; i != kChatsCount; ++i) {
+		chats.push_back(BuildAnswer(1 + i * kChatSize, kChatSize));
+	}
+
+	runner.step("parse one 10k answer", [&] {
+		base::benchmark::KeepAlive(PrepareTexts(Unpack(history)));
+	});
+	runner.step("parse 100 answers of 100", [&] {
+		auto entities = 0;
+		for (const auto &slice : slices) {
+			entities += PrepareTexts(Unpack(slice));
+		}
+		base::benchmark::KeepAlive(entities);
+	});
+	runner.step("parse 20 answers of 50", [&] {
+		auto entities = 0;
+		for (const auto &chat : chats) {
+			entities += PrepareTexts(Unpack(chat));
+		}
+		base::benchmark::KeepAlive(entities);
+	});
+}
@@ -0,0 +1,230 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "lang/lang_binary_pack.h"
+
+namespace Lang {
+namespace {
+
+constexpr auto kFormatVersion = 1;
+constexpr auto kDataLimit = 16 * 1024 * 1024;
+
+// The plural rules language id is stored as one more value.
+constexpr auto kPluralIdIndex = int(kLangKeysCount);
+constexpr auto kRangesCount = kPluralIdIndex + 1;
+
+struct Header {
+	char magic[4];
+	qint32 formatVersion;
+	qint32 appVersion;
+	qint32 keysCount;
+	BinaryPack::Checksum checksum;
+	qint32 dataLength; // In QChars.
+};
+
+constexpr auto kOffsetsSize = (kRangesCount + 1) * sizeof(uint32);
+constexpr auto kSetSize = kLangKeysCount * sizeof(uchar);
+
+static_assert(sizeof(Header) % sizeof(uint32) == 0);
+static_assert(kOffsetsSize % sizeof(QChar) == 0);
+
+void FillMagic(Header &header) {
+	header.magic[0] = 'T';
+	header.magic[1] = 'D';
+	header.magic[2] = 'L';
+	header.magic[3] = 'P';
+}
+
+int64 FullSize(int dataLength) {
+	return sizeof(Header)
+		+ kOffsetsSize
+		+ int64(dataLength) * sizeof(QChar)
+		+ kSetSize;
+}
+
+} // namespace
+
+BinaryPack::Checksum BinaryPack::ComputeChecksum(
+		const QByteArray &serialized) {
+	return hashSha1(serialized.constData(), serialized.size());
+}
+
+BinaryPack::BinaryPack(const QString &path) : _file(path) {
+}
+
+BinaryPack::~BinaryPack() {
+	if (_mapped) {
+		_file.unmap(_mapped);
+	}
+}
+
+std::unique_ptr<BinaryPack> BinaryPack::Open(
+		const QString &path,
+		const Checksum &checksum) {
+	auto result = std::unique_ptr<BinaryPack>(new BinaryPack(path));
+	if (!result->map(checksum)) {
+		return nullptr;
+	}
+	return result;
+}
+
+bool BinaryPack::map(const Checksum &checksum) {
+	if (!_file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	const auto size = _file.size();
+	if (size < FullSize(0) || size > FullSize(kDataLimit)) {
+		LOG(("Lang Error: Bad binary langpack size: %1").arg(size));
+		return false;
+	}
+
+	auto header = Header();
+	if (_file.read(reinterpret_cast<char*>(&header), sizeof(Header))
+		!= sizeof(Header)) {
+		LOG(("Lang Error: Could not read binary langpack header."));
+		return false;
+	}
+	auto magic = Header();
+	FillMagic(magic);
+	if (memcmp(header.magic, magic.magic, sizeof(magic.magic))
+		|| header.formatVersion != kFormatVersion
+		|| header.appVersion != AppVersion
+		|| header.keysCount != kLangKeysCount) {
+		LOG(("Lang Info: Outdated binary langpack."));
+		return false;
+	} else if (header.checksum != checksum) {
+		LOG(("Lang Info: Binary langpack checksum mismatch."));
+		return false;
+	} else if (header.dataLength < 0
+		|| FullSize(header.dataLength) != size) {
+		LOG(("Lang Error: Bad binary langpack data length: %1"
+			).arg(header.dataLength));
+		return false;
+	}
+
+	_mapped = _file.map(0, size);
+	if (!_mapped) {
+		LOG(("Lang Error: Could not map binary langpack."));
+		return false;
+	}
+	_offsets = reinterpret_cast<const uint32*>(_mapped + sizeof(Header));
+	_data = reinterpret_cast<const QChar*>(
+		_mapped + sizeof(Header) + kOffsetsSize);
+	_set = _mapped + size - kSetSize;
+
+	// Offsets are checked once, so that value() could trust them.
+	auto previous = uint32(0);
+	for (auto i = 0; i != kRangesCount + 1; ++i) {
+		const auto offset = _offsets[i];
+		if (offset < previous || offset > uint32(header.dataLength)) {
+			LOG(("Lang Error: Bad binary langpack offset %1 for %2."
+				).arg(offset
+				).arg(i));
+			_file.unmap(base::take(_mapped));
+			return false;
+		}
+		previous = offset;
+	}
+	return true;
+}
+
+bool BinaryPack::Write(
+		const QString &path,
+		const Checksum &checksum,
+		const std::vector<QString> &values,
+		const std::vector<uchar> &set,
+		const QString &pluralId) {
+	Expects(values.size() == kLangKeysCount);
+	Expects(set.size() == kLangKeysCount);
+
+	auto offsets = std::vector<uint32>();
+	offsets.reserve(kRangesCount + 1);
+	auto dataLength = 0;
+	const auto append = [&](const QString &value) {
+		offsets.push_back(dataLength);
+		dataLength += value.size();
+	};
+	for (auto i = 0; i != kLangKeysCount; ++i) {
+		append(set[i] ? values[i] : QString());
+	}
+	append(pluralId);
+	offsets.push_back(dataLength);
+	if (dataLength > kDataLimit) {
+		LOG(("Lang Error: Binary langpack is too big: %1").arg(dataLength));
+		return false;
+	}
+
+	auto header = Header();
+	FillMagic(header);
+	header.formatVersion = kFormatVersion;
+	header.appVersion = AppVersion;
+	header.keysCount = kLangKeysCount;
+	header.checksum = checksum;
+	header.dataLength = dataLength;
+
+	auto content = QByteArray();
+	content.reserve(int(FullSize(dataLength)));
+	content.append(reinterpret_cast<const char*>(&header), sizeof(Header));
+	content.append(
+		reinterpret_cast<const char*>(offsets.data()),
+		kOffsetsSize);
+	const auto appendData = [&](const QString &value) {
+		content.append(
+			reinterpret_cast<const char*>(value.constData()),
+			value.size() * sizeof(QChar));
+	};
+	for (auto i = 0; i != kLangKeysCount; ++i) {
+		if (set[i]) {
+			appendData(values[i]);
+		}
+	}
+	appendData(pluralId);
+	for (const auto flag : set) {
+		content.append(flag ? char(1) : char(0));
+	}
+	Assert(content.size() == FullSize(dataLength));
+
+	// On Windows a mapped file can't be replaced, then we fail here
+	// and the next launch parses the serialized language pack again.
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		LOG(("Lang Error: Could not open '%1' for writing.").arg(path));
+		return false;
+	} else if (file.write(content) != content.size() || !file.commit()) {
+		LOG(("Lang Error: Could not write binary langpack to '%1'."
+			).arg(path));
+		return false;
+	}
+	return true;
+}
+
+QString BinaryPack::range(int index) const {
+	Expects(_mapped != nullptr);
+	Expects(index >= 0 && index < kRangesCount);
+
+	const auto offset = _offsets[index];
+	return QString::fromRawData(_data + offset, _offsets[index + 1] - offset);
+}
+
+bool BinaryPack::isSet(LangKey key) const {
+	Expects(_mapped != nullptr);
+	Expects(key >= 0 && key < kLangKeysCount);
+
+	return (_set[key] != 0);
+}
+
+QString BinaryPack::value(LangKey key) const {
+	Expects(key >= 0 && key < kLangKeysCount);
+
+	return range(key);
+}
+
+QString BinaryPack::pluralId() const {
+	return range(kPluralIdIndex);
+}
+
+} // namespace Lang
@@ -0,0 +1,63 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "lang_auto.h"
+
+namespace Lang {
+
+// Already parsed language pack values, mapped from a file.
+//
+// The file is a cache built from the serialized language pack, it is
+// valid only for the same serialized data and the same application
+// version (LangKey indices and tag indices depend on it). The values
+// are UTF-16 strings with the tags already replaced, so they're given
+// away by QString::fromRawData() and only the pages that are actually
+// read are loaded from the disk.
+class BinaryPack {
+public:
+	using Checksum = std::array<char, 20>;
+
+	static Checksum ComputeChecksum(const QByteArray &serialized);
+
+	// Returns nullptr if the file is absent, broken or outdated.
+	static std::unique_ptr<BinaryPack> Open(
+		const QString &path,
+		const Checksum &checksum);
+
+	// Only values with the non-zero 'set' flag are written.
+	static bool Write(
+		const QString &path,
+		const Checksum &checksum,
+		const std::vector<QString> &values,
+		const std::vector<uchar> &set,
+		const QString &pluralId);
+
+	BinaryPack(const BinaryPack &other) = delete;
+	BinaryPack &operator=(const BinaryPack &other) = delete;
+	~BinaryPack();
+
+	bool isSet(LangKey key) const;
+	QString value(LangKey key) const;
+	QString pluralId() const;
+
+private:
+	explicit BinaryPack(const QString &path);
+
+	bool map(const Checksum &checksum);
+	QString range(int index) const;
+
+	QFile _file;
+	uchar *_mapped = nullptr;
+	const uint32 *_offsets = nullptr;
+	const QChar *_data = nullptr;
+	const uchar *_set = nullptr;
+
+};
+
+} // namespace Lang
@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "platform/platform_specific.h"
 #include "boxes/confirm_box.h"
 #include "lang/lang_file_parser.h"
+#include "lang/lang_binary_pack.h"
 #include "base/qthelp_regex.h"
 
 namespace Lang {
@@ -173,6 +174,14 @@ QString CloudLangPackName() {
 	return str_const_toString(kCloudLangPackName);
 }
 
+Instance::Instance() {
+	fillDefaults();
+}
+
+Instance::Instance(Instance &&other) = default;
+Instance &Instance::operator=(Instance &&other) = default;
+Instance::~Instance() = default;
+
 void Instance::switchToId(const QString &id) {
 	reset();
 	_id = id;
@@ -266,7 +275,9 @@ QByteArray Instance::serialize() const {
 	return result;
 }
 
-void Instance::fillFromSerialized(const QByteArray &data) {
+void Instance::fillFromSerialized(
+		const QByteArray &data,
+		const QString &binaryPath) {
 	QDataStream stream(data);
 	stream.setVersion(QDataStream::Qt_5_1);
 	QString id;
@@ -315,10 +326,59 @@ void Instance::fillFromSerialized(const QByteArray &data) {
 	_customFilePathRelative = customFilePathRelative;
 	_customFileContent = customFileContent;
 	LOG(("Lang Info: Loaded cached, keys: %1").arg(nonDefaultValuesCount));
+	if (fillFromBinary(nonDefaultStrings, binaryPath, data)) {
+		return;
+	}
 	for (auto i = 0, count = nonDefaultValuesCount * 2; i != count; i += 2) {
 		applyValue(nonDefaultStrings[i], nonDefaultStrings[i + 1]);
 	}
 	updatePluralRules();
+	writeBinary(data, binaryPath);
+}
+
+bool Instance::fillFromBinary(
+		const std::vector<QByteArray> &nonDefaultStrings,
+		const QString &binaryPath,
+		const QByteArray &serialized) {
+	if (binaryPath.isEmpty()) {
+		return false;
+	}
+	auto pack = BinaryPack::Open(
+		binaryPath,
+		BinaryPack::ComputeChecksum(serialized));
+	if (!pack) {
+		return false;
+	}
+
+	// Raw strings are kept only for serialize() and getNonDefaultValue(),
+	// the values themselves are not parsed and not copied at all.
+	for (auto i = 0, count = int(nonDefaultStrings.size()); i != count; i += 2) {
+		_nonDefaultValues[nonDefaultStrings[i]] = nonDefaultStrings[i + 1];
+	}
+	for (auto i = 0; i != kLangKeysCount; ++i) {
+		const auto key = LangKey(i);
+		if (pack->isSet(key)) {
+			_values[i] = pack->value(key);
+			_nonDefaultSet[i] = 1;
+		}
+	}
+	UpdatePluralRules(pack->pluralId());
+	_binaryPacks.push_back(std::move(pack));
+	return true;
+}
+
+void Instance::writeBinary(
+		const QByteArray &serialized,
+		const QString &binaryPath) const {
+	if (binaryPath.isEmpty()) {
+		return;
+	}
+	BinaryPack::Write(
+		binaryPath,
+		BinaryPack::ComputeChecksum(serialized),
+		_values,
+		_nonDefaultSet,
+		computePluralId());
 }
 
 void Instance::loadFromContent(const QByteArray &content) {
@@ -486,7 +546,7 @@ void Instance::applyValue(const QByteArray &key, const QByteArray &value) {
 	}
 }
 
-void Instance::updatePluralRules() {
+QString Instance::computePluralId() const {
 	auto id = _id;
 	if (isCustom()) {
 		auto path = _customFilePathAbsolute.isEmpty()
@@ -499,7 +559,11 @@ void Instance::updatePluralRules() {
 	} else if (auto match = qthelp::regex_match("^([a-z]{2,3})(_[A-Z]{2,3}|\\-[a-z]{2,3})$", id)) {
 		id = match->captured(1);
 	}
-	UpdatePluralRules(id);
+	return id;
+}
+
+void Instance::updatePluralRules() {
+	UpdatePluralRules(computePluralId());
 }
 
 void Instance::resetValue(const QByteArray &key) {
@@ -508,6 +572,7 @@ void Instance::resetValue(const QByteArray &key) {
 	auto keyIndex = GetKeyIndex(QLatin1String(key));
 	if (keyIndex != kLangKeysCount) {
 		_values[keyIndex] = GetOriginalValue(keyIndex);
+		_nonDefaultSet[keyIndex] = 0;
 	}
 }
 
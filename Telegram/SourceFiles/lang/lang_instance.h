@@ -13,6 +13,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Lang {
 
+class BinaryPack;
+
 constexpr auto kLegacyLanguageNone = -2;
 constexpr auto kLegacyCustomLanguage = -1;
 constexpr auto kLegacyDefaultLanguage = 0;
@@ -41,16 +43,15 @@ rpl::producer<QString> Viewer(LangKey key);
 
 class Instance {
 public:
-	Instance() {
-		fillDefaults();
-	}
+	Instance();
 	void switchToId(const QString &id);
 	void switchToCustomFile(const QString &filePath);
 
 	Instance(const Instance &other) = delete;
 	Instance &operator=(const Instance &other) = delete;
-	Instance(Instance &&other) = default;
-	Instance &operator=(Instance &&other) = default;
+	Instance(Instance &&other);
+	Instance &operator=(Instance &&other);
+	~Instance();
 
 	QString systemLangCode() const;
 	QString cloudLangCode() const;
@@ -69,7 +70,15 @@ public:
 	}
 
 	QByteArray serialize() const;
-	void fillFromSerialized(const QByteArray &data);
+
+	// The binary pack at binaryPath is used instead of parsing the values
+	// if it was written for the same serialized data, else it is rebuilt.
+	void fillFromSerialized(
+		const QByteArray &data,
+		const QString &binaryPath);
+	void writeBinary(
+		const QByteArray &serialized,
+		const QString &binaryPath) const;
 	void fillFromLegacy(int legacyId, const QString &legacyPath);
 
 	void applyDifference(const MTPDlangPackDifference &difference);
@@ -125,6 +134,11 @@ private:
 		const QString &absolutePath,
 		const QString &relativePath,
 		const QByteArray &content);
+	bool fillFromBinary(
+		const std::vector<QByteArray> &nonDefaultStrings,
+		const QString &binaryPath,
+		const QByteArray &serialized);
+	QString computePluralId() const;
 	void updatePluralRules();
 
 	QString _id;
@@ -141,6 +155,10 @@ private:
 	std::vector<uchar> _nonDefaultSet;
 	std::map<QByteArray, QByteArray> _nonDefaultValues;
 
+	// Values from a binary pack reference its mapping, so all the packs
+	// loaded by this instance are kept till it is destroyed.
+	std::vector<std::unique_ptr<BinaryPack>> _binaryPacks;
+
 };
 
 } // namespace Lang
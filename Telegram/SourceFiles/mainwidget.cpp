@@ -1708,7 +1708,7 @@ void MainWidget::checkChatBackground() {
 				|| _background->id == Window::Theme::kDefaultBackground) {
 				Window::Theme::Background()->setImage(_background->id);
 			} else {
-				Window::Theme::Background()->setImage(_background->id, _background->full->pix(Data::FileOrigin()).toImage());
+				Window::Theme::Background()->setImage(_background->id, _background->full->original());
 			}
 			_background = nullptr;
 			QTimer::singleShot(0, this, SLOT(update()));
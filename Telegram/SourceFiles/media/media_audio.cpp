@@ -12,7 +12,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/media_child_ffmpeg_loader.h"
 #include "media/media_audio_loaders.h"
 #include "media/media_audio_track.h"
+#include "media/media_audio_waveform.h"
+#include "media/media_streaming_file.h"
 #include "platform/platform_audio.h"
+#include "core/stats.h"
 #include "messenger.h"
 
 #include <AL/al.h>
@@ -255,7 +258,7 @@ namespace Player {
 namespace {
 
 constexpr auto kVolumeRound = 10000;
-constexpr auto kPreloadSamples = 2LL * kDefaultFrequency; // preload next part if less than 2 seconds remains
+constexpr auto kMaxFeedDepth = 16;
 constexpr auto kFadeDuration = TimeMs(500);
 constexpr auto kCheckPlaybackPositionTimeout = TimeMs(100); // 100ms per check audio position
 constexpr auto kCheckPlaybackPositionDelta = 2400LL; // update position called each 2400 samples
@@ -263,6 +266,30 @@ constexpr auto kCheckFadingTimeout = TimeMs(7); // 7ms
 
 base::Observable<AudioMsgId> UpdatedObservable;
 
+const auto StatsRegistered = Core::Stats::Register("audio", [] {
+	const auto mixer = Player::mixer();
+	if (!mixer) {
+		return std::vector<Core::Stats::Row>();
+	}
+	const auto types = {
+		std::make_pair(AudioMsgId::Type::Voice, "voice"),
+		std::make_pair(AudioMsgId::Type::Song, "song"),
+		std::make_pair(AudioMsgId::Type::Video, "video"),
+	};
+	auto result = std::vector<Core::Stats::Row>();
+	for (const auto [type, name] : types) {
+		const auto stats = mixer->feedStats(type);
+		result.push_back({ QString::fromLatin1(name), {
+			{ "chunks", stats.chunks },
+			{ "underruns", stats.underruns },
+			{ "ahead ms", stats.ahead },
+			{ "last load latency ms", stats.latency },
+			{ "max load latency ms", stats.latencyMax },
+		} });
+	}
+	return result;
+});
+
 } // namespace
 
 base::Observable<AudioMsgId> &Updated() {
@@ -283,6 +310,11 @@ Mixer *mixer() {
 	return Audio::MixerInstance;
 }
 
+Mixer::Track::Track()
+: decoded(std::make_unique<Audio::RingBuffer<DecodedChunk>>(
+	kDefaultFeedDepth)) {
+}
+
 void Mixer::Track::createStream() {
 	alGenSources(1, &stream.source);
 	alSourcef(stream.source, AL_PITCH, 1.f);
@@ -338,9 +370,14 @@ void Mixer::Track::detach() {
 void Mixer::Track::clear() {
 	detach();
 
+	// Loaders may still be decoding the previous audio right now.
+	++generation;
+	dropDecoded();
+
 	state = TrackState();
 	file = FileLocation();
 	data = QByteArray();
+	streamed = nullptr;
 	bufferedPosition = 0;
 	bufferedLength = 0;
 	loading = false;
@@ -359,9 +396,18 @@ void Mixer::Track::clear() {
 	lastUpdateCorrectedMs = 0;
 }
 
-void Mixer::Track::started() {
+void Mixer::Track::started(int feedDepth) {
 	resetStream();
 
+	// Loaders are the only producer and the lock keeps out consumers,
+	// so the buffer may be replaced here.
+	dropDecoded();
+	if (decoded->capacity() != feedDepth) {
+		decoded = std::make_unique<Audio::RingBuffer<DecodedChunk>>(
+			feedDepth);
+	}
+	decodedSamples = 0;
+
 	bufferedPosition = 0;
 	bufferedLength = 0;
 	loaded = false;
@@ -388,48 +434,147 @@ void Mixer::Track::ensureStreamCreated() {
 int Mixer::Track::getNotQueuedBufferIndex() {
 	// See if there are no free buffers right now.
 	while (samplesCount[kBuffersCount - 1] != 0) {
-		// Try to unqueue some buffer.
-		ALint processed = 0;
-		alGetSourcei(stream.source, AL_BUFFERS_PROCESSED, &processed);
-		if (processed < 1) { // No processed buffers, wait.
+		if (!unqueueProcessedBuffer()) { // No processed buffers, wait.
 			return -1;
 		}
+	}
+
+	for (auto i = 0; i != kBuffersCount; ++i) {
+		if (!samplesCount[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool Mixer::Track::unqueueProcessedBuffer() {
+	ALint processed = 0;
+	alGetSourcei(stream.source, AL_BUFFERS_PROCESSED, &processed);
+	if (processed < 1) {
+		return false;
+	}
+
+	// Unqueue some processed buffer.
+	ALuint buffer = 0;
+	alSourceUnqueueBuffers(stream.source, 1, &buffer);
+
+	// Find it in the list and clear it.
+	for (auto i = 0; i != kBuffersCount; ++i) {
+		if (stream.buffers[i] == buffer) {
+			auto samplesInBuffer = samplesCount[i];
+			bufferedPosition += samplesInBuffer;
+			bufferedLength -= samplesInBuffer;
+			for (auto j = i + 1; j != kBuffersCount; ++j) {
+				samplesCount[j - 1] = samplesCount[j];
+				stream.buffers[j - 1] = stream.buffers[j];
+				bufferSamples[j - 1] = bufferSamples[j];
+			}
+			samplesCount[kBuffersCount - 1] = 0;
+			stream.buffers[kBuffersCount - 1] = buffer;
+			bufferSamples[kBuffersCount - 1] = QByteArray();
+			return true;
+		}
+	}
+	LOG(("Audio Error: Could not find the unqueued buffer! Buffer %1 in source %2 with processed count %3").arg(buffer).arg(stream.source).arg(processed));
+	return false;
+}
+
+void Mixer::Track::dropDecoded() {
+	while (const auto chunk = decoded->front()) {
+		decodedSamples -= chunk->samplesCount;
+		decoded->pop();
+	}
+}
 
-		// Unqueue some processed buffer.
-		ALuint buffer = 0;
-		alSourceUnqueueBuffers(stream.source, 1, &buffer);
-
-		// Find it in the list and clear it.
-		bool found = false;
-		for (auto i = 0; i != kBuffersCount; ++i) {
-			if (stream.buffers[i] == buffer) {
-				auto samplesInBuffer = samplesCount[i];
-				bufferedPosition += samplesInBuffer;
-				bufferedLength -= samplesInBuffer;
-				for (auto j = i + 1; j != kBuffersCount; ++j) {
-					samplesCount[j - 1] = samplesCount[j];
-					stream.buffers[j - 1] = stream.buffers[j];
-					bufferSamples[j - 1] = bufferSamples[j];
+Mixer::Track::FeedResult Mixer::Track::feed(
+		AudioMsgId::Type type,
+		FeedCounters &counters) {
+	const auto current = generation.load(std::memory_order_acquire);
+	auto drained = false;
+	auto fed = false;
+	while (const auto chunk = decoded->front()) {
+		if (chunk->generation != current) {
+			decodedSamples -= chunk->samplesCount;
+			decoded->pop();
+			continue;
+		}
+		if (chunk->samplesCount > 0) {
+			if (!fed && isStreamCreated()) {
+				// A stopped source would play all the queued buffers
+				// from the start, so the processed ones go away first.
+				ALint sourceState = AL_INITIAL;
+				ALint queued = 0;
+				ALint processed = 0;
+				alGetSourcei(stream.source, AL_SOURCE_STATE, &sourceState);
+				alGetSourcei(stream.source, AL_BUFFERS_QUEUED, &queued);
+				alGetSourcei(stream.source, AL_BUFFERS_PROCESSED, &processed);
+				drained = (sourceState == AL_STOPPED)
+					&& (queued > 0)
+					&& (processed == queued);
+				while (drained && samplesCount[0] != 0) {
+					if (!unqueueProcessedBuffer()) {
+						break;
+					}
 				}
-				samplesCount[kBuffersCount - 1] = 0;
-				stream.buffers[kBuffersCount - 1] = buffer;
-				bufferSamples[kBuffersCount - 1] = QByteArray();
-				found = true;
+			}
+			ensureStreamCreated();
+			const auto bufferIndex = getNotQueuedBufferIndex();
+			if (!internal::audioCheckError()) {
+				return FeedResult::Error;
+			} else if (bufferIndex < 0) { // No free buffers, wait.
 				break;
 			}
+
+			bufferSamples[bufferIndex] = std::move(chunk->samples);
+			samplesCount[bufferIndex] = chunk->samplesCount;
+			bufferedLength += chunk->samplesCount;
+			alBufferData(stream.buffers[bufferIndex], format, bufferSamples[bufferIndex].constData(), bufferSamples[bufferIndex].size(), frequency);
+
+			alSourceQueueBuffers(stream.source, 1, stream.buffers + bufferIndex);
+			if (!internal::audioCheckError()) {
+				return FeedResult::Error;
+			}
+			++counters.chunks;
 		}
-		if (!found) {
-			LOG(("Audio Error: Could not find the unqueued buffer! Buffer %1 in source %2 with processed count %3").arg(buffer).arg(stream.source).arg(processed));
-			return -1;
+		if (chunk->last) {
+			state.length = bufferedPosition + bufferedLength;
 		}
+		decodedSamples -= chunk->samplesCount;
+		decoded->pop();
+		fed = true;
+	}
+	if (!fed) {
+		return FeedResult::Idle;
+	} else if (state.state != State::Resuming
+		&& state.state != State::Playing
+		&& state.state != State::Starting) {
+		return FeedResult::Fed;
 	}
 
-	for (auto i = 0; i != kBuffersCount; ++i) {
-		if (!samplesCount[i]) {
-			return i;
-		}
+	ALint sourceState = AL_INITIAL;
+	alGetSourcei(stream.source, AL_SOURCE_STATE, &sourceState);
+	if (!internal::audioCheckError()) {
+		return FeedResult::Error;
+	} else if (sourceState == AL_PLAYING) {
+		return FeedResult::Fed;
+	} else if (sourceState == AL_STOPPED
+		&& !internal::CheckAudioDeviceConnected()) {
+		return FeedResult::Fed;
 	}
-	return -1;
+
+	alSourcef(stream.source, AL_GAIN, ComputeVolume(type));
+	if (!internal::audioCheckError()) {
+		return FeedResult::Error;
+	}
+
+	alSourcePlay(stream.source);
+	if (!internal::audioCheckError()) {
+		return FeedResult::Error;
+	}
+	if (drained) {
+		++counters.underruns;
+	}
+	return FeedResult::Fed;
 }
 
 void Mixer::Track::resetStream() {
@@ -444,8 +589,10 @@ Mixer::Track::~Track() = default;
 Mixer::Mixer()
 : _volumeVideo(kVolumeRound)
 , _volumeSong(kVolumeRound)
+, _feedDepth(kDefaultFeedDepth)
 , _fader(new Fader(&_faderThread))
-, _loader(new Loaders(&_loaderThread)) {
+, _loader(new Loaders(&_loaderThread, false))
+, _streamedLoader(new Loaders(&_streamedLoaderThread, true)) {
 	connect(this, SIGNAL(faderOnTimer()), _fader, SLOT(onTimer()), Qt::QueuedConnection);
 	connect(this, SIGNAL(suppressSong()), _fader, SLOT(onSuppressSong()));
 	connect(this, SIGNAL(unsuppressSong()), _fader, SLOT(onUnsuppressSong()));
@@ -456,11 +603,13 @@ Mixer::Mixer()
 	subscribe(Global::RefVideoVolumeChanged(), [this] {
 		QMetaObject::invokeMethod(_fader, "onVideoVolumeChanged");
 	});
-	connect(this, SIGNAL(loaderOnStart(const AudioMsgId&, qint64)), _loader, SLOT(onStart(const AudioMsgId&, qint64)));
-	connect(this, SIGNAL(loaderOnCancel(const AudioMsgId&)), _loader, SLOT(onCancel(const AudioMsgId&)));
-	connect(_loader, SIGNAL(needToCheck()), _fader, SLOT(onTimer()));
-	connect(_loader, SIGNAL(error(const AudioMsgId&)), this, SLOT(onError(const AudioMsgId&)));
-	connect(_fader, SIGNAL(needToPreload(const AudioMsgId&)), _loader, SLOT(onLoad(const AudioMsgId&)));
+	for (const auto loader : { _loader, _streamedLoader }) {
+		connect(this, SIGNAL(loaderOnStart(const AudioMsgId&, qint64)), loader, SLOT(onStart(const AudioMsgId&, qint64)));
+		connect(this, SIGNAL(loaderOnCancel(const AudioMsgId&)), loader, SLOT(onCancel(const AudioMsgId&)));
+		connect(loader, SIGNAL(needToCheck()), _fader, SLOT(onTimer()));
+		connect(loader, SIGNAL(error(const AudioMsgId&)), this, SLOT(onError(const AudioMsgId&)));
+		connect(_fader, SIGNAL(needToPreload(const AudioMsgId&)), loader, SLOT(onLoad(const AudioMsgId&)));
+	}
 	connect(_fader, SIGNAL(playPositionUpdated(const AudioMsgId&)), this, SIGNAL(updated(const AudioMsgId&)));
 	connect(_fader, SIGNAL(audioStopped(const AudioMsgId&)), this, SLOT(onStopped(const AudioMsgId&)));
 	connect(_fader, SIGNAL(error(const AudioMsgId&)), this, SLOT(onError(const AudioMsgId&)));
@@ -468,17 +617,25 @@ Mixer::Mixer()
 	connect(this, SIGNAL(updated(const AudioMsgId&)), this, SLOT(onUpdated(const AudioMsgId&)));
 
 	_loaderThread.start();
+	_streamedLoaderThread.start();
 	_faderThread.start();
 }
 
 // Thread: Main. Locks: AudioMutex.
 Mixer::~Mixer() {
+	_streamedStartLifetime.destroy();
+
+	auto streamed = std::vector<std::shared_ptr<Streaming::SparseFile>>();
 	{
 		QMutexLocker lock(&AudioMutex);
 
 		for (auto i = 0; i != kTogetherLimit; ++i) {
+			const auto song = trackForType(AudioMsgId::Type::Song, i);
+			if (song->streamed) {
+				streamed.push_back(song->streamed);
+			}
 			trackForType(AudioMsgId::Type::Voice, i)->clear();
-			trackForType(AudioMsgId::Type::Song, i)->clear();
+			song->clear();
 		}
 		_videoTrack.clear();
 
@@ -486,10 +643,17 @@ Mixer::~Mixer() {
 		Audio::MixerInstance = nullptr;
 	}
 
+	// Wake the streamed loader if it waits for the download.
+	for (const auto &stream : streamed) {
+		stream->cancel();
+	}
+
 	_faderThread.quit();
 	_loaderThread.quit();
+	_streamedLoaderThread.quit();
 	_faderThread.wait();
 	_loaderThread.wait();
+	_streamedLoaderThread.wait();
 }
 
 void Mixer::onUpdated(const AudioMsgId &audio) {
@@ -692,6 +856,7 @@ void Mixer::play(
 		} else {
 			current->file = audio.audio()->location(true);
 			current->data = audio.audio()->data();
+			current->streamed = nullptr;
 			notLoadedYet = (current->file.isEmpty() && current->data.isEmpty());
 		}
 		if (notLoadedYet) {
@@ -702,6 +867,7 @@ void Mixer::play(
 				/ 1000LL;
 			current->state.state = current->videoData ? State::Paused : fadedStart ? State::Starting : State::Playing;
 			current->loading = true;
+			++current->generation;
 			emit loaderOnStart(current->state.id, positionMs);
 			if (type == AudioMsgId::Type::Voice) {
 				emit suppressSong();
@@ -714,6 +880,11 @@ void Mixer::play(
 				audio.contextId(),
 				audio.audio(),
 				App::histItemById(audio.contextId()));
+			if (type == AudioMsgId::Type::Song) {
+				if (auto stream = audio.audio()->stream()) {
+					playStreamed(audio, std::move(stream), positionMs);
+				}
+			}
 		} else {
 			onError(audio);
 		}
@@ -723,6 +894,64 @@ void Mixer::play(
 	}
 }
 
+void Mixer::playStreamed(
+		const AudioMsgId &audio,
+		std::shared_ptr<Streaming::SparseFile> stream,
+		TimeMs positionMs) {
+	const auto type = audio.type();
+	{
+		QMutexLocker lock(&AudioMutex);
+		const auto current = trackForType(type);
+		if (!current || current->state.id != audio) {
+			return;
+		}
+
+		// The track is playing from now on, but Loaders are started
+		// only when the beginning of the file is downloaded.
+		current->streamed = stream;
+		current->state.position = (positionMs * current->state.frequency)
+			/ 1000LL;
+		current->state.state = State::Playing;
+		current->loading = true;
+	}
+	emit updated(audio);
+
+	const auto start = [=] {
+		auto cancelled = false;
+		{
+			QMutexLocker lock(&AudioMutex);
+			const auto current = trackForType(type);
+			if (!current
+				|| current->state.id != audio
+				|| current->streamed != stream
+				|| IsStopped(current->state.state)) {
+				return;
+			} else if (stream->cancelled()) {
+				current->loading = false;
+				setStoppedState(current);
+				cancelled = true;
+			} else {
+				++current->generation;
+				emit loaderOnStart(audio, positionMs);
+			}
+		}
+		if (cancelled) {
+			emit updated(audio);
+		}
+	};
+	_streamedStartLifetime.destroy();
+	if (stream->startable()) {
+		start();
+		return;
+	}
+	stream->fed(
+	) | rpl::filter([=] {
+		return stream->startable() || stream->cancelled();
+	}) | rpl::take(
+		1
+	) | rpl::start_with_next(start, _streamedStartLifetime);
+}
+
 void Mixer::feedFromVideo(VideoSoundPart &&part) {
 	_loader->feedFromVideo(std::move(part));
 }
@@ -1100,6 +1329,39 @@ float64 Mixer::getVideoVolume() const {
 	return float64(_volumeVideo.loadAcquire()) / kVolumeRound;
 }
 
+void Mixer::setFeedDepth(int chunks) {
+	_feedDepth.storeRelease(snap(chunks, 1, kMaxFeedDepth));
+}
+
+int Mixer::feedDepth() const {
+	return _feedDepth.loadAcquire();
+}
+
+FeedStats Mixer::feedStats(AudioMsgId::Type type) const {
+	const auto &counters = feedCounters(type);
+	auto result = FeedStats();
+	result.underruns = counters.underruns.load();
+	result.chunks = counters.chunks.load();
+	result.ahead = counters.ahead.load();
+	result.latency = counters.latency.load();
+	result.latencyMax = counters.latencyMax.load();
+	return result;
+}
+
+Mixer::FeedCounters &Mixer::feedCounters(AudioMsgId::Type type) {
+	switch (type) {
+	case AudioMsgId::Type::Voice: return _feedCounters[0];
+	case AudioMsgId::Type::Song: return _feedCounters[1];
+	case AudioMsgId::Type::Video: return _feedCounters[2];
+	}
+	Unexpected("Type in Mixer::feedCounters.");
+}
+
+const Mixer::FeedCounters &Mixer::feedCounters(
+		AudioMsgId::Type type) const {
+	return const_cast<Mixer*>(this)->feedCounters(type);
+}
+
 Fader::Fader(QThread *thread) : QObject()
 , _timer(this)
 , _suppressVolumeAll(1., 1.)
@@ -1204,6 +1466,16 @@ int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasF
 		return false;
 	};
 
+	// Chunks decoded ahead are queued right away without waiting for
+	// Loaders, so the source doesn't run out of buffers while they are
+	// busy or can't get AudioMutex.
+	const auto type = track->state.id.type();
+	auto &counters = mixer()->feedCounters(type);
+	if (track->feed(type, counters) == Mixer::Track::FeedResult::Error) {
+		setStoppedState(track, State::StoppedAtError);
+		return EmitError;
+	}
+
 	ALint positionInBuffered = 0;
 	ALint state = AL_INITIAL;
 	alGetSourcei(track->stream.source, AL_SAMPLE_OFFSET, &positionInBuffered);
@@ -1229,7 +1501,28 @@ int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasF
 	}
 
 	auto fullPosition = track->bufferedPosition + positionInBuffered;
-	if (state != AL_PLAYING && !track->loading) {
+	if (playing || track->state.state == State::Starting || track->state.state == State::Resuming) {
+		if (!track->loaded && !track->loading && !track->decoded->full()) {
+			track->loading = true;
+			track->loadRequested = getms();
+			emitSignals |= EmitNeedToPreload;
+		}
+	}
+	if (track->state.frequency > 0) {
+		const auto ahead = track->bufferedPosition
+			+ track->bufferedLength
+			+ track->decodedSamples.load()
+			- fullPosition;
+		counters.ahead = std::max(ahead, 0LL) * 1000 / track->state.frequency;
+	}
+	// A streamed track waits for the download when it runs out of the
+	// decoded audio, the source is restarted by feed() after that.
+	const auto waitingForDownload = track->streamed
+		&& !track->loaded
+		&& (playing
+			|| track->state.state == State::Starting
+			|| track->state.state == State::Resuming);
+	if (state != AL_PLAYING && !track->loading && !waitingForDownload) {
 		if (fading || playing) {
 			fading = false;
 			playing = false;
@@ -1285,15 +1578,6 @@ int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasF
 		track->state.position = fullPosition;
 		emitSignals |= EmitPositionUpdated;
 	}
-	if (playing || track->state.state == State::Starting || track->state.state == State::Resuming) {
-		if (!track->loaded && !track->loading) {
-			auto needPreload = (track->state.position + kPreloadSamples > track->bufferedPosition + track->bufferedLength);
-			if (needPreload) {
-				track->loading = true;
-				emitSignals |= EmitNeedToPreload;
-			}
-		}
-	}
 	if (playing) hasPlaying = true;
 	if (fading) hasFading = true;
 
@@ -1530,30 +1814,21 @@ public:
 			return false;
 		}
 
-		QByteArray buffer;
-		buffer.reserve(AudioVoiceMsgBufferSize);
-		int64 countbytes = sampleSize() * samplesCount();
-		int64 processed = 0;
-		int64 sumbytes = 0;
 		if (samplesCount() < Media::Player::kWaveformSamplesCount) {
 			return false;
 		}
-
-		QVector<uint16> peaks;
-		peaks.reserve(Media::Player::kWaveformSamplesCount);
-
-		auto fmt = format();
-		auto peak = uint16(0);
-		auto callback = [&](uint16 sample) {
-			accumulate_max(peak, sample);
-			sumbytes += Media::Player::kWaveformSamplesCount;
-			if (sumbytes >= countbytes) {
-				sumbytes -= countbytes;
-				peaks.push_back(peak);
-				peak = 0;
-			}
-		};
-		while (processed < countbytes) {
+		const auto fmt = format();
+		const auto eightBit = (fmt == AL_FORMAT_MONO8)
+			|| (fmt == AL_FORMAT_STEREO8);
+		const auto countbytes = sampleSize() * samplesCount();
+		const auto valueSize = int64(eightBit ? sizeof(uchar) : sizeof(int16));
+		auto counter = Media::Audio::WaveformCounter(countbytes / valueSize);
+
+		// Peaks are taken from every decoded chunk right away.
+		QByteArray buffer;
+		buffer.reserve(AudioVoiceMsgBufferSize);
+		int64 processed = 0;
+		while (processed < countbytes && !counter.full()) {
 			buffer.resize(0);
 
 			int64 samples = 0;
@@ -1565,30 +1840,22 @@ public:
 				continue;
 			}
 
-			auto sampleBytes = bytes::make_span(buffer);
-			if (fmt == AL_FORMAT_MONO8 || fmt == AL_FORMAT_STEREO8) {
-				Media::Audio::IterateSamples<uchar>(sampleBytes, callback);
-			} else if (fmt == AL_FORMAT_MONO16 || fmt == AL_FORMAT_STEREO16) {
-				Media::Audio::IterateSamples<int16>(sampleBytes, callback);
+			const auto data = reinterpret_cast<const uchar*>(buffer.constData());
+			if (eightBit) {
+				counter.add(gsl::make_span(data, buffer.size()));
+			} else {
+				counter.add(gsl::make_span(
+					reinterpret_cast<const int16*>(data),
+					buffer.size() / sizeof(int16)));
 			}
 			processed += sampleSize() * samples;
 		}
-		if (sumbytes > 0 && peaks.size() < Media::Player::kWaveformSamplesCount) {
-			peaks.push_back(peak);
-		}
 
-		if (peaks.isEmpty()) {
+		result = counter.finish();
+		if (result.isEmpty()) {
 			return false;
 		}
 
-		auto sum = std::accumulate(peaks.cbegin(), peaks.cend(), 0LL);
-		peak = qMax(int32(sum * 1.8 / peaks.size()), 2500);
-
-		result.resize(peaks.size());
-		for (int32 i = 0, l = peaks.size(); i != l; ++i) {
-			result[i] = char(qMin(31U, uint32(qMin(peaks.at(i), peak)) * 31 / peak));
-		}
-
 		return true;
 	}
 
@@ -8,12 +8,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "storage/localimageloader.h"
+#include "media/media_audio_ring_buffer.h"
 #include "base/bytes.h"
 
 struct VideoSoundData;
 struct VideoSoundPart;
 
 namespace Media {
+namespace Streaming {
+class SparseFile;
+} // namespace Streaming
+
 namespace Audio {
 
 // Thread: Main.
@@ -41,6 +46,7 @@ namespace Player {
 constexpr auto kDefaultFrequency = 48000; // 48 kHz
 constexpr auto kTogetherLimit = 4;
 constexpr auto kWaveformSamplesCount = 100;
+constexpr auto kDefaultFeedDepth = 4; // Decoded chunks ready for OpenAL.
 
 class Fader;
 class Loaders;
@@ -103,6 +109,14 @@ struct TrackState {
 	int frequency = kDefaultFrequency;
 };
 
+struct FeedStats {
+	int underruns = 0; // OpenAL source ran out of buffers while playing.
+	int chunks = 0; // Decoded chunks passed to OpenAL.
+	TimeMs ahead = 0; // Decoded audio ahead of the playback position.
+	TimeMs latency = 0; // From the preload request to the decoded chunks.
+	TimeMs latencyMax = 0;
+};
+
 class Mixer : public QObject, private base::Subscriber {
 	Q_OBJECT
 
@@ -142,6 +156,11 @@ public:
 	void setVideoVolume(float64 volume);
 	float64 getVideoVolume() const;
 
+	// Thread: Any. The depth is applied when a track starts loading.
+	void setFeedDepth(int chunks);
+	int feedDepth() const;
+	FeedStats feedStats(AudioMsgId::Type type) const;
+
 	~Mixer();
 
 private slots:
@@ -169,16 +188,52 @@ private:
 
 	void videoSoundProgress(const AudioMsgId &audio);
 
+	// Thread: Main. Plays the song while it is being downloaded.
+	void playStreamed(
+		const AudioMsgId &audio,
+		std::shared_ptr<Streaming::SparseFile> stream,
+		TimeMs positionMs);
+
+	struct FeedCounters {
+		std::atomic<int> underruns = 0;
+		std::atomic<int> chunks = 0;
+		std::atomic<TimeMs> ahead = 0;
+		std::atomic<TimeMs> latency = 0;
+		std::atomic<TimeMs> latencyMax = 0;
+	};
+
 	class Track {
 	public:
 		static constexpr int kBuffersCount = 3;
 
+		struct DecodedChunk {
+			QByteArray samples;
+			int64 samplesCount = 0;
+			uint32 generation = 0;
+			bool last = false;
+		};
+
+		enum class FeedResult {
+			Idle,
+			Fed,
+			Error,
+		};
+
+		Track();
+
 		// Thread: Any. Must be locked: AudioMutex.
 		void reattach(AudioMsgId::Type type);
 
 		void detach();
 		void clear();
-		void started();
+
+		// Thread: Loaders. Must be locked: AudioMutex.
+		void started(int feedDepth);
+
+		// Thread: Any. Must be locked: AudioMutex.
+		// Moves the decoded chunks to the free OpenAL buffers and
+		// restarts the source if it has run out of them while playing.
+		FeedResult feed(AudioMsgId::Type type, FeedCounters &counters);
 
 		bool isStreamCreated() const;
 		void ensureStreamCreated();
@@ -191,6 +246,7 @@ private:
 
 		FileLocation file;
 		QByteArray data;
+		std::shared_ptr<Streaming::SparseFile> streamed;
 		int64 bufferedPosition = 0;
 		int64 bufferedLength = 0;
 		bool loading = false;
@@ -212,10 +268,20 @@ private:
 		TimeMs lastUpdateWhen = 0;
 		TimeMs lastUpdateCorrectedMs = 0;
 
+		// Chunks decoded by Loaders without AudioMutex. Any change of
+		// the playing audio increments the generation, so that chunks
+		// of the previous audio are dropped instead of being played.
+		std::unique_ptr<Audio::RingBuffer<DecodedChunk>> decoded;
+		std::atomic<int64> decodedSamples = 0;
+		std::atomic<uint32> generation = 0;
+		TimeMs loadRequested = 0;
+
 	private:
 		void createStream();
 		void destroyStream();
 		void resetStream();
+		bool unqueueProcessedBuffer();
+		void dropDecoded();
 
 	};
 
@@ -235,15 +301,23 @@ private:
 
 	Track _videoTrack;
 
+	FeedCounters &feedCounters(AudioMsgId::Type type);
+	const FeedCounters &feedCounters(AudioMsgId::Type type) const;
+
 	QAtomicInt _volumeVideo;
 	QAtomicInt _volumeSong;
+	QAtomicInt _feedDepth;
+	FeedCounters _feedCounters[3];
+
+	rpl::lifetime _streamedStartLifetime;
 
 	friend class Fader;
 	friend class Loaders;
 
-	QThread _faderThread, _loaderThread;
+	QThread _faderThread, _loaderThread, _streamedLoaderThread;
 	Fader *_fader;
 	Loaders *_loader;
+	Loaders *_streamedLoader;
 
 };
 
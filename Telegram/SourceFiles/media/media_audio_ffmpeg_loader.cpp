@@ -7,8 +7,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "media/media_audio_ffmpeg_loader.h"
 
+#include "media/media_streaming_file.h"
 #include "base/bytes.h"
 
+namespace {
+
+// The demuxer reads the streamed file only when at least this much is
+// downloaded after the read position, or everything up to the end.
+constexpr auto kStreamedReadAhead = 64 * 1024;
+
+} // namespace
+
 uint64_t AbstractFFMpegLoader::ComputeChannelLayout(
 		uint64_t channel_layout,
 		int channels) {
@@ -24,6 +33,13 @@ int64 AbstractFFMpegLoader::Mul(int64 value, AVRational rational) {
 	return value * rational.num / rational.den;
 }
 
+bool AbstractFFMpegLoader::streamedDataReady() const {
+	Expects(_stream != nullptr);
+
+	const auto left = _stream->size() - _dataPos;
+	return (_stream->readyFrom(_dataPos) >= std::min(left, kStreamedReadAhead));
+}
+
 bool AbstractFFMpegLoader::open(TimeMs positionMs) {
 	if (!AudioPlayerLoader::openFile()) {
 		return false;
@@ -33,7 +49,9 @@ bool AbstractFFMpegLoader::open(TimeMs positionMs) {
 	char err[AV_ERROR_MAX_STRING_SIZE] = { 0 };
 
 	ioBuffer = (uchar*)av_malloc(AVBlockSize);
-	if (!_data.isEmpty()) {
+	if (_stream) {
+		ioContext = avio_alloc_context(ioBuffer, AVBlockSize, 0, reinterpret_cast<void*>(this), &AbstractFFMpegLoader::_read_stream, 0, &AbstractFFMpegLoader::_seek_stream);
+	} else if (!_data.isEmpty()) {
 		ioContext = avio_alloc_context(ioBuffer, AVBlockSize, 0, reinterpret_cast<void*>(this), &AbstractFFMpegLoader::_read_data, 0, &AbstractFFMpegLoader::_seek_data);
 	} else if (!_bytes.empty()) {
 		ioContext = avio_alloc_context(ioBuffer, AVBlockSize, 0, reinterpret_cast<void*>(this), &AbstractFFMpegLoader::_read_bytes, 0, &AbstractFFMpegLoader::_seek_bytes);
@@ -182,6 +200,44 @@ int64_t AbstractFFMpegLoader::_seek_file(void *opaque, int64_t offset, int whenc
 	return -1;
 }
 
+int AbstractFFMpegLoader::_read_stream(void *opaque, uint8_t *buf, int buf_size) {
+	auto l = reinterpret_cast<AbstractFFMpegLoader*>(opaque);
+
+	// Blocks the streamed Loaders thread only if the demuxer jumps to
+	// the bytes that are not downloaded yet, for example after a seek.
+	const auto nbytes = l->_stream->read(
+		l->_dataPos,
+		bytes::make_span(buf, buf_size));
+	if (nbytes < 0) {
+		return AVERROR_EXIT;
+	} else if (!nbytes) {
+		return AVERROR_EOF;
+	}
+	l->_dataPos += nbytes;
+	return nbytes;
+}
+
+int64_t AbstractFFMpegLoader::_seek_stream(void *opaque, int64_t offset, int whence) {
+	auto l = reinterpret_cast<AbstractFFMpegLoader*>(opaque);
+
+	const auto size = l->_stream->size();
+	int64_t newPos = -1;
+	switch (whence) {
+	case SEEK_SET: newPos = offset; break;
+	case SEEK_CUR: newPos = l->_dataPos + offset; break;
+	case SEEK_END: newPos = size + offset; break;
+	case AVSEEK_SIZE: {
+		// Special whence for determining filesize without any seek.
+		return size;
+	} break;
+	}
+	if (newPos < 0 || newPos > size) {
+		return -1;
+	}
+	l->_dataPos = int(newPos);
+	return l->_dataPos;
+}
+
 AbstractAudioFFMpegLoader::AbstractAudioFFMpegLoader(
 	const FileLocation &file,
 	const QByteArray &data,
@@ -581,6 +637,9 @@ AudioPlayerLoader::ReadResult FFMpegLoader::readMore(
 	if (readResult != ReadResult::Wait) {
 		return readResult;
 	}
+	if (_stream && !streamedDataReady()) {
+		return _stream->cancelled() ? ReadResult::Error : ReadResult::Wait;
+	}
 
 	auto res = 0;
 	if ((res = av_read_frame(fmtContext, &_packet)) < 0) {
@@ -47,6 +47,9 @@ public:
 protected:
 	static int64 Mul(int64 value, AVRational rational);
 
+	// Reading the streamed file won't block for some time.
+	bool streamedDataReady() const;
+
 	int _samplesFrequency = Media::Player::kDefaultFrequency;
 	int64 _samplesCount = 0;
 
@@ -65,6 +68,8 @@ private:
 	static int64_t _seek_bytes(void *opaque, int64_t offset, int whence);
 	static int _read_file(void *opaque, uint8_t *buf, int buf_size);
 	static int64_t _seek_file(void *opaque, int64_t offset, int whence);
+	static int _read_stream(void *opaque, uint8_t *buf, int buf_size);
+	static int64_t _seek_stream(void *opaque, int64_t offset, int whence);
 
 };
 
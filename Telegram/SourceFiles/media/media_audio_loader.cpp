@@ -24,6 +24,11 @@ bool AudioPlayerLoader::check(const FileLocation &file, const QByteArray &data)
 	return this->_file == file && this->_data.size() == data.size();
 }
 
+void AudioPlayerLoader::setStream(
+		std::shared_ptr<Media::Streaming::SparseFile> stream) {
+	_stream = std::move(stream);
+}
+
 void AudioPlayerLoader::saveDecodedSamples(QByteArray *samples, int64 *samplesCount) {
 	Assert(_savedSamplesCount == 0);
 	Assert(_savedSamples.isEmpty());
@@ -47,7 +52,7 @@ bool AudioPlayerLoader::holdsSavedDecodedSamples() const {
 }
 
 bool AudioPlayerLoader::openFile() {
-	if (_data.isEmpty() && _bytes.empty()) {
+	if (_data.isEmpty() && _bytes.empty() && !_stream) {
 		if (_f.isOpen()) _f.close();
 		if (!_access) {
 			if (!_file.accessEnable()) {
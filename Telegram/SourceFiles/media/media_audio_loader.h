@@ -13,6 +13,12 @@ namespace FFMpeg {
 struct AVPacketDataWrap;
 } // namespace FFMpeg
 
+namespace Media {
+namespace Streaming {
+class SparseFile;
+} // namespace Streaming
+} // namespace Media
+
 class AudioPlayerLoader {
 public:
 	AudioPlayerLoader(
@@ -23,6 +29,13 @@ public:
 
 	virtual bool check(const FileLocation &file, const QByteArray &data);
 
+	// Reads the file that is still being downloaded, must be set
+	// before open(). The file location and data are not used then.
+	void setStream(std::shared_ptr<Media::Streaming::SparseFile> stream);
+	bool streamed() const {
+		return (_stream != nullptr);
+	}
+
 	virtual bool open(TimeMs positionMs) = 0;
 	virtual int64 samplesCount() = 0;
 	virtual int samplesFrequency() = 0;
@@ -49,6 +62,7 @@ protected:
 	bool _access = false;
 	QByteArray _data;
 	bytes::vector _bytes;
+	std::shared_ptr<Media::Streaming::SparseFile> _stream;
 
 	QFile _f;
 	int _dataPos = 0;
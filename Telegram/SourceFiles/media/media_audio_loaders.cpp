@@ -14,7 +14,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Media {
 namespace Player {
 
-Loaders::Loaders(QThread *thread) : _fromVideoNotify([this] { videoSoundAdded(); }) {
+Loaders::Loaders(QThread *thread, bool streamed)
+: _streamed(streamed)
+, _fromVideoNotify([this] { videoSoundAdded(); }) {
 	moveToThread(thread);
 	_fromVideoNotify.moveToThread(thread);
 	connect(thread, SIGNAL(started()), this, SLOT(onInit()));
@@ -139,144 +141,141 @@ void Loaders::loadData(AudioMsgId audio, TimeMs positionMs) {
 	auto waiting = false;
 	auto errAtStart = started;
 
-	QByteArray samples;
-	int64 samplesCount = 0;
-	if (l->holdsSavedDecodedSamples()) {
-		l->takeSavedDecodedSamples(&samples, &samplesCount);
-	}
-	while (samples.size() < AudioVoiceMsgBufferSize) {
-		auto res = l->readMore(samples, samplesCount);
-		using Result = AudioPlayerLoader::ReadResult;
-		if (res == Result::Error) {
-			if (errAtStart) {
-				{
-					QMutexLocker lock(internal::audioPlayerMutex());
-					if (auto track = checkLoader(type)) {
-						track->state.state = State::StoppedAtStart;
-					}
-				}
-				emitError(type);
-				return;
-			}
-			finished = true;
-			break;
-		} else if (res == Result::EndOfFile) {
-			finished = true;
-			break;
-		} else if (res == Result::Ok) {
-			errAtStart = false;
-		} else if (res == Result::Wait) {
-			waiting = (samples.size() < AudioVoiceMsgBufferSize);
-			if (waiting) {
-				l->saveDecodedSamples(&samples, &samplesCount);
-			}
-			break;
-		}
-
+	auto track = (Mixer::Track*)nullptr;
+	auto generation = uint32(0);
+	{
 		QMutexLocker lock(internal::audioPlayerMutex());
-		if (!checkLoader(type)) {
+		track = checkLoader(type);
+		if (!track) {
 			clear(type);
 			return;
 		}
+		generation = track->generation.load();
 	}
 
-	QMutexLocker lock(internal::audioPlayerMutex());
-	auto track = checkLoader(type);
-	if (!track) {
-		clear(type);
-		return;
-	}
-
-	if (started) {
-		Audio::AttachToDevice();
-
-		track->started();
-		if (!internal::audioCheckError()) {
-			setStoppedState(track, State::StoppedAtStart);
-			emitError(type);
-			return;
+	// Chunks are decoded without AudioMutex until the track buffer is
+	// full, the mixer picks them up from there when it needs them.
+	while (!finished && !waiting) {
+		if (!started && track->decoded->full()) {
+			break;
 		}
 
-		track->format = l->format();
-		track->frequency = l->samplesFrequency();
-
-		const auto position = (positionMs * track->frequency) / 1000LL;
-		track->bufferedPosition = position;
-		track->state.position = position;
-		track->fadeStartPosition = position;
-	}
-	if (samplesCount) {
-		track->ensureStreamCreated();
-
-		auto bufferIndex = track->getNotQueuedBufferIndex();
-
-		if (!internal::audioCheckError()) {
-			setStoppedState(track, State::StoppedAtError);
-			emitError(type);
-			return;
+		QByteArray samples;
+		int64 samplesCount = 0;
+		if (l->holdsSavedDecodedSamples()) {
+			l->takeSavedDecodedSamples(&samples, &samplesCount);
 		}
+		while (samples.size() < AudioVoiceMsgBufferSize) {
+			auto res = l->readMore(samples, samplesCount);
+			using Result = AudioPlayerLoader::ReadResult;
+			if (res == Result::Error) {
+				if (errAtStart) {
+					{
+						QMutexLocker lock(internal::audioPlayerMutex());
+						if (checkLoader(type)) {
+							track->state.state = State::StoppedAtStart;
+						}
+					}
+					emitError(type);
+					return;
+				}
+				finished = true;
+				break;
+			} else if (res == Result::EndOfFile) {
+				finished = true;
+				break;
+			} else if (res == Result::Ok) {
+				errAtStart = false;
+			} else if (res == Result::Wait) {
+				waiting = (samples.size() < AudioVoiceMsgBufferSize);
+				if (waiting) {
+					l->saveDecodedSamples(&samples, &samplesCount);
+				}
+				break;
+			}
 
-		if (bufferIndex < 0) { // No free buffers, wait.
-			l->saveDecodedSamples(&samples, &samplesCount);
-			return;
+			if (track->generation.load() != generation) {
+				clear(type);
+				return;
+			}
 		}
 
-		track->bufferSamples[bufferIndex] = samples;
-		track->samplesCount[bufferIndex] = samplesCount;
-		track->bufferedLength += samplesCount;
-		alBufferData(track->stream.buffers[bufferIndex], track->format, samples.constData(), samples.size(), track->frequency);
+		if (started) {
+			started = false;
+
+			QMutexLocker lock(internal::audioPlayerMutex());
+			if (!checkLoader(type)) {
+				clear(type);
+				return;
+			}
+			Audio::AttachToDevice();
+
+			track->started(mixer()->feedDepth());
+			if (!internal::audioCheckError()) {
+				setStoppedState(track, State::StoppedAtStart);
+				emitError(type);
+				return;
+			}
 
-		alSourceQueueBuffers(track->stream.source, 1, track->stream.buffers + bufferIndex);
+			track->format = l->format();
+			track->frequency = l->samplesFrequency();
 
-		if (!internal::audioCheckError()) {
-			setStoppedState(track, State::StoppedAtError);
-			emitError(type);
-			return;
+			const auto position = (positionMs * track->frequency) / 1000LL;
+			track->bufferedPosition = position;
+			track->state.position = position;
+			track->fadeStartPosition = position;
 		}
-	} else {
-		if (waiting) {
-			return;
+		if (samplesCount || finished) {
+			// While a track switches between the Loaders instances the
+			// previous one may still be here, only the current
+			// generation is allowed to push.
+			QMutexLocker lock(internal::audioPlayerMutex());
+			if (track->generation.load() != generation) {
+				clear(type);
+				return;
+			}
+			track->decodedSamples += samplesCount;
+			track->decoded->push({
+				std::move(samples),
+				samplesCount,
+				generation,
+				finished });
 		}
-		finished = true;
+	}
+
+	QMutexLocker lock(internal::audioPlayerMutex());
+	if (!checkLoader(type)) {
+		clear(type);
+		return;
 	}
 
 	if (finished) {
 		track->loaded = true;
-		track->state.length = track->bufferedPosition + track->bufferedLength;
 		clear(type);
 	}
 
-	track->loading = false;
-	if (track->state.state == State::Resuming || track->state.state == State::Playing || track->state.state == State::Starting) {
-		ALint state = AL_INITIAL;
-		alGetSourcei(track->stream.source, AL_SOURCE_STATE, &state);
-		if (internal::audioCheckError()) {
-			if (state != AL_PLAYING) {
-				if (state == AL_STOPPED && !internal::CheckAudioDeviceConnected()) {
-					return;
-				}
-
-				alSourcef(track->stream.source, AL_GAIN, ComputeVolume(type));
-				if (!internal::audioCheckError()) {
-					setStoppedState(track, State::StoppedAtError);
-					emitError(type);
-					return;
-				}
-
-				alSourcePlay(track->stream.source);
-				if (!internal::audioCheckError()) {
-					setStoppedState(track, State::StoppedAtError);
-					emitError(type);
-					return;
-				}
-
-				emit needToCheck();
+	auto &counters = mixer()->feedCounters(type);
+	if (waiting && l->streamed()) {
+		// Fader will ask again, when more of the file is downloaded.
+		track->loading = false;
+	} else if (!waiting) {
+		track->loading = false;
+		if (const auto requested = base::take(track->loadRequested)) {
+			const auto latency = getms() - requested;
+			counters.latency = latency;
+			if (latency > counters.latencyMax.load()) {
+				counters.latencyMax = latency;
 			}
-		} else {
-			setStoppedState(track, State::StoppedAtError);
-			emitError(type);
 		}
 	}
+
+	const auto result = track->feed(type, counters);
+	if (result == Mixer::Track::FeedResult::Error) {
+		setStoppedState(track, State::StoppedAtError);
+		emitError(type);
+	} else if (result == Mixer::Track::FeedResult::Fed) {
+		emit needToCheck();
+	}
 }
 
 AudioPlayerLoader *Loaders::setupLoader(
@@ -288,7 +287,17 @@ AudioPlayerLoader *Loaders::setupLoader(
 	if (!mixer()) return nullptr;
 
 	auto track = mixer()->trackForType(audio.type());
-	if (!track || track->state.id != audio || !track->loading) {
+	if (track
+		&& track->state.id == audio
+		&& (track->streamed != nullptr) != _streamed) {
+		err = SetupErrorOtherLoaders;
+		return nullptr;
+	} else if (!track || track->state.id != audio || !track->loading) {
+		if (_streamed) {
+			// The error is reported once, by the other instance.
+			err = SetupErrorOtherLoaders;
+			return nullptr;
+		}
 		emit error(audio);
 		LOG(("Audio Error: trying to load part of audio, that is not current at the moment"));
 		err = SetupErrorNotPlaying;
@@ -327,10 +336,25 @@ AudioPlayerLoader *Loaders::setupLoader(
 			*loader = std::make_unique<ChildFFMpegLoader>(std::move(track->videoData));
 		} else {
 			*loader = std::make_unique<FFMpegLoader>(track->file, track->data, bytes::vector());
+			if (track->streamed) {
+				(*loader)->setStream(track->streamed);
+			}
 		}
 		l = loader->get();
 
-		if (!l->open(positionMs)) {
+		// A streamed file may wait for the download here.
+		lock.unlock();
+		const auto opened = l->open(positionMs);
+		lock.relock();
+		if (!mixer()) {
+			return nullptr;
+		}
+		track = mixer()->trackForType(audio.type());
+		if (!track || track->state.id != audio || !track->loading) {
+			clear(audio.type());
+			err = SetupErrorNotPlaying;
+			return nullptr;
+		} else if (!opened) {
 			track->state.state = State::StoppedAtStart;
 			return nullptr;
 		}
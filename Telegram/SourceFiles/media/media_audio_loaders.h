@@ -21,7 +21,7 @@ class Loaders : public QObject {
 	Q_OBJECT
 
 public:
-	Loaders(QThread *thread);
+	Loaders(QThread *thread, bool streamed);
 	void feedFromVideo(VideoSoundPart &&part);
 	~Loaders();
 
@@ -40,6 +40,11 @@ private:
 	void videoSoundAdded();
 	void clearFromVideoQueue();
 
+	// Streamed tracks are decoded by a separate instance on its own
+	// thread, because SparseFile::read() blocks until the download
+	// reaches the offset the demuxer has jumped to.
+	const bool _streamed = false;
+
 	AudioMsgId _audio, _song, _video;
 	std::unique_ptr<AudioPlayerLoader> _audioLoader;
 	std::unique_ptr<AudioPlayerLoader> _songLoader;
@@ -58,6 +63,7 @@ private:
 		SetupErrorNotPlaying = 1,
 		SetupErrorLoadedFull = 2,
 		SetupNoErrorStarted = 3,
+		SetupErrorOtherLoaders = 4,
 	};
 	void loadData(AudioMsgId audio, TimeMs positionMs);
 	AudioPlayerLoader *setupLoader(
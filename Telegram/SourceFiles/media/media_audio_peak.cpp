@@ -0,0 +1,91 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "media/media_audio_peak.h"
+
+#include "base/algorithm.h"
+
+#ifdef ARCH_CPU_X86_64
+#include <emmintrin.h>
+#endif // ARCH_CPU_X86_64
+
+namespace Media {
+namespace Audio {
+
+// On x86_64 SSE2 is always available, the samples are processed
+// by 8 and 16 at once tracking the minimum and the maximum value.
+uint16 CountPeak(gsl::span<const int16> samples) {
+	const auto data = samples.data();
+	const auto size = samples.size();
+	auto maximum = int16(0);
+	auto minimum = int16(0);
+	auto i = decltype(samples.size())(0);
+#ifdef ARCH_CPU_X86_64
+	constexpr auto kStep = int(sizeof(__m128i) / sizeof(int16));
+	if (size >= kStep) {
+		auto maximums = _mm_setzero_si128();
+		auto minimums = _mm_setzero_si128();
+		for (; i + kStep <= size; i += kStep) {
+			const auto values = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(data + i));
+			maximums = _mm_max_epi16(maximums, values);
+			minimums = _mm_min_epi16(minimums, values);
+		}
+		alignas(16) int16 maximumsData[kStep];
+		alignas(16) int16 minimumsData[kStep];
+		_mm_store_si128(reinterpret_cast<__m128i*>(maximumsData), maximums);
+		_mm_store_si128(reinterpret_cast<__m128i*>(minimumsData), minimums);
+		for (auto j = 0; j != kStep; ++j) {
+			accumulate_max(maximum, maximumsData[j]);
+			accumulate_min(minimum, minimumsData[j]);
+		}
+	}
+#endif // ARCH_CPU_X86_64
+	for (; i != size; ++i) {
+		accumulate_max(maximum, data[i]);
+		accumulate_min(minimum, data[i]);
+	}
+	return uint16(std::max(int(maximum), -int(minimum)));
+}
+
+uint16 CountPeak(gsl::span<const uchar> samples) {
+	const auto data = samples.data();
+	const auto size = samples.size();
+	auto maximum = uchar(0x80);
+	auto minimum = uchar(0x80);
+	auto i = decltype(samples.size())(0);
+#ifdef ARCH_CPU_X86_64
+	constexpr auto kStep = int(sizeof(__m128i));
+	if (size >= kStep) {
+		auto maximums = _mm_set1_epi8(char(0x80));
+		auto minimums = maximums;
+		for (; i + kStep <= size; i += kStep) {
+			const auto values = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(data + i));
+			maximums = _mm_max_epu8(maximums, values);
+			minimums = _mm_min_epu8(minimums, values);
+		}
+		alignas(16) uchar maximumsData[kStep];
+		alignas(16) uchar minimumsData[kStep];
+		_mm_store_si128(reinterpret_cast<__m128i*>(maximumsData), maximums);
+		_mm_store_si128(reinterpret_cast<__m128i*>(minimumsData), minimums);
+		for (auto j = 0; j != kStep; ++j) {
+			accumulate_max(maximum, maximumsData[j]);
+			accumulate_min(minimum, minimumsData[j]);
+		}
+	}
+#endif // ARCH_CPU_X86_64
+	for (; i != size; ++i) {
+		accumulate_max(maximum, data[i]);
+		accumulate_min(minimum, data[i]);
+	}
+	const auto peak = std::max(int(maximum) - 0x80, 0x80 - int(minimum));
+	return uint16(peak * 0x100);
+}
+
+} // namespace Audio
+} // namespace Media
@@ -0,0 +1,20 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+namespace Media {
+namespace Audio {
+
+// Absolute peak of the samples, 8 bit samples are scaled to 16 bit.
+uint16 CountPeak(gsl::span<const int16> samples);
+uint16 CountPeak(gsl::span<const uchar> samples);
+
+} // namespace Audio
+} // namespace Media
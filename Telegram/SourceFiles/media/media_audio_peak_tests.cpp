@@ -0,0 +1,145 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "media/media_audio_peak.h"
+#include "base/algorithm.h"
+
+#include <random>
+
+using Media::Audio::CountPeak;
+
+namespace {
+
+constexpr auto kMaxSize = 100;
+
+// The same values as Media::Player::ReadOneSample() gives, sample by sample.
+uint16 ScalarPeak(gsl::span<const int16> samples) {
+	auto result = uint16(0);
+	for (const auto sample : samples) {
+		accumulate_max(result, uint16(std::abs(int(sample))));
+	}
+	return result;
+}
+
+uint16 ScalarPeak(gsl::span<const uchar> samples) {
+	auto result = uint16(0);
+	for (const auto sample : samples) {
+		accumulate_max(result, uint16(std::abs((int(sample) - 0x80) * 0x100)));
+	}
+	return result;
+}
+
+template <typename Sample>
+uint16 Peak(const std::vector<Sample> &samples) {
+	return CountPeak(gsl::span<const Sample>(samples));
+}
+
+template <typename Sample>
+std::vector<Sample> Random(
+		std::mt19937 &generator,
+		int size,
+		int from,
+		int till) {
+	auto distribution = std::uniform_int_distribution<int>(from, till);
+	auto result = std::vector<Sample>(size);
+	for (auto &sample : result) {
+		sample = Sample(distribution(generator));
+	}
+	return result;
+}
+
+template <typename Sample>
+void CheckAllSubspans(const std::vector<Sample> &samples) {
+	const auto size = int(samples.size());
+	for (auto offset = 0; offset != std::min(size, 3); ++offset) {
+		for (auto count = 0; offset + count <= size; ++count) {
+			const auto span = gsl::span<const Sample>(samples).subspan(
+				offset,
+				count);
+			REQUIRE(CountPeak(span) == ScalarPeak(span));
+		}
+	}
+}
+
+} // namespace
+
+TEST_CASE("16 bit peak matches the scalar path", "[Media::Audio::CountPeak]") {
+	auto generator = std::mt19937(1234);
+
+	SECTION("empty and silent input") {
+		REQUIRE(CountPeak(gsl::span<const int16>()) == 0);
+		const auto silence = std::vector<int16>(kMaxSize, 0);
+		CheckAllSubspans(silence);
+	}
+
+	SECTION("random input of every size and alignment") {
+		for (auto i = 0; i != 20; ++i) {
+			CheckAllSubspans(Random<int16>(generator, kMaxSize, -1000, 1000));
+		}
+		CheckAllSubspans(Random<int16>(generator, kMaxSize, -32768, 32767));
+	}
+
+	SECTION("only positive or only negative input") {
+		CheckAllSubspans(Random<int16>(generator, kMaxSize, 1, 30000));
+		CheckAllSubspans(Random<int16>(generator, kMaxSize, -30000, -1));
+	}
+
+	SECTION("minimum value in the vector body and in the tail") {
+		for (const auto position : { 0, 3, 7, 8, 15, 16, 63, 64, 70, 99 }) {
+			auto samples = Random<int16>(generator, kMaxSize, -100, 100);
+			samples[position] = std::numeric_limits<int16>::min();
+			REQUIRE(Peak(samples) == 32768);
+			CheckAllSubspans(samples);
+		}
+	}
+
+	SECTION("maximum value in the vector body and in the tail") {
+		for (const auto position : { 0, 7, 8, 64, 99 }) {
+			auto samples = Random<int16>(generator, kMaxSize, -100, 100);
+			samples[position] = std::numeric_limits<int16>::max();
+			REQUIRE(Peak(samples) == 32767);
+			CheckAllSubspans(samples);
+		}
+	}
+}
+
+TEST_CASE("8 bit peak matches the scalar path", "[Media::Audio::CountPeak]") {
+	auto generator = std::mt19937(4321);
+
+	SECTION("empty and silent input") {
+		REQUIRE(CountPeak(gsl::span<const uchar>()) == 0);
+		const auto silence = std::vector<uchar>(kMaxSize, 0x80);
+		CheckAllSubspans(silence);
+	}
+
+	SECTION("random input of every size and alignment") {
+		for (auto i = 0; i != 20; ++i) {
+			CheckAllSubspans(Random<uchar>(generator, kMaxSize, 0x70, 0x90));
+		}
+		CheckAllSubspans(Random<uchar>(generator, kMaxSize, 0, 0xFF));
+	}
+
+	SECTION("only high or only low input") {
+		CheckAllSubspans(Random<uchar>(generator, kMaxSize, 0x81, 0xFF));
+		CheckAllSubspans(Random<uchar>(generator, kMaxSize, 0, 0x7F));
+	}
+
+	SECTION("extreme values in the vector body and in the tail") {
+		for (const auto position : { 0, 15, 16, 31, 32, 80, 95, 99 }) {
+			auto samples = Random<uchar>(generator, kMaxSize, 0x7C, 0x84);
+			samples[position] = 0;
+			REQUIRE(Peak(samples) == 32768);
+			CheckAllSubspans(samples);
+
+			samples[position] = 0xFF;
+			REQUIRE(Peak(samples) == 32512);
+			CheckAllSubspans(samples);
+		}
+	}
+}
@@ -0,0 +1,117 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/assertion.h"
+#include <atomic>
+#include <vector>
+
+namespace Media {
+namespace Audio {
+
+// Bounded single producer single consumer queue without locks.
+//
+// push() and full() may be called only by the producer thread, front(),
+// pop() and empty() only by the consumer. The consumer role may move
+// between threads if they are serialized by some mutex.
+template <typename Type>
+class RingBuffer {
+public:
+	explicit RingBuffer(int capacity);
+	RingBuffer(const RingBuffer &other) = delete;
+	RingBuffer &operator=(const RingBuffer &other) = delete;
+
+	int capacity() const {
+		return int(_values.size()) - 1;
+	}
+
+	// Thread: Producer.
+	bool push(Type &&value);
+	bool full() const;
+
+	// Thread: Consumer.
+	Type *front();
+	void pop();
+	bool empty() const;
+
+	// Thread: Any. Exact only when the other side is idle.
+	int size() const;
+
+private:
+	int next(int index) const {
+		return (index + 1 == int(_values.size())) ? 0 : (index + 1);
+	}
+
+	std::vector<Type> _values;
+
+	// Separate cache lines, so that the threads don't invalidate each
+	// other's index on every operation.
+	alignas(64) std::atomic<int> _head = 0; // Written by the consumer.
+	alignas(64) std::atomic<int> _tail = 0; // Written by the producer.
+
+};
+
+template <typename Type>
+RingBuffer<Type>::RingBuffer(int capacity) : _values(capacity + 1) {
+	Expects(capacity > 0);
+}
+
+template <typename Type>
+bool RingBuffer<Type>::push(Type &&value) {
+	const auto tail = _tail.load(std::memory_order_relaxed);
+	const auto following = next(tail);
+	if (following == _head.load(std::memory_order_acquire)) {
+		return false;
+	}
+	_values[tail] = std::move(value);
+	_tail.store(following, std::memory_order_release);
+	return true;
+}
+
+template <typename Type>
+bool RingBuffer<Type>::full() const {
+	const auto tail = _tail.load(std::memory_order_relaxed);
+	return (next(tail) == _head.load(std::memory_order_acquire));
+}
+
+template <typename Type>
+Type *RingBuffer<Type>::front() {
+	const auto head = _head.load(std::memory_order_relaxed);
+	if (head == _tail.load(std::memory_order_acquire)) {
+		return nullptr;
+	}
+	return &_values[head];
+}
+
+template <typename Type>
+void RingBuffer<Type>::pop() {
+	const auto head = _head.load(std::memory_order_relaxed);
+	Expects(head != _tail.load(std::memory_order_acquire));
+
+	// Free the value memory right away, not when the slot is reused.
+	_values[head] = Type();
+	_head.store(next(head), std::memory_order_release);
+}
+
+template <typename Type>
+bool RingBuffer<Type>::empty() const {
+	const auto head = _head.load(std::memory_order_relaxed);
+	return (head == _tail.load(std::memory_order_acquire));
+}
+
+template <typename Type>
+int RingBuffer<Type>::size() const {
+	const auto head = _head.load(std::memory_order_acquire);
+	const auto tail = _tail.load(std::memory_order_acquire);
+	return (tail >= head)
+		? (tail - head)
+		: (tail + int(_values.size()) - head);
+}
+
+} // namespace Audio
+} // namespace Media
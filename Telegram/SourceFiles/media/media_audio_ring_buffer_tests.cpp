@@ -0,0 +1,75 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "media/media_audio_ring_buffer.h"
+#include <memory>
+#include <thread>
+
+using Media::Audio::RingBuffer;
+
+TEST_CASE("ring buffer tests", "[Media::Audio::RingBuffer]") {
+	SECTION("push and pop in order") {
+		auto ring = RingBuffer<int>(3);
+		REQUIRE(ring.capacity() == 3);
+		REQUIRE(ring.empty());
+		REQUIRE(ring.front() == nullptr);
+		REQUIRE(ring.push(1));
+		REQUIRE(ring.push(2));
+		REQUIRE(ring.push(3));
+		REQUIRE(ring.full());
+		REQUIRE(!ring.push(4));
+		REQUIRE(ring.size() == 3);
+		REQUIRE(*ring.front() == 1);
+		ring.pop();
+		REQUIRE(!ring.full());
+		REQUIRE(ring.push(4));
+		for (auto value = 2; value != 5; ++value) {
+			REQUIRE(*ring.front() == value);
+			ring.pop();
+		}
+		REQUIRE(ring.empty());
+		REQUIRE(ring.size() == 0);
+	}
+	SECTION("popped values are destroyed") {
+		auto ring = RingBuffer<std::shared_ptr<int>>(2);
+		auto value = std::make_shared<int>(1);
+		REQUIRE(ring.push(std::shared_ptr<int>(value)));
+		REQUIRE(value.use_count() == 2);
+		ring.pop();
+		REQUIRE(value.use_count() == 1);
+	}
+	SECTION("producer and consumer threads") {
+		constexpr auto kCount = 100000;
+
+		auto ring = RingBuffer<int>(4);
+		auto producer = std::thread([&] {
+			for (auto i = 0; i != kCount;) {
+				if (ring.push(int(i))) {
+					++i;
+				} else {
+					std::this_thread::yield();
+				}
+			}
+		});
+		auto received = 0;
+		auto ordered = true;
+		while (received != kCount) {
+			if (const auto value = ring.front()) {
+				ordered = ordered && (*value == received);
+				ring.pop();
+				++received;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+		producer.join();
+		REQUIRE(ordered);
+		REQUIRE(ring.empty());
+	}
+}
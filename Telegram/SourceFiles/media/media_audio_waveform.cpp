@@ -0,0 +1,102 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "media/media_audio_waveform.h"
+
+#include "media/media_audio.h"
+
+#include "media/media_audio_peak.h"
+
+#include <numeric>
+
+namespace Media {
+namespace Audio {
+namespace {
+
+constexpr auto kWaveformMaxValue = 31;
+constexpr auto kMinNormalizePeak = 2500;
+
+} // namespace
+
+WaveformCounter::WaveformCounter(int64 samplesCount)
+: _samplesCount(samplesCount) {
+	Expects(_samplesCount >= Player::kWaveformSamplesCount);
+
+	_peaks.reserve(Player::kWaveformSamplesCount);
+}
+
+void WaveformCounter::add(gsl::span<const int16> samples) {
+	addSamples(samples);
+}
+
+void WaveformCounter::add(gsl::span<const uchar> samples) {
+	addSamples(samples);
+}
+
+bool WaveformCounter::full() const {
+	return (_peaks.size() == Player::kWaveformSamplesCount);
+}
+
+template <typename Sample>
+void WaveformCounter::addSamples(gsl::span<const Sample> samples) {
+	while (!samples.empty() && !full()) {
+		const auto index = int64(_peaks.size()) + 1;
+		const auto till = (index * _samplesCount)
+			/ Player::kWaveformSamplesCount;
+		const auto count = std::min(
+			int64(samples.size()),
+			till - _processed);
+		accumulate_max(_peak, CountPeak(samples.subspan(0, count)));
+		_processed += count;
+		samples = samples.subspan(count);
+		if (_processed == till) {
+			_peaks.push_back(base::take(_peak));
+		}
+	}
+}
+
+VoiceWaveform WaveformCounter::finish() {
+	const auto index = int64(_peaks.size());
+	const auto from = (index * _samplesCount)
+		/ Player::kWaveformSamplesCount;
+	if (!full() && _processed > from) {
+		_peaks.push_back(base::take(_peak));
+	}
+	if (_peaks.empty()) {
+		return VoiceWaveform();
+	}
+
+	const auto sum = std::accumulate(_peaks.begin(), _peaks.end(), 0LL);
+	const auto peak = std::max(
+		int(sum * 1.8 / _peaks.size()),
+		kMinNormalizePeak);
+
+	auto result = VoiceWaveform();
+	result.reserve(_peaks.size());
+	for (const auto value : _peaks) {
+		result.push_back(char(std::min(
+			uint32(kWaveformMaxValue),
+			uint32(std::min(int(value), peak)) * kWaveformMaxValue / peak)));
+	}
+	return result;
+}
+
+bool ValidateWaveform(const VoiceWaveform &waveform) {
+	if (waveform.isEmpty()
+		|| waveform.size() > Player::kWaveformSamplesCount) {
+		return false;
+	}
+	for (const auto value : waveform) {
+		if (value < 0 || value > kWaveformMaxValue) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace Audio
+} // namespace Media
@@ -0,0 +1,43 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Media {
+namespace Audio {
+
+// Collects the voice message waveform from the decoded samples chunk
+// by chunk, so that the decoded audio is never kept in memory whole.
+class WaveformCounter {
+public:
+	// The count of all samples of all channels.
+	explicit WaveformCounter(int64 samplesCount);
+
+	void add(gsl::span<const int16> samples);
+	void add(gsl::span<const uchar> samples);
+
+	bool full() const;
+
+	// Returns an empty waveform if nothing was added.
+	VoiceWaveform finish();
+
+private:
+	template <typename Sample>
+	void addSamples(gsl::span<const Sample> samples);
+
+	int64 _samplesCount = 0;
+	int64 _processed = 0;
+	std::vector<uint16> _peaks;
+	uint16 _peak = 0;
+
+};
+
+// Checks the waveform loaded from the local cache.
+bool ValidateWaveform(const VoiceWaveform &waveform);
+
+} // namespace Audio
+} // namespace Media
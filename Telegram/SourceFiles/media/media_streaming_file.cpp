@@ -0,0 +1,261 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "media/media_streaming_file.h"
+
+#include "base/algorithm.h"
+#include "base/assertion.h"
+
+namespace Media {
+namespace Streaming {
+namespace {
+
+// Enough for the decoder to read the headers and the first frames.
+constexpr auto kStartBytes = 512 * 1024;
+
+// Demuxers look for the tags at the end of the file while opening it.
+constexpr auto kEndBytes = 4 * 1024;
+
+constexpr auto kBoxHeaderSize = 8;
+constexpr auto kLargeBoxHeaderSize = 16;
+
+uint64 ReadBigEndian(bytes::const_span data) {
+	auto result = uint64(0);
+	for (const auto byte : data) {
+		result = (result << 8) | uint64(uchar(byte));
+	}
+	return result;
+}
+
+bool IsBoxType(bytes::const_span header, const char (&type)[5]) {
+	return !bytes::compare(
+		header.subspan(4, 4),
+		bytes::make_span(type, 4));
+}
+
+} // namespace
+
+SparseFile::SparseFile(int size) : _size(size) {
+	Expects(size > 0);
+}
+
+void SparseFile::feed(int offset, bytes::vector &&bytes) {
+	Expects(offset >= 0);
+
+	if (offset >= _size || bytes.empty()) {
+		return;
+	} else if (offset + int(bytes.size()) > _size) {
+		bytes.resize(_size - offset);
+	}
+	auto wanted = -1;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_cancelled) {
+			return;
+		}
+		auto &part = _parts[offset];
+		if (part.size() < bytes.size()) {
+			part = std::move(bytes);
+		}
+		findIndexLocked();
+		const auto prefetch = prefetchWantedLocked();
+		if (prefetch != _prefetchWanted) {
+			_prefetchWanted = wanted = prefetch;
+		}
+	}
+	_arrived.notify_all();
+	if (wanted >= 0) {
+		_wanted.fire_copy(wanted);
+	}
+	_fed.fire({});
+}
+
+void SparseFile::cancel() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_cancelled) {
+			return;
+		}
+		_cancelled = true;
+		_parts.clear();
+	}
+	_arrived.notify_all();
+	_fed.fire({});
+}
+
+rpl::producer<> SparseFile::fed() const {
+	return _fed.events();
+}
+
+rpl::producer<int> SparseFile::wantedOffsets() const {
+	return _wanted.events_on_main();
+}
+
+bool SparseFile::startable() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_cancelled) {
+		return false;
+	} else if (readyFromLocked(0) < std::min(_size, kStartBytes)) {
+		return false;
+	} else if (readyFromLocked(endOffset()) < _size - endOffset()) {
+		return false;
+	}
+	switch (_index) {
+	case Index::Searching: return false;
+	case Index::Found: return (readyFromLocked(_boxOffset) >= _indexSize);
+	case Index::None: return true;
+	}
+	Unexpected("Index state in SparseFile::startable.");
+}
+
+bool SparseFile::complete() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return (readyFromLocked(0) >= _size);
+}
+
+bool SparseFile::cancelled() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _cancelled;
+}
+
+int SparseFile::readyFrom(int offset) const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return readyFromLocked(offset);
+}
+
+int SparseFile::read(int offset, bytes::span buffer) {
+	Expects(offset >= 0);
+
+	auto lock = std::unique_lock<std::mutex>(_mutex);
+	auto requested = false;
+	while (true) {
+		if (_cancelled) {
+			return -1;
+		} else if (offset >= _size || buffer.empty()) {
+			return 0;
+		}
+		auto i = _parts.upper_bound(offset);
+		if (i != begin(_parts)) {
+			--i;
+			const auto from = offset - i->first;
+			const auto available = int(i->second.size()) - from;
+			if (available > 0) {
+				const auto count = std::min(available, int(buffer.size()));
+				bytes::copy(
+					buffer,
+					bytes::make_span(i->second).subspan(from, count));
+				return count;
+			}
+		}
+		if (!requested) {
+			requested = true;
+			_wanted.fire_copy(offset);
+		}
+		_arrived.wait(lock);
+	}
+}
+
+int SparseFile::readyFromLocked(int offset) const {
+	auto i = _parts.upper_bound(offset);
+	if (i == begin(_parts)) {
+		return 0;
+	}
+	--i;
+	auto till = offset;
+	for (; i != end(_parts) && i->first <= till; ++i) {
+		accumulate_max(till, i->first + int(i->second.size()));
+	}
+	return till - offset;
+}
+
+bool SparseFile::copyLocked(int offset, bytes::span buffer) const {
+	while (!buffer.empty()) {
+		auto i = _parts.upper_bound(offset);
+		if (i == begin(_parts)) {
+			return false;
+		}
+		--i;
+		const auto from = offset - i->first;
+		const auto available = int(i->second.size()) - from;
+		if (available <= 0) {
+			return false;
+		}
+		const auto count = std::min(available, int(buffer.size()));
+		bytes::copy(buffer, bytes::make_span(i->second).subspan(from, count));
+		buffer = buffer.subspan(count);
+		offset += count;
+	}
+	return true;
+}
+
+void SparseFile::findIndexLocked() {
+	// Walk the top level MP4 boxes up to "moov", most of them are not
+	// downloaded yet, but only their headers are needed here.
+	while (_index == Index::Searching) {
+		auto header = bytes::array<kLargeBoxHeaderSize>();
+		const auto available = std::min(
+			kLargeBoxHeaderSize,
+			_size - _boxOffset);
+		if (available < kBoxHeaderSize) {
+			_index = Index::None;
+			return;
+		}
+		const auto data = bytes::make_span(header).subspan(0, available);
+		if (!copyLocked(_boxOffset, data)) {
+			return;
+		} else if (!_boxOffset && !IsBoxType(data, "ftyp")) {
+			_index = Index::None;
+			return;
+		}
+		auto boxSize = ReadBigEndian(data.subspan(0, 4));
+		if (boxSize == 1) {
+			if (available < kLargeBoxHeaderSize) {
+				_index = Index::None;
+				return;
+			}
+			boxSize = ReadBigEndian(data.subspan(8, 8));
+		} else if (!boxSize) {
+			boxSize = uint64(_size - _boxOffset);
+		}
+		if (boxSize < kBoxHeaderSize
+			|| boxSize > uint64(_size - _boxOffset)) {
+			_index = Index::None;
+			return;
+		} else if (IsBoxType(data, "moov")) {
+			_index = Index::Found;
+			_indexSize = int(boxSize);
+			return;
+		}
+		_boxOffset += int(boxSize);
+	}
+}
+
+int SparseFile::endOffset() const {
+	return std::max(_size - kEndBytes, 0);
+}
+
+int SparseFile::prefetchWantedLocked() const {
+	const auto end = readyFromLocked(endOffset());
+	if (end < _size - endOffset()) {
+		return endOffset() + end;
+	}
+	switch (_index) {
+	case Index::Searching: {
+		// The next box header lies after a box that isn't downloaded.
+		return (readyFromLocked(0) > _boxOffset) ? -1 : _boxOffset;
+	} break;
+	case Index::Found: {
+		const auto ready = readyFromLocked(_boxOffset);
+		return (ready < _indexSize) ? (_boxOffset + ready) : -1;
+	} break;
+	case Index::None: return -1;
+	}
+	Unexpected("Index state in SparseFile::prefetchWantedLocked.");
+}
+
+} // namespace Streaming
+} // namespace Media
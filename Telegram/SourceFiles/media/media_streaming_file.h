@@ -0,0 +1,85 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/bytes.h"
+
+#include <rpl/concurrent_event_stream.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+namespace Media {
+namespace Streaming {
+
+// Contents of a file that is still being downloaded.
+//
+// The downloader feeds the parts in any order, the decoder reads them
+// on its own thread. Offsets the reader has to wait for are fired to
+// wantedOffsets(), so that they can be downloaded before the rest.
+// The end of the file and, for MP4 files, the index box written after
+// the media data are requested the same way before the start.
+class SparseFile {
+public:
+	explicit SparseFile(int size);
+	SparseFile(const SparseFile &other) = delete;
+	SparseFile &operator=(const SparseFile &other) = delete;
+
+	int size() const {
+		return _size;
+	}
+
+	// Thread: Main.
+	void feed(int offset, bytes::vector &&bytes);
+	void cancel();
+	rpl::producer<> fed() const;
+	rpl::producer<int> wantedOffsets() const;
+
+	// Thread: Any.
+	bool startable() const;
+	bool complete() const;
+	bool cancelled() const;
+	int readyFrom(int offset) const;
+
+	// Thread: Any except Main.
+	// Blocks until the bytes at the offset arrive, returns the count
+	// of the bytes read, zero at the end of file or -1 if cancelled.
+	int read(int offset, bytes::span buffer);
+
+private:
+	enum class Index {
+		Searching,
+		Found,
+		None,
+	};
+
+	int readyFromLocked(int offset) const;
+	bool copyLocked(int offset, bytes::span buffer) const;
+	void findIndexLocked();
+	int prefetchWantedLocked() const;
+	int endOffset() const;
+
+	const int _size = 0;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _arrived;
+	std::map<int, bytes::vector> _parts;
+	bool _cancelled = false;
+
+	Index _index = Index::Searching;
+	int _boxOffset = 0; // The index box offset if it was found.
+	int _indexSize = 0;
+	int _prefetchWanted = -1;
+
+	rpl::event_stream<> _fed;
+	rpl::concurrent_event_stream<int> _wanted;
+
+};
+
+} // namespace Streaming
+} // namespace Media
@@ -0,0 +1,135 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "media/media_streaming_file.h"
+#include <algorithm>
+#include <random>
+#include <thread>
+
+using Media::Streaming::SparseFile;
+
+namespace {
+
+constexpr auto kPartSize = 128 * 1024;
+
+bytes::vector RandomFile(int size) {
+	auto generator = std::mt19937(size);
+	auto result = bytes::vector(size);
+	for (auto &byte : result) {
+		byte = bytes::type(generator() & 0xFF);
+	}
+	return result;
+}
+
+void WriteBox(bytes::vector &file, int offset, int size, const char *type) {
+	for (auto i = 0; i != 4; ++i) {
+		file[offset + i] = bytes::type((size >> (24 - 8 * i)) & 0xFF);
+		file[offset + 4 + i] = bytes::type(type[i]);
+	}
+}
+
+void FeedPart(SparseFile &stream, const bytes::vector &file, int offset) {
+	const auto till = std::min(offset + kPartSize, int(file.size()));
+	stream.feed(offset, bytes::vector(
+		file.begin() + offset,
+		file.begin() + till));
+}
+
+} // namespace
+
+TEST_CASE("sparse file tests", "[Media::Streaming::SparseFile]") {
+	SECTION("ready bytes are counted through the parts") {
+		const auto file = RandomFile(5 * kPartSize + 100);
+		auto stream = SparseFile(int(file.size()));
+		FeedPart(stream, file, 0);
+		FeedPart(stream, file, 2 * kPartSize);
+		REQUIRE(stream.readyFrom(0) == kPartSize);
+		REQUIRE(stream.readyFrom(100) == kPartSize - 100);
+		REQUIRE(stream.readyFrom(kPartSize) == 0);
+		FeedPart(stream, file, kPartSize);
+		REQUIRE(stream.readyFrom(100) == 3 * kPartSize - 100);
+		REQUIRE(!stream.complete());
+	}
+	SECTION("start waits for the head and the end of the file") {
+		const auto file = RandomFile(10 * kPartSize + 5000);
+		auto stream = SparseFile(int(file.size()));
+		for (auto offset = 0; offset != 4 * kPartSize; offset += kPartSize) {
+			FeedPart(stream, file, offset);
+		}
+		REQUIRE(!stream.startable());
+		FeedPart(stream, file, 10 * kPartSize);
+		REQUIRE(stream.startable());
+	}
+	SECTION("start waits for the mp4 index after the media data") {
+		auto file = RandomFile(24 + 2000000 + 300000);
+		WriteBox(file, 0, 24, "ftyp");
+		WriteBox(file, 24, 2000000, "mdat");
+		WriteBox(file, 2000024, 300000, "moov");
+		auto stream = SparseFile(int(file.size()));
+		for (auto offset = 0; offset != 4 * kPartSize; offset += kPartSize) {
+			FeedPart(stream, file, offset);
+		}
+		const auto last = (int(file.size()) - 1) / kPartSize * kPartSize;
+		FeedPart(stream, file, last);
+		REQUIRE(!stream.startable());
+		const auto first = 2000024 / kPartSize * kPartSize;
+		for (auto offset = first; offset != last; offset += kPartSize) {
+			FeedPart(stream, file, offset);
+		}
+		REQUIRE(stream.startable());
+	}
+	SECTION("read waits for the parts fed in any order") {
+		const auto file = RandomFile(20 * kPartSize + 100);
+		const auto size = int(file.size());
+		auto stream = SparseFile(size);
+		auto offsets = std::vector<int>();
+		for (auto offset = 0; offset < size; offset += kPartSize) {
+			offsets.push_back(offset);
+		}
+		std::shuffle(begin(offsets), end(offsets), std::mt19937(size));
+
+		auto read = bytes::vector(size);
+		auto failed = false;
+		auto reader = std::thread([&] {
+			auto position = 0;
+			while (position < size) {
+				const auto buffer = bytes::make_span(read).subspan(
+					position,
+					std::min(7777, size - position));
+				const auto count = stream.read(position, buffer);
+				if (count <= 0) {
+					failed = true;
+					return;
+				}
+				position += count;
+			}
+		});
+		for (const auto offset : offsets) {
+			FeedPart(stream, file, offset);
+		}
+		reader.join();
+		REQUIRE(!failed);
+		REQUIRE(read == file);
+		REQUIRE(stream.complete());
+		REQUIRE(stream.read(size, bytes::make_span(read)) == 0);
+	}
+	SECTION("cancel wakes up the reader") {
+		auto stream = SparseFile(kPartSize);
+		auto buffer = bytes::vector(16);
+		auto result = 0;
+		auto reader = std::thread([&] {
+			result = stream.read(100, bytes::make_span(buffer));
+		});
+		stream.cancel();
+		reader.join();
+		REQUIRE(result == -1);
+		REQUIRE(stream.cancelled());
+		REQUIRE(!stream.startable());
+	}
+}
@@ -872,7 +872,7 @@ void MediaView::onSaveAs() {
 				_photo->date),
 			crl::guard(this, [this, photo = _photo](const QString &result) {
 				if (!result.isEmpty() && _photo == photo && photo->loaded()) {
-					photo->full->pix(fileOrigin()).toImage().save(result, "JPG");
+					photo->full->original().save(result, "JPG");
 				}
 				psShowOverAll(this);
 			}), crl::guard(this, [this] {
@@ -994,7 +994,7 @@ void MediaView::onDownload() {
 		} else {
 			if (!QDir().exists(path)) QDir().mkpath(path);
 			toName = filedialogDefaultName(qsl("photo"), qsl(".jpg"), path);
-			if (!_photo->full->pix(fileOrigin()).toImage().save(toName, "JPG")) {
+			if (!_photo->full->original().save(toName, "JPG")) {
 				toName = QString();
 			}
 		}
@@ -1073,7 +1073,7 @@ void MediaView::onCopy() {
 	} else {
 		if (!_photo || !_photo->loaded()) return;
 
-		QApplication::clipboard()->setPixmap(_photo->full->pix(fileOrigin()));
+		QApplication::clipboard()->setImage(_photo->full->original());
 	}
 }
 
@@ -1981,7 +1981,12 @@ void MediaView::paintEvent(QPaintEvent *e) {
 			int32 h = int((_photo->full->height() * (qreal(w) / qreal(_photo->full->width()))) + 0.9999);
 			_current = _photo->full->pixNoCache(fileOrigin(), w, h, Images::Option::Smooth);
 			if (cRetina()) _current.setDevicePixelRatio(cRetinaFactor());
-			_full = 1;
+
+			// A forgotten image gives a placeholder until it is decoded,
+			// it is prepared again when the decoded image repaints us.
+			if (_photo->full->decoded()) {
+				_full = 1;
+			}
 		} else if (_full < 0 && _photo->medium->loaded()) {
 			int32 h = int((_photo->full->height() * (qreal(w) / qreal(_photo->full->width()))) + 0.9999);
 			_current = _photo->medium->pixNoCache(fileOrigin(), w, h, Images::Option::Smooth | Images::Option::Blurred);
@@ -1011,6 +1011,10 @@ Messenger::~Messenger() {
 	_window.reset();
 	_mediaView.reset();
 
+	if (_authSession) {
+		_authSession->saveSharedMediaCountsNow();
+	}
+
 	// Some MTP requests can be cancelled from data clearing.
 	App::clearHistories();
 	authSessionDestroy();
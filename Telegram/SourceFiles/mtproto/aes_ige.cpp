@@ -0,0 +1,79 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/aes_ige.h"
+
+#include "base/assertion.h"
+
+extern "C" {
+#include <openssl/evp.h>
+} // extern "C"
+
+#include <cstring>
+
+namespace MTP {
+
+AesIge::AesIge(const void *key, const void *iv, bool encrypt)
+: _context(EVP_CIPHER_CTX_new())
+, _encrypt(encrypt) {
+	Expects(_context != nullptr);
+
+	// OpenSSL keeps the IGE iv as the cipher text block and then
+	// the plain text block, for both encryption and decryption.
+	memcpy(_cipherIv, iv, kBlockSize);
+	memcpy(_plainIv, static_cast<const uchar*>(iv) + kBlockSize, kBlockSize);
+
+	EVP_CipherInit_ex(
+		_context,
+		EVP_aes_256_ecb(),
+		nullptr,
+		static_cast<const uchar*>(key),
+		nullptr,
+		encrypt ? 1 : 0);
+	EVP_CIPHER_CTX_set_padding(_context, 0);
+}
+
+AesIge::~AesIge() {
+	EVP_CIPHER_CTX_free(_context);
+}
+
+void AesIge::process(const void *src, void *dst, uint32 len) {
+	Expects(len % kBlockSize == 0);
+
+	auto from = static_cast<const uchar*>(src);
+	auto to = static_cast<uchar*>(dst);
+	uint64 input[2], block[2];
+	for (const auto till = from + len; from != till; from += kBlockSize, to += kBlockSize) {
+		memcpy(input, from, kBlockSize);
+		if (_encrypt) {
+			block[0] = input[0] ^ _cipherIv[0];
+			block[1] = input[1] ^ _cipherIv[1];
+		} else {
+			block[0] = input[0] ^ _plainIv[0];
+			block[1] = input[1] ^ _plainIv[1];
+		}
+		EVP_Cipher(
+			_context,
+			reinterpret_cast<uchar*>(block),
+			reinterpret_cast<const uchar*>(block),
+			kBlockSize);
+		if (_encrypt) {
+			block[0] ^= _plainIv[0];
+			block[1] ^= _plainIv[1];
+			memcpy(_cipherIv, block, kBlockSize);
+			memcpy(_plainIv, input, kBlockSize);
+		} else {
+			block[0] ^= _cipherIv[0];
+			block[1] ^= _cipherIv[1];
+			memcpy(_cipherIv, input, kBlockSize);
+			memcpy(_plainIv, block, kBlockSize);
+		}
+		memcpy(to, block, kBlockSize);
+	}
+}
+
+} // namespace MTP
@@ -0,0 +1,39 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+struct evp_cipher_ctx_st;
+
+namespace MTP {
+
+// AES-256-IGE over the OpenSSL EVP block cipher, which uses AES-NI
+// when the processor has it. The chaining state is kept between calls,
+// so the data may be processed chunk by chunk.
+class AesIge {
+public:
+	static constexpr auto kBlockSize = 16;
+
+	AesIge(const void *key, const void *iv, bool encrypt);
+	AesIge(const AesIge &other) = delete;
+	AesIge &operator=(const AesIge &other) = delete;
+	~AesIge();
+
+	// len must be a multiple of kBlockSize, src may be equal to dst.
+	void process(const void *src, void *dst, uint32 len);
+
+private:
+	evp_cipher_ctx_st *_context = nullptr;
+	bool _encrypt = false;
+	uint64 _cipherIv[2] = { 0 }; // The previous cipher text block.
+	uint64 _plainIv[2] = { 0 }; // The previous plain text block.
+
+};
+
+} // namespace MTP
@@ -0,0 +1,88 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "mtproto/aes_ige.h"
+
+extern "C" {
+#include <openssl/aes.h>
+} // extern "C"
+
+#include <random>
+
+using MTP::AesIge;
+
+namespace {
+
+constexpr auto kSize = 100 * AesIge::kBlockSize;
+
+std::vector<uchar> RandomBytes(int size, int seed) {
+	auto generator = std::mt19937(seed);
+	auto result = std::vector<uchar>(size);
+	for (auto &byte : result) {
+		byte = uchar(generator() & 0xFF);
+	}
+	return result;
+}
+
+std::vector<uchar> LowLevel(
+		const std::vector<uchar> &data,
+		const std::vector<uchar> &key,
+		std::vector<uchar> iv,
+		bool encrypt) {
+	auto aes = AES_KEY();
+	if (encrypt) {
+		AES_set_encrypt_key(key.data(), 256, &aes);
+	} else {
+		AES_set_decrypt_key(key.data(), 256, &aes);
+	}
+	auto result = std::vector<uchar>(data.size());
+	AES_ige_encrypt(
+		data.data(),
+		result.data(),
+		data.size(),
+		&aes,
+		iv.data(),
+		encrypt ? AES_ENCRYPT : AES_DECRYPT);
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("aes ige tests", "[MTP::AesIge]") {
+	const auto data = RandomBytes(kSize, 1);
+	const auto key = RandomBytes(32, 2);
+	const auto iv = RandomBytes(32, 3);
+
+	SECTION("encryption matches AES_ige_encrypt") {
+		auto result = std::vector<uchar>(kSize);
+		AesIge(key.data(), iv.data(), true).process(
+			data.data(),
+			result.data(),
+			kSize);
+		REQUIRE(result == LowLevel(data, key, iv, true));
+	}
+	SECTION("decryption matches AES_ige_encrypt") {
+		auto result = std::vector<uchar>(kSize);
+		AesIge(key.data(), iv.data(), false).process(
+			data.data(),
+			result.data(),
+			kSize);
+		REQUIRE(result == LowLevel(data, key, iv, false));
+	}
+	SECTION("chunks in place give the same result") {
+		auto result = data;
+		auto aes = AesIge(key.data(), iv.data(), false);
+		for (auto offset = 0; offset != kSize;) {
+			const auto chunk = std::min(7 * AesIge::kBlockSize, kSize - offset);
+			aes.process(result.data() + offset, result.data() + offset, chunk);
+			offset += chunk;
+		}
+		REQUIRE(result == LowLevel(data, key, iv, false));
+	}
+}
@@ -10,9 +10,16 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 extern "C" {
 #include <openssl/aes.h>
 #include <openssl/modes.h>
+#include <openssl/sha.h>
 } // extern "C"
 
 namespace MTP {
+namespace {
+
+// Small enough for the decrypted chunk to be hashed from the L1 cache.
+constexpr auto kHashChunkSize = 16 * 1024U;
+
+} // namespace
 
 void AuthKey::prepareAES_oldmtp(const MTPint128 &msgKey, MTPint256 &aesKey, MTPint256 &aesIV, bool send) const {
 	uint32 x = send ? 0 : 8;
@@ -73,23 +80,39 @@ void AuthKey::prepareAES(const MTPint128 &msgKey, MTPint256 &aesKey, MTPint256 &
 }
 
 void aesIgeEncryptRaw(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
-	uchar aes_key[32], aes_iv[32];
-	memcpy(aes_key, key, 32);
-	memcpy(aes_iv, iv, 32);
-
-	AES_KEY aes;
-	AES_set_encrypt_key(aes_key, 256, &aes);
-	AES_ige_encrypt(static_cast<const uchar*>(src), static_cast<uchar*>(dst), len, &aes, aes_iv, AES_ENCRYPT);
+	AesIge(key, iv, true).process(src, dst, len);
 }
 
 void aesIgeDecryptRaw(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
-	uchar aes_key[32], aes_iv[32];
-	memcpy(aes_key, key, 32);
-	memcpy(aes_iv, iv, 32);
+	AesIge(key, iv, false).process(src, dst, len);
+}
 
-	AES_KEY aes;
-	AES_set_decrypt_key(aes_key, 256, &aes);
-	AES_ige_encrypt(static_cast<const uchar*>(src), static_cast<uchar*>(dst), len, &aes, aes_iv, AES_DECRYPT);
+bool aesIgeDecryptChecked(const void *src, void *dst, uint32 len, const AuthKeyPtr &authKey, const MTPint128 &msgKey) {
+	MTPint256 aesKey, aesIV;
+	authKey->prepareAES(msgKey, aesKey, aesIV, false);
+
+	auto aes = AesIge(&aesKey, &aesIV, false);
+
+	SHA256_CTX sha256;
+	SHA256_Init(&sha256);
+	SHA256_Update(&sha256, authKey->partForMsgKey(false), 32);
+
+	auto from = static_cast<const uchar*>(src);
+	auto to = static_cast<uchar*>(dst);
+	for (auto left = len; left != 0;) {
+		const auto chunk = std::min(left, kHashChunkSize);
+		aes.process(from, to, chunk);
+		SHA256_Update(&sha256, to, chunk);
+		from += chunk;
+		to += chunk;
+		left -= chunk;
+	}
+
+	uchar sha256Buffer[32];
+	SHA256_Final(sha256Buffer, &sha256);
+
+	constexpr auto kMsgKeyShift = 8U;
+	return !memcmp(&msgKey, sha256Buffer + kMsgKeyShift, sizeof(msgKey));
 }
 
 void aesCtrEncrypt(bytes::span data, const void *key, CTRState *state) {
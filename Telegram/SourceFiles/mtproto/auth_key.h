@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <array>
 #include <memory>
 #include "base/bytes.h"
+#include "mtproto/aes_ige.h"
 
 namespace MTP {
 
@@ -97,6 +98,11 @@ using AuthKeysList = std::vector<AuthKeyPtr>;
 void aesIgeEncryptRaw(const void *src, void *dst, uint32 len, const void *key, const void *iv);
 void aesIgeDecryptRaw(const void *src, void *dst, uint32 len, const void *key, const void *iv);
 
+// Decrypts a packet and counts its msg_key chunk by chunk, so that
+// the decrypted data is hashed while it is still in the cache.
+// Returns false if the msg_key of the decrypted data is different.
+bool aesIgeDecryptChecked(const void *src, void *dst, uint32 len, const AuthKeyPtr &authKey, const MTPint128 &msgKey);
+
 inline void aesIgeEncrypt_oldmtp(const void *src, void *dst, uint32 len, const AuthKeyPtr &authKey, const MTPint128 &msgKey) {
 	MTPint256 aesKey, aesIV;
 	authKey->prepareAES_oldmtp(msgKey, aesKey, aesIV, true);
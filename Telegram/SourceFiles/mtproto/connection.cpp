@@ -12,9 +12,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/rpc_sender.h"
 #include "mtproto/dc_options.h"
 #include "mtproto/connection_abstract.h"
+#include "mtproto/received_buffers.h"
 #include "zlib.h"
 #include "messenger.h"
 #include "core/launcher.h"
+#include "core/stats.h"
 #include "lang/lang_keys.h"
 #include "base/openssl_help.h"
 #include "base/qthelp_url.h"
@@ -41,6 +43,18 @@ constexpr auto kMaxConnectedTimeout = TimeMs(8000);
 constexpr auto kMinReceiveTimeout = TimeMs(4000);
 constexpr auto kMaxReceiveTimeout = TimeMs(64000);
 constexpr auto kMarkConnectionOldTimeout = TimeMs(192000);
+constexpr auto kLockKeyRetryTimeout = TimeMs(100);
+
+// All the connections share a few network threads. Each of them waits
+// for all of its sockets at once in its Qt event loop, more threads would
+// only add wakeups. The price is that parsing and decrypting the answers
+// of all the connections on a thread is serialized, a large download on
+// one of them delays the others. Compare "busy ms" of a thread in the
+// "network" stats with the wall time to see how loaded it is.
+constexpr auto kNetworkThreadsCount = 2;
+
+// Thread: Main.
+std::vector<std::unique_ptr<Thread>> NetworkThreads;
 constexpr auto kPingDelayDisconnect = 60;
 constexpr auto kPingSendAfter = TimeMs(30000);
 constexpr auto kPingSendAfterForce = TimeMs(45000);
@@ -78,6 +92,25 @@ bool IsGoodModExpFirst(
 	return true;
 }
 
+// The prime the server usually sends, it is checked only once.
+constexpr unsigned char kGoodPrime[] = {
+	0xC7, 0x1C, 0xAE, 0xB9, 0xC6, 0xB1, 0xC9, 0x04, 0x8E, 0x6C, 0x52, 0x2F, 0x70, 0xF1, 0x3F, 0x73,
+	0x98, 0x0D, 0x40, 0x23, 0x8E, 0x3E, 0x21, 0xC1, 0x49, 0x34, 0xD0, 0x37, 0x56, 0x3D, 0x93, 0x0F,
+	0x48, 0x19, 0x8A, 0x0A, 0xA7, 0xC1, 0x40, 0x58, 0x22, 0x94, 0x93, 0xD2, 0x25, 0x30, 0xF4, 0xDB,
+	0xFA, 0x33, 0x6F, 0x6E, 0x0A, 0xC9, 0x25, 0x13, 0x95, 0x43, 0xAE, 0xD4, 0x4C, 0xCE, 0x7C, 0x37,
+	0x20, 0xFD, 0x51, 0xF6, 0x94, 0x58, 0x70, 0x5A, 0xC6, 0x8C, 0xD4, 0xFE, 0x6B, 0x6B, 0x13, 0xAB,
+	0xDC, 0x97, 0x46, 0x51, 0x29, 0x69, 0x32, 0x84, 0x54, 0xF1, 0x8F, 0xAF, 0x8C, 0x59, 0x5F, 0x64,
+	0x24, 0x77, 0xFE, 0x96, 0xBB, 0x2A, 0x94, 0x1D, 0x5B, 0xCD, 0x1D, 0x4A, 0xC8, 0xCC, 0x49, 0x88,
+	0x07, 0x08, 0xFA, 0x9B, 0x37, 0x8E, 0x3C, 0x4F, 0x3A, 0x90, 0x60, 0xBE, 0xE6, 0x7C, 0xF9, 0xA4,
+	0xA4, 0xA6, 0x95, 0x81, 0x10, 0x51, 0x90, 0x7E, 0x16, 0x27, 0x53, 0xB5, 0x6B, 0x0F, 0x6B, 0x41,
+	0x0D, 0xBA, 0x74, 0xD8, 0xA8, 0x4B, 0x2A, 0x14, 0xB3, 0x14, 0x4E, 0x0E, 0xF1, 0x28, 0x47, 0x54,
+	0xFD, 0x17, 0xED, 0x95, 0x0D, 0x59, 0x65, 0xB4, 0xB9, 0xDD, 0x46, 0x58, 0x2D, 0xB1, 0x17, 0x8D,
+	0x16, 0x9C, 0x6B, 0xC4, 0x65, 0xB0, 0xD6, 0xFF, 0x9C, 0xA3, 0x92, 0x8F, 0xEF, 0x5B, 0x9A, 0xE4,
+	0xE4, 0x18, 0xFC, 0x15, 0xE8, 0x3E, 0xBE, 0xA0, 0xF8, 0x7F, 0xA9, 0xFF, 0x5E, 0xED, 0x70, 0x05,
+	0x0D, 0xED, 0x28, 0x49, 0xF4, 0x7B, 0xF9, 0x59, 0xD9, 0x56, 0x85, 0x0C, 0xE9, 0x29, 0x85, 0x1F,
+	0x0D, 0x81, 0x15, 0xF6, 0x35, 0xB1, 0x05, 0xEE, 0x2E, 0x4E, 0x15, 0xD0, 0x4B, 0x24, 0x54, 0xBF,
+	0x6F, 0x4F, 0xAD, 0xF0, 0x34, 0xB1, 0x04, 0x03, 0x11, 0x9C, 0xD8, 0xE3, 0xB9, 0x2F, 0xCC, 0x5B };
+
 bool IsPrimeAndGoodCheck(const openssl::BigNum &prime, int g) {
 	constexpr auto kGoodPrimeBitsCount = 2048;
 
@@ -146,26 +179,13 @@ bool IsPrimeAndGoodCheck(const openssl::BigNum &prime, int g) {
 	return true;
 }
 
+bytes::const_span GoodPrime() {
+	return bytes::make_span(kGoodPrime);
+}
+
 bool IsPrimeAndGood(bytes::const_span primeBytes, int g) {
-	static constexpr unsigned char GoodPrime[] = {
-		0xC7, 0x1C, 0xAE, 0xB9, 0xC6, 0xB1, 0xC9, 0x04, 0x8E, 0x6C, 0x52, 0x2F, 0x70, 0xF1, 0x3F, 0x73,
-		0x98, 0x0D, 0x40, 0x23, 0x8E, 0x3E, 0x21, 0xC1, 0x49, 0x34, 0xD0, 0x37, 0x56, 0x3D, 0x93, 0x0F,
-		0x48, 0x19, 0x8A, 0x0A, 0xA7, 0xC1, 0x40, 0x58, 0x22, 0x94, 0x93, 0xD2, 0x25, 0x30, 0xF4, 0xDB,
-		0xFA, 0x33, 0x6F, 0x6E, 0x0A, 0xC9, 0x25, 0x13, 0x95, 0x43, 0xAE, 0xD4, 0x4C, 0xCE, 0x7C, 0x37,
-		0x20, 0xFD, 0x51, 0xF6, 0x94, 0x58, 0x70, 0x5A, 0xC6, 0x8C, 0xD4, 0xFE, 0x6B, 0x6B, 0x13, 0xAB,
-		0xDC, 0x97, 0x46, 0x51, 0x29, 0x69, 0x32, 0x84, 0x54, 0xF1, 0x8F, 0xAF, 0x8C, 0x59, 0x5F, 0x64,
-		0x24, 0x77, 0xFE, 0x96, 0xBB, 0x2A, 0x94, 0x1D, 0x5B, 0xCD, 0x1D, 0x4A, 0xC8, 0xCC, 0x49, 0x88,
-		0x07, 0x08, 0xFA, 0x9B, 0x37, 0x8E, 0x3C, 0x4F, 0x3A, 0x90, 0x60, 0xBE, 0xE6, 0x7C, 0xF9, 0xA4,
-		0xA4, 0xA6, 0x95, 0x81, 0x10, 0x51, 0x90, 0x7E, 0x16, 0x27, 0x53, 0xB5, 0x6B, 0x0F, 0x6B, 0x41,
-		0x0D, 0xBA, 0x74, 0xD8, 0xA8, 0x4B, 0x2A, 0x14, 0xB3, 0x14, 0x4E, 0x0E, 0xF1, 0x28, 0x47, 0x54,
-		0xFD, 0x17, 0xED, 0x95, 0x0D, 0x59, 0x65, 0xB4, 0xB9, 0xDD, 0x46, 0x58, 0x2D, 0xB1, 0x17, 0x8D,
-		0x16, 0x9C, 0x6B, 0xC4, 0x65, 0xB0, 0xD6, 0xFF, 0x9C, 0xA3, 0x92, 0x8F, 0xEF, 0x5B, 0x9A, 0xE4,
-		0xE4, 0x18, 0xFC, 0x15, 0xE8, 0x3E, 0xBE, 0xA0, 0xF8, 0x7F, 0xA9, 0xFF, 0x5E, 0xED, 0x70, 0x05,
-		0x0D, 0xED, 0x28, 0x49, 0xF4, 0x7B, 0xF9, 0x59, 0xD9, 0x56, 0x85, 0x0C, 0xE9, 0x29, 0x85, 0x1F,
-		0x0D, 0x81, 0x15, 0xF6, 0x35, 0xB1, 0x05, 0xEE, 0x2E, 0x4E, 0x15, 0xD0, 0x4B, 0x24, 0x54, 0xBF,
-		0x6F, 0x4F, 0xAD, 0xF0, 0x34, 0xB1, 0x04, 0x03, 0x11, 0x9C, 0xD8, 0xE3, 0xB9, 0x2F, 0xCC, 0x5B };
-
-	if (!bytes::compare(bytes::make_span(GoodPrime), primeBytes)) {
+
+	if (!bytes::compare(GoodPrime(), primeBytes)) {
 		if (g == 3 || g == 4 || g == 5 || g == 7) {
 			return true;
 		}
@@ -280,41 +300,118 @@ bool parsePQ(const QByteArray &pqStr, QByteArray &pStr, QByteArray &qStr) {
 	return true;
 }
 
+not_null<Thread*> AcquireThread() {
+	if (NetworkThreads.size() < kNetworkThreadsCount) {
+		NetworkThreads.push_back(std::make_unique<Thread>());
+		NetworkThreads.back()->start();
+	}
+	const auto i = ranges::min_element(
+		NetworkThreads,
+		std::less<>(),
+		[](const std::unique_ptr<Thread> &thread) {
+			return thread->connectionsCount();
+		});
+	const auto result = i->get();
+	result->connectionAdded();
+	return result;
+}
+
+void ReleaseThread(not_null<Thread*> thread) {
+	thread->connectionRemoved();
+	if (thread->connectionsCount() > 0) {
+		return;
+	}
+	const auto i = ranges::find(
+		NetworkThreads,
+		thread.get(),
+		[](const std::unique_ptr<Thread> &thread) { return thread.get(); });
+	Assert(i != end(NetworkThreads));
+	thread->quit();
+	thread->wait();
+	NetworkThreads.erase(i);
+}
+
+const auto StatsRegistered = Core::Stats::Register("network", [] {
+	auto result = std::vector<Core::Stats::Row>();
+	result.reserve(NetworkThreads.size());
+	for (const auto &thread : NetworkThreads) {
+		result.push_back({ qsl("thread %1").arg(thread->getThreadIndex()), {
+			{ "connections", thread->connectionsCount() },
+			{ "wakeups", thread->wakeups() },
+			{ "busy ms", thread->busyMs() },
+		} });
+	}
+	const auto buffers = CollectReceivedBuffersStats();
+	result.push_back({ qsl("received buffers"), {
+		{ "taken", buffers.taken },
+		{ "allocated", buffers.allocated },
+		{ "released", buffers.released },
+		{ "dropped", buffers.dropped },
+		{ "pooled", buffers.pooled },
+		{ "pooled bytes", buffers.pooledBytes },
+	} });
+	return result;
+});
+
 } // namespace
 
+void Thread::run() {
+	connect(
+		eventDispatcher(),
+		&QAbstractEventDispatcher::awake,
+		[=] {
+			++_wakeups;
+			_awakeAt = getms(true);
+		});
+	connect(
+		eventDispatcher(),
+		&QAbstractEventDispatcher::aboutToBlock,
+		[=] {
+			if (_awakeAt) {
+				_busyMs += getms(true) - base::take(_awakeAt);
+			}
+		});
+	exec();
+}
+
 Connection::Connection(not_null<Instance*> instance) : _instance(instance) {
 }
 
 void Connection::start(SessionData *sessionData, ShiftedDcId shiftedDcId) {
 	Expects(_thread == nullptr && _private == nullptr);
 
-	_thread = std::make_unique<Thread>();
+	_thread = AcquireThread();
 	auto newData = std::make_unique<ConnectionPrivate>(
 		_instance,
-		_thread.get(),
+		_thread,
 		this,
 		sessionData,
 		shiftedDcId);
 
-	// will be deleted in the thread::finished signal
+	// will be deleted in ConnectionPrivate::finishAndDestroy()
 	_private = newData.release();
-	_thread->start();
 }
 
 void Connection::kill() {
 	Expects(_private != nullptr && _thread != nullptr);
 
 	_private->stop();
+	InvokeQueued(_private, [connection = _private] {
+		connection->finishAndDestroy();
+	});
 	_private = nullptr;
-	_thread->quit();
 }
 
 void Connection::waitTillFinish() {
 	Expects(_private == nullptr && _thread != nullptr);
 
 	DEBUG_LOG(("Waiting for connectionThread to finish"));
-	_thread->wait();
-	_thread.reset();
+	_privateDestroyed.acquire();
+	ReleaseThread(base::take(_thread));
+}
+
+void Connection::privateDestroyed() {
+	_privateDestroyed.release();
 }
 
 int32 Connection::state() const {
@@ -420,13 +517,13 @@ ConnectionPrivate::ConnectionPrivate(
 , _waitForReceived(kMinReceiveTimeout)
 , _waitForConnected(kMinConnectedTimeout)
 , _pingSender(thread, [=] { sendPingByTimer(); })
-, sessionData(data) {
+, sessionData(data)
+, _lockKeyTimer(thread, [=] { updateAuthKey(); }) {
 	Expects(_shiftedDcId != 0);
 
 	moveToThread(thread);
 
-	connect(thread, &QThread::started, this, [=] { connectToServer(); });
-	connect(thread, &QThread::finished, this, [=] { finishAndDestroy(); });
+	InvokeQueued(this, [=] { connectToServer(); });
 	connect(this, SIGNAL(finished(internal::Connection*)), _instance, SLOT(connectionFinished(internal::Connection*)), Qt::QueuedConnection);
 
 	connect(sessionData->owner(), SIGNAL(authKeyCreated()), this, SLOT(updateAuthKey()), Qt::QueuedConnection);
@@ -818,12 +915,18 @@ void ConnectionPrivate::tryToSend() {
 		const auto systemLangCode = _connectionOptions->systemLangCode;
 		const auto cloudLangCode = _connectionOptions->cloudLangCode;
 		const auto langPackName = _connectionOptions->langPackName;
+#ifdef TDESKTOP_BENCHMARKS
+		// There is no Messenger in the benchmarks.
+		const auto deviceModel = qsl("n/a");
+		const auto systemVersion = qsl("n/a");
+#else // TDESKTOP_BENCHMARKS
 		const auto deviceModel = (_dcType == DcType::Cdn)
 			? "n/a"
 			: Messenger::Instance().launcher()->deviceModel();
 		const auto systemVersion = (_dcType == DcType::Cdn)
 			? "n/a"
 			: Messenger::Instance().launcher()->systemVersion();
+#endif // TDESKTOP_BENCHMARKS
 #if defined OS_MAC_STORE || defined OS_WIN_STORE
 		const auto appVersion = str_const_toString(AppVersionStr)
 			+ " store";
@@ -894,6 +997,7 @@ void ConnectionPrivate::tryToSend() {
 					QWriteLocker locker2(sessionData->haveSentMutex());
 					auto &haveSent = sessionData->haveSentMap();
 					haveSent.insert(msgId, toSendRequest);
+					Telemetry::RequestSent(toSendRequest->requestId);
 
 					if (needsLayer && !toSendRequest->needsLayer) needsLayer = false;
 					if (toSendRequest->after) {
@@ -1003,6 +1107,7 @@ void ConnectionPrivate::tryToSend() {
 							added = true;
 						}
 						haveSent.insert(msgId, req);
+						Telemetry::RequestSent(req->requestId);
 
 						needAnyResponse = true;
 					} else {
@@ -1050,10 +1155,12 @@ void ConnectionPrivate::retryByTimer() {
 	}
 	if (keyId == kRecreateKeyId) {
 		if (sessionData->getKey()) {
-			unlockKey();
-
-			QWriteLocker lock(sessionData->keyMutex());
+			if (!lockKey()) {
+				_retryTimer.callOnce(kLockKeyRetryTimeout);
+				return;
+			}
 			sessionData->owner()->destroyKey();
+			unlockKey();
 		}
 		keyId = 0;
 	}
@@ -1405,7 +1512,7 @@ void ConnectionPrivate::handleReceived() {
 		constexpr auto kMinimalEncryptedIntsCount = kEncryptedHeaderIntsCount + 4U; // + 1 data + 3 padding
 		constexpr auto kMinimalIntsCount = kExternalHeaderIntsCount + kMinimalEncryptedIntsCount;
 		auto intsCount = uint32(intsBuffer.size());
-		auto ints = intsBuffer.constData();
+		auto ints = intsBuffer.data();
 		if ((intsCount < kMinimalIntsCount) || (intsCount > kMaxMessageLength / kIntSize)) {
 			LOG(("TCP Error: bad message received, len %1").arg(intsCount * kIntSize));
 			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
@@ -1422,16 +1529,16 @@ void ConnectionPrivate::handleReceived() {
 		auto encryptedInts = ints + kExternalHeaderIntsCount;
 		auto encryptedIntsCount = (intsCount - kExternalHeaderIntsCount) & ~0x03U;
 		auto encryptedBytesCount = encryptedIntsCount * kIntSize;
-		auto decryptedBuffer = QByteArray(encryptedBytesCount, Qt::Uninitialized);
 		auto msgKey = *(MTPint128*)(ints + 2);
 
+		// The packet is decrypted in place, its buffer is not shared.
 #ifdef TDESKTOP_MTPROTO_OLD
-		aesIgeDecrypt_oldmtp(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, key, msgKey);
+		aesIgeDecrypt_oldmtp(encryptedInts, encryptedInts, encryptedBytesCount, key, msgKey);
 #else // TDESKTOP_MTPROTO_OLD
-		aesIgeDecrypt(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, key, msgKey);
+		const auto msgKeyChecked = aesIgeDecryptChecked(encryptedInts, encryptedInts, encryptedBytesCount, key, msgKey);
 #endif // TDESKTOP_MTPROTO_OLD
 
-		auto decryptedInts = reinterpret_cast<const mtpPrime*>(decryptedBuffer.constData());
+		const mtpPrime *decryptedInts = encryptedInts;
 		auto serverSalt = *(uint64*)&decryptedInts[0];
 		auto session = *(uint64*)&decryptedInts[2];
 		auto msgId = *(uint64*)&decryptedInts[4];
@@ -1471,16 +1578,7 @@ void ConnectionPrivate::handleReceived() {
 		constexpr auto kMaxPaddingSize = 1024U;
 		auto badMessageLength = (paddingSize < kMinPaddingSize || paddingSize > kMaxPaddingSize);
 
-		std::array<uchar, 32> sha256Buffer = { { 0 } };
-
-		SHA256_CTX msgKeyLargeContext;
-		SHA256_Init(&msgKeyLargeContext);
-		SHA256_Update(&msgKeyLargeContext, key->partForMsgKey(false), 32);
-		SHA256_Update(&msgKeyLargeContext, decryptedInts, encryptedBytesCount);
-		SHA256_Final(sha256Buffer.data(), &msgKeyLargeContext);
-
-		constexpr auto kMsgKeyShift = 8U;
-		if (memcmp(&msgKey, sha256Buffer.data() + kMsgKeyShift, sizeof(msgKey)) != 0) {
+		if (!msgKeyChecked) {
 			LOG(("TCP Error: bad SHA256 hash after aesDecrypt in message"));
 			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
 
@@ -1559,6 +1657,9 @@ void ConnectionPrivate::handleReceived() {
 			sessionData->receivedIdsSet().shrink();
 		}
 
+		// Everything needed was copied from the packet by now.
+		ReleaseReceivedBuffer(std::move(intsBuffer));
+
 		// send acks
 		uint32 toAckSize = ackRequestData.size();
 		if (toAckSize) {
@@ -1754,6 +1855,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 
 				DEBUG_LOG(("Message Info: unixtime updated, now %1, resending in container...").arg(serverTime));
 
+				countResend(resendId, Telemetry::Resend::BadMsg);
 				resend(resendId, 0, true);
 			} else { // must create new session, because msg_id and msg_seqno are inconsistent
 				if (badTime) {
@@ -1815,6 +1917,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 		badTime = false;
 
 		DEBUG_LOG(("Message Info: unixtime updated, now %1, server_salt updated, now %2, resending...").arg(serverTime).arg(serverSalt));
+		countResend(resendId, Telemetry::Resend::BadSalt);
 		resend(resendId);
 	} return HandleResult::Success;
 
@@ -2013,6 +2116,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 		QVector<quint64> toResend(ids.size());
 		for (int32 i = 0, l = ids.size(); i < l; ++i) {
 			toResend[i] = ids.at(i).v;
+			countResend(toResend[i], Telemetry::Resend::Requested);
 		}
 		resendMany(toResend, 0, false, true);
 	} return HandleResult::Success;
@@ -2061,6 +2165,11 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 
 		auto requestId = wasSent(reqMsgId.v);
 		if (requestId && requestId != mtpRequestId(0xFFFFFFFF)) {
+			Telemetry::RequestResponded(
+				requestId,
+				response.size() * sizeof(mtpPrime),
+				(typeId == mtpc_rpc_error));
+
 			// Save rpc_result for processing in the main thread.
 			QWriteLocker locker(sessionData->haveReceivedMutex());
 			sessionData->haveReceivedResponses().insert(requestId, response);
@@ -2098,6 +2207,9 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 				if (i.value()->requestId) toResend.push_back(i.key());
 			}
 		}
+		for (const auto msgId : toResend) {
+			countResend(msgId, Telemetry::Resend::NewSession);
+		}
 		resendMany(toResend, 10, true);
 
 		mtpBuffer update(from - start);
@@ -2382,6 +2494,7 @@ void ConnectionPrivate::handleMsgsStates(const QVector<MTPlong> &ids, const QByt
 		}
 		if ((state & 0x07) != 0x04) { // was received
 			DEBUG_LOG(("Message Info: state was received for msgId %1, state %2, resending in container").arg(requestMsgId).arg((int32)state));
+			countResend(requestMsgId, Telemetry::Resend::StateLost);
 			resend(requestMsgId, 10, true);
 		} else {
 			DEBUG_LOG(("Message Info: state was received for msgId %1, state %2, ack").arg(requestMsgId).arg((int32)state));
@@ -2519,7 +2632,13 @@ void ConnectionPrivate::updateAuthKey() 	{
 	}
 
 	DEBUG_LOG(("AuthKey Info: No key in updateAuthKey(), will be creating auth_key"));
-	lockKey();
+	if (!lockKey()) {
+		DEBUG_LOG(("MTP Info: could not lock auth_key for write, retrying"));
+		clearMessages();
+		keyId = 0;
+		_lockKeyTimer.callOnce(kLockKeyRetryTimeout);
+		return;
+	}
 
 	auto &key = sessionData->getKey();
 	if (key) {
@@ -3212,10 +3331,21 @@ mtpRequestId ConnectionPrivate::wasSent(mtpMsgId msgId) const {
 	return 0;
 }
 
-void ConnectionPrivate::lockKey() {
+void ConnectionPrivate::countResend(
+		mtpMsgId msgId,
+		Telemetry::Resend cause) const {
+	if (Telemetry::Enabled()) {
+		Telemetry::RequestResent(wasSent(msgId), cause);
+	}
+}
+
+bool ConnectionPrivate::lockKey() {
 	unlockKey();
-	sessionData->keyMutex()->lockForWrite();
+	if (!sessionData->keyMutex()->tryLockForWrite()) {
+		return false;
+	}
 	myKeyLock = true;
+	return true;
 }
 
 void ConnectionPrivate::unlockKey() {
@@ -3228,6 +3358,8 @@ void ConnectionPrivate::unlockKey() {
 ConnectionPrivate::~ConnectionPrivate() {
 	clearAuthKeyData();
 	Assert(_finished && _connection == nullptr && _testConnections.empty());
+
+	_owner->privateDestroyed();
 }
 
 void ConnectionPrivate::stop() {
@@ -3244,6 +3376,10 @@ void ConnectionPrivate::stop() {
 
 } // namespace internal
 
+bytes::const_span GoodPrime() {
+	return internal::GoodPrime();
+}
+
 bool IsPrimeAndGood(bytes::const_span primeBytes, int g) {
 	return internal::IsPrimeAndGood(primeBytes, g);
 }
@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/auth_key.h"
 #include "mtproto/dc_options.h"
 #include "mtproto/connection_abstract.h"
+#include "mtproto/request_telemetry.h"
 #include "base/openssl_help.h"
 #include "base/timer.h"
 
@@ -17,6 +18,7 @@ namespace MTP {
 
 class Instance;
 
+bytes::const_span GoodPrime();
 bool IsPrimeAndGood(bytes::const_span primeBytes, int g);
 struct ModExpFirst {
 	static constexpr auto kRandomPowerSize = 256;
@@ -36,6 +38,7 @@ class SessionData;
 class RSAPublicKey;
 struct ConnectionOptions;
 
+// Network thread shared by the connections of all sessions.
 class Thread : public QThread {
 	Q_OBJECT
 
@@ -48,8 +51,34 @@ public:
 		return _threadIndex;
 	}
 
+	// Thread: Main.
+	int connectionsCount() const {
+		return _connectionsCount;
+	}
+	void connectionAdded() {
+		++_connectionsCount;
+	}
+	void connectionRemoved() {
+		--_connectionsCount;
+	}
+
+	// Thread: Any.
+	int64 wakeups() const {
+		return _wakeups;
+	}
+	int64 busyMs() const {
+		return _busyMs;
+	}
+
+protected:
+	void run() override;
+
 private:
 	int _threadIndex = 0;
+	int _connectionsCount = 0;
+	std::atomic<int64> _wakeups = 0;
+	std::atomic<int64> _busyMs = 0;
+	TimeMs _awakeAt = 0; // Thread: This.
 
 };
 
@@ -73,10 +102,14 @@ public:
 	int32 state() const;
 	QString transport() const;
 
+	// Thread: Network, when the ConnectionPrivate is destroyed.
+	void privateDestroyed();
+
 private:
 	not_null<Instance*> _instance;
-	std::unique_ptr<QThread> _thread;
+	Thread *_thread = nullptr;
 	ConnectionPrivate *_private = nullptr;
+	QSemaphore _privateDestroyed;
 
 };
 
@@ -93,6 +126,7 @@ public:
 	~ConnectionPrivate();
 
 	void stop();
+	void finishAndDestroy();
 
 	int32 getShiftedDcId() const;
 
@@ -150,7 +184,6 @@ private:
 	void connectToServer(bool afterConfig = false);
 	void doDisconnect();
 	void restart();
-	void finishAndDestroy();
 	void requestCDNConfig();
 	void handleError(int errorCode);
 	void onError(
@@ -184,6 +217,7 @@ private:
 		bool needAnyResponse,
 		QReadLocker &lockFinished);
 	mtpRequestId wasSent(mtpMsgId msgId) const;
+	void countResend(mtpMsgId msgId, Telemetry::Resend cause) const;
 
 	enum class HandleResult {
 		Success,
@@ -267,9 +301,13 @@ private:
 	SessionData *sessionData = nullptr;
 	std::unique_ptr<ConnectionOptions> _connectionOptions;
 
+	// The network threads are shared by the connections of all the dcs,
+	// so the key is never waited for: if another connection holds it
+	// lockKey() fails and the caller tries again from the event loop.
 	bool myKeyLock = false;
-	void lockKey();
+	bool lockKey();
 	void unlockKey();
+	base::Timer _lockKeyTimer;
 
 	// Auth key creation fields and methods
 	struct AuthKeyCreateData {
@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "mtproto/connection_tcp.h"
 
+#include "mtproto/received_buffers.h"
 #include "base/bytes.h"
 #include "base/openssl_help.h"
 #include "base/qthelp_url.h"
@@ -24,6 +25,9 @@ constexpr auto kFullConnectionTimeout = 8 * TimeMs(1000);
 constexpr auto kSmallBufferSize = 256 * 1024;
 constexpr auto kMinPacketBuffer = 256;
 
+// The large buffer is kept for the next file parts up to this size.
+constexpr auto kKeepLargeBufferSize = 1024 * 1024 + kMinPacketBuffer;
+
 using ErrorSignal = void(QTcpSocket::*)(QAbstractSocket::SocketError);
 const auto QTcpSocket_error = ErrorSignal(&QAbstractSocket::error);
 
@@ -278,14 +282,17 @@ void TcpConnection::ensureAvailableInBuffer(int amount) {
 	if (amount <= _smallBuffer.size()) {
 		if (_usingLargeBuffer) {
 			bytes::copy(_smallBuffer, read);
-			_usingLargeBuffer = false;
-			_largeBuffer.clear();
+			releaseLargeBuffer();
 		} else {
 			bytes::move(_smallBuffer, read);
 		}
 	} else if (amount <= _largeBuffer.size()) {
-		Assert(_usingLargeBuffer);
-		bytes::move(_largeBuffer, read);
+		if (_usingLargeBuffer) {
+			bytes::move(_largeBuffer, read);
+		} else {
+			bytes::copy(_largeBuffer, read);
+			_usingLargeBuffer = true;
+		}
 	} else {
 		auto enough = bytes::vector(amount);
 		bytes::copy(enough, read);
@@ -295,6 +302,13 @@ void TcpConnection::ensureAvailableInBuffer(int amount) {
 	_offsetBytes = 0;
 }
 
+void TcpConnection::releaseLargeBuffer() {
+	_usingLargeBuffer = false;
+	if (_largeBuffer.size() > kKeepLargeBufferSize) {
+		_largeBuffer = bytes::vector();
+	}
+}
+
 void TcpConnection::socketRead() {
 	Expects(_leftBytes > 0 || !_usingLargeBuffer);
 
@@ -334,8 +348,7 @@ void TcpConnection::socketRead() {
 				_leftBytes -= readCount;
 				if (!_leftBytes) {
 					socketPacket(full.subspan(0, _readBytes));
-					_usingLargeBuffer = false;
-					_largeBuffer.clear();
+					releaseLargeBuffer();
 					_offsetBytes = _readBytes = 0;
 				} else {
 					TCP_LOG(("TCP Info: not enough %1 for packet! read %2"
@@ -412,7 +425,7 @@ mtpBuffer TcpConnection::parsePacket(bytes::const_span bytes) {
 		}
 		return mtpBuffer(1, ints[0]);
 	}
-	auto result = mtpBuffer(ints.size());
+	auto result = TakeReceivedBuffer(ints.size());
 	memcpy(result.data(), ints.data(), ints.size() * sizeof(mtpPrime));
 	return result;
 }
@@ -621,7 +634,7 @@ void TcpConnection::socketPacket(bytes::const_span bytes) {
 	if (_status == Status::Finished) return;
 
 	// old quickack?..
-	const auto data = parsePacket(bytes);
+	auto data = parsePacket(bytes);
 	if (data.size() == 1) {
 		if (data[0] != 0) {
 			emit error(data[0]);
@@ -631,7 +644,7 @@ void TcpConnection::socketPacket(bytes::const_span bytes) {
 	//} else if (data.size() == 2) {
 		// new quickack?..
 	} else if (_status == Status::Ready) {
-		_receivedQueue.push_back(data);
+		_receivedQueue.push_back(std::move(data));
 		emit receivedData();
 	} else if (_status == Status::Waiting) {
 		try {
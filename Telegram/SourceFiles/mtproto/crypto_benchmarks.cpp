@@ -0,0 +1,104 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/benchmark.h"
+
+#include "mtproto/auth_key.h"
+
+#include <iostream>
+
+extern "C" {
+#include <openssl/aes.h>
+#include <openssl/sha.h>
+} // extern "C"
+
+namespace {
+
+using namespace MTP;
+
+constexpr auto kBytesPerStep = 16 * 1024 * 1024;
+constexpr int kPartSizes[] = { 128 * 1024, 512 * 1024 };
+
+MTPint128 CountMsgKey(const AuthKeyPtr &key, const void *data, int size, bool send) {
+	uchar sha256Buffer[32];
+	SHA256_CTX context;
+	SHA256_Init(&context);
+	SHA256_Update(&context, key->partForMsgKey(send), 32);
+	SHA256_Update(&context, data, size);
+	SHA256_Final(sha256Buffer, &context);
+	return *reinterpret_cast<const MTPint128*>(sha256Buffer + 8);
+}
+
+// The path used before the packets were decrypted through AesIge.
+void DecryptAndHashLowLevel(const void *src, void *dst, int size, const AuthKeyPtr &key, const MTPint128 &msgKey) {
+	MTPint256 aesKey, aesIV;
+	key->prepareAES(msgKey, aesKey, aesIV, false);
+
+	AES_KEY aes;
+	AES_set_decrypt_key(reinterpret_cast<const uchar*>(&aesKey), 256, &aes);
+	AES_ige_encrypt(static_cast<const uchar*>(src), static_cast<uchar*>(dst), size, &aes, reinterpret_cast<uchar*>(&aesIV), AES_DECRYPT);
+	CountMsgKey(key, dst, size, false);
+}
+
+void RunForSize(
+		base::benchmark::Runner &runner,
+		const AuthKeyPtr &key,
+		int size) {
+	auto plain = QByteArray(size, Qt::Uninitialized);
+	auto encrypted = QByteArray(size, Qt::Uninitialized);
+	auto decrypted = QByteArray(size, Qt::Uninitialized);
+	memset_rand(plain.data(), size);
+
+	// A packet as it is received, so that the msg_key check passes.
+	const auto received = CountMsgKey(key, plain.constData(), size, false);
+	MTPint256 aesKey, aesIV;
+	key->prepareAES(received, aesKey, aesIV, false);
+	aesIgeEncryptRaw(plain.constData(), encrypted.data(), size, &aesKey, &aesIV);
+	if (!aesIgeDecryptChecked(encrypted.constData(), decrypted.data(), size, key, received)
+		|| decrypted != plain) {
+		std::cout << "Bad decrypted data for " << (size / 1024)
+			<< " KB parts." << std::endl;
+		return;
+	}
+
+	const auto count = kBytesPerStep / size;
+	const auto name = [&](const char *what) {
+		return std::string(what) + ' ' + std::to_string(size / 1024) + " KB";
+	};
+	runner.step(name("encrypt"), [&] {
+		for (auto i = 0; i != count; ++i) {
+			const auto msgKey = CountMsgKey(key, plain.constData(), size, true);
+			aesIgeEncrypt(plain.constData(), encrypted.data(), size, key, msgKey);
+		}
+	});
+	runner.counter("bytes", kBytesPerStep);
+	runner.step(name("decrypt"), [&] {
+		for (auto i = 0; i != count; ++i) {
+			aesIgeDecryptChecked(encrypted.constData(), decrypted.data(), size, key, received);
+		}
+	});
+	runner.counter("bytes", kBytesPerStep);
+	runner.step(name("decrypt with AES_ige_encrypt"), [&] {
+		for (auto i = 0; i != count; ++i) {
+			DecryptAndHashLowLevel(encrypted.constData(), decrypted.data(), size, key, received);
+		}
+	});
+	runner.counter("bytes", kBytesPerStep);
+}
+
+} // namespace
+
+// Packet encryption and decryption with the msg_key hash for the file
+// part sizes, compared to the AES_ige_encrypt() path.
+TDESKTOP_BENCHMARK(mtproto_crypto) {
+	auto data = AuthKey::Data();
+	memset_rand(data.data(), data.size());
+	const auto key = std::make_shared<AuthKey>(data);
+	for (const auto size : kPartSizes) {
+		RunForSize(runner, key, size);
+	}
+}
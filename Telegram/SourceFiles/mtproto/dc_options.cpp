@@ -236,6 +236,16 @@ void DcOptions::constructAddOne(
 	applyOneGuarded(BareDcId(id), flags, ip, port, secret);
 }
 
+void DcOptions::constructAddPublicKey(bytes::const_span key) {
+	auto parsed = internal::RSAPublicKey(key);
+	if (!parsed.isValid()) {
+		LOG(("MTP Error: could not read the added public RSA key."));
+		return;
+	}
+	WriteLocker lock(this);
+	_publicKeys.emplace(parsed.getFingerPrint(), std::move(parsed));
+}
+
 bool DcOptions::applyOneGuarded(
 		DcId dcId,
 		Flags flags,
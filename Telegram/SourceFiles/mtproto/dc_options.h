@@ -57,6 +57,7 @@ public:
 		const std::string &ip,
 		int port,
 		const bytes::vector &secret);
+	void constructAddPublicKey(bytes::const_span key);
 	QByteArray serialize() const;
 
 	using Ids = std::vector<DcId>;
@@ -0,0 +1,313 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/benchmark.h"
+
+#include "mtproto/loopback_server.h"
+#include "mtproto/mtp_instance.h"
+#include "mtproto/dc_options.h"
+#include "mtproto/facade.h"
+#include "core/main_queue_processor.h"
+#include "base/timer.h"
+
+#include <QtCore/QEventLoop>
+
+namespace {
+
+using namespace MTP;
+
+constexpr auto kDcId = 2;
+constexpr auto kPartSize = 128 * 1024;
+constexpr auto kDownloadParts = 64;
+constexpr auto kUploadParts = 64;
+constexpr auto kDifferenceRequests = 100;
+constexpr auto kPushedUpdates = 100;
+constexpr auto kTimeout = 120 * TimeMs(1000);
+
+Core::MainQueueProcessor *Processor = nullptr; // Lives till the exit.
+
+// There is no Messenger here, only the parts that MTP::Instance uses.
+void PrepareEnvironment() {
+	if (Processor) {
+		return;
+	}
+	if (!Global::started()) {
+		Global::start();
+	}
+	Processor = new Core::MainQueueProcessor();
+}
+
+// A separate MTP::Instance working with a scripted LoopbackServer,
+// each method sends the requests and waits for all the answers.
+class Loopback {
+public:
+	explicit Loopback(const LoopbackServer::Conditions &conditions);
+
+	bool started() const {
+		return _started;
+	}
+
+	void connect();
+	void download();
+	void upload();
+	void difference();
+	void reconnect();
+
+	int takeFailures() {
+		return base::take(_failures);
+	}
+	int updates() const {
+		return _updates;
+	}
+	LoopbackServer::Stats stats() const {
+		return _server.stats();
+	}
+
+private:
+	void scriptServer();
+	void sendNearestDc();
+	void wait(int requests);
+	void requestDone(int step);
+	RPCDoneHandlerPtr doneHandler();
+	RPCFailHandlerPtr failHandler();
+
+	LoopbackServer _server;
+	DcOptions _dcOptions;
+	std::unique_ptr<Instance> _instance;
+	QEventLoop *_loop = nullptr;
+	int _step = 0;
+	int _waiting = 0;
+	int _failures = 0;
+	int _updates = 0;
+	bool _started = false;
+
+};
+
+Loopback::Loopback(const LoopbackServer::Conditions &conditions) {
+	if (!_server.start()) {
+		return;
+	}
+	scriptServer();
+	_server.setConditions(conditions);
+
+	_dcOptions.constructAddOne(
+		kDcId,
+		DcOptions::Flag::f_tcpo_only,
+		"127.0.0.1",
+		_server.port(),
+		{});
+	_dcOptions.constructAddPublicKey(_server.publicKey());
+	_started = true;
+}
+
+void Loopback::scriptServer() {
+	// Handlers run on the server thread, they capture only the answers.
+	const auto nearest = LoopbackServer::Serialize(MTPNearestDc(
+		MTP_nearestDc(MTP_string("XX"), MTP_int(kDcId), MTP_int(kDcId))));
+	_server.setHandler(mtpc_help_getNearestDc, [=](
+			const mtpPrime *from,
+			const mtpPrime *end) {
+		return nearest;
+	});
+
+	auto part = QByteArray(kPartSize, Qt::Uninitialized);
+	memset_rand(part.data(), part.size());
+	const auto file = LoopbackServer::Serialize(MTPupload_File(
+		MTP_upload_file(
+			MTP_storage_filePartial(),
+			MTP_int(0),
+			MTP_bytes(part))));
+	_server.setHandler(mtpc_upload_getFile, [=](
+			const mtpPrime *from,
+			const mtpPrime *end) {
+		return file;
+	});
+
+	const auto saved = LoopbackServer::Serialize(MTPBool(MTP_bool(true)));
+	_server.setHandler(mtpc_upload_saveFilePart, [=](
+			const mtpPrime *from,
+			const mtpPrime *end) {
+		return saved;
+	});
+
+	_server.setHandler(mtpc_updates_getDifference, [](
+			const mtpPrime *from,
+			const mtpPrime *end) {
+		return LoopbackServer::Serialize(MTPupdates_Difference(
+			MTP_updates_differenceEmpty(MTP_int(unixtime()), MTP_int(0))));
+	});
+}
+
+void Loopback::wait(int requests) {
+	QEventLoop loop;
+	base::Timer timeout([&] {
+		_failures += _waiting;
+		loop.quit();
+	});
+	_waiting = requests;
+	_loop = &loop;
+	timeout.callOnce(kTimeout);
+	loop.exec();
+	_loop = nullptr;
+
+	// Answers to the requests that timed out are ignored.
+	++_step;
+}
+
+void Loopback::requestDone(int step) {
+	if (step == _step && !--_waiting && _loop) {
+		_loop->quit();
+	}
+}
+
+RPCDoneHandlerPtr Loopback::doneHandler() {
+	return rpcDone([=, step = _step](const mtpPrime *from, const mtpPrime *end) {
+		requestDone(step);
+	});
+}
+
+RPCFailHandlerPtr Loopback::failHandler() {
+	return rpcFail([=, step = _step](const RPCError &error) {
+		if (step == _step) {
+			++_failures;
+		}
+		requestDone(step);
+		return true;
+	});
+}
+
+void Loopback::sendNearestDc() {
+	_instance->send(MTPhelp_GetNearestDc(), doneHandler(), failHandler());
+}
+
+void Loopback::connect() {
+	// A new instance has no keys, so the first request waits for
+	// the connection and the key exchange.
+	_instance = nullptr;
+
+	auto config = Instance::Config();
+	config.mainDcId = kDcId;
+	_instance = std::make_unique<Instance>(
+		&_dcOptions,
+		Instance::Mode::Normal,
+		std::move(config));
+	_instance->setUpdatesHandler(rpcDone([=](
+			const mtpPrime *from,
+			const mtpPrime *end) {
+		++_updates;
+	}));
+	sendNearestDc();
+	wait(1);
+}
+
+void Loopback::download() {
+	const auto location = MTP_inputFileLocation(
+		MTP_long(0),
+		MTP_int(0),
+		MTP_long(0),
+		MTP_bytes(QByteArray()));
+	for (auto i = 0; i != kDownloadParts; ++i) {
+		_instance->send(
+			MTPupload_GetFile(
+				location,
+				MTP_int(i * kPartSize),
+				MTP_int(kPartSize)),
+			doneHandler(),
+			failHandler(),
+			downloadDcId(kDcId, i % kDownloadSessionsCount));
+	}
+	wait(kDownloadParts);
+}
+
+void Loopback::upload() {
+	auto part = QByteArray(kPartSize, Qt::Uninitialized);
+	memset_rand(part.data(), part.size());
+	const auto fileId = rand_value<uint64>();
+	for (auto i = 0; i != kUploadParts; ++i) {
+		_instance->send(
+			MTPupload_SaveFilePart(
+				MTP_long(fileId),
+				MTP_int(i),
+				MTP_bytes(part)),
+			doneHandler(),
+			failHandler(),
+			uploadDcId(i % kUploadSessionsCount));
+	}
+	wait(kUploadParts);
+}
+
+void Loopback::difference() {
+	// Updates are pushed by the server while the difference is requested.
+	_updates = 0;
+	for (auto i = 0; i != kDifferenceRequests; ++i) {
+		_instance->send(
+			MTPupdates_GetDifference(
+				MTP_flags(0),
+				MTP_int(1),
+				MTPint(),
+				MTP_int(unixtime()),
+				MTP_int(0)),
+			doneHandler(),
+			failHandler());
+	}
+	const auto updates = LoopbackServer::Serialize(
+		MTPUpdates(MTP_updatesTooLong()));
+	for (auto i = 0; i != kPushedUpdates; ++i) {
+		_server.sendUpdates(mtpBuffer(updates));
+	}
+	wait(kDifferenceRequests);
+}
+
+void Loopback::reconnect() {
+	_server.dropConnections();
+	sendNearestDc();
+	wait(1);
+}
+
+void RunLoopback(
+		base::benchmark::Runner &runner,
+		const LoopbackServer::Conditions &conditions) {
+	PrepareEnvironment();
+
+	auto loopback = Loopback(conditions);
+	if (!loopback.started()) {
+		return;
+	}
+	runner.step("connect", [&] { loopback.connect(); });
+	runner.counter("failures", loopback.takeFailures());
+	runner.step("download", [&] { loopback.download(); });
+	runner.counter("failures", loopback.takeFailures());
+	runner.counter("bytes", int64(kDownloadParts) * kPartSize);
+	runner.step("upload", [&] { loopback.upload(); });
+	runner.counter("failures", loopback.takeFailures());
+	runner.counter("bytes", int64(kUploadParts) * kPartSize);
+	runner.step("getDifference with updates", [&] { loopback.difference(); });
+	runner.counter("failures", loopback.takeFailures());
+	runner.counter("updates", loopback.updates());
+	runner.step("reconnect", [&] { loopback.reconnect(); });
+	runner.counter("failures", loopback.takeFailures());
+
+	const auto stats = loopback.stats();
+	runner.counter("server connections", stats.connections);
+	runner.counter("server auth keys", stats.authKeys);
+	runner.counter("server packets lost", stats.packetsLost);
+}
+
+} // namespace
+
+TDESKTOP_BENCHMARK(mtproto_loopback_ideal) {
+	RunLoopback(runner, LoopbackServer::Conditions());
+}
+
+TDESKTOP_BENCHMARK(mtproto_loopback_slow) {
+	auto conditions = LoopbackServer::Conditions();
+	conditions.latency = 100;
+	conditions.lossPercent = 2;
+	conditions.bandwidth = 1024 * 1024;
+	conditions.seed = 1;
+	RunLoopback(runner, conditions);
+}
@@ -0,0 +1,1099 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/loopback_server.h"
+
+#include "mtproto/connection.h"
+#include "mtproto/auth_key.h"
+#include "mtproto/rsa_public_key.h"
+#include "base/openssl_help.h"
+#include "base/timer.h"
+
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <random>
+#include <deque>
+
+extern "C" {
+#include <openssl/rsa.h>
+#include <openssl/pem.h>
+#include <openssl/bio.h>
+} // extern "C"
+
+namespace MTP {
+namespace {
+
+constexpr auto kRsaKeyBits = 2048;
+constexpr auto kRsaDataSize = 256;
+constexpr auto kSha1Ints = 5;
+
+// The client factors pq itself, close primes make it instant.
+constexpr auto kPrimeP = uint64(1000000007);
+constexpr auto kPrimeQ = uint64(1000000009);
+constexpr auto kGenerator = 3;
+
+constexpr auto kHeaderSize = 64;
+constexpr auto kAbridged = uint32(0xEFEFEFEFU);
+constexpr auto kIntermediate = uint32(0xEEEEEEEEU);
+constexpr auto kPaddedIntermediate = uint32(0xDDDDDDDDU);
+constexpr auto kPacketSizeMax = 16 * 1024 * 1024;
+
+constexpr auto kExternalHeaderInts = 6; // 2 auth_key_id, 4 msg_key
+constexpr auto kEncryptedHeaderInts = 8; // 2 salt, 2 session, 2 msg_id, 1 seq_no, 1 length
+constexpr auto kUnknownKeyError = -404;
+constexpr auto kNotScriptedError = 400;
+
+// Temporary AES key and iv of the key exchange, as the client makes them.
+struct ExchangeKey {
+	MTPint256 key;
+	MTPint256 iv;
+};
+
+struct Delayed {
+	TimeMs at = 0;
+	bytes::vector data;
+};
+
+bytes::vector BigEndian(uint64 value) {
+	auto result = bytes::vector();
+	for (; value != 0; value >>= 8) {
+		result.insert(result.begin(), bytes::type(value & 0xFF));
+	}
+	return result;
+}
+
+ExchangeKey PrepareExchangeKey(
+		const MTPint256 &newNonce,
+		const MTPint128 &serverNonce) {
+	const auto nonce = bytes::object_as_span(&newNonce);
+	const auto server = bytes::object_as_span(&serverNonce);
+	const auto ns = openssl::Sha1(nonce, server);
+	const auto sn = openssl::Sha1(server, nonce);
+	const auto nn = openssl::Sha1(nonce, nonce);
+
+	auto result = ExchangeKey();
+	const auto key = bytes::object_as_span(&result.key);
+	const auto iv = bytes::object_as_span(&result.iv);
+	bytes::copy(key, ns);
+	bytes::copy(key.subspan(20), bytes::make_span(sn).subspan(0, 12));
+	bytes::copy(iv, bytes::make_span(sn).subspan(12));
+	bytes::copy(iv.subspan(8), nn);
+	bytes::copy(iv.subspan(28), nonce.subspan(0, 4));
+	return result;
+}
+
+// SHA1 of the data, the data and the random padding to a 16 bytes block.
+mtpBuffer PrepareHashedAnswer(const mtpBuffer &data) {
+	auto result = mtpBuffer(kSha1Ints);
+	hashSha1(
+		data.constData(),
+		data.size() * sizeof(mtpPrime),
+		result.data());
+	result.append(data);
+	while (result.size() & 0x03) {
+		result.push_back(rand_value<mtpPrime>());
+	}
+	return result;
+}
+
+template <typename Type>
+bool ReadHashed(const mtpBuffer &decrypted, Type &result) {
+	if (decrypted.size() <= kSha1Ints) {
+		return false;
+	}
+	const auto start = decrypted.constData() + kSha1Ints;
+	auto from = start;
+	result.read(from, decrypted.constData() + decrypted.size());
+
+	const auto hash = openssl::Sha1(bytes::make_span(
+		start,
+		from - start));
+	return !bytes::compare(
+		hash,
+		bytes::make_span(decrypted).subspan(0, openssl::kSha1Size));
+}
+
+// Skips the invokeWith* and initConnection wrappers of the query.
+const mtpPrime *UnwrapQuery(const mtpPrime *from, const mtpPrime *end) {
+	while (from < end) {
+		switch (mtpTypeId(*from)) {
+		case mtpc_invokeWithLayer: from += 2; break;
+		case mtpc_invokeWithoutUpdates: from += 1; break;
+		case mtpc_invokeAfterMsg: from += 3; break;
+		case mtpc_invokeAfterMsgs: {
+			auto ids = MTPVector<MTPlong>();
+			ids.read(++from, end);
+		} break;
+		case mtpc_initConnection: {
+			auto flags = MTPint();
+			auto apiId = MTPint();
+			flags.read(++from, end);
+			apiId.read(from, end);
+			for (auto i = 0; i != 6; ++i) {
+				auto value = MTPstring();
+				value.read(from, end);
+			}
+			if (flags.v & 0x01) { // proxy:flags.0?InputClientProxy
+				auto proxy = MTPInputClientProxy();
+				proxy.read(from, end);
+			}
+		} break;
+		default: return from;
+		}
+	}
+	throw mtpErrorInsufficient();
+}
+
+RSA *GenerateKey() {
+	const auto exponent = BN_new();
+	BN_set_word(exponent, RSA_F4);
+	auto result = RSA_new();
+	if (!RSA_generate_key_ex(result, kRsaKeyBits, exponent, nullptr)) {
+		RSA_free(result);
+		result = nullptr;
+	}
+	BN_free(exponent);
+	return result;
+}
+
+bytes::vector ExportPublicKey(RSA *key) {
+	const auto bio = BIO_new(BIO_s_mem());
+	PEM_write_bio_RSAPublicKey(bio, key);
+	auto data = (char*)nullptr;
+	const auto size = BIO_get_mem_data(bio, &data);
+	auto result = bytes::make_vector(bytes::make_span(data, size));
+	BIO_free(bio);
+	return result;
+}
+
+} // namespace
+
+class LoopbackServer::Listener : public QObject {
+public:
+	struct Session {
+		uint64 id = 0;
+		uint64 salt = 0;
+		AuthKeyPtr key;
+		Client *client = nullptr;
+		int contentMessages = 0;
+	};
+
+	Listener();
+	~Listener();
+
+	// Thread: Any.
+	bytes::const_span publicKey() const;
+	Stats stats() const;
+
+	// Thread: Server.
+	int listen();
+	void setConditions(const Conditions &conditions);
+	void setHandler(mtpTypeId type, Handler &&handler);
+	void sendUpdates(const mtpBuffer &updates);
+	void dropConnections();
+
+	const Conditions &conditions() const;
+	uint64 fingerprint() const;
+	bytes::vector decrypt(bytes::const_span data) const;
+	AuthKeyPtr findKey(AuthKey::KeyId keyId) const;
+	void addKey(AuthKeyPtr &&key);
+	Session &session(uint64 id, const AuthKeyPtr &key);
+	mtpBuffer handle(const mtpPrime *from, const mtpPrime *end);
+	uint64 nextMsgId(bool response);
+	bool loseNext();
+	void remove(not_null<Client*> client);
+
+	void countReceived(int bytes);
+	void countSent(int bytes);
+
+private:
+	void accept();
+
+	QTcpServer _server;
+	RSA *_key = nullptr;
+	bytes::vector _publicKey;
+	uint64 _fingerprint = 0;
+
+	Conditions _conditions;
+	std::mt19937 _random;
+	std::map<mtpTypeId, Handler> _handlers;
+	std::map<AuthKey::KeyId, AuthKeyPtr> _keys;
+	std::map<uint64, Session> _sessions;
+	std::vector<std::unique_ptr<Client>> _clients;
+	uint64 _lastMsgId = 0;
+
+	std::atomic<int> _connections = 0;
+	std::atomic<int> _authKeys = 0;
+	std::atomic<int64> _queries = 0;
+	std::atomic<int64> _bytesReceived = 0;
+	std::atomic<int64> _bytesSent = 0;
+	std::atomic<int64> _packetsLost = 0;
+
+};
+
+class LoopbackServer::Client {
+public:
+	Client(not_null<Listener*> listener, not_null<QTcpSocket*> socket);
+	~Client();
+
+	void sendSecure(
+		Listener::Session &session,
+		mtpBuffer &&body,
+		bool response);
+	void close();
+
+private:
+	using Session = Listener::Session;
+
+	void read();
+	bool startConnection();
+	void readPackets();
+	void handlePacket(const mtpBuffer &packet);
+	void handlePlain(const mtpBuffer &packet);
+	void handleSecure(const mtpBuffer &packet);
+	void handleMessage(
+		Session &session,
+		uint64 msgId,
+		const mtpPrime *from,
+		const mtpPrime *end);
+	void handleQuery(
+		Session &session,
+		uint64 msgId,
+		const mtpPrime *from,
+		const mtpPrime *end);
+
+	void answerPQ(const mtpPrime *from, const mtpPrime *end);
+	void answerDHParams(const mtpPrime *from, const mtpPrime *end);
+	void answerClientDHParams(const mtpPrime *from, const mtpPrime *end);
+
+	void sendPlain(mtpBuffer &&body);
+	void send(mtpBuffer &&packet, bool encrypted);
+	void sendQueued();
+
+	const not_null<Listener*> _listener;
+	const std::unique_ptr<QTcpSocket> _socket;
+	bool _closed = false;
+
+	uint32 _protocol = 0;
+	bytes::vector _incoming;
+	bytes::array<CTRState::KeySize> _receiveKey;
+	bytes::array<CTRState::KeySize> _sendKey;
+	CTRState _receiveState;
+	CTRState _sendState;
+
+	MTPint128 _nonce;
+	MTPint128 _serverNonce;
+	MTPint256 _newNonce;
+	bytes::vector _power;
+
+	std::deque<Delayed> _queue;
+	int64 _busyTill = 0; // In microseconds, for the bandwidth limit.
+	base::Timer _sendTimer;
+
+};
+
+LoopbackServer::Listener::Listener()
+: _server(this)
+, _key(GenerateKey()) {
+	if (_key) {
+		_publicKey = ExportPublicKey(_key);
+		_fingerprint = internal::RSAPublicKey(_publicKey).getFingerPrint();
+	} else {
+		LOG(("Loopback Error: could not generate the RSA key."));
+	}
+	QObject::connect(&_server, &QTcpServer::newConnection, [=] {
+		accept();
+	});
+}
+
+LoopbackServer::Listener::~Listener() {
+	_clients.clear();
+	if (_key) {
+		RSA_free(_key);
+	}
+}
+
+bytes::const_span LoopbackServer::Listener::publicKey() const {
+	return _publicKey;
+}
+
+auto LoopbackServer::Listener::stats() const -> Stats {
+	auto result = Stats();
+	result.connections = _connections;
+	result.authKeys = _authKeys;
+	result.queries = _queries;
+	result.bytesReceived = _bytesReceived;
+	result.bytesSent = _bytesSent;
+	result.packetsLost = _packetsLost;
+	return result;
+}
+
+int LoopbackServer::Listener::listen() {
+	if (!_key || !_server.listen(QHostAddress::LocalHost, 0)) {
+		LOG(("Loopback Error: could not start listening."));
+		return 0;
+	}
+	return _server.serverPort();
+}
+
+void LoopbackServer::Listener::setConditions(const Conditions &conditions) {
+	_conditions = conditions;
+	_random.seed(conditions.seed);
+}
+
+void LoopbackServer::Listener::setHandler(
+		mtpTypeId type,
+		Handler &&handler) {
+	if (handler) {
+		_handlers[type] = std::move(handler);
+	} else {
+		_handlers.erase(type);
+	}
+}
+
+void LoopbackServer::Listener::sendUpdates(const mtpBuffer &updates) {
+	for (auto &[id, session] : _sessions) {
+		if (session.client) {
+			session.client->sendSecure(session, mtpBuffer(updates), false);
+		}
+	}
+}
+
+void LoopbackServer::Listener::dropConnections() {
+	for (const auto &client : _clients) {
+		client->close();
+	}
+}
+
+auto LoopbackServer::Listener::conditions() const -> const Conditions & {
+	return _conditions;
+}
+
+uint64 LoopbackServer::Listener::fingerprint() const {
+	return _fingerprint;
+}
+
+bytes::vector LoopbackServer::Listener::decrypt(
+		bytes::const_span data) const {
+	if (data.size() != kRsaDataSize) {
+		return {};
+	}
+	auto result = bytes::vector(kRsaDataSize);
+	const auto decrypted = RSA_private_decrypt(
+		kRsaDataSize,
+		reinterpret_cast<const unsigned char*>(data.data()),
+		reinterpret_cast<unsigned char*>(result.data()),
+		_key,
+		RSA_NO_PADDING);
+	return (decrypted == kRsaDataSize) ? result : bytes::vector();
+}
+
+AuthKeyPtr LoopbackServer::Listener::findKey(AuthKey::KeyId keyId) const {
+	const auto i = _keys.find(keyId);
+	return (i != end(_keys)) ? i->second : nullptr;
+}
+
+void LoopbackServer::Listener::addKey(AuthKeyPtr &&key) {
+	const auto keyId = key->keyId();
+	_keys.emplace(keyId, std::move(key));
+	++_authKeys;
+}
+
+auto LoopbackServer::Listener::session(uint64 id, const AuthKeyPtr &key)
+-> Session & {
+	auto &result = _sessions[id];
+	if (result.key != key) {
+		result = Session();
+		result.id = id;
+		result.key = key;
+	}
+	return result;
+}
+
+mtpBuffer LoopbackServer::Listener::handle(
+		const mtpPrime *from,
+		const mtpPrime *end) {
+	++_queries;
+	const auto i = _handlers.find(mtpTypeId(*from));
+	return (i != _handlers.end())
+		? i->second(from, end)
+		: Error(kNotScriptedError, "METHOD_NOT_SCRIPTED");
+}
+
+uint64 LoopbackServer::Listener::nextMsgId(bool response) {
+	const auto time = (uint64(unixtime()) << 32);
+	_lastMsgId = std::max(time, _lastMsgId + 4) & ~uint64(0x03);
+	return _lastMsgId | (response ? 0x01 : 0x03);
+}
+
+bool LoopbackServer::Listener::loseNext() {
+	if (_conditions.lossPercent <= 0
+		|| int(_random() % 100) >= _conditions.lossPercent) {
+		return false;
+	}
+	++_packetsLost;
+	return true;
+}
+
+void LoopbackServer::Listener::remove(not_null<Client*> client) {
+	for (auto &[id, session] : _sessions) {
+		if (session.client == client) {
+			session.client = nullptr;
+		}
+	}
+	_clients.erase(ranges::remove(
+		_clients,
+		client.get(),
+		[](const std::unique_ptr<Client> &client) { return client.get(); }
+	), end(_clients));
+}
+
+void LoopbackServer::Listener::countReceived(int bytes) {
+	_bytesReceived += bytes;
+}
+
+void LoopbackServer::Listener::countSent(int bytes) {
+	_bytesSent += bytes;
+}
+
+void LoopbackServer::Listener::accept() {
+	while (const auto socket = _server.nextPendingConnection()) {
+		socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+		_clients.push_back(std::make_unique<Client>(this, socket));
+		++_connections;
+	}
+}
+
+LoopbackServer::Client::Client(
+	not_null<Listener*> listener,
+	not_null<QTcpSocket*> socket)
+: _listener(listener)
+, _socket(socket.get())
+, _sendTimer([=] { sendQueued(); }) {
+	QObject::connect(_socket.get(), &QTcpSocket::readyRead, [=] {
+		read();
+	});
+	QObject::connect(_socket.get(), &QTcpSocket::disconnected, [=] {
+		close();
+	});
+}
+
+LoopbackServer::Client::~Client() {
+	// Socket destructor aborts the connection and emits disconnected().
+	QObject::disconnect(_socket.get(), nullptr, nullptr, nullptr);
+}
+
+void LoopbackServer::Client::close() {
+	if (_closed) {
+		return;
+	}
+	_closed = true;
+	_sendTimer.cancel();
+	_socket->abort();
+
+	// We're inside a socket signal handler, so the removal is queued.
+	const auto listener = _listener;
+	InvokeQueued(listener, [=] {
+		listener->remove(this);
+	});
+}
+
+void LoopbackServer::Client::read() {
+	const auto data = _socket->readAll();
+	if (_closed || data.isEmpty()) {
+		return;
+	}
+	_listener->countReceived(data.size());
+
+	const auto was = int(_incoming.size());
+	_incoming.resize(was + data.size());
+	bytes::copy(
+		bytes::make_span(_incoming).subspan(was),
+		bytes::make_span(data));
+	if (_protocol) {
+		aesCtrEncrypt(
+			bytes::make_span(_incoming).subspan(was),
+			_receiveKey.data(),
+			&_receiveState);
+	} else if (_incoming.size() < kHeaderSize) {
+		return;
+	} else if (!startConnection()) {
+		LOG(("Loopback Error: unsupported transport."));
+		return close();
+	}
+	readPackets();
+}
+
+bool LoopbackServer::Client::startConnection() {
+	// The mirror of TcpConnection::writeConnectionStart() without secrets.
+	const auto header = bytes::make_span(_incoming).subspan(0, kHeaderSize);
+	bytes::copy(_receiveKey, header.subspan(8, CTRState::KeySize));
+	bytes::copy(
+		bytes::make_span(_receiveState.ivec),
+		header.subspan(8 + CTRState::KeySize, CTRState::IvecSize));
+
+	auto reversedBytes = bytes::vector(48);
+	const auto reversed = bytes::make_span(reversedBytes);
+	bytes::copy(reversed, header.subspan(8, reversed.size()));
+	std::reverse(reversed.begin(), reversed.end());
+	bytes::copy(_sendKey, reversed.subspan(0, CTRState::KeySize));
+	bytes::copy(
+		bytes::make_span(_sendState.ivec),
+		reversed.subspan(CTRState::KeySize, CTRState::IvecSize));
+
+	aesCtrEncrypt(
+		bytes::make_span(_incoming),
+		_receiveKey.data(),
+		&_receiveState);
+	_protocol = *reinterpret_cast<const uint32*>(header.data() + 56);
+	_incoming.erase(_incoming.begin(), _incoming.begin() + kHeaderSize);
+	return (_protocol == kAbridged)
+		|| (_protocol == kIntermediate)
+		|| (_protocol == kPaddedIntermediate);
+}
+
+void LoopbackServer::Client::readPackets() {
+	auto offset = 0;
+	while (!_closed) {
+		const auto data = bytes::make_span(_incoming).subspan(offset);
+		auto prefix = 0;
+		auto size = 0;
+		if (_protocol == kAbridged) {
+			if (data.empty()) {
+				break;
+			}
+			const auto first = uchar(data[0]) & 0x7F;
+			if (first == 0x7F) {
+				if (data.size() < 4) {
+					break;
+				}
+				prefix = 4;
+				size = int(uint32(data[1])
+					| (uint32(data[2]) << 8)
+					| (uint32(data[3]) << 16)) * sizeof(mtpPrime);
+			} else {
+				prefix = 1;
+				size = first * sizeof(mtpPrime);
+			}
+		} else {
+			if (data.size() < 4) {
+				break;
+			}
+			prefix = 4;
+			size = int(*reinterpret_cast<const uint32*>(data.data())
+				& 0x7FFFFFFFU);
+		}
+		if (size < int(sizeof(mtpPrime)) || size > kPacketSizeMax) {
+			LOG(("Loopback Error: bad packet size %1.").arg(size));
+			return close();
+		} else if (data.size() < prefix + size) {
+			break;
+		}
+
+		// The padded intermediate protocol adds up to 15 random bytes.
+		auto packet = mtpBuffer(size / sizeof(mtpPrime));
+		bytes::copy(
+			bytes::make_span(packet),
+			data.subspan(prefix, packet.size() * sizeof(mtpPrime)));
+		offset += prefix + size;
+		handlePacket(packet);
+	}
+	if (!_closed && offset > 0) {
+		_incoming.erase(_incoming.begin(), _incoming.begin() + offset);
+	}
+}
+
+void LoopbackServer::Client::handlePacket(const mtpBuffer &packet) {
+	try {
+		if (packet.size() > 1 && !packet[0] && !packet[1]) {
+			handlePlain(packet);
+		} else {
+			handleSecure(packet);
+		}
+	} catch (Exception &) {
+		LOG(("Loopback Error: could not parse a packet."));
+		close();
+	}
+}
+
+void LoopbackServer::Client::handlePlain(const mtpBuffer &packet) {
+	// auth_key_id = 0, msg_id, length, data.
+	if (packet.size() < 6) {
+		return close();
+	}
+	const auto length = uint32(packet[4]);
+	if ((length & 0x03) || length / 4 > uint32(packet.size() - 5)) {
+		return close();
+	}
+	const auto from = packet.constData() + 5;
+	const auto end = from + length / 4;
+	switch (mtpTypeId(*from)) {
+	case mtpc_req_pq:
+	case mtpc_req_pq_multi: return answerPQ(from, end);
+	case mtpc_req_DH_params: return answerDHParams(from, end);
+	case mtpc_set_client_DH_params: return answerClientDHParams(from, end);
+	}
+	LOG(("Loopback Error: unexpected plain message %1."
+		).arg(mtpTypeId(*from)));
+	close();
+}
+
+void LoopbackServer::Client::answerPQ(
+		const mtpPrime *from,
+		const mtpPrime *end) {
+	_nonce.read(++from, end);
+	_serverNonce = rand_value<MTPint128>();
+	sendPlain(Serialize(MTPResPQ(MTP_resPQ(
+		_nonce,
+		_serverNonce,
+		MTP_bytes(BigEndian(kPrimeP * kPrimeQ)),
+		MTP_vector<MTPlong>(1, MTP_long(_listener->fingerprint()))))));
+}
+
+void LoopbackServer::Client::answerDHParams(
+		const mtpPrime *from,
+		const mtpPrime *end) {
+	auto request = MTPReq_DH_params();
+	request.read(from, end);
+	if (request.vnonce != _nonce
+		|| request.vserver_nonce != _serverNonce
+		|| uint64(request.vpublic_key_fingerprint.v)
+			!= _listener->fingerprint()) {
+		return close();
+	}
+	const auto decrypted = _listener->decrypt(
+		bytes::make_span(request.vencrypted_data.v));
+	if (decrypted.empty()) {
+		return close();
+	}
+
+	// Zero byte, SHA1 of the data and the data with the random padding.
+	auto buffer = mtpBuffer(kRsaDataSize / sizeof(mtpPrime));
+	bytes::copy(
+		bytes::make_span(buffer),
+		bytes::make_span(decrypted).subspan(1));
+	auto inner = MTPP_Q_inner_data();
+	if (!ReadHashed(buffer, inner)
+		|| inner.type() != mtpc_p_q_inner_data_dc) {
+		return close();
+	}
+	const auto &data = inner.c_p_q_inner_data_dc();
+	if (data.vnonce != _nonce || data.vserver_nonce != _serverNonce) {
+		return close();
+	}
+	_newNonce = data.vnew_nonce;
+
+	auto seed = bytes::vector(ModExpFirst::kRandomPowerSize);
+	bytes::set_random(seed);
+	auto first = CreateModExp(kGenerator, GoodPrime(), seed);
+	_power = std::move(first.randomPower);
+
+	const auto answer = PrepareHashedAnswer(Serialize(
+		MTPServer_DH_inner_data(MTP_server_DH_inner_data(
+			_nonce,
+			_serverNonce,
+			MTP_int(kGenerator),
+			MTP_bytes(GoodPrime()),
+			MTP_bytes(first.modexp),
+			MTP_int(unixtime())))));
+	const auto key = PrepareExchangeKey(_newNonce, _serverNonce);
+	auto encrypted = bytes::vector(answer.size() * sizeof(mtpPrime));
+	aesIgeEncryptRaw(
+		answer.constData(),
+		encrypted.data(),
+		encrypted.size(),
+		&key.key,
+		&key.iv);
+	sendPlain(Serialize(MTPServer_DH_Params(MTP_server_DH_params_ok(
+		_nonce,
+		_serverNonce,
+		MTP_bytes(encrypted)))));
+}
+
+void LoopbackServer::Client::answerClientDHParams(
+		const mtpPrime *from,
+		const mtpPrime *end) {
+	auto request = MTPSet_client_DH_params();
+	request.read(from, end);
+	const auto &encrypted = request.vencrypted_data.v;
+	if (request.vnonce != _nonce
+		|| request.vserver_nonce != _serverNonce
+		|| _power.empty()
+		|| encrypted.isEmpty()
+		|| (encrypted.size() & 0x0F)) {
+		return close();
+	}
+	const auto key = PrepareExchangeKey(_newNonce, _serverNonce);
+	auto decrypted = mtpBuffer(encrypted.size() / sizeof(mtpPrime));
+	aesIgeDecryptRaw(
+		encrypted.constData(),
+		decrypted.data(),
+		encrypted.size(),
+		&key.key,
+		&key.iv);
+	auto inner = MTPClient_DH_Inner_Data();
+	if (!ReadHashed(decrypted, inner)) {
+		return close();
+	}
+	const auto &data = inner.c_client_DH_inner_data();
+	if (data.vnonce != _nonce || data.vserver_nonce != _serverNonce) {
+		return close();
+	}
+	const auto computed = CreateAuthKey(
+		bytes::make_span(data.vg_b.v),
+		_power,
+		GoodPrime());
+	_power.clear();
+	if (computed.empty()) {
+		return close();
+	}
+	auto authKey = AuthKey::Data();
+	AuthKey::FillData(authKey, computed);
+
+	// new_nonce_hash1 is made of new_nonce, byte 1 and auth_key_aux_hash.
+	const auto one = bytes::type(1);
+	const auto auxHash = openssl::Sha1(bytes::make_span(authKey));
+	const auto hash = openssl::Sha1(
+		bytes::object_as_span(&_newNonce),
+		bytes::object_as_span(&one),
+		bytes::make_span(auxHash).subspan(0, 8));
+	auto hash1 = MTPint128();
+	bytes::copy(
+		bytes::object_as_span(&hash1),
+		bytes::make_span(hash).subspan(4));
+
+	_listener->addKey(std::make_shared<AuthKey>(authKey));
+	sendPlain(Serialize(MTPSet_client_DH_params_answer(MTP_dh_gen_ok(
+		_nonce,
+		_serverNonce,
+		hash1))));
+}
+
+void LoopbackServer::Client::handleSecure(const mtpBuffer &packet) {
+	constexpr auto kMinimalInts = kExternalHeaderInts
+		+ kEncryptedHeaderInts
+		+ 4; // 1 data + 3 padding
+	const auto ints = packet.constData();
+	if (packet.size() < kMinimalInts) {
+		return close();
+	}
+	const auto key = _listener->findKey(*reinterpret_cast<const uint64*>(ints));
+	if (!key) {
+		return send(mtpBuffer(1, kUnknownKeyError), false);
+	}
+	const auto msgKey = *reinterpret_cast<const MTPint128*>(ints + 2);
+	const auto encryptedInts = (packet.size() - kExternalHeaderInts) & ~0x03;
+	auto decrypted = mtpBuffer(encryptedInts);
+	auto aesKey = MTPint256();
+	auto aesIV = MTPint256();
+	key->prepareAES(msgKey, aesKey, aesIV, true);
+	aesIgeDecryptRaw(
+		ints + kExternalHeaderInts,
+		decrypted.data(),
+		encryptedInts * sizeof(mtpPrime),
+		&aesKey,
+		&aesIV);
+
+	const auto check = openssl::Sha256(
+		bytes::make_span(
+			static_cast<const bytes::type*>(key->partForMsgKey(true)),
+			32),
+		bytes::make_span(decrypted));
+	if (bytes::compare(
+			bytes::object_as_span(&msgKey),
+			bytes::make_span(check).subspan(8, 16))) {
+		LOG(("Loopback Error: bad msg_key received."));
+		return close();
+	}
+	const auto data = decrypted.constData();
+	const auto length = uint32(data[7]);
+	if ((length & 0x03)
+		|| length / 4 > uint32(encryptedInts - kEncryptedHeaderInts)) {
+		return close();
+	}
+	auto &session = _listener->session(
+		*reinterpret_cast<const uint64*>(data + 2),
+		key);
+	session.salt = *reinterpret_cast<const uint64*>(data);
+	session.client = this;
+
+	const auto from = data + kEncryptedHeaderInts;
+	handleMessage(
+		session,
+		*reinterpret_cast<const uint64*>(data + 4),
+		from,
+		from + length / 4);
+}
+
+void LoopbackServer::Client::handleMessage(
+		Session &session,
+		uint64 msgId,
+		const mtpPrime *from,
+		const mtpPrime *end) {
+	if (from >= end) {
+		throw mtpErrorInsufficient();
+	}
+	switch (mtpTypeId(*from)) {
+	case mtpc_msg_container: {
+		auto count = MTPint();
+		count.read(++from, end);
+		for (auto i = 0; i != count.v; ++i) {
+			// msg_id, seq_no, length, body.
+			if (from + 4 > end) {
+				throw mtpErrorInsufficient();
+			}
+			const auto innerId = *reinterpret_cast<const uint64*>(from);
+			const auto length = uint32(from[3]);
+			from += 4;
+			if ((length & 0x03) || length / 4 > uint32(end - from)) {
+				throw mtpErrorInsufficient();
+			}
+			handleMessage(session, innerId, from, from + length / 4);
+			from += length / 4;
+		}
+	} return;
+
+	case mtpc_msgs_ack:
+	case mtpc_http_wait: return;
+
+	case mtpc_ping:
+	case mtpc_ping_delay_disconnect: {
+		auto pingId = MTPlong();
+		pingId.read(++from, end);
+		sendSecure(
+			session,
+			Serialize(MTPPong(MTP_pong(MTP_long(msgId), pingId))),
+			true);
+	} return;
+
+	case mtpc_msgs_state_req: {
+		// Report everything as unknown, so that the client resends
+		// the queries which answers were lost by the conditions.
+		auto ids = MTPVector<MTPlong>();
+		ids.read(++from, end);
+		const auto info = std::string(ids.v.size(), char(0x01));
+		sendSecure(
+			session,
+			Serialize(MTPMsgsStateInfo(MTP_msgs_state_info(
+				MTP_long(msgId),
+				MTP_string(info)))),
+			true);
+	} return;
+	}
+	handleQuery(session, msgId, from, end);
+}
+
+void LoopbackServer::Client::handleQuery(
+		Session &session,
+		uint64 msgId,
+		const mtpPrime *from,
+		const mtpPrime *end) {
+	const auto query = UnwrapQuery(from, end);
+	const auto answer = _listener->handle(query, end);
+
+	auto result = mtpBuffer();
+	result.reserve(3 + answer.size());
+	result.push_back(mtpc_rpc_result);
+	result.resize(3);
+	*reinterpret_cast<uint64*>(&result[1]) = msgId;
+	result.append(answer);
+	sendSecure(session, std::move(result), true);
+}
+
+void LoopbackServer::Client::sendSecure(
+		Session &session,
+		mtpBuffer &&body,
+		bool response) {
+	Expects(session.key != nullptr);
+
+	// At least 12 padding bytes, up to a 16 bytes block.
+	const auto bodyInts = int(body.size());
+	const auto dataInts = kEncryptedHeaderInts + bodyInts;
+	const auto paddingInts = 3 + ((4 - ((dataInts + 3) & 0x03)) & 0x03);
+	auto data = mtpBuffer();
+	data.reserve(dataInts + paddingInts);
+	data.resize(kEncryptedHeaderInts);
+	*reinterpret_cast<uint64*>(&data[0]) = session.salt;
+	*reinterpret_cast<uint64*>(&data[2]) = session.id;
+	*reinterpret_cast<uint64*>(&data[4]) = _listener->nextMsgId(response);
+	data[6] = session.contentMessages++ * 2 + 1;
+	data[7] = bodyInts * sizeof(mtpPrime);
+	data.append(body);
+	data.resize(dataInts + paddingInts);
+	memset_rand(&data[dataInts], paddingInts * sizeof(mtpPrime));
+
+	const auto &key = session.key;
+	const auto hash = openssl::Sha256(
+		bytes::make_span(
+			static_cast<const bytes::type*>(key->partForMsgKey(false)),
+			32),
+		bytes::make_span(data));
+	auto msgKey = MTPint128();
+	bytes::copy(
+		bytes::object_as_span(&msgKey),
+		bytes::make_span(hash).subspan(8, 16));
+
+	auto packet = mtpBuffer(kExternalHeaderInts + data.size());
+	*reinterpret_cast<uint64*>(&packet[0]) = key->keyId();
+	*reinterpret_cast<MTPint128*>(&packet[2]) = msgKey;
+	auto aesKey = MTPint256();
+	auto aesIV = MTPint256();
+	key->prepareAES(msgKey, aesKey, aesIV, false);
+	aesIgeEncryptRaw(
+		data.constData(),
+		&packet[kExternalHeaderInts],
+		data.size() * sizeof(mtpPrime),
+		&aesKey,
+		&aesIV);
+	send(std::move(packet), true);
+}
+
+void LoopbackServer::Client::sendPlain(mtpBuffer &&body) {
+	auto packet = mtpBuffer();
+	packet.reserve(5 + body.size());
+	packet.resize(5);
+	packet[0] = packet[1] = 0;
+	*reinterpret_cast<uint64*>(&packet[2]) = _listener->nextMsgId(true);
+	packet[4] = body.size() * sizeof(mtpPrime);
+	packet.append(body);
+	send(std::move(packet), false);
+}
+
+void LoopbackServer::Client::send(mtpBuffer &&packet, bool encrypted) {
+	// Only the encrypted packets are lost, the client does not
+	// retry the key exchange steps, it restarts the connection.
+	if (_closed || (encrypted && _listener->loseNext())) {
+		return;
+	}
+	const auto ints = uint32(packet.size());
+	const auto size = ints * sizeof(mtpPrime);
+	auto data = bytes::vector();
+	data.reserve(4 + size);
+	if (_protocol != kAbridged) {
+		for (auto i = 0; i != 4; ++i) {
+			data.push_back(bytes::type((size >> (8 * i)) & 0xFF));
+		}
+	} else if (ints < 0x7F) {
+		data.push_back(bytes::type(ints));
+	} else {
+		data.push_back(bytes::type(0x7F));
+		for (auto i = 0; i != 3; ++i) {
+			data.push_back(bytes::type((ints >> (8 * i)) & 0xFF));
+		}
+	}
+	const auto prefix = int(data.size());
+	data.resize(prefix + size);
+	bytes::copy(
+		bytes::make_span(data).subspan(prefix),
+		bytes::make_span(packet));
+
+	// The stream is encrypted in the order of sending, queue keeps it.
+	aesCtrEncrypt(bytes::make_span(data), _sendKey.data(), &_sendState);
+
+	const auto &conditions = _listener->conditions();
+	const auto now = getms();
+	auto sentAt = now;
+	if (conditions.bandwidth > 0) {
+		_busyTill = std::max(_busyTill, now * 1000)
+			+ int64(data.size()) * 1000000 / conditions.bandwidth;
+		sentAt = _busyTill / 1000;
+	}
+	const auto at = std::max(
+		sentAt + conditions.latency,
+		_queue.empty() ? TimeMs(0) : _queue.back().at);
+	_queue.push_back({ at, std::move(data) });
+	if (_queue.size() == 1) {
+		sendQueued();
+	}
+}
+
+void LoopbackServer::Client::sendQueued() {
+	const auto now = getms();
+	while (!_queue.empty() && _queue.front().at <= now) {
+		const auto &data = _queue.front().data;
+		_socket->write(
+			reinterpret_cast<const char*>(data.data()),
+			data.size());
+		_listener->countSent(data.size());
+		_queue.pop_front();
+	}
+	if (!_queue.empty()) {
+		_sendTimer.callOnce(_queue.front().at - now);
+	}
+}
+
+LoopbackServer::LoopbackServer() : _listener(new Listener()) {
+	_listener->moveToThread(&_thread);
+	_thread.start();
+}
+
+bool LoopbackServer::start() {
+	Expects(!_port);
+
+	auto ready = QSemaphore();
+	const auto listener = _listener;
+	InvokeQueued(listener, [&] {
+		_port = listener->listen();
+		ready.release();
+	});
+	ready.acquire();
+	return (_port != 0);
+}
+
+int LoopbackServer::port() const {
+	return _port;
+}
+
+bytes::const_span LoopbackServer::publicKey() const {
+	return _listener->publicKey();
+}
+
+void LoopbackServer::setConditions(const Conditions &conditions) {
+	const auto listener = _listener;
+	InvokeQueued(listener, [=] {
+		listener->setConditions(conditions);
+	});
+}
+
+void LoopbackServer::setHandler(mtpTypeId type, Handler handler) {
+	const auto listener = _listener;
+	InvokeQueued(listener, [=]() mutable {
+		listener->setHandler(type, std::move(handler));
+	});
+}
+
+void LoopbackServer::sendUpdates(mtpBuffer &&updates) {
+	const auto listener = _listener;
+	InvokeQueued(listener, [=] {
+		listener->sendUpdates(updates);
+	});
+}
+
+void LoopbackServer::dropConnections() {
+	const auto listener = _listener;
+	InvokeQueued(listener, [=] {
+		listener->dropConnections();
+	});
+}
+
+auto LoopbackServer::stats() const -> Stats {
+	return _listener->stats();
+}
+
+mtpBuffer LoopbackServer::Error(int code, const QString &type) {
+	return Serialize(MTPRpcError(MTP_rpc_error(
+		MTP_int(code),
+		MTP_string(type))));
+}
+
+LoopbackServer::~LoopbackServer() {
+	_listener->deleteLater();
+	_thread.quit();
+	_thread.wait();
+}
+
+} // namespace MTP
@@ -0,0 +1,76 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/bytes.h"
+
+namespace MTP {
+
+// Server side of MTProto listening on 127.0.0.1, for the benchmarks.
+//
+// Creates auth keys with its own RSA key, answers the service messages
+// and passes the queries to the scripted handlers. The network may be
+// made slower with the conditions applied to the packets it sends.
+class LoopbackServer {
+public:
+	struct Conditions {
+		TimeMs latency = 0; // Added to every packet sent.
+		int lossPercent = 0; // Of the encrypted packets sent.
+		int bandwidth = 0; // Bytes per second for each connection.
+		uint32 seed = 0; // Of the losses, so that runs are repeatable.
+	};
+	struct Stats {
+		int connections = 0;
+		int authKeys = 0;
+		int64 queries = 0;
+		int64 bytesReceived = 0;
+		int64 bytesSent = 0;
+		int64 packetsLost = 0;
+	};
+
+	// Thread: Server. Returns the serialized result or rpc_error.
+	using Handler = Fn<mtpBuffer(const mtpPrime *from, const mtpPrime *end)>;
+
+	LoopbackServer();
+	LoopbackServer(const LoopbackServer &other) = delete;
+	LoopbackServer &operator=(const LoopbackServer &other) = delete;
+	~LoopbackServer();
+
+	// Thread: Main.
+	bool start();
+	int port() const;
+	bytes::const_span publicKey() const;
+
+	void setConditions(const Conditions &conditions);
+	void setHandler(mtpTypeId type, Handler handler);
+	void sendUpdates(mtpBuffer &&updates);
+	void dropConnections();
+
+	// Thread: Any.
+	Stats stats() const;
+
+	template <typename Type>
+	static mtpBuffer Serialize(const Type &value) {
+		auto result = mtpBuffer();
+		result.reserve(value.innerLength() >> 2);
+		value.write(result);
+		return result;
+	}
+	static mtpBuffer Error(int code, const QString &type);
+
+private:
+	class Listener;
+	class Client;
+
+	QThread _thread;
+	Listener *_listener = nullptr; // Lives in _thread.
+	int _port = 0;
+
+};
+
+} // namespace MTP
@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/connection.h"
 #include "mtproto/sender.h"
 #include "mtproto/rsa_public_key.h"
+#include "mtproto/request_telemetry.h"
 #include "storage/localstorage.h"
 #include "auth_session.h"
 #include "application.h"
@@ -391,12 +392,16 @@ void Instance::Private::requestConfig() {
 	if (_configLoader || isKeysDestroyer()) {
 		return;
 	}
+
+	// The benchmarks work with MTP::LoopbackServer, it has no config.
+#ifndef TDESKTOP_BENCHMARKS
 	_configLoader = std::make_unique<internal::ConfigLoader>(
 		_instance,
 		_userPhone,
 		rpcDone([=](const MTPConfig &result) { configLoadDone(result); }),
 		rpcFail([=](const RPCError &error) { return configLoadFail(error); }));
 	_configLoader->load();
+#endif // !TDESKTOP_BENCHMARKS
 }
 
 void Instance::Private::setUserPhone(const QString &phone) {
@@ -871,6 +876,13 @@ void Instance::Private::sendRequest(
 	const auto realShiftedDcId = session->getDcWithShift();
 	const auto signedDcId = toMainDc ? -realShiftedDcId : realShiftedDcId;
 	registerRequest(requestId, signedDcId);
+	if (Telemetry::Enabled() && request->size() > SecureRequest::kMessageBodyPosition) {
+		Telemetry::RequestStarted(
+			requestId,
+			(*request)[SecureRequest::kMessageBodyPosition],
+			BareDcId(realShiftedDcId),
+			request.innerLength());
+	}
 
 	if (afterRequestId) {
 		request->after = getRequest(afterRequestId);
@@ -892,6 +904,7 @@ void Instance::Private::unregisterRequest(mtpRequestId requestId) {
 	DEBUG_LOG(("MTP Info: unregistering request %1.").arg(requestId));
 
 	_requestsDelays.erase(requestId);
+	Telemetry::RequestFinished(requestId);
 
 	{
 		QWriteLocker locker(&_requestMapLock);
@@ -1239,6 +1252,7 @@ bool Instance::Private::onErrorDefault(mtpRequestId requestId, const RPCError &e
 		registerRequest(
 			requestId,
 			(dcWithShift < 0) ? -newdcWithShift : newdcWithShift);
+		Telemetry::RequestResent(requestId, Telemetry::Resend::Migrate);
 		session->sendPrepared(request);
 		return true;
 	} else if (code < 0 || code >= 500 || (m = QRegularExpression("^FLOOD_WAIT_(\\d+)$").match(err)).hasMatch()) {
@@ -1252,9 +1266,13 @@ bool Instance::Private::onErrorDefault(mtpRequestId requestId, const RPCError &e
 			} else {
 				_requestsDelays.emplace(requestId, secs);
 			}
+			Telemetry::RequestResent(
+				requestId,
+				Telemetry::Resend::ServerError);
 		} else {
 			secs = m.captured(1).toInt();
 //			if (secs >= 60) return false;
+			Telemetry::RequestFloodWait(requestId, secs);
 		}
 		auto sendAt = getms(true) + secs * 1000 + 10;
 		auto it = _delayedRequests.begin(), e = _delayedRequests.end();
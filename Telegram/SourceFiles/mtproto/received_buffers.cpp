@@ -0,0 +1,96 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/received_buffers.h"
+
+#include <QtCore/QMutex>
+
+namespace MTP {
+namespace internal {
+namespace {
+
+constexpr auto kMaxPooledBuffers = 32;
+constexpr auto kMaxPooledBytes = int64(8 * 1024 * 1024);
+
+// Larger packets are rare enough to be allocated each time.
+constexpr auto kMaxPooledBufferBytes = 1024 * 1024;
+
+struct Pool {
+	QMutex mutex;
+	std::vector<mtpBuffer> buffers;
+	ReceivedBuffersStats stats;
+};
+
+Pool &ReceivedPool() {
+	static Pool result;
+	return result;
+}
+
+int64 CapacityBytes(const mtpBuffer &buffer) {
+	return int64(buffer.capacity()) * sizeof(mtpPrime);
+}
+
+} // namespace
+
+mtpBuffer TakeReceivedBuffer(int ints) {
+	auto &pool = ReceivedPool();
+	auto result = mtpBuffer();
+	{
+		QMutexLocker lock(&pool.mutex);
+		++pool.stats.taken;
+
+		// The most recently released buffer is the most likely cached.
+		const auto i = std::find_if(
+			pool.buffers.rbegin(),
+			pool.buffers.rend(),
+			[&](const mtpBuffer &buffer) { return buffer.capacity() >= ints; });
+		if (i != pool.buffers.rend()) {
+			result = std::move(*i);
+			pool.buffers.erase(std::next(i).base());
+			--pool.stats.pooled;
+			pool.stats.pooledBytes -= CapacityBytes(result);
+		} else {
+			++pool.stats.allocated;
+		}
+	}
+	result.resize(ints);
+	return result;
+}
+
+void ReleaseReceivedBuffer(mtpBuffer &&buffer) {
+	auto &pool = ReceivedPool();
+	const auto bytes = CapacityBytes(buffer);
+
+	QMutexLocker lock(&pool.mutex);
+	++pool.stats.released;
+	if (!buffer.isDetached() || bytes > kMaxPooledBufferBytes) {
+		++pool.stats.dropped;
+		return;
+	}
+	while (!pool.buffers.empty()
+		&& (pool.stats.pooled == kMaxPooledBuffers
+			|| pool.stats.pooledBytes + bytes > kMaxPooledBytes)) {
+		// Forget the oldest buffers first.
+		pool.stats.pooledBytes -= CapacityBytes(pool.buffers.front());
+		--pool.stats.pooled;
+		++pool.stats.dropped;
+		pool.buffers.erase(pool.buffers.begin());
+	}
+	buffer.resize(0);
+	pool.buffers.push_back(std::move(buffer));
+	++pool.stats.pooled;
+	pool.stats.pooledBytes += bytes;
+}
+
+ReceivedBuffersStats CollectReceivedBuffersStats() {
+	auto &pool = ReceivedPool();
+	QMutexLocker lock(&pool.mutex);
+	return pool.stats;
+}
+
+} // namespace internal
+} // namespace MTP
@@ -0,0 +1,34 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/core_types.h"
+
+namespace MTP {
+namespace internal {
+
+struct ReceivedBuffersStats {
+	int64 taken = 0;
+	int64 allocated = 0;
+	int64 released = 0;
+	int64 dropped = 0;
+	int pooled = 0;
+	int64 pooledBytes = 0;
+};
+
+// Thread: Any. Reported in the "network" section of Core::Stats.
+ReceivedBuffersStats CollectReceivedBuffersStats();
+
+// Thread: Any. The received packets are framed into these buffers,
+// decrypted in place and then given back, so that in the steady state
+// no packet allocates. The pool keeps a bounded number of bytes.
+mtpBuffer TakeReceivedBuffer(int ints);
+void ReleaseReceivedBuffer(mtpBuffer &&buffer);
+
+} // namespace internal
+} // namespace MTP
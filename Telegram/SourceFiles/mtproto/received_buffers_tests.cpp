@@ -0,0 +1,132 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "mtproto/received_buffers.h"
+
+using namespace MTP::internal;
+
+namespace {
+
+constexpr auto kMaxPooledBuffers = 32;
+constexpr auto kMaxPooledBytes = int64(8 * 1024 * 1024);
+constexpr auto kLargeInts = 200 * 1024;
+constexpr auto kTooLargeInts = 512 * 1024;
+
+// The pool is global, so every section starts with an empty one.
+void Drain() {
+	while (CollectReceivedBuffersStats().pooled > 0) {
+		TakeReceivedBuffer(0);
+	}
+}
+
+} // namespace
+
+TEST_CASE("received buffers are reused", "[MTP::ReceivedBuffers]") {
+	Drain();
+	const auto was = CollectReceivedBuffersStats();
+
+	SECTION("a released buffer is taken again") {
+		auto buffer = TakeReceivedBuffer(100);
+		REQUIRE(buffer.size() == 100);
+		const auto data = buffer.constData();
+		ReleaseReceivedBuffer(std::move(buffer));
+		REQUIRE(CollectReceivedBuffersStats().pooled == 1);
+
+		const auto smaller = TakeReceivedBuffer(50);
+		REQUIRE(smaller.size() == 50);
+		REQUIRE(smaller.constData() == data);
+
+		const auto now = CollectReceivedBuffersStats();
+		REQUIRE(now.taken - was.taken == 2);
+		REQUIRE(now.allocated - was.allocated == 1);
+		REQUIRE(now.released - was.released == 1);
+		REQUIRE(now.dropped == was.dropped);
+		REQUIRE(now.pooled == 0);
+		REQUIRE(now.pooledBytes == 0);
+	}
+
+	SECTION("a smaller buffer is not taken for a larger packet") {
+		ReleaseReceivedBuffer(TakeReceivedBuffer(100));
+		const auto larger = TakeReceivedBuffer(1000);
+		REQUIRE(larger.size() == 1000);
+
+		const auto now = CollectReceivedBuffersStats();
+		REQUIRE(now.allocated - was.allocated == 2);
+		REQUIRE(now.pooled == 1);
+	}
+
+	SECTION("the most recently released fitting buffer is taken") {
+		auto first = TakeReceivedBuffer(100);
+		auto second = TakeReceivedBuffer(100);
+		auto small = TakeReceivedBuffer(10);
+		const auto data = second.constData();
+		ReleaseReceivedBuffer(std::move(first));
+		ReleaseReceivedBuffer(std::move(second));
+		ReleaseReceivedBuffer(std::move(small));
+		REQUIRE(TakeReceivedBuffer(100).constData() == data);
+	}
+
+	SECTION("shared and too large buffers are not pooled") {
+		auto shared = TakeReceivedBuffer(100);
+		const auto copy = shared;
+		ReleaseReceivedBuffer(std::move(shared));
+		ReleaseReceivedBuffer(TakeReceivedBuffer(kTooLargeInts));
+
+		const auto now = CollectReceivedBuffersStats();
+		REQUIRE(now.released - was.released == 2);
+		REQUIRE(now.dropped - was.dropped == 2);
+		REQUIRE(now.pooled == 0);
+		REQUIRE(copy.size() == 100);
+	}
+}
+
+TEST_CASE("received buffers pool is bounded", "[MTP::ReceivedBuffers]") {
+	Drain();
+	const auto was = CollectReceivedBuffersStats();
+
+	SECTION("by the buffers count, the oldest are dropped first") {
+		const auto count = kMaxPooledBuffers + 3;
+		auto buffers = std::vector<mtpBuffer>();
+		auto datas = std::vector<const mtpPrime*>();
+		for (auto i = 0; i != count; ++i) {
+			buffers.push_back(TakeReceivedBuffer(16));
+			datas.push_back(buffers.back().constData());
+		}
+		for (auto &buffer : buffers) {
+			ReleaseReceivedBuffer(std::move(buffer));
+		}
+
+		const auto now = CollectReceivedBuffersStats();
+		REQUIRE(now.pooled == kMaxPooledBuffers);
+		REQUIRE(now.dropped - was.dropped == count - kMaxPooledBuffers);
+
+		// Taken in the reverse order of releasing.
+		for (auto i = count; i != count - kMaxPooledBuffers; --i) {
+			REQUIRE(TakeReceivedBuffer(16).constData() == datas[i - 1]);
+		}
+		REQUIRE(CollectReceivedBuffersStats().pooled == 0);
+	}
+
+	SECTION("by the pooled bytes") {
+		const auto count = 12;
+		auto buffers = std::vector<mtpBuffer>();
+		for (auto i = 0; i != count; ++i) {
+			buffers.push_back(TakeReceivedBuffer(kLargeInts));
+		}
+		for (auto &buffer : buffers) {
+			ReleaseReceivedBuffer(std::move(buffer));
+		}
+
+		const auto now = CollectReceivedBuffersStats();
+		REQUIRE(now.pooledBytes <= kMaxPooledBytes);
+		REQUIRE(now.pooledBytes >= now.pooled * kLargeInts * 4);
+		REQUIRE(now.pooled < count);
+		REQUIRE(now.dropped - was.dropped == count - now.pooled);
+	}
+}
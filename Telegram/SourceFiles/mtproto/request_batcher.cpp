@@ -0,0 +1,59 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/request_batcher.h"
+
+#include "core/stats.h"
+
+namespace MTP {
+namespace {
+
+// Batchers are created and used only from the main thread.
+std::deque<RequestStats> &Registry() {
+	static auto result = std::deque<RequestStats>();
+	return result;
+}
+
+const auto StatsRegistered = Core::Stats::Register("api", [] {
+	auto result = std::vector<Core::Stats::Row>();
+	for (const auto &stats : Registry()) {
+		result.push_back({ QString::fromLatin1(stats.name), {
+			{ "keys", stats.requests },
+			{ "deduplicated", stats.deduplicated },
+			{ "cached", stats.cached },
+			{ "requests", stats.batches },
+			{ "failed", stats.failed },
+			{ "average latency ms", stats.batches
+				? (stats.latencySum / stats.batches)
+				: 0 },
+			{ "max latency ms", stats.latencyMax },
+		} });
+	}
+	return result;
+});
+
+} // namespace
+
+namespace details {
+
+RequestStats &LookupRequestStats(const char *name) {
+	Expects(name != nullptr);
+
+	auto &registry = Registry();
+	const auto i = ranges::find_if(registry, [&](const RequestStats &stats) {
+		return !strcmp(stats.name, name);
+	});
+	if (i != registry.end()) {
+		return *i;
+	}
+	registry.push_back(RequestStats());
+	registry.back().name = name;
+	return registry.back();
+}
+
+} // namespace details
+} // namespace MTP
@@ -0,0 +1,206 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/timer.h"
+
+namespace MTP {
+
+struct RequestStats {
+	const char *name = nullptr;
+	int requests = 0; // Keys passed to request().
+	int deduplicated = 0; // Already pending or in flight.
+	int cached = 0; // Answered less than cacheLifetime ago.
+	int batches = 0; // Requests sent to the server.
+	int failed = 0;
+	TimeMs latencySum = 0;
+	TimeMs latencyMax = 0;
+};
+
+namespace details {
+
+// Stats of all the batchers with the same name are summed up,
+// they are reported in the "api" section of Core::Stats.
+RequestStats &LookupRequestStats(const char *name);
+
+} // namespace details
+
+// Coalesces requests for the same kind of data about different keys.
+//
+// Keys requested during the batching window are sent together in
+// batches of at most "limit" keys. A key that is already waiting or
+// in flight is not requested twice, a key that was answered less than
+// "cacheLifetime" ago is not requested again until forget() is called.
+//
+// The send callback must pass the request id to done() or fail() from
+// the request handlers, otherwise the keys stay in flight forever.
+template <typename Key>
+class RequestBatcher {
+public:
+	struct Options {
+		TimeMs delay = 0; // 0 - send right away.
+		int limit = 0; // 0 - no limit.
+		TimeMs cacheLifetime = 0; // 0 - no cache.
+	};
+	using Send = Fn<mtpRequestId(std::vector<Key> &&keys)>;
+
+	RequestBatcher(const char *name, Options options, Send send);
+
+	// Returns false if the key didn't need a new request.
+	bool request(const Key &key);
+	bool requested(const Key &key) const;
+
+	void done(mtpRequestId requestId);
+	void fail(mtpRequestId requestId);
+	void forget(const Key &key);
+
+private:
+	struct Sent {
+		std::vector<Key> keys;
+		TimeMs sent = 0;
+	};
+
+	void sendPending();
+	void finish(mtpRequestId requestId, bool success);
+	void removeExpired(TimeMs now);
+
+	RequestStats &_stats;
+	const Options _options;
+	const Send _send;
+	base::Timer _timer;
+
+	std::vector<Key> _pending;
+	base::flat_map<mtpRequestId, Sent> _sent;
+	base::flat_map<Key, mtpRequestId> _inFlight;
+	base::flat_map<Key, TimeMs> _answered;
+
+};
+
+template <typename Key>
+RequestBatcher<Key>::RequestBatcher(
+	const char *name,
+	Options options,
+	Send send)
+: _stats(details::LookupRequestStats(name))
+, _options(options)
+, _send(std::move(send))
+, _timer([=] { sendPending(); }) {
+}
+
+template <typename Key>
+bool RequestBatcher<Key>::request(const Key &key) {
+	++_stats.requests;
+	if (requested(key)) {
+		++_stats.deduplicated;
+		return false;
+	}
+	if (_options.cacheLifetime > 0) {
+		const auto i = _answered.find(key);
+		if (i != _answered.end()) {
+			if (getms(true) - i->second < _options.cacheLifetime) {
+				++_stats.cached;
+				return false;
+			}
+			_answered.erase(i);
+		}
+	}
+	_pending.push_back(key);
+	if (_options.delay <= 0
+		|| (_options.limit > 0 && int(_pending.size()) >= _options.limit)) {
+		_timer.cancel();
+		sendPending();
+	} else if (!_timer.isActive()) {
+		_timer.callOnce(_options.delay);
+	}
+	return true;
+}
+
+template <typename Key>
+bool RequestBatcher<Key>::requested(const Key &key) const {
+	return _inFlight.contains(key)
+		|| (ranges::find(_pending, key) != _pending.end());
+}
+
+template <typename Key>
+void RequestBatcher<Key>::done(mtpRequestId requestId) {
+	finish(requestId, true);
+}
+
+template <typename Key>
+void RequestBatcher<Key>::fail(mtpRequestId requestId) {
+	finish(requestId, false);
+}
+
+template <typename Key>
+void RequestBatcher<Key>::forget(const Key &key) {
+	_answered.remove(key);
+}
+
+template <typename Key>
+void RequestBatcher<Key>::sendPending() {
+	while (!_pending.empty()) {
+		const auto count = (_options.limit > 0)
+			? std::min(int(_pending.size()), _options.limit)
+			: int(_pending.size());
+		auto keys = std::vector<Key>(
+			_pending.begin(),
+			_pending.begin() + count);
+		_pending.erase(_pending.begin(), _pending.begin() + count);
+
+		auto sent = Sent{ keys, getms(true) };
+		if (const auto requestId = _send(std::move(keys))) {
+			++_stats.batches;
+			for (const auto &key : sent.keys) {
+				_inFlight.emplace(key, requestId);
+			}
+			_sent.emplace(requestId, std::move(sent));
+		}
+	}
+}
+
+template <typename Key>
+void RequestBatcher<Key>::finish(mtpRequestId requestId, bool success) {
+	const auto i = _sent.find(requestId);
+	if (i == _sent.end()) {
+		return;
+	}
+	const auto now = getms(true);
+	const auto latency = now - i->second.sent;
+	_stats.latencySum += latency;
+	accumulate_max(_stats.latencyMax, latency);
+	if (!success) {
+		++_stats.failed;
+	}
+	for (const auto &key : i->second.keys) {
+		const auto j = _inFlight.find(key);
+		if (j != _inFlight.end() && j->second == requestId) {
+			_inFlight.erase(j);
+		}
+		if (success && _options.cacheLifetime > 0) {
+			_answered[key] = now;
+		}
+	}
+	_sent.erase(i);
+	removeExpired(now);
+}
+
+template <typename Key>
+void RequestBatcher<Key>::removeExpired(TimeMs now) {
+	if (_options.cacheLifetime <= 0) {
+		return;
+	}
+	for (auto i = _answered.begin(); i != _answered.end();) {
+		if (now - i->second >= _options.cacheLifetime) {
+			i = _answered.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+} // namespace MTP
@@ -0,0 +1,237 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/request_telemetry.h"
+
+#include "base/timer.h"
+
+#include <atomic>
+
+namespace MTP {
+namespace Telemetry {
+namespace {
+
+constexpr auto kDumpTimeout = TimeMs(60 * 1000);
+
+struct State {
+	std::atomic<bool> enabled = false;
+	QMutex mutex;
+	Aggregator aggregator;
+};
+
+State &GetState() {
+	static State result;
+	return result;
+}
+
+template <typename Method>
+void WithAggregator(Method method) {
+	auto &state = GetState();
+	QMutexLocker lock(&state.mutex);
+	method(state.aggregator);
+}
+
+// Thread: Main.
+std::unique_ptr<base::Timer> DumpTimer;
+
+QString DefaultPath() {
+	return cWorkingDir() + qsl("tdata/mtp_telemetry.json");
+}
+
+QString MethodName(mtpTypeId method) {
+	// Only the name is written before the missing fields are read.
+	const auto value = mtpPrime(method);
+	auto from = &value;
+	auto to = MTPStringLogger();
+	try {
+		mtpTextSerializeType(to, from, from + 1);
+	} catch (Exception &) {
+	}
+	const auto text = QString::fromUtf8(to.p, to.size);
+	const auto match = QRegularExpression(
+		"^\\{ ([A-Za-z0-9_\\.]+)").match(text);
+	return match.hasMatch()
+		? match.captured(1)
+		: QString::number(uint32(method), 16);
+}
+
+QByteArray SerializeHistogram(const Histogram &histogram) {
+	auto buckets = QByteArray();
+	auto last = Histogram::kBucketsCount;
+	while (last > 0 && !histogram.buckets[last - 1]) {
+		--last;
+	}
+	for (auto i = 0; i != last; ++i) {
+		if (i) {
+			buckets.append(',');
+		}
+		buckets.append(QByteArray::number(histogram.buckets[i]));
+	}
+	return "{\"count\":" + QByteArray::number(histogram.count)
+		+ ",\"sum\":" + QByteArray::number(histogram.sum)
+		+ ",\"max\":" + QByteArray::number(histogram.max)
+		+ ",\"buckets\":[" + buckets + "]}";
+}
+
+QByteArray SerializeResends(const MethodStats &stats) {
+	static const auto names = std::array<const char*, kResendCausesCount>{ {
+		"timeout",
+		"requested",
+		"state_lost",
+		"bad_msg",
+		"bad_salt",
+		"new_session",
+		"reconnect",
+		"migrate",
+		"server_error",
+		"flood_wait",
+	} };
+	auto result = QByteArray("{");
+	for (auto i = 0; i != kResendCausesCount; ++i) {
+		if (i) {
+			result.append(',');
+		}
+		result.append('"').append(names[i]).append("\":");
+		result.append(QByteArray::number(stats.resends[i]));
+	}
+	return result + '}';
+}
+
+} // namespace
+
+bool Enabled() {
+	return GetState().enabled.load(std::memory_order_relaxed);
+}
+
+void SetEnabled(bool enabled) {
+	auto &state = GetState();
+	if (state.enabled == enabled) {
+		return;
+	}
+	state.enabled = enabled;
+	if (enabled) {
+		DumpTimer = std::make_unique<base::Timer>([] {
+			ExportJson(DefaultPath());
+		});
+		DumpTimer->callEach(kDumpTimeout);
+	} else {
+		DumpTimer = nullptr;
+		ExportJson(DefaultPath());
+
+		WithAggregator([](Aggregator &aggregator) {
+			aggregator.clearRequests();
+		});
+	}
+}
+
+void RequestStarted(
+		mtpRequestId requestId,
+		mtpTypeId method,
+		DcId dcId,
+		int bytes) {
+	if (!Enabled()) {
+		return;
+	}
+	const auto now = getms(true);
+	WithAggregator([&](Aggregator &aggregator) {
+		aggregator.started(requestId, method, dcId, bytes, now);
+	});
+}
+
+void RequestSent(mtpRequestId requestId) {
+	if (!Enabled()) {
+		return;
+	}
+	const auto now = getms(true);
+	WithAggregator([&](Aggregator &aggregator) {
+		aggregator.sent(requestId, now);
+	});
+}
+
+void RequestResent(mtpRequestId requestId, Resend cause) {
+	if (!Enabled()) {
+		return;
+	}
+	WithAggregator([&](Aggregator &aggregator) {
+		aggregator.resent(requestId, cause);
+	});
+}
+
+void RequestFloodWait(mtpRequestId requestId, int seconds) {
+	if (!Enabled()) {
+		return;
+	}
+	WithAggregator([&](Aggregator &aggregator) {
+		aggregator.floodWait(requestId, seconds);
+	});
+}
+
+void RequestResponded(mtpRequestId requestId, int bytes, bool error) {
+	if (!Enabled()) {
+		return;
+	}
+	const auto now = getms(true);
+	WithAggregator([&](Aggregator &aggregator) {
+		aggregator.responded(requestId, bytes, error, now);
+	});
+}
+
+void RequestFinished(mtpRequestId requestId) {
+	if (!Enabled()) {
+		return;
+	}
+	WithAggregator([&](Aggregator &aggregator) {
+		aggregator.finished(requestId);
+	});
+}
+
+std::vector<MethodStats> CollectStats() {
+	auto result = std::vector<MethodStats>();
+	WithAggregator([&](const Aggregator &aggregator) {
+		result = aggregator.collect();
+	});
+	return result;
+}
+
+bool ExportJson(const QString &path) {
+	auto result = QByteArray();
+	auto first = true;
+	result.append("{\"time\":" + QByteArray::number(unixtime()));
+	result.append(",\"methods\":[");
+	for (const auto &stats : CollectStats()) {
+		result.append(first ? "\n" : ",\n");
+		first = false;
+		result.append("{\"method\":\"" + MethodName(stats.method).toUtf8()
+			+ "\",\"dc\":" + QByteArray::number(stats.dcId)
+			+ ",\"requests\":" + QByteArray::number(stats.requests)
+			+ ",\"errors\":" + QByteArray::number(stats.errors)
+			+ ",\"queue_wait_ms\":" + SerializeHistogram(stats.queueWait)
+			+ ",\"round_trip_ms\":" + SerializeHistogram(stats.roundTrip)
+			+ ",\"request_bytes\":" + SerializeHistogram(stats.requestBytes)
+			+ ",\"response_bytes\":" + SerializeHistogram(stats.responseBytes)
+			+ ",\"retries\":" + SerializeHistogram(stats.retries)
+			+ ",\"resends\":" + SerializeResends(stats)
+			+ ",\"flood_wait_seconds\":"
+			+ QByteArray::number(stats.floodWaitSeconds)
+			+ "}");
+	}
+	result.append("\n]}\n");
+
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		LOG(("MTP Telemetry Error: could not open '%1' for writing."
+			).arg(path));
+		return false;
+	} else if (file.write(result) != result.size()) {
+		LOG(("MTP Telemetry Error: could not write to '%1'.").arg(path));
+		return false;
+	}
+	return true;
+}
+
+} // namespace Telemetry
+} // namespace MTP
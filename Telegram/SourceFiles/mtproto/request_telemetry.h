@@ -0,0 +1,45 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/request_telemetry_aggregator.h"
+
+namespace MTP {
+namespace Telemetry {
+
+// Opt-in request instrumentation. While disabled every hook is one check.
+//
+// Requests are accounted by their TL method and their (bare) dc id.
+// For each pair we record the time from send() till the request was
+// first written to a connection (queue wait), the time from the last
+// write till the rpc_result (round trip), the request and response
+// sizes, the retries per request with their causes and flood waits.
+bool Enabled();
+void SetEnabled(bool enabled);
+
+// Thread: Any.
+void RequestStarted(
+	mtpRequestId requestId,
+	mtpTypeId method,
+	DcId dcId,
+	int bytes);
+void RequestSent(mtpRequestId requestId);
+void RequestResent(mtpRequestId requestId, Resend cause);
+void RequestFloodWait(mtpRequestId requestId, int seconds);
+void RequestResponded(mtpRequestId requestId, int bytes, bool error);
+void RequestFinished(mtpRequestId requestId);
+
+// Thread: Any. Sorted by the summary round trip time.
+std::vector<MethodStats> CollectStats();
+
+// Thread: Main. While enabled the same is written periodically
+// to 'tdata/mtp_telemetry.json' in the working directory.
+bool ExportJson(const QString &path);
+
+} // namespace Telemetry
+} // namespace MTP
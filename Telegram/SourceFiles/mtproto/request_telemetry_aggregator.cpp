@@ -0,0 +1,133 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/request_telemetry_aggregator.h"
+
+#include <range/v3/algorithm/sort.hpp>
+#include <range/v3/utility/functional.hpp>
+
+namespace MTP {
+namespace Telemetry {
+
+void Histogram::add(int64 value) {
+	auto bucket = 0;
+	for (auto left = std::max(value, int64(0)); left != 0; left >>= 1) {
+		++bucket;
+	}
+	++buckets[std::min(bucket, kBucketsCount - 1)];
+	++count;
+	sum += value;
+	accumulate_max(max, value);
+}
+
+MethodStats &Aggregator::methodFor(const Request &request) {
+	const auto key = std::make_pair(request.method, request.dcId);
+	auto i = _methods.find(key);
+	if (i == end(_methods)) {
+		i = _methods.emplace(key, MethodStats()).first;
+		i->second.method = request.method;
+		i->second.dcId = request.dcId;
+	}
+	return i->second;
+}
+
+auto Aggregator::lookup(mtpRequestId requestId) -> Request* {
+	const auto i = _requests.find(requestId);
+	return (i != end(_requests)) ? &i->second : nullptr;
+}
+
+void Aggregator::started(
+		mtpRequestId requestId,
+		mtpTypeId method,
+		DcId dcId,
+		int bytes,
+		TimeMs now) {
+	if (_requests.size() >= kMaxRequestsInFlight) {
+		return;
+	}
+	auto request = Request();
+	request.method = method;
+	request.dcId = dcId;
+	request.started = now;
+	auto &stats = methodFor(request);
+	++stats.requests;
+	stats.requestBytes.add(bytes);
+	_requests.emplace(requestId, request);
+}
+
+void Aggregator::sent(mtpRequestId requestId, TimeMs now) {
+	if (const auto request = lookup(requestId)) {
+		if (!request->sent) {
+			methodFor(*request).queueWait.add(now - request->started);
+		}
+		request->sent = now;
+	}
+}
+
+void Aggregator::resent(mtpRequestId requestId, Resend cause) {
+	if (const auto request = lookup(requestId)) {
+		++request->retries;
+		++methodFor(*request).resends[int(cause)];
+	}
+}
+
+void Aggregator::floodWait(mtpRequestId requestId, int seconds) {
+	if (const auto request = lookup(requestId)) {
+		auto &stats = methodFor(*request);
+		++request->retries;
+		++stats.resends[int(Resend::FloodWait)];
+		stats.floodWaitSeconds += seconds;
+	}
+}
+
+void Aggregator::responded(
+		mtpRequestId requestId,
+		int bytes,
+		bool error,
+		TimeMs now) {
+	if (const auto request = lookup(requestId)) {
+		auto &stats = methodFor(*request);
+		if (request->sent) {
+			stats.roundTrip.add(now - request->sent);
+		}
+		stats.responseBytes.add(bytes);
+		if (error) {
+			++stats.errors;
+		}
+	}
+}
+
+void Aggregator::finished(mtpRequestId requestId) {
+	const auto i = _requests.find(requestId);
+	if (i != end(_requests)) {
+		methodFor(i->second).retries.add(i->second.retries);
+		_requests.erase(i);
+	}
+}
+
+int Aggregator::requestsInFlight() const {
+	return int(_requests.size());
+}
+
+void Aggregator::clearRequests() {
+	_requests.clear();
+}
+
+std::vector<MethodStats> Aggregator::collect() const {
+	auto result = std::vector<MethodStats>();
+	result.reserve(_methods.size());
+	for (const auto &[key, stats] : _methods) {
+		result.push_back(stats);
+	}
+	ranges::sort(result, ranges::greater(), [](const MethodStats &stats) {
+		return stats.roundTrip.sum;
+	});
+	return result;
+}
+
+} // namespace Telemetry
+} // namespace MTP
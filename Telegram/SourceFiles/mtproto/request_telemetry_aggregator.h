@@ -0,0 +1,101 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/core_types.h"
+
+#include <array>
+#include <map>
+
+namespace MTP {
+namespace Telemetry {
+
+enum class Resend {
+	Timeout, // No answer for MTPCheckResendTimeout.
+	Requested, // msg_resend_req from the server.
+	StateLost, // msgs_state_info said the server didn't get it.
+	BadMsg, // bad_msg_notification, usually a wrong local time.
+	BadSalt,
+	NewSession,
+	Reconnect,
+	Migrate, // *_MIGRATE_X error.
+	ServerError, // Delayed after an internal server error.
+	FloodWait,
+};
+constexpr auto kResendCausesCount = int(Resend::FloodWait) + 1;
+
+struct Histogram {
+	// Bucket i counts values from 2^(i - 1) till 2^i, the first one zeros.
+	static constexpr auto kBucketsCount = 32;
+
+	void add(int64 value);
+
+	std::array<int64, kBucketsCount> buckets = { { 0 } };
+	int64 count = 0;
+	int64 sum = 0;
+	int64 max = 0;
+};
+
+struct MethodStats {
+	mtpTypeId method = 0;
+	DcId dcId = 0;
+	int64 requests = 0;
+	int64 errors = 0;
+	Histogram queueWait; // ms
+	Histogram roundTrip; // ms
+	Histogram requestBytes;
+	Histogram responseBytes;
+	Histogram retries;
+	std::array<int64, kResendCausesCount> resends = { { 0 } };
+	int64 floodWaitSeconds = 0;
+};
+
+// Accounts the requests by their TL method and their (bare) dc id.
+// It is not thread safe and the current time is passed to it.
+class Aggregator final {
+public:
+	// Requests that never finish must not grow the map without limits.
+	static constexpr auto kMaxRequestsInFlight = 16 * 1024;
+
+	void started(
+		mtpRequestId requestId,
+		mtpTypeId method,
+		DcId dcId,
+		int bytes,
+		TimeMs now);
+	void sent(mtpRequestId requestId, TimeMs now);
+	void resent(mtpRequestId requestId, Resend cause);
+	void floodWait(mtpRequestId requestId, int seconds);
+	void responded(mtpRequestId requestId, int bytes, bool error, TimeMs now);
+	void finished(mtpRequestId requestId);
+
+	int requestsInFlight() const;
+	void clearRequests();
+
+	// Sorted by the summary round trip time.
+	std::vector<MethodStats> collect() const;
+
+private:
+	struct Request {
+		mtpTypeId method = 0;
+		DcId dcId = 0;
+		TimeMs started = 0;
+		TimeMs sent = 0;
+		int retries = 0;
+	};
+
+	MethodStats &methodFor(const Request &request);
+	Request *lookup(mtpRequestId requestId);
+
+	std::map<mtpRequestId, Request> _requests;
+	std::map<std::pair<mtpTypeId, DcId>, MethodStats> _methods;
+
+};
+
+} // namespace Telemetry
+} // namespace MTP
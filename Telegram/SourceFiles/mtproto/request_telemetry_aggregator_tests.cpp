@@ -0,0 +1,173 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "mtproto/request_telemetry_aggregator.h"
+
+using namespace MTP::Telemetry;
+
+namespace {
+
+constexpr auto kGetFile = mtpTypeId(0xe3a6cfb5U);
+constexpr auto kSaveFilePart = mtpTypeId(0xb304a621U);
+
+const MethodStats &Find(
+		const std::vector<MethodStats> &list,
+		mtpTypeId method,
+		MTP::DcId dcId) {
+	const auto i = std::find_if(begin(list), end(list), [&](
+			const MethodStats &stats) {
+		return (stats.method == method) && (stats.dcId == dcId);
+	});
+	REQUIRE(i != end(list));
+	return *i;
+}
+
+} // namespace
+
+TEST_CASE("histogram buckets are powers of two", "[MTP::Telemetry]") {
+	auto histogram = Histogram();
+	for (const auto value : { 0, 1, 2, 3, 4, 7, 8, 1000 }) {
+		histogram.add(value);
+	}
+	histogram.add(int64(1) << 40);
+
+	REQUIRE(histogram.count == 9);
+	REQUIRE(histogram.sum == 1025 + (int64(1) << 40));
+	REQUIRE(histogram.max == (int64(1) << 40));
+	REQUIRE(histogram.buckets[0] == 1); // 0
+	REQUIRE(histogram.buckets[1] == 1); // 1
+	REQUIRE(histogram.buckets[2] == 2); // 2, 3
+	REQUIRE(histogram.buckets[3] == 2); // 4, 7
+	REQUIRE(histogram.buckets[4] == 1); // 8
+	REQUIRE(histogram.buckets[10] == 1); // 1000
+	REQUIRE(histogram.buckets[Histogram::kBucketsCount - 1] == 1);
+}
+
+TEST_CASE("requests are aggregated by method and dc", "[MTP::Telemetry]") {
+	auto aggregator = Aggregator();
+
+	SECTION("times and sizes of a request") {
+		aggregator.started(1, kGetFile, 2, 100, 1000);
+		aggregator.sent(1, 1010);
+		aggregator.responded(1, 5000, false, 1060);
+		aggregator.finished(1);
+
+		const auto list = aggregator.collect();
+		REQUIRE(list.size() == 1);
+		const auto &stats = list.front();
+		REQUIRE(stats.method == kGetFile);
+		REQUIRE(stats.dcId == 2);
+		REQUIRE(stats.requests == 1);
+		REQUIRE(stats.errors == 0);
+		REQUIRE(stats.queueWait.count == 1);
+		REQUIRE(stats.queueWait.sum == 10);
+		REQUIRE(stats.roundTrip.count == 1);
+		REQUIRE(stats.roundTrip.sum == 50);
+		REQUIRE(stats.requestBytes.sum == 100);
+		REQUIRE(stats.responseBytes.sum == 5000);
+		REQUIRE(stats.retries.count == 1);
+		REQUIRE(stats.retries.sum == 0);
+		REQUIRE(aggregator.requestsInFlight() == 0);
+	}
+
+	SECTION("different methods and dcs are counted separately") {
+		aggregator.started(1, kGetFile, 2, 10, 0);
+		aggregator.started(2, kGetFile, 2, 20, 0);
+		aggregator.started(3, kGetFile, 4, 30, 0);
+		aggregator.started(4, kSaveFilePart, 2, 40, 0);
+		aggregator.responded(2, 0, true, 0);
+
+		const auto list = aggregator.collect();
+		REQUIRE(list.size() == 3);
+		const auto &first = Find(list, kGetFile, 2);
+		REQUIRE(first.requests == 2);
+		REQUIRE(first.errors == 1);
+		REQUIRE(first.requestBytes.sum == 30);
+		REQUIRE(Find(list, kGetFile, 4).requests == 1);
+		REQUIRE(Find(list, kSaveFilePart, 2).requests == 1);
+		REQUIRE(aggregator.requestsInFlight() == 4);
+	}
+
+	SECTION("resends count the retries and their causes") {
+		aggregator.started(1, kGetFile, 2, 10, 0);
+		aggregator.sent(1, 5);
+		aggregator.resent(1, Resend::Timeout);
+		aggregator.sent(1, 100);
+		aggregator.resent(1, Resend::BadSalt);
+		aggregator.floodWait(1, 30);
+		aggregator.sent(1, 200);
+		aggregator.responded(1, 10, false, 250);
+		aggregator.finished(1);
+
+		const auto list = aggregator.collect();
+		const auto &stats = list.front();
+		REQUIRE(stats.resends[int(Resend::Timeout)] == 1);
+		REQUIRE(stats.resends[int(Resend::BadSalt)] == 1);
+		REQUIRE(stats.resends[int(Resend::FloodWait)] == 1);
+		REQUIRE(stats.floodWaitSeconds == 30);
+		REQUIRE(stats.retries.sum == 3);
+
+		// The queue wait is till the first write, the round trip is
+		// from the last one.
+		REQUIRE(stats.queueWait.count == 1);
+		REQUIRE(stats.queueWait.sum == 5);
+		REQUIRE(stats.roundTrip.sum == 50);
+	}
+
+	SECTION("unknown and finished requests are ignored") {
+		aggregator.sent(1, 10);
+		aggregator.responded(1, 10, true, 20);
+		aggregator.finished(1);
+		REQUIRE(aggregator.collect().empty());
+
+		aggregator.started(1, kGetFile, 2, 10, 0);
+		aggregator.finished(1);
+		aggregator.responded(1, 10, true, 20);
+		aggregator.finished(1);
+		const auto list = aggregator.collect();
+		const auto &stats = list.front();
+		REQUIRE(stats.requests == 1);
+		REQUIRE(stats.errors == 0);
+		REQUIRE(stats.retries.count == 1);
+	}
+
+	SECTION("the requests in flight are limited") {
+		const auto count = Aggregator::kMaxRequestsInFlight + 10;
+		for (auto i = 0; i != count; ++i) {
+			aggregator.started(i + 1, kGetFile, 2, 10, 0);
+		}
+		REQUIRE(aggregator.requestsInFlight()
+			== Aggregator::kMaxRequestsInFlight);
+		REQUIRE(aggregator.collect().front().requests
+			== Aggregator::kMaxRequestsInFlight);
+
+		aggregator.clearRequests();
+		REQUIRE(aggregator.requestsInFlight() == 0);
+		REQUIRE(aggregator.collect().front().requests
+			== Aggregator::kMaxRequestsInFlight);
+	}
+
+	SECTION("methods are sorted by the summary round trip") {
+		aggregator.started(1, kGetFile, 2, 10, 1000);
+		aggregator.started(2, kSaveFilePart, 2, 10, 1000);
+		aggregator.started(3, kGetFile, 4, 10, 1000);
+		aggregator.sent(1, 1000);
+		aggregator.sent(2, 1000);
+		aggregator.sent(3, 1000);
+		aggregator.responded(1, 10, false, 1020);
+		aggregator.responded(2, 10, false, 1300);
+		aggregator.responded(3, 10, false, 1100);
+
+		const auto list = aggregator.collect();
+		REQUIRE(list.size() == 3);
+		REQUIRE(list[0].method == kSaveFilePart);
+		REQUIRE(list[1].dcId == 4);
+		REQUIRE(list[2].dcId == 2);
+	}
+}
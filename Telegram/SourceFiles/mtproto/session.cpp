@@ -304,6 +304,9 @@ void Session::checkRequestsByTimer() {
 					if (req.messageSize() < MTPResendThreshold) { // resend
 						resendingIds.reserve(haveSentCount);
 						resendingIds.push_back(i.key());
+						Telemetry::RequestResent(
+							req->requestId,
+							Telemetry::Resend::Timeout);
 					} else {
 						req->msDate = ms;
 						stateRequestIds.reserve(haveSentCount);
@@ -497,6 +500,9 @@ void Session::resendAll() {
 		for (auto i = haveSent.cbegin(), e = haveSent.cend(); i != e; ++i) {
 			if (i.value()->requestId) {
 				toResend.push_back(i.key());
+				Telemetry::RequestResent(
+					i.value()->requestId,
+					Telemetry::Resend::Reconnect);
 			}
 		}
 	}
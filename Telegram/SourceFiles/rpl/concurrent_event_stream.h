@@ -0,0 +1,284 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <rpl/producer.h>
+#include <rpl/event_stream.h>
+#include <crl/crl.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace rpl {
+namespace details {
+
+// Type erased void(const Value&) callable that keeps small callables
+// inline, so a handler capturing a few pointers is stored without
+// the separate heap allocation std::function would make for it.
+template <typename Value>
+class small_handler {
+public:
+	static constexpr auto kInlineSize = 4 * sizeof(void*);
+
+	template <
+		typename Handler,
+		typename = std::enable_if_t<!std::is_same_v<
+			std::decay_t<Handler>,
+			small_handler>>>
+	small_handler(Handler &&handler) {
+		using Decayed = std::decay_t<Handler>;
+		if constexpr (sizeof(Decayed) <= sizeof(_storage)
+			&& alignof(Decayed) <= alignof(storage)) {
+			new (&_storage) Decayed(std::forward<Handler>(handler));
+			_call = &call_inline<Decayed>;
+			_destroy = &destroy_inline<Decayed>;
+		} else {
+			new (&_storage) Decayed*(
+				new Decayed(std::forward<Handler>(handler)));
+			_call = &call_heap<Decayed>;
+			_destroy = &destroy_heap<Decayed>;
+		}
+	}
+	small_handler(const small_handler &other) = delete;
+	small_handler &operator=(const small_handler &other) = delete;
+
+	void operator()(const Value &value) const {
+		_call(&_storage, value);
+	}
+
+	~small_handler() {
+		_destroy(&_storage);
+	}
+
+private:
+	using storage = std::aligned_storage_t<kInlineSize>;
+
+	template <typename Handler>
+	static void call_inline(void *storage, const Value &value) {
+		(*static_cast<Handler*>(storage))(value);
+	}
+	template <typename Handler>
+	static void destroy_inline(void *storage) {
+		static_cast<Handler*>(storage)->~Handler();
+	}
+	template <typename Handler>
+	static void call_heap(void *storage, const Value &value) {
+		(**static_cast<Handler**>(storage))(value);
+	}
+	template <typename Handler>
+	static void destroy_heap(void *storage) {
+		delete *static_cast<Handler**>(storage);
+	}
+
+	mutable storage _storage;
+	void (*_call)(void *storage, const Value &value) = nullptr;
+	void (*_destroy)(void *storage) = nullptr;
+
+};
+
+template <typename Value>
+struct concurrent_handler {
+	template <typename Handler>
+	concurrent_handler(std::uint64_t id, Handler &&handler)
+	: id(id)
+	, handler(std::forward<Handler>(handler)) {
+	}
+
+	const std::uint64_t id = 0;
+	std::atomic<bool> alive = true;
+	const small_handler<Value> handler;
+};
+
+} // namespace details
+
+// Unlike event_stream this one may be fired from any thread.
+//
+// Handlers added by on_next() are called on the firing thread. They
+// are kept in an immutable snapshot that is replaced when a handler is
+// added or removed, so fire() doesn't lock anything to reach them.
+// A handler may still be called once by a fire() that has started
+// before its lifetime was destroyed.
+//
+// events_on_main() gives a usual producer for the main thread. Values
+// fired while the main thread is busy are collected and delivered in
+// a single crl::on_main() call instead of one call for each value.
+template <typename Value = empty_value>
+class concurrent_event_stream {
+public:
+	concurrent_event_stream();
+	concurrent_event_stream(const concurrent_event_stream &other) = delete;
+	concurrent_event_stream &operator=(
+		const concurrent_event_stream &other) = delete;
+
+	template <typename OtherValue>
+	void fire_forward(OtherValue &&value) const;
+	void fire(Value &&value) const {
+		return fire_forward(std::move(value));
+	}
+	void fire_copy(const Value &value) const {
+		return fire_forward(value);
+	}
+	bool has_consumers() const;
+
+	template <typename OtherHandler>
+	[[nodiscard]] lifetime on_next(OtherHandler &&handler) const;
+
+	// Main thread only.
+	auto events_on_main() const {
+		return make_producer<Value>([weak = std::weak_ptr<Data>(_data)](
+				const auto &consumer) {
+			const auto strong = weak.lock();
+			if (!strong) {
+				return lifetime();
+			}
+			++strong->main_consumers;
+			auto result = lifetime([weak] {
+				if (const auto strong = weak.lock()) {
+					--strong->main_consumers;
+				}
+			});
+			result.add(strong->on_main.events().start_existing(consumer));
+			return result;
+		});
+	}
+
+	~concurrent_event_stream();
+
+private:
+	using Entry = details::concurrent_handler<Value>;
+	using Snapshot = std::vector<std::shared_ptr<Entry>>;
+
+	struct Data {
+		void remove(std::uint64_t id);
+		void deliver_on_main();
+
+		std::mutex handlers_mutex; // Guards handlers replacement.
+		std::shared_ptr<const Snapshot> handlers;
+		std::uint64_t next_id = 0;
+		std::atomic<int> handlers_count = 0;
+
+		std::mutex pending_mutex;
+		std::vector<Value> pending;
+		std::atomic<int> main_consumers = 0;
+		event_stream<Value> on_main; // Main thread only.
+	};
+
+	const std::shared_ptr<Data> _data;
+
+};
+
+template <typename Value>
+inline concurrent_event_stream<Value>::concurrent_event_stream()
+: _data(std::make_shared<Data>()) {
+}
+
+template <typename Value>
+template <typename OtherValue>
+inline void concurrent_event_stream<Value>::fire_forward(
+		OtherValue &&value) const {
+	if (_data->handlers_count.load(std::memory_order_acquire) > 0) {
+		const auto handlers = std::atomic_load(&_data->handlers);
+		for (const auto &handler : *handlers) {
+			if (handler->alive.load(std::memory_order_acquire)) {
+				handler->handler(value);
+			}
+		}
+	}
+	if (_data->main_consumers.load(std::memory_order_acquire) > 0) {
+		auto schedule = false;
+		{
+			std::lock_guard<std::mutex> lock(_data->pending_mutex);
+			schedule = _data->pending.empty();
+			_data->pending.push_back(std::forward<OtherValue>(value));
+		}
+		if (schedule) {
+			crl::on_main([weak = std::weak_ptr<Data>(_data)] {
+				if (const auto strong = weak.lock()) {
+					strong->deliver_on_main();
+				}
+			});
+		}
+	}
+}
+
+template <typename Value>
+inline bool concurrent_event_stream<Value>::has_consumers() const {
+	return (_data->handlers_count.load(std::memory_order_acquire) > 0)
+		|| (_data->main_consumers.load(std::memory_order_acquire) > 0);
+}
+
+template <typename Value>
+template <typename OtherHandler>
+inline lifetime concurrent_event_stream<Value>::on_next(
+		OtherHandler &&handler) const {
+	std::lock_guard<std::mutex> lock(_data->handlers_mutex);
+	const auto id = ++_data->next_id;
+	auto updated = std::make_shared<Snapshot>();
+	if (const auto &was = _data->handlers) {
+		updated->reserve(was->size() + 1);
+		*updated = *was;
+	}
+	updated->push_back(std::make_shared<Entry>(
+		id,
+		std::forward<OtherHandler>(handler)));
+	std::atomic_store(
+		&_data->handlers,
+		std::shared_ptr<const Snapshot>(std::move(updated)));
+	++_data->handlers_count;
+	return lifetime([weak = std::weak_ptr<Data>(_data), id] {
+		if (const auto strong = weak.lock()) {
+			strong->remove(id);
+		}
+	});
+}
+
+template <typename Value>
+inline void concurrent_event_stream<Value>::Data::remove(
+		std::uint64_t id) {
+	std::lock_guard<std::mutex> lock(handlers_mutex);
+	if (!handlers) {
+		return;
+	}
+	auto updated = std::make_shared<Snapshot>();
+	updated->reserve(handlers->size());
+	for (const auto &handler : *handlers) {
+		if (handler->id == id) {
+			handler->alive.store(false, std::memory_order_release);
+			--handlers_count;
+		} else {
+			updated->push_back(handler);
+		}
+	}
+	std::atomic_store(
+		&handlers,
+		std::shared_ptr<const Snapshot>(std::move(updated)));
+}
+
+template <typename Value>
+inline void concurrent_event_stream<Value>::Data::deliver_on_main() {
+	auto values = std::vector<Value>();
+	{
+		std::lock_guard<std::mutex> lock(pending_mutex);
+		std::swap(values, pending);
+	}
+	for (auto &value : values) {
+		on_main.fire(std::move(value));
+	}
+}
+
+template <typename Value>
+inline concurrent_event_stream<Value>::~concurrent_event_stream() {
+	// The main thread consumers must be done on the main thread.
+	if (_data->main_consumers.load(std::memory_order_acquire) > 0) {
+		crl::on_main([data = _data] {});
+	}
+}
+
+} // namespace rpl
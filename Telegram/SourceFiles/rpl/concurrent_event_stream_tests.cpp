@@ -0,0 +1,77 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include <rpl/concurrent_event_stream.h>
+#include <array>
+#include <string>
+#include <thread>
+
+using namespace rpl;
+
+TEST_CASE("concurrent event stream tests", "[rpl::concurrent_event_stream]") {
+	SECTION("fire from several threads") {
+		constexpr auto kThreads = 4;
+		constexpr auto kFires = 1000;
+
+		auto sum = std::atomic<int>(0);
+		auto stream = concurrent_event_stream<int>();
+		auto alive = stream.on_next([&](int value) {
+			sum += value;
+		});
+		REQUIRE(stream.has_consumers());
+
+		auto threads = std::vector<std::thread>();
+		for (auto i = 0; i != kThreads; ++i) {
+			threads.emplace_back([&] {
+				for (auto j = 0; j != kFires; ++j) {
+					stream.fire_copy(1);
+				}
+			});
+		}
+		for (auto &thread : threads) {
+			thread.join();
+		}
+		REQUIRE(sum == kThreads * kFires);
+	}
+
+	SECTION("handler is removed with its lifetime") {
+		auto calls = std::make_shared<int>(0);
+		auto stream = concurrent_event_stream<int>();
+		{
+			auto alive = stream.on_next([=](int) {
+				++*calls;
+			});
+			stream.fire(1);
+		}
+		REQUIRE(!stream.has_consumers());
+		stream.fire(2);
+		REQUIRE(*calls == 1);
+	}
+
+	SECTION("lifetime may outlive the stream") {
+		auto alive = lifetime();
+		{
+			auto stream = concurrent_event_stream<int>();
+			alive = stream.on_next([](int) {});
+		}
+		alive.destroy();
+	}
+
+	SECTION("big handlers are supported") {
+		auto result = std::make_shared<std::string>();
+		auto stream = concurrent_event_stream<std::string>();
+		auto big = std::array<std::string, 8>();
+		big.back() = "!";
+		auto alive = stream.on_next([=](const std::string &value) {
+			*result = value + big.back();
+		});
+		stream.fire("hello");
+		REQUIRE(*result == "hello!");
+	}
+}
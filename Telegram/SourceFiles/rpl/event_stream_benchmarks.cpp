@@ -0,0 +1,80 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/benchmark.h"
+
+#include <rpl/concurrent_event_stream.h>
+
+namespace {
+
+constexpr auto kConsumers = 16;
+constexpr auto kFires = 100000;
+constexpr auto kSubscriptions = 10000;
+
+// Capture of a typical size: a couple of pointers and a flag.
+struct Capture {
+	int64 *sum = nullptr;
+	const void *owner = nullptr;
+	bool enabled = true;
+};
+
+} // namespace
+
+TDESKTOP_BENCHMARK(rpl_event_stream) {
+	auto sum = int64(0);
+	const auto capture = Capture{ &sum, &runner, true };
+
+	runner.step("event_stream fire", [&] {
+		auto stream = rpl::event_stream<int>();
+		auto lifetime = rpl::lifetime();
+		for (auto i = 0; i != kConsumers; ++i) {
+			stream.events(
+			) | rpl::start_with_next([=](int value) {
+				if (capture.enabled) {
+					*capture.sum += value;
+				}
+			}, lifetime);
+		}
+		for (auto i = 0; i != kFires; ++i) {
+			stream.fire_copy(i);
+		}
+	});
+	runner.step("concurrent_event_stream fire", [&] {
+		auto stream = rpl::concurrent_event_stream<int>();
+		auto lifetime = rpl::lifetime();
+		for (auto i = 0; i != kConsumers; ++i) {
+			lifetime.add(stream.on_next([=](int value) {
+				if (capture.enabled) {
+					*capture.sum += value;
+				}
+			}));
+		}
+		for (auto i = 0; i != kFires; ++i) {
+			stream.fire_copy(i);
+		}
+	});
+
+	runner.step("event_stream subscribe", [&] {
+		auto stream = rpl::event_stream<int>();
+		for (auto i = 0; i != kSubscriptions; ++i) {
+			auto lifetime = stream.events(
+			) | rpl::start_with_next([=](int value) {
+				*capture.sum += value;
+			});
+		}
+	});
+	runner.step("concurrent_event_stream subscribe", [&] {
+		auto stream = rpl::concurrent_event_stream<int>();
+		for (auto i = 0; i != kSubscriptions; ++i) {
+			auto lifetime = stream.on_next([=](int value) {
+				*capture.sum += value;
+			});
+		}
+	});
+
+	base::benchmark::KeepAlive(sum);
+}
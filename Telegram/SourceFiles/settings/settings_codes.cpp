@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "platform/platform_specific.h"
 #include "ui/toast/toast.h"
 #include "mainwidget.h"
+#include "mainwindow.h"
 #include "data/data_session.h"
 #include "storage/localstorage.h"
 #include "boxes/confirm_box.h"
@@ -17,10 +18,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "messenger.h"
 #include "mtproto/mtp_instance.h"
 #include "mtproto/dc_options.h"
+#include "mtproto/request_telemetry.h"
 #include "core/file_utilities.h"
+#include "core/stats.h"
 #include "core/update_checker.h"
 #include "window/themes/window_theme.h"
 #include "window/themes/window_theme_editor.h"
+#include "ui/paint_profiler.h"
 #include "media/media_audio_track.h"
 
 namespace Settings {
@@ -120,6 +124,35 @@ auto GenerateCodes() {
 	codes.emplace(qsl("export"), [] {
 		Auth().data().startExport();
 	});
+	codes.emplace(qsl("paintprofiler"), [] {
+		const auto enabled = !Ui::PaintProfiler::Enabled();
+		Ui::PaintProfiler::SetEnabled(enabled);
+		if (const auto window = App::wnd(); enabled && window) {
+			Ui::PaintProfiler::ShowOverlay(window);
+		}
+		Ui::Toast::Show(enabled
+			? "Paint profiler enabled."
+			: "Paint profiler disabled.");
+	});
+	codes.emplace(qsl("painttrace"), [] {
+		const auto path = cWorkingDir() + qsl("tdata/paint_trace.json");
+		if (Ui::PaintProfiler::ExportChromeTrace(path)) {
+			File::ShowInFolder(path);
+		} else {
+			Ui::show(Box<InformBox>("Could not write the trace :( Errors in 'log.txt'."));
+		}
+	});
+	codes.emplace(qsl("stats"), [] {
+		Core::Stats::WriteToLog();
+		Ui::Toast::Show("Stats written to 'log.txt'.");
+	});
+	codes.emplace(qsl("mtptelemetry"), [] {
+		const auto enabled = !MTP::Telemetry::Enabled();
+		MTP::Telemetry::SetEnabled(enabled);
+		Ui::Toast::Show(enabled
+			? "Request telemetry enabled, see 'tdata/mtp_telemetry.json'."
+			: "Request telemetry disabled.");
+	});
 
 	auto audioFilters = qsl("Audio files (*.wav *.mp3);;") + FileDialog::AllFilesFilter();
 	auto audioKeys = {
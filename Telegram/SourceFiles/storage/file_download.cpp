@@ -17,6 +17,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "auth_session.h"
 #include "apiwrap.h"
 #include "core/crash_reports.h"
+#include "media/media_streaming_file.h"
 #include "base/bytes.h"
 #include "base/openssl_help.h"
 
@@ -79,6 +80,7 @@ constexpr auto kDownloadDocumentPartSize = 128 * 1024; // 128kb for document
 constexpr auto kMaxFileQueries = 16; // max 16 file parts downloaded at the same time
 constexpr auto kMaxWebFileQueries = 8; // max 8 http[s] files downloaded at the same time
 constexpr auto kDownloadCdnPartSize = 128 * 1024; // 128kb for cdn requests
+constexpr auto kMaxStreamedFileSize = 256 * 1024 * 1024; // streamed files are held in memory
 
 } // namespace
 
@@ -254,6 +256,9 @@ void FileLoader::localLoaded(
 		Platform::File::PostprocessDownloaded(
 			QFileInfo(_file).absoluteFilePath());
 	}
+	if (const auto streamed = stream()) {
+		streamed->feed(0, bytes::make_vector(_data));
+	}
 	_downloader->taskFinished().notify();
 
 	emit progress(this);
@@ -591,6 +596,103 @@ Data::FileOrigin mtpFileLoader::fileOrigin() const {
 	return _origin;
 }
 
+std::shared_ptr<Media::Streaming::SparseFile> mtpFileLoader::stream() {
+	if (!_stream
+		&& !_finished
+		&& _id != 0
+		&& _size > 0
+		&& _size <= kMaxStreamedFileSize) {
+		_stream = std::make_shared<Media::Streaming::SparseFile>(_size);
+		fillStream();
+		_stream->wantedOffsets(
+		) | rpl::start_with_next([=](int offset) {
+			prioritize(offset);
+		}, _streamLifetime);
+	}
+	return _stream;
+}
+
+void mtpFileLoader::fillStream() {
+	auto loading = base::flat_set<int>();
+	for (const auto &[requestId, requestData] : _sentRequests) {
+		loading.emplace(requestData.offset);
+	}
+	for (const auto &[offset, part] : _cdnUncheckedParts) {
+		loading.emplace(offset);
+	}
+	auto loaded = std::vector<int>();
+	for (auto offset = 0; offset < _nextRequestOffset; offset += partSize()) {
+		if (!loading.contains(offset)) {
+			loaded.push_back(offset);
+		}
+	}
+	for (const auto offset : _prioritizedOffsets) {
+		if (!loading.contains(offset)) {
+			loaded.push_back(offset);
+		}
+	}
+	if (loaded.empty()) {
+		return;
+	} else if (_fileIsOpen) {
+		_file.flush();
+		QFile f(_file.fileName());
+		if (!f.open(QIODevice::ReadOnly)) {
+			return;
+		}
+		for (const auto offset : loaded) {
+			if (!f.seek(offset)) {
+				break;
+			}
+			_stream->feed(offset, bytes::make_vector(f.read(partSize())));
+		}
+	} else {
+		for (const auto offset : loaded) {
+			if (offset >= _data.size()) {
+				break;
+			}
+			const auto length = std::min(partSize(), _data.size() - offset);
+			_stream->feed(offset, bytes::make_vector(
+				bytes::make_span(_data).subspan(offset, length)));
+		}
+	}
+}
+
+void mtpFileLoader::prioritize(int offset) {
+	if (_finished || offset < 0 || offset >= _size) {
+		return;
+	}
+	const auto aligned = offset - (offset % partSize());
+	if (aligned < _nextRequestOffset
+		|| _prioritizedOffsets.contains(aligned)
+		|| _wantedOffsets.contains(aligned)) {
+		return;
+	}
+	_wantedOffsets.emplace(aligned);
+	startLoading(false, false);
+}
+
+bool mtpFileLoader::loadWantedPart() {
+	while (!_wantedOffsets.empty()) {
+		const auto offset = _wantedOffsets.front();
+		_wantedOffsets.erase(_wantedOffsets.begin());
+		if (offset >= _nextRequestOffset
+			&& !_prioritizedOffsets.contains(offset)) {
+			_prioritizedOffsets.emplace(offset);
+			makeRequest(offset);
+			return true;
+		}
+	}
+	return false;
+}
+
+void mtpFileLoader::skipPrioritizedParts() {
+	while (!_prioritizedOffsets.empty()
+		&& _prioritizedOffsets.front() == _nextRequestOffset) {
+		_prioritizedOffsets.erase(_prioritizedOffsets.begin());
+		_nextRequestOffset += partSize();
+	}
+}
+
 void mtpFileLoader::refreshFileReferenceFrom(
 		const Data::UpdatedFileReferences &data,
 		int requestId,
@@ -622,6 +724,10 @@ void mtpFileLoader::refreshFileReferenceFrom(
 bool mtpFileLoader::loadPart() {
 	if (_finished || _lastComplete || (!_sentRequests.empty() && !_size)) {
 		return false;
+	}
+	skipPrioritizedParts();
+	if (loadWantedPart()) {
+		return true;
 	} else if (_size && _nextRequestOffset >= _size) {
 		return false;
 	}
@@ -971,10 +1077,18 @@ bool mtpFileLoader::feedPart(int offset, bytes::const_span buffer) {
 				bytes::copy(dst, buffer);
 			}
 		}
+		if (_stream) {
+			_stream->feed(offset, bytes::make_vector(buffer));
+		}
 	}
-	if (!buffer.size() || (buffer.size() % 1024)) { // bad next offset
+
+	// A prioritized part may be the short last one, while the parts
+	// before it are still not requested.
+	if ((!buffer.size() || (buffer.size() % 1024)) // bad next offset
+		&& offset < _nextRequestOffset) {
 		_lastComplete = true;
 	}
+	skipPrioritizedParts();
 	if (_sentRequests.empty()
 		&& _cdnUncheckedParts.empty()
 		&& (_lastComplete || (_size && _nextRequestOffset >= _size))) {
@@ -1080,6 +1194,9 @@ void mtpFileLoader::cancelRequests() {
 		MTP::cancel(requestId);
 		finishSentRequestGetOffset(requestId);
 	}
+	if (_stream && !_finished) {
+		_stream->cancel();
+	}
 }
 
 void mtpFileLoader::switchToCDN(
@@ -11,6 +11,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_file_origin.h"
 #include "base/binary_guard.h"
 
+namespace Media {
+namespace Streaming {
+class SparseFile;
+} // namespace Streaming
+} // namespace Media
+
 namespace Storage {
 namespace Cache {
 struct Key;
@@ -105,6 +111,11 @@ public:
 	virtual int32 currentOffset(bool includeSkipped = false) const = 0;
 	int32 fullSize() const;
 
+	// Parts of the file for playing it before the download finishes.
+	virtual std::shared_ptr<Media::Streaming::SparseFile> stream() {
+		return nullptr;
+	}
+
 	bool setFileName(const QString &filename); // set filename for loaders to cache
 	void permitLoadFromCloud();
 
@@ -236,6 +247,11 @@ public:
 
 	int32 currentOffset(bool includeSkipped = false) const override;
 	Data::FileOrigin fileOrigin() const override;
+	std::shared_ptr<Media::Streaming::SparseFile> stream() override;
+
+	// The part with the offset is requested by the next loadPart(),
+	// so it still counts against the queue limits.
+	void prioritize(int offset);
 
 	uint64 objId() const override {
 		return _id;
@@ -281,6 +297,9 @@ private:
 
 	bool feedPart(int offset, bytes::const_span buffer);
 	void partLoaded(int offset, bytes::const_span buffer);
+	void skipPrioritizedParts();
+	bool loadWantedPart();
+	void fillStream();
 
 	bool partFailed(const RPCError &error, mtpRequestId requestId);
 	bool cdnPartFailed(const RPCError &error, mtpRequestId requestId);
@@ -304,6 +323,12 @@ private:
 	int32 _skippedBytes = 0;
 	int32 _nextRequestOffset = 0;
 
+	// Parts after _nextRequestOffset requested out of order.
+	base::flat_set<int> _prioritizedOffsets;
+	base::flat_set<int> _wantedOffsets;
+	std::shared_ptr<Media::Streaming::SparseFile> _stream;
+	rpl::lifetime _streamLifetime;
+
 	MTP::DcId _dcId = 0; // for photo locations
 	StorageImageLocation *_location = nullptr;
 
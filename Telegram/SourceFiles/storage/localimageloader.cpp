@@ -19,6 +19,34 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "boxes/confirm_box.h"
 #include "storage/file_download.h"
 #include "storage/storage_media_prepare.h"
+#include "core/stats.h"
+
+namespace {
+
+// Updated only from the main thread, in TaskQueue::onTaskProcessed().
+int TasksFinished = 0;
+TimeMs TasksProcessSum = 0;
+TimeMs TasksProcessMax = 0;
+TimeMs TasksWaitSum = 0;
+TimeMs TasksWaitMax = 0;
+std::atomic<int> TasksQueued = 0;
+
+const auto StatsRegistered = Core::Stats::Register("tasks", [] {
+	return std::vector<Core::Stats::Row>{ { QString(), {
+		{ "queued", TasksQueued.load() },
+		{ "finished", TasksFinished },
+		{ "average process ms", TasksFinished
+			? (TasksProcessSum / TasksFinished)
+			: 0 },
+		{ "max process ms", TasksProcessMax },
+		{ "average wait ms", TasksFinished
+			? (TasksWaitSum / TasksFinished)
+			: 0 },
+		{ "max wait ms", TasksWaitMax },
+	} } };
+});
+
+} // namespace
 
 using Storage::ValidateThumbDimensions;
 
@@ -82,7 +110,10 @@ SendMediaReady PreparePeerPhoto(PeerId peerId, QImage &&image) {
 		0);
 }
 
-TaskQueue::TaskQueue(TimeMs stopTimeoutMs) {
+TaskQueue::TaskQueue(TimeMs stopTimeoutMs, int threadsCount)
+: _threadsCount((threadsCount > 0)
+	? threadsCount
+	: std::max(QThread::idealThreadCount(), 1)) {
 	if (stopTimeoutMs > 0) {
 		_stopTimer = new QTimer(this);
 		connect(_stopTimer, SIGNAL(timeout()), this, SLOT(stop()));
@@ -94,97 +125,196 @@ TaskQueue::TaskQueue(TimeMs stopTimeoutMs) {
 TaskId TaskQueue::addTask(std::unique_ptr<Task> &&task) {
 	const auto result = task->id();
 	{
-		QMutexLocker lock(&_tasksToProcessMutex);
-		_tasksToProcess.push_back(std::move(task));
+		QMutexLocker lock(&_tasksMutex);
+		pushEntry(std::move(task), getms());
 	}
 
-	wakeThread();
+	wakeThreads();
 
 	return result;
 }
 
 void TaskQueue::addTasks(std::vector<std::unique_ptr<Task>> &&tasks) {
 	{
-		QMutexLocker lock(&_tasksToProcessMutex);
+		QMutexLocker lock(&_tasksMutex);
+		const auto now = getms();
 		for (auto &task : tasks) {
-			_tasksToProcess.push_back(std::move(task));
+			pushEntry(std::move(task), now);
 		}
 	}
 
-	wakeThread();
+	wakeThreads();
 }
 
-void TaskQueue::wakeThread() {
-	if (!_thread) {
-		_thread = new QThread();
+void TaskQueue::pushEntry(std::unique_ptr<Task> &&task, TimeMs added) {
+	auto entry = Entry();
+	entry.id = task->id();
+	entry.key = task->orderKey();
+	entry.task = std::move(task);
+	entry.added = added;
+	_tasks.push_back(std::move(entry));
+	++_waitingCount;
+	++TasksQueued;
+}
 
-		_worker = new TaskQueueWorker(this);
-		_worker->moveToThread(_thread);
+auto TaskQueue::findTaskToFinish() -> std::deque<Entry>::iterator {
+	auto blocked = base::flat_set<uint64>();
+	for (auto i = begin(_tasks); i != end(_tasks); ++i) {
+		if (blocked.contains(i->key)) {
+			continue;
+		} else if (i->state == State::Processed) {
+			return i;
+		}
+		blocked.emplace(i->key);
+	}
+	return end(_tasks);
+}
 
-		connect(this, SIGNAL(taskAdded()), _worker, SLOT(onTaskAdded()));
-		connect(_worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
+void TaskQueue::wakeThreads() {
+	auto needed = 0;
+	{
+		QMutexLocker lock(&_tasksMutex);
+		needed = std::min(_waitingCount, _threadsCount);
+	}
+	while (int(_threads.size()) < needed) {
+		const auto thread = new QThread();
+		const auto worker = new TaskQueueWorker(this);
+		worker->moveToThread(thread);
 
-		_thread->start();
+		connect(this, SIGNAL(taskAdded()), worker, SLOT(onTaskAdded()));
+		connect(worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
+
+		thread->start();
+		_threads.push_back(thread);
+		_workers.push_back(worker);
 	}
 	if (_stopTimer) _stopTimer->stop();
 	emit taskAdded();
 }
 
+std::unique_ptr<Task> TaskQueue::takeTaskToProcess() {
+	QMutexLocker lock(&_tasksMutex);
+	if (!_waitingCount) {
+		return nullptr;
+	}
+	const auto i = ranges::find(_tasks, State::Waiting, &Entry::state);
+	Assert(i != end(_tasks));
+	i->state = State::Processing;
+	--_waitingCount;
+	return std::move(i->task);
+}
+
+bool TaskQueue::taskProcessed(
+		std::unique_ptr<Task> &&task,
+		TimeMs duration) {
+	QMutexLocker lock(&_tasksMutex);
+	const auto i = ranges::find(_tasks, task->id(), &Entry::id);
+	if (i == end(_tasks)) {
+		// The task was cancelled while being processed.
+		lock.unlock();
+		task = nullptr;
+		return false;
+	}
+	i->task = std::move(task);
+	i->state = State::Processed;
+	i->duration = duration;
+
+	// Wake the main thread only when the task is ready to finish.
+	const auto key = i->key;
+	return ranges::find(begin(_tasks), i, key, &Entry::key) == i;
+}
+
 void TaskQueue::cancelTask(TaskId id) {
-	const auto removeFrom = [&](std::deque<std::unique_ptr<Task>> &queue) {
-		const auto proj = [](const std::unique_ptr<Task> &task) {
-			return task->id();
-		};
-		auto i = ranges::find(queue, id, proj);
-		if (i != queue.end()) {
-			queue.erase(i);
-		}
-	};
+	auto removed = std::unique_ptr<Task>();
+	auto unblocked = false;
 	{
-		QMutexLocker lock(&_tasksToProcessMutex);
-		removeFrom(_tasksToProcess);
-		if (_taskInProcessId == id) {
-			_taskInProcessId = TaskId();
+		QMutexLocker lock(&_tasksMutex);
+		const auto i = ranges::find(_tasks, id, &Entry::id);
+		if (i == end(_tasks)) {
+			return;
+		}
+		if (i->state == State::Waiting) {
+			--_waitingCount;
 		}
+		--TasksQueued;
+		removed = std::move(i->task);
+		const auto key = i->key;
+		const auto first = (ranges::find(begin(_tasks), i, key, &Entry::key)
+			== i);
+		const auto next = _tasks.erase(i);
+		const auto j = ranges::find(next, end(_tasks), key, &Entry::key);
+		unblocked = first
+			&& (j != end(_tasks))
+			&& (j->state == State::Processed);
+	}
+	if (unblocked) {
+		QMetaObject::invokeMethod(
+			this,
+			"onTaskProcessed",
+			Qt::QueuedConnection);
 	}
-	QMutexLocker lock(&_tasksToFinishMutex);
-	removeFrom(_tasksToFinish);
 }
 
 void TaskQueue::onTaskProcessed() {
 	do {
 		auto task = std::unique_ptr<Task>();
+		auto waited = TimeMs(0);
+		auto duration = TimeMs(0);
+		auto left = 0;
 		{
-			QMutexLocker lock(&_tasksToFinishMutex);
-			if (_tasksToFinish.empty()) break;
-			task = std::move(_tasksToFinish.front());
-			_tasksToFinish.pop_front();
+			QMutexLocker lock(&_tasksMutex);
+			const auto i = findTaskToFinish();
+			if (i == end(_tasks)) {
+				break;
+			}
+			task = std::move(i->task);
+			waited = getms() - i->added - i->duration;
+			duration = i->duration;
+			_tasks.erase(i);
+			left = int(_tasks.size());
 		}
+		--TasksQueued;
+		++TasksFinished;
+		TasksProcessSum += duration;
+		TasksProcessMax = std::max(TasksProcessMax, duration);
+		TasksWaitSum += waited;
+		TasksWaitMax = std::max(TasksWaitMax, waited);
+		DEBUG_LOG(("Task Queue: processed in %1 ms, waited %2 ms, "
+			"%3 tasks left."
+			).arg(duration
+			).arg(waited
+			).arg(left));
 		task->finish();
 	} while (true);
 
 	if (_stopTimer) {
-		QMutexLocker lock(&_tasksToProcessMutex);
-		if (_tasksToProcess.empty() && !_taskInProcessId) {
+		QMutexLocker lock(&_tasksMutex);
+		if (_tasks.empty()) {
 			_stopTimer->start();
 		}
 	}
 }
 
 void TaskQueue::stop() {
-	if (_thread) {
-		_thread->requestInterruption();
-		_thread->quit();
-		DEBUG_LOG(("Waiting for taskThread to finish"));
-		_thread->wait();
-		delete _worker;
-		delete _thread;
-		_worker = 0;
-		_thread = 0;
-	}
-	_tasksToProcess.clear();
-	_tasksToFinish.clear();
-	_taskInProcessId = TaskId();
+	for (const auto thread : _threads) {
+		thread->requestInterruption();
+		thread->quit();
+	}
+	if (!_threads.empty()) {
+		DEBUG_LOG(("Waiting for taskThreads to finish"));
+	}
+	for (const auto thread : _threads) {
+		thread->wait();
+	}
+	for (const auto worker : base::take(_workers)) {
+		delete worker;
+	}
+	for (const auto thread : base::take(_threads)) {
+		delete thread;
+	}
+	TasksQueued -= int(_tasks.size());
+	_tasks.clear();
+	_waitingCount = 0;
 }
 
 TaskQueue::~TaskQueue() {
@@ -196,38 +326,19 @@ void TaskQueueWorker::onTaskAdded() {
 	if (_inTaskAdded) return;
 	_inTaskAdded = true;
 
-	bool someTasksLeft = false;
-	do {
-		auto task = std::unique_ptr<Task>();
-		{
-			QMutexLocker lock(&_queue->_tasksToProcessMutex);
-			if (!_queue->_tasksToProcess.empty()) {
-				task = std::move(_queue->_tasksToProcess.front());
-				_queue->_tasksToProcess.pop_front();
-				_queue->_taskInProcessId = task->id();
-			}
+	while (!thread()->isInterruptionRequested()) {
+		auto task = _queue->takeTaskToProcess();
+		if (!task) {
+			break;
 		}
-
-		if (task) {
-			task->process();
-			bool emitTaskProcessed = false;
-			{
-				QMutexLocker lockToProcess(&_queue->_tasksToProcessMutex);
-				if (_queue->_taskInProcessId == task->id()) {
-					_queue->_taskInProcessId = TaskId();
-					someTasksLeft = !_queue->_tasksToProcess.empty();
-
-					QMutexLocker lockToFinish(&_queue->_tasksToFinishMutex);
-					emitTaskProcessed = _queue->_tasksToFinish.empty();
-					_queue->_tasksToFinish.push_back(std::move(task));
-				}
-			}
-			if (emitTaskProcessed) {
-				emit taskProcessed();
-			}
+		const auto started = getms();
+		task->process();
+		const auto duration = getms() - started;
+		if (_queue->taskProcessed(std::move(task), duration)) {
+			emit taskProcessed();
 		}
 		QCoreApplication::processEvents();
-	} while (someTasksLeft && !thread()->isInterruptionRequested());
+	}
 
 	_inTaskAdded = false;
 }
@@ -603,22 +714,23 @@ void FileLoadTask::process() {
 			if (isAnimation) {
 				attributes.push_back(MTP_documentAttributeAnimated());
 			} else if (_type != SendMediaType::File) {
-				auto thumb = (w > 100 || h > 100) ? App::pixmapFromImageInPlace(fullimage.scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation)) : QPixmap::fromImage(fullimage);
-				photoThumbs.insert('s', thumb);
-				photoSizes.push_back(MTP_photoSize(MTP_string("s"), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(thumb.width()), MTP_int(thumb.height()), MTP_int(0)));
-
-				auto medium = (w > 320 || h > 320) ? App::pixmapFromImageInPlace(fullimage.scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation)) : QPixmap::fromImage(fullimage);
-				photoThumbs.insert('m', medium);
-				photoSizes.push_back(MTP_photoSize(MTP_string("m"), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(medium.width()), MTP_int(medium.height()), MTP_int(0)));
-
-				auto full = (w > 1280 || h > 1280) ? App::pixmapFromImageInPlace(fullimage.scaled(1280, 1280, Qt::KeepAspectRatio, Qt::SmoothTransformation)) : QPixmap::fromImage(fullimage);
-				photoThumbs.insert('y', full);
-				photoSizes.push_back(MTP_photoSize(MTP_string("y"), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(full.width()), MTP_int(full.height()), MTP_int(0)));
-
+				// Each size is scaled down from the previous one and
+				// the pixmaps are made only after the jpeg is encoded.
+				auto full = Images::DownscaleToFit(fullimage, 1280);
 				{
 					QBuffer buffer(&filedata);
 					full.save(&buffer, "JPG", 87);
 				}
+				auto medium = Images::DownscaleToFit(full, 320);
+				auto thumb = Images::DownscaleToFit(medium, 100);
+
+				const auto push = [&](const char *type, QImage &&image) {
+					photoSizes.push_back(MTP_photoSize(MTP_string(type), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(image.width()), MTP_int(image.height()), MTP_int(0)));
+					photoThumbs.insert(type[0], App::pixmapFromImageInPlace(std::move(image)));
+				};
+				push("s", std::move(thumb));
+				push("m", std::move(medium));
+				push("y", std::move(full));
 
 				photo = MTP_photo(
 					MTP_flags(0),
@@ -728,6 +840,11 @@ void FileLoadTask::finish() {
 	}
 }
 
+uint64 FileLoadTask::orderKey() const {
+	// Files sent to one chat must arrive in the order they were chosen.
+	return uint64(_to.peer);
+}
+
 void FileLoadTask::removeFromAlbum() {
 	if (!_album) {
 		return;
@@ -99,6 +99,12 @@ public:
 	virtual void finish() = 0; // is executed in the same as TaskQueue thread
 	virtual ~Task() = default;
 
+	// Tasks with the same key are finished in the order they were added,
+	// tasks with different keys don't wait for each other.
+	virtual uint64 orderKey() const {
+		return 0;
+	}
+
 	TaskId id() const {
 		return static_cast<TaskId>(const_cast<Task*>(this));
 	}
@@ -110,7 +116,12 @@ class TaskQueue : public QObject {
 	Q_OBJECT
 
 public:
-	explicit TaskQueue(TimeMs stopTimeoutMs = 0); // <= 0 - never stop worker
+	// Tasks are processed in up to threadsCount threads at once
+	// (<= 0 - one thread for each core), but finish() is always called
+	// in the same order the tasks with the same orderKey() were added in.
+	explicit TaskQueue(
+		TimeMs stopTimeoutMs = 0, // <= 0 - never stop workers
+		int threadsCount = 1);
 
 	TaskId addTask(std::unique_ptr<Task> &&task);
 	void addTasks(std::vector<std::unique_ptr<Task>> &&tasks);
@@ -128,14 +139,37 @@ public slots:
 private:
 	friend class TaskQueueWorker;
 
-	void wakeThread();
+	enum class State {
+		Waiting,
+		Processing,
+		Processed,
+	};
+	struct Entry {
+		TaskId id = TaskId();
+		uint64 key = 0;
+		std::unique_ptr<Task> task; // Empty while processing.
+		State state = State::Waiting;
+		TimeMs added = 0;
+		TimeMs duration = 0;
+	};
+
+	void wakeThreads();
+	void pushEntry(std::unique_ptr<Task> &&task, TimeMs added);
+
+	// Returns the first processed entry that has no earlier entries with
+	// the same key. Must be called with _tasksMutex locked.
+	std::deque<Entry>::iterator findTaskToFinish();
+
+	// Called from the worker threads.
+	std::unique_ptr<Task> takeTaskToProcess();
+	bool taskProcessed(std::unique_ptr<Task> &&task, TimeMs duration);
 
-	std::deque<std::unique_ptr<Task>> _tasksToProcess;
-	std::deque<std::unique_ptr<Task>> _tasksToFinish;
-	TaskId _taskInProcessId = TaskId();
-	QMutex _tasksToProcessMutex, _tasksToFinishMutex;
-	QThread *_thread = nullptr;
-	TaskQueueWorker *_worker = nullptr;
+	std::deque<Entry> _tasks;
+	int _waitingCount = 0;
+	QMutex _tasksMutex;
+	int _threadsCount = 1;
+	std::vector<QThread*> _threads;
+	std::vector<TaskQueueWorker*> _workers;
 	QTimer *_stopTimer = nullptr;
 
 };
@@ -299,6 +333,7 @@ public:
 
 	void process();
 	void finish();
+	uint64 orderKey() const;
 
 private:
 	static bool CheckForSong(
@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/serialize_document.h"
 #include "storage/serialize_common.h"
 #include "storage/storage_encrypted_file.h"
+#include "storage/storage_shared_media.h"
 #include "storage/storage_clear_legacy.h"
 #include "chat_helpers/stickers.h"
 #include "data/data_drafts.h"
@@ -24,6 +25,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwindow.h"
 #include "lang/lang_keys.h"
 #include "media/media_audio.h"
+#include "media/media_audio_waveform.h"
 #include "mtproto/dc_options.h"
 #include "messenger.h"
 #include "application.h"
@@ -45,6 +47,8 @@ constexpr auto kThemeFileSizeLimit = 5 * 1024 * 1024;
 constexpr auto kFileLoaderQueueStopTimeout = TimeMs(5000);
 constexpr auto kDefaultStickerInstallDate = TimeId(1);
 constexpr auto kProxyTypeShift = 1024;
+constexpr auto kSharedMediaCountsPeersLimit = 4096;
+constexpr auto kSharedMediaCountsTypesLimit = 64;
 
 constexpr auto kSinglePeerTypeUser = qint32(1);
 constexpr auto kSinglePeerTypeChat = qint32(2);
@@ -515,6 +519,7 @@ enum { // Local Storage Keys
 	lskExportSettings = 0x13, // no data
 	lskBackground = 0x14, // no data
 	lskSelfSerialized = 0x15, // serialized self
+	lskSharedMediaCounts = 0x16, // no data
 };
 
 enum {
@@ -657,6 +662,7 @@ qint64 _cacheTotalSizeLimit = Database::Settings().totalSizeLimit;
 qint32 _cacheTotalTimeLimit = Database::Settings().totalTimeLimit;
 
 FileKey _exportSettingsKey = 0;
+FileKey _sharedMediaCountsKey = 0;
 
 FileKey _savedPeersKey = 0;
 FileKey _langPackKey = 0;
@@ -2142,6 +2148,7 @@ ReadMapState _readMap(const QByteArray &pass) {
 	quint64 savedGifsKey = 0;
 	quint64 backgroundKeyDay = 0, backgroundKeyNight = 0;
 	quint64 userSettingsKey = 0, recentHashtagsAndBotsKey = 0, savedPeersKey = 0, exportSettingsKey = 0;
+	quint64 sharedMediaCountsKey = 0;
 	while (!map.stream.atEnd()) {
 		quint32 keyType;
 		map.stream >> keyType;
@@ -2231,6 +2238,9 @@ ReadMapState _readMap(const QByteArray &pass) {
 		case lskExportSettings: {
 			map.stream >> exportSettingsKey;
 		} break;
+		case lskSharedMediaCounts: {
+			map.stream >> sharedMediaCountsKey;
+		} break;
 		default:
 		LOG(("App Error: unknown key type in encrypted map: %1").arg(keyType));
 		return ReadMapFailed;
@@ -2260,6 +2270,7 @@ ReadMapState _readMap(const QByteArray &pass) {
 	_userSettingsKey = userSettingsKey;
 	_recentHashtagsAndBotsKey = recentHashtagsAndBotsKey;
 	_exportSettingsKey = exportSettingsKey;
+	_sharedMediaCountsKey = sharedMediaCountsKey;
 	_oldMapVersion = mapData.version;
 	if (_oldMapVersion < AppVersion) {
 		_mapChanged = true;
@@ -2360,6 +2371,7 @@ void _writeMap(WriteMapWhen when) {
 	if (_userSettingsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_recentHashtagsAndBotsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_exportSettingsKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_sharedMediaCountsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 
 	EncryptedDescriptor mapData(mapSize);
 	if (!self.isEmpty()) {
@@ -2417,6 +2429,9 @@ void _writeMap(WriteMapWhen when) {
 	if (_exportSettingsKey) {
 		mapData.stream << quint32(lskExportSettings) << quint64(_exportSettingsKey);
 	}
+	if (_sharedMediaCountsKey) {
+		mapData.stream << quint32(lskSharedMediaCounts) << quint64(_sharedMediaCountsKey);
+	}
 	map.writeEncrypted(mapData);
 
 	_mapChanged = false;
@@ -2677,6 +2692,7 @@ void reset() {
 	_backgroundKeyDay = _backgroundKeyNight = 0;
 	Window::Theme::Background()->reset();
 	_userSettingsKey = _recentHashtagsAndBotsKey = _savedPeersKey = _exportSettingsKey = 0;
+	_sharedMediaCountsKey = 0;
 	_oldMapVersion = _oldSettingsVersion = 0;
 	_cacheTotalSizeLimit = Database::Settings().totalSizeLimit;
 	_cacheTotalTimeLimit = Database::Settings().totalTimeLimit;
@@ -2723,6 +2739,7 @@ base::flat_set<QString> CollectGoodNames() {
 		_backgroundKeyDay,
 		_recentHashtagsAndBotsKey,
 		_exportSettingsKey,
+		_sharedMediaCountsKey,
 		_savedPeersKey,
 		_trustedBotsKey
 	};
@@ -3104,6 +3121,13 @@ public:
 			if (!_waveform.isEmpty()) {
 				voice->waveform = _waveform;
 				voice->wavemax = _wavemax;
+				Auth().data().cache().put(
+					_doc->waveformCacheKey(),
+					Database::TaggedValue(
+						QByteArray(
+							reinterpret_cast<const char*>(_waveform.constData()),
+							_waveform.size()),
+						Data::kVoiceMessageCacheTag));
 			}
 			if (voice->waveform.isEmpty()) {
 				voice->waveform.resize(1);
@@ -3131,16 +3155,52 @@ protected:
 
 };
 
+namespace {
+
+void StartCountWaveformTask(not_null<DocumentData*> document) {
+	const auto voice = document->voice();
+	if (!voice || !_localLoader) {
+		return;
+	}
+	voice->waveform.resize(1 + sizeof(TaskId));
+	voice->waveform[0] = -1; // counting
+	TaskId taskId = _localLoader->addTask(
+		std::make_unique<CountWaveformTask>(document));
+	memcpy(voice->waveform.data() + 1, &taskId, sizeof(taskId));
+}
+
+} // namespace
+
 void countVoiceWaveform(DocumentData *document) {
-	if (const auto voice = document->voice()) {
-		if (_localLoader) {
-			voice->waveform.resize(1 + sizeof(TaskId));
-			voice->waveform[0] = -1; // counting
-			TaskId taskId = _localLoader->addTask(
-				std::make_unique<CountWaveformTask>(document));
-			memcpy(voice->waveform.data() + 1, &taskId, sizeof(taskId));
-		}
+	const auto voice = document->voice();
+	if (!voice || !_localLoader) {
+		return;
 	}
+
+	// The waveform is decoded only once, then it is read from the cache.
+	voice->waveform.fill(0, 1 + sizeof(TaskId));
+	voice->waveform[0] = -1; // counting
+	const auto session = &Auth();
+	session->data().cache().get(document->waveformCacheKey(), [=](
+			QByteArray &&value) {
+		crl::on_main(session, [=, value = std::move(value)] {
+			const auto voice = document->voice();
+			if (!voice
+				|| voice->waveform.isEmpty()
+				|| voice->waveform[0] != -1) {
+				return;
+			}
+			auto waveform = VoiceWaveform(value.size());
+			memcpy(waveform.data(), value.constData(), value.size());
+			if (!Media::Audio::ValidateWaveform(waveform)) {
+				StartCountWaveformTask(document);
+				return;
+			}
+			voice->waveform = std::move(waveform);
+			voice->wavemax = *ranges::max_element(voice->waveform);
+			session->data().requestDocumentViewRepaint(document);
+		});
+	});
 }
 
 void cancelTask(TaskId id) {
@@ -4042,6 +4102,10 @@ Window::Theme::Saved readThemeAfterSwitch() {
 	return readThemeUsingKey(key);
 }
 
+QString langPackBinaryPath() {
+	return _basePath + qsl("langpack_binary");
+}
+
 void readLangPack() {
 	FileReadDescriptor langpack;
 	if (!_langPackKey || !readEncryptedFile(langpack, _langPackKey, FileOption::Safe, SettingsKey)) {
@@ -4050,7 +4114,7 @@ void readLangPack() {
 	auto data = QByteArray();
 	langpack.stream >> data;
 	if (langpack.stream.status() == QDataStream::Ok) {
-		Lang::Current().fillFromSerialized(data);
+		Lang::Current().fillFromSerialized(data, langPackBinaryPath());
 	}
 }
 
@@ -4066,6 +4130,8 @@ void writeLangPack() {
 
 	FileWriteDescriptor file(_langPackKey, FileOption::Safe);
 	file.writeEncrypted(data, SettingsKey);
+
+	Lang::Current().writeBinary(langpack, langPackBinaryPath());
 }
 
 bool copyThemeColorsToPalette(const QString &path) {
@@ -4427,6 +4493,92 @@ Export::Settings ReadExportSettings() {
 		: Export::Settings();
 }
 
+void WriteSharedMediaCounts(
+		const std::vector<Storage::SharedMediaCounts> &counts) {
+	if (!_working()) return;
+
+	if (counts.empty()) {
+		if (_sharedMediaCountsKey) {
+			clearKey(_sharedMediaCountsKey);
+			_sharedMediaCountsKey = 0;
+			_mapChanged = true;
+		}
+		_writeMap();
+		return;
+	}
+	if (!_sharedMediaCountsKey) {
+		_sharedMediaCountsKey = genKey();
+		_mapChanged = true;
+		_writeMap(WriteMapWhen::Fast);
+	}
+	// Counts go most recently updated first, so the peers that don't fit
+	// are the ones not seen for the longest time.
+	const auto count = std::min(
+		int(counts.size()),
+		kSharedMediaCountsPeersLimit);
+	quint32 size = sizeof(quint32) * 2
+		+ count * (sizeof(quint64)
+			+ Storage::kSharedMediaTypeCount * sizeof(qint32));
+	EncryptedDescriptor data(size);
+	data.stream
+		<< quint32(Storage::kSharedMediaTypeCount)
+		<< quint32(count);
+	for (const auto &entry : counts | ranges::view::take(count)) {
+		data.stream << quint64(entry.peerId);
+		for (const auto value : entry.counts) {
+			data.stream << qint32(value);
+		}
+	}
+
+	FileWriteDescriptor file(_sharedMediaCountsKey);
+	file.writeEncrypted(data);
+}
+
+std::vector<Storage::SharedMediaCounts> ReadSharedMediaCounts() {
+	if (!_sharedMediaCountsKey) {
+		return {};
+	}
+	FileReadDescriptor file;
+	if (!readEncryptedFile(file, _sharedMediaCountsKey)) {
+		clearKey(_sharedMediaCountsKey);
+		_sharedMediaCountsKey = 0;
+		_writeMap();
+		return {};
+	}
+
+	quint32 typesCount = 0, count = 0;
+	file.stream >> typesCount >> count;
+	if (!_checkStreamStatus(file.stream)
+		|| typesCount > kSharedMediaCountsTypesLimit
+		|| count > kSharedMediaCountsPeersLimit) {
+		return {};
+	}
+	auto result = std::vector<Storage::SharedMediaCounts>();
+	result.reserve(count);
+	for (auto i = 0; i != int(count); ++i) {
+		auto entry = Storage::SharedMediaCounts();
+		ranges::fill(entry.counts, -1);
+
+		quint64 peerId = 0;
+		file.stream >> peerId;
+		entry.peerId = peerId;
+		for (auto index = 0; index != int(typesCount); ++index) {
+			qint32 value = 0;
+			file.stream >> value;
+
+			// Types added in newer versions are skipped.
+			if (index < Storage::kSharedMediaTypeCount) {
+				entry.counts[index] = value;
+			}
+		}
+		result.push_back(entry);
+	}
+	if (!_checkStreamStatus(file.stream)) {
+		return {};
+	}
+	return result;
+}
+
 void writeSavedPeers() {
 	if (!_working()) return;
 
@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Storage {
 class EncryptionKey;
+struct SharedMediaCounts;
 } // namespace Storage
 
 namespace Window {
@@ -150,6 +151,10 @@ void saveRecentSearchHashtags(const QString &text);
 void WriteExportSettings(const Export::Settings &settings);
 Export::Settings ReadExportSettings();
 
+void WriteSharedMediaCounts(
+	const std::vector<Storage::SharedMediaCounts> &counts);
+std::vector<Storage::SharedMediaCounts> ReadSharedMediaCounts();
+
 void addSavedPeer(PeerData *peer, const QDateTime &position);
 void removeSavedPeer(PeerData *peer);
 void readSavedPeers();
@@ -21,6 +21,8 @@ public:
 	void remove(SharedMediaRemoveOne &&query);
 	void remove(SharedMediaRemoveAll &&query);
 	void invalidate(SharedMediaInvalidateBottom &&query);
+	std::vector<SharedMediaCounts> sharedMediaCounts() const;
+	void restore(std::vector<SharedMediaCounts> &&counts);
 	rpl::producer<SharedMediaResult> query(SharedMediaQuery &&query) const;
 	rpl::producer<SharedMediaSliceUpdate> sharedMediaSliceUpdated() const;
 	rpl::producer<SharedMediaRemoveOne> sharedMediaOneRemoved() const;
@@ -79,6 +81,14 @@ void Facade::Impl::invalidate(SharedMediaInvalidateBottom &&query) {
 	_sharedMedia.invalidate(std::move(query));
 }
 
+std::vector<SharedMediaCounts> Facade::Impl::sharedMediaCounts() const {
+	return _sharedMedia.counts();
+}
+
+void Facade::Impl::restore(std::vector<SharedMediaCounts> &&counts) {
+	_sharedMedia.restore(std::move(counts));
+}
+
 rpl::producer<SharedMediaResult> Facade::Impl::query(SharedMediaQuery &&query) const {
 	return _sharedMedia.query(std::move(query));
 }
@@ -199,6 +209,14 @@ void Facade::invalidate(SharedMediaInvalidateBottom &&query) {
 	_impl->invalidate(std::move(query));
 }
 
+std::vector<SharedMediaCounts> Facade::sharedMediaCounts() const {
+	return _impl->sharedMediaCounts();
+}
+
+void Facade::restore(std::vector<SharedMediaCounts> &&counts) {
+	_impl->restore(std::move(counts));
+}
+
 rpl::producer<SharedMediaResult> Facade::query(SharedMediaQuery &&query) const {
 	return _impl->query(std::move(query));
 }
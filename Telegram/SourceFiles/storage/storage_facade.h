@@ -27,6 +27,7 @@ struct SharedMediaInvalidateBottom;
 struct SharedMediaQuery;
 using SharedMediaResult = SparseIdsListResult;
 struct SharedMediaSliceUpdate;
+struct SharedMediaCounts;
 
 struct UserPhotosAddNew;
 struct UserPhotosAddSlice;
@@ -57,6 +58,10 @@ public:
 	void remove(SharedMediaRemoveAll &&query);
 	void invalidate(SharedMediaInvalidateBottom &&query);
 
+	// Counts are persisted in the local storage between launches.
+	std::vector<SharedMediaCounts> sharedMediaCounts() const;
+	void restore(std::vector<SharedMediaCounts> &&counts);
+
 	rpl::producer<SharedMediaResult> query(SharedMediaQuery &&query) const;
 	rpl::producer<SharedMediaSliceUpdate> sharedMediaSliceUpdated() const;
 	rpl::producer<SharedMediaRemoveOne> sharedMediaOneRemoved() const;
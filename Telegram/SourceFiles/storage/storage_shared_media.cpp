@@ -33,9 +33,14 @@ std::map<PeerId, SharedMedia::Lists>::iterator
 	return result;
 }
 
+void SharedMedia::markUpdated(PeerId peer) {
+	_updatedAt[peer] = ++_lastUpdate;
+}
+
 void SharedMedia::add(SharedMediaAddNew &&query) {
 	auto peer = query.peerId;
 	auto peerIt = enforceLists(peer);
+	markUpdated(peer);
 	for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
 		auto type = static_cast<SharedMediaType>(index);
 		if (query.types.test(type)) {
@@ -46,6 +51,7 @@ void SharedMedia::add(SharedMediaAddNew &&query) {
 
 void SharedMedia::add(SharedMediaAddExisting &&query) {
 	auto peerIt = enforceLists(query.peerId);
+	markUpdated(query.peerId);
 	for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
 		auto type = static_cast<SharedMediaType>(index);
 		if (query.types.test(type)) {
@@ -58,6 +64,7 @@ void SharedMedia::add(SharedMediaAddSlice &&query) {
 	Expects(IsValidSharedMediaType(query.type));
 
 	auto peerIt = enforceLists(query.peerId);
+	markUpdated(query.peerId);
 	auto index = static_cast<int>(query.type);
 	peerIt->second[index].addSlice(
 		std::move(query.messageIds),
@@ -68,6 +75,7 @@ void SharedMedia::add(SharedMediaAddSlice &&query) {
 void SharedMedia::remove(SharedMediaRemoveOne &&query) {
 	auto peerIt = _lists.find(query.peerId);
 	if (peerIt != _lists.end()) {
+		markUpdated(query.peerId);
 		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
 			auto type = static_cast<SharedMediaType>(index);
 			if (query.types.test(type)) {
@@ -81,6 +89,7 @@ void SharedMedia::remove(SharedMediaRemoveOne &&query) {
 void SharedMedia::remove(SharedMediaRemoveAll &&query) {
 	auto peerIt = _lists.find(query.peerId);
 	if (peerIt != _lists.end()) {
+		markUpdated(query.peerId);
 		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
 			peerIt->second[index].removeAll();
 		}
@@ -91,6 +100,7 @@ void SharedMedia::remove(SharedMediaRemoveAll &&query) {
 void SharedMedia::invalidate(SharedMediaInvalidateBottom &&query) {
 	auto peerIt = _lists.find(query.peerId);
 	if (peerIt != _lists.end()) {
+		markUpdated(query.peerId);
 		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
 			peerIt->second[index].invalidateBottom();
 		}
@@ -98,6 +108,41 @@ void SharedMedia::invalidate(SharedMediaInvalidateBottom &&query) {
 	}
 }
 
+std::vector<SharedMediaCounts> SharedMedia::counts() const {
+	auto result = std::vector<SharedMediaCounts>();
+	for (const auto &[peerId, lists] : _lists) {
+		auto entry = SharedMediaCounts();
+		entry.peerId = peerId;
+		auto known = false;
+		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
+			const auto count = lists[index].count();
+			entry.counts[index] = count ? *count : -1;
+			known = known || count.has_value();
+		}
+		if (known) {
+			result.push_back(entry);
+		}
+	}
+	const auto updatedAt = [&](const SharedMediaCounts &entry) {
+		const auto i = _updatedAt.find(entry.peerId);
+		return (i != _updatedAt.end()) ? i->second : uint64(0);
+	};
+	ranges::sort(result, ranges::greater(), updatedAt);
+	return result;
+}
+
+void SharedMedia::restore(std::vector<SharedMediaCounts> &&counts) {
+	for (const auto &entry : counts | ranges::view::reverse) {
+		auto peerIt = enforceLists(entry.peerId);
+		markUpdated(entry.peerId);
+		for (auto index = 0; index != kSharedMediaTypeCount; ++index) {
+			if (entry.counts[index] >= 0) {
+				peerIt->second[index].restoreCount(entry.counts[index]);
+			}
+		}
+	}
+}
+
 rpl::producer<SharedMediaResult> SharedMedia::query(SharedMediaQuery &&query) const {
 	Expects(IsValidSharedMediaType(query.key.type));
 	auto peerIt = _lists.find(query.key.peerId);
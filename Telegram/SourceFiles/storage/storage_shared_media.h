@@ -37,6 +37,12 @@ constexpr bool IsValidSharedMediaType(SharedMediaType type) {
 
 using SharedMediaTypesMask = base::enum_mask<SharedMediaType>;
 
+// Known counts of all shared media types of a peer, -1 if unknown.
+struct SharedMediaCounts {
+	PeerId peerId = 0;
+	std::array<int, kSharedMediaTypeCount> counts = { { 0 } };
+};
+
 struct SharedMediaAddNew {
 	SharedMediaAddNew(PeerId peerId, SharedMediaTypesMask types, MsgId messageId)
 		: peerId(peerId), messageId(messageId), types(types) {
@@ -190,6 +196,10 @@ public:
 	void remove(SharedMediaRemoveAll &&query);
 	void invalidate(SharedMediaInvalidateBottom &&query);
 
+	// Most recently updated peers go first.
+	std::vector<SharedMediaCounts> counts() const;
+	void restore(std::vector<SharedMediaCounts> &&counts);
+
 	rpl::producer<SharedMediaResult> query(SharedMediaQuery &&query) const;
 	rpl::producer<SharedMediaSliceUpdate> sliceUpdated() const;
 	rpl::producer<SharedMediaRemoveOne> oneRemoved() const;
@@ -200,8 +210,11 @@ private:
 	using Lists = std::array<SparseIdsList, kSharedMediaTypeCount>;
 
 	std::map<PeerId, Lists>::iterator enforceLists(PeerId peer);
+	void markUpdated(PeerId peer);
 
 	std::map<PeerId, Lists> _lists;
+	base::flat_map<PeerId, uint64> _updatedAt;
+	uint64 _lastUpdate = 0;
 
 	rpl::event_stream<SharedMediaSliceUpdate> _sliceUpdated;
 	rpl::event_stream<SharedMediaRemoveOne> _oneRemoved;
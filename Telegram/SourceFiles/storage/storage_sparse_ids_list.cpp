@@ -105,15 +105,24 @@ void SparseIdsList::addRange(
 		noSkipRange);
 	if (count) {
 		_count = count;
+		_countRestored = false;
 	} else if (incrementCount && _count && result > 0) {
-		*_count += result;
+		if (_countRestored) {
+			// The restored count is trusted only until the list changes.
+			_count = std::nullopt;
+			_countRestored = false;
+		} else {
+			*_count += result;
+		}
 	}
 	if (_slices.size() == 1) {
 		if (_slices.front().range == MsgRange { 0, ServerMaxMsgId }) {
 			_count = _slices.front().messages.size();
+			_countRestored = false;
 		}
 	}
 	update.count = _count;
+	update.countRestored = _countRestored;
 	_sliceUpdated.fire(std::move(update));
 }
 
@@ -147,7 +156,7 @@ void SparseIdsList::removeOne(MsgId messageId) {
 			return slice.messages.remove(messageId);
 		});
 	}
-	if (_count) {
+	if (_count && *_count > 0) {
 		--*_count;
 	}
 }
@@ -156,6 +165,7 @@ void SparseIdsList::removeAll() {
 	_slices.clear();
 	_slices.emplace(base::flat_set<MsgId>{}, MsgRange { 0, ServerMaxMsgId });
 	_count = 0;
+	_countRestored = false;
 }
 
 void SparseIdsList::invalidateBottom() {
@@ -170,6 +180,16 @@ void SparseIdsList::invalidateBottom() {
 		}
 	}
 	_count = std::nullopt;
+	_countRestored = false;
+}
+
+void SparseIdsList::restoreCount(int count) {
+	Expects(count >= 0);
+
+	if (!_count) {
+		_count = count;
+		_countRestored = true;
+	}
 }
 
 rpl::producer<SparseIdsListResult> SparseIdsList::query(
@@ -188,6 +208,7 @@ rpl::producer<SparseIdsListResult> SparseIdsList::query(
 		} else if (_count) {
 			auto result = SparseIdsListResult {};
 			result.count = _count;
+			result.countRestored = _countRestored;
 			consumer.put_next(std::move(result));
 		}
 		consumer.put_done();
@@ -218,6 +239,7 @@ SparseIdsListResult SparseIdsList::queryFromSlice(
 	}
 	if (_count) {
 		result.count = _count;
+		result.countRestored = _countRestored;
 		if (!result.skippedBefore && result.skippedAfter) {
 			result.skippedBefore = *result.count
 				- *result.skippedAfter
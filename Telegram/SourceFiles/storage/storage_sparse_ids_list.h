@@ -27,6 +27,7 @@ struct SparseIdsListQuery {
 
 struct SparseIdsListResult {
 	std::optional<int> count;
+	bool countRestored = false; // Read from the local cache, unconfirmed.
 	std::optional<int> skippedBefore;
 	std::optional<int> skippedAfter;
 	base::flat_set<MsgId> messageIds;
@@ -36,6 +37,7 @@ struct SparseIdsSliceUpdate {
 	const base::flat_set<MsgId> *messages = nullptr;
 	MsgRange range;
 	std::optional<int> count;
+	bool countRestored = false; // Read from the local cache, unconfirmed.
 };
 
 class SparseIdsList {
@@ -52,6 +54,16 @@ public:
 	rpl::producer<SparseIdsListResult> query(SparseIdsListQuery &&query) const;
 	rpl::producer<SparseIdsSliceUpdate> sliceUpdated() const;
 
+	std::optional<int> count() const {
+		return _count;
+	}
+
+	// A count read from the local cache, ignored if we already know one.
+	// It is kept up to date by addNew() / removeOne() / invalidateBottom(),
+	// but stays unconfirmed until a slice with a count is received
+	// from the server, so viewers still request the actual one.
+	void restoreCount(int count);
+
 private:
 	struct Slice {
 		Slice(base::flat_set<MsgId> &&messages, MsgRange range);
@@ -92,6 +104,7 @@ private:
 		const Slice &slice) const;
 
 	std::optional<int> _count;
+	bool _countRestored = false;
 	base::flat_set<Slice> _slices;
 
 	rpl::event_stream<SparseIdsSliceUpdate> _sliceUpdated;
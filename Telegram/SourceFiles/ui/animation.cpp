@@ -8,6 +8,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "animation.h"
 
 #include "media/media_clip_reader.h"
+#include "ui/paint_profiler.h"
+#include "core/stats.h"
+
+#include <QtGui/QScreen>
 
 namespace Media {
 namespace Clip {
@@ -26,9 +30,30 @@ ReaderPointer::~ReaderPointer() {
 
 namespace {
 
+constexpr auto kMinFrameRate = 30.;
+constexpr auto kDefaultFrameRate = 60.;
+
 AnimationManager *_manager = nullptr;
 bool AnimationsDisabled = false;
 
+float64 FrameDuration() {
+	const auto screen = QGuiApplication::primaryScreen();
+	const auto rate = screen ? screen->refreshRate() : kDefaultFrameRate;
+	const auto duration = 1000. / std::max(rate, kMinFrameRate);
+	return std::max(duration, float64(AnimationTimerDelta));
+}
+
+const auto StatsRegistered = Core::Stats::Register("animation", [] {
+	if (!_manager) {
+		return std::vector<Core::Stats::Row>();
+	}
+	const auto &stats = _manager->frameStats();
+	return std::vector<Core::Stats::Row>{ { QString(), {
+		{ "frames", stats.produced },
+		{ "skipped refreshes", stats.skipped },
+	} } };
+});
+
 } // namespace
 
 namespace anim {
@@ -155,9 +180,7 @@ void BasicAnimation::stop() {
 	_manager->stop(this);
 }
 
-AnimationManager::AnimationManager() : _timer(this) {
-	_timer.setSingleShot(false);
-	connect(&_timer, &QTimer::timeout, this, &AnimationManager::step);
+AnimationManager::AnimationManager() : _timer([=] { frame(); }) {
 }
 
 void AnimationManager::start(BasicAnimation *obj) {
@@ -167,10 +190,8 @@ void AnimationManager::start(BasicAnimation *obj) {
 			_stopping.erase(obj);
 		}
 	} else {
-		if (_objects.empty()) {
-			_timer.start(AnimationTimerDelta);
-		}
 		_objects.insert(obj);
+		scheduleFrame();
 	}
 }
 
@@ -184,8 +205,8 @@ void AnimationManager::stop(BasicAnimation *obj) {
 		auto i = _objects.find(obj);
 		if (i != _objects.cend()) {
 			_objects.erase(i);
-			if (_objects.empty()) {
-				_timer.stop();
+			if (idle()) {
+				stopFrames();
 			}
 		}
 	}
@@ -221,8 +242,69 @@ void AnimationManager::step() {
 		}
 		_stopping.clear();
 	}
-	if (_objects.empty()) {
-		_timer.stop();
+	if (idle()) {
+		stopFrames();
+	}
+}
+
+const anim::FrameStats &AnimationManager::frameStats() const {
+	return _frameStats;
+}
+
+bool AnimationManager::idle() const {
+	return _objects.empty() && _clipRepaints.empty();
+}
+
+void AnimationManager::frame() {
+	const auto now = getms();
+	const auto index = int64((now - _framesOrigin) / _frameDuration);
+	if (_lastFrame >= 0 && index > _lastFrame + 1) {
+		const auto skipped = int(index - _lastFrame - 1);
+		_frameStats.skipped += skipped;
+		Ui::PaintProfiler::Count("skipped refreshes", skipped);
+	}
+	_lastFrame = std::max(index, _lastFrame);
+	++_frameStats.produced;
+	Ui::PaintProfiler::Count("animation frames");
+
+	flushClipRepaints();
+	step();
+	scheduleFrame();
+}
+
+void AnimationManager::stopFrames() {
+	_timer.cancel();
+	_lastFrame = -1;
+}
+
+void AnimationManager::scheduleFrame() {
+	if (idle()) {
+		stopFrames();
+		return;
+	} else if (_timer.isActive()) {
+		return;
+	}
+	const auto now = getms();
+	if (_lastFrame < 0) {
+		// Waking up, start counting frames from now.
+		_frameDuration = FrameDuration();
+		_framesOrigin = now;
+		_lastFrame = 0;
+	}
+	const auto index = std::max(
+		int64((now - _framesOrigin) / _frameDuration) + 1,
+		_lastFrame + 1);
+	const auto when = _framesOrigin
+		+ TimeMs(std::ceil(index * _frameDuration));
+	_timer.callOnce(std::max(when - now, TimeMs(0)), Qt::PreciseTimer);
+}
+
+void AnimationManager::flushClipRepaints() {
+	for (const auto &[reader, threadIndex] : base::take(_clipRepaints)) {
+		Media::Clip::Reader::callback(
+			reader,
+			threadIndex,
+			Media::Clip::NotificationRepaint);
 	}
 }
 
@@ -230,9 +312,19 @@ void AnimationManager::clipCallback(
 		Media::Clip::Reader *reader,
 		qint32 threadIndex,
 		qint32 notification) {
-	Media::Clip::Reader::callback(
-		reader,
-		threadIndex,
-		Media::Clip::Notification(notification));
+	if (notification != Media::Clip::NotificationRepaint) {
+		Media::Clip::Reader::callback(
+			reader,
+			threadIndex,
+			Media::Clip::Notification(notification));
+		return;
+	}
+
+	// Repaint the clip together with the next animations frame.
+	const auto key = std::make_pair(reader, threadIndex);
+	if (ranges::find(_clipRepaints, key) == end(_clipRepaints)) {
+		_clipRepaints.push_back(key);
+	}
+	scheduleFrame();
 }
 
@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtGui/QColor>
 #include "base/binary_guard.h"
 #include "base/flat_set.h"
+#include "base/timer.h"
 
 namespace Media {
 namespace Clip {
@@ -165,6 +166,12 @@ void startManager();
 void stopManager();
 void registerClipManager(not_null<Media::Clip::Manager*> manager);
 
+// Reported in the "animation" section of Core::Stats.
+struct FrameStats {
+	int64 produced = 0;
+	int64 skipped = 0; // Display refreshes missed between two frames.
+};
+
 TG_FORCE_INLINE int interpolate(int a, int b, float64 b_ratio) {
 	return qRound(a + float64(b - a) * b_ratio);
 }
@@ -700,6 +707,10 @@ private:
 
 };
 
+// All animation steps and clip repaints are done together in frames,
+// following the refresh rate of the primary screen. Qt merges widget
+// updates made in one frame into one repaint of each window. Without
+// running animations and clip repaints no timer is active at all.
 class AnimationManager : public QObject {
 public:
 	AnimationManager();
@@ -710,14 +721,26 @@ public:
 	void registerClip(not_null<Media::Clip::Manager*> clip);
 	void step();
 
+	const anim::FrameStats &frameStats() const;
+
 private:
 	void clipCallback(
 		Media::Clip::Reader *reader,
 		qint32 threadIndex,
 		qint32 notification);
+	void frame();
+	void scheduleFrame();
+	void stopFrames();
+	void flushClipRepaints();
+	bool idle() const;
 
 	base::flat_set<BasicAnimation*> _objects, _starting, _stopping;
-	QTimer _timer;
+	std::vector<std::pair<Media::Clip::Reader*, qint32>> _clipRepaints;
+	base::Timer _timer;
+	TimeMs _framesOrigin = 0;
+	float64 _frameDuration = 0.;
+	int64 _lastFrame = -1;
+	anim::FrameStats _frameStats;
 	bool _iterating = false;
 
 };
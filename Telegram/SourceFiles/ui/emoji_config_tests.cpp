@@ -0,0 +1,133 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "emoji_find_reference.h"
+
+#include <chrono>
+
+namespace {
+
+constexpr auto kBenchmarkIterations = 200;
+constexpr auto kPostfix = QChar(0xFE0F);
+
+using Finder = int(*)(const QChar*, const QChar*, int*);
+
+using namespace Ui::Emoji::internal::reference;
+
+const std::vector<QString> &Corpus() {
+	static const auto result = std::vector<QString>{
+		QString::fromUtf8("Hello everyone! Meeting moved to 10:30, see you there :)"),
+		QString::fromUtf8("Привет! Как дела? Завтра в 9 у входа \xF0\x9F\x98\x8A"),
+		QString::fromUtf8("\xE4\xBD\xA0\xE5\xA5\xBD\xEF\xBC\x8C\xE6\x98\x8E\xE5\xA4\xA9\xE8\xA7\x81 \xF0\x9F\x91\x8B\xF0\x9F\x8F\xBD"),
+		QString::fromUtf8("\xD9\x85\xD8\xB1\xD8\xAD\xD8\xA8\xD8\xA7 \xD8\xA8\xD9\x83\xD9\x85 \xE2\x9D\xA4\xEF\xB8\x8F \xF0\x9F\x87\xAA\xF0\x9F\x87\xAC"),
+		QString::fromUtf8("#1 *2 3\xEF\xB8\x8F\xE2\x83\xA3 \xC2\xA9 2018 \xE2\x84\xA2 \xE2\x86\x94\xEF\xB8\x8F ok"),
+		QString::fromUtf8("\xF0\x9F\x91\xA8\xE2\x80\x8D\xF0\x9F\x91\xA9\xE2\x80\x8D\xF0\x9F\x91\xA7\xE2\x80\x8D\xF0\x9F\x91\xA6 family \xF0\x9F\x8F\xB3\xEF\xB8\x8F\xE2\x80\x8D\xF0\x9F\x8C\x88"),
+		QString::fromUtf8("https://telegram.org/blog and @durov #news \xF0\x9F\x94\xA5\xF0\x9F\x94\xA5\xF0\x9F\x94\xA5"),
+	};
+	return result;
+}
+
+auto Walk(Finder finder, const QString &text) {
+	auto result = std::vector<std::pair<int, int>>();
+	const auto end = text.constEnd();
+	for (auto ch = text.constBegin(); ch != end;) {
+		auto length = 0;
+		const auto index = finder(ch, end, &length);
+		result.emplace_back(index, index ? length : 0);
+		ch += index ? length : 1;
+	}
+	return result;
+}
+
+void RequireSame(Finder table, Finder tree, const QString &text) {
+	auto tableLength = 0;
+	auto treeLength = 0;
+	const auto tableIndex = table(
+		text.constBegin(),
+		text.constEnd(),
+		&tableLength);
+	const auto treeIndex = tree(
+		text.constBegin(),
+		text.constEnd(),
+		&treeLength);
+	REQUIRE(tableIndex == treeIndex);
+	if (tableIndex) {
+		REQUIRE(tableLength == treeLength);
+	}
+}
+
+void RequireSameForKeys(
+		Finder table,
+		Finder tree,
+		const std::vector<QString> &keys,
+		bool postfixes) {
+	REQUIRE(!keys.empty());
+
+	auto all = QString();
+	for (const auto &key : keys) {
+		RequireSame(table, tree, key);
+		RequireSame(table, tree, key + 'a');
+		RequireSame(table, tree, key.mid(0, key.size() - 1));
+		if (postfixes) {
+			auto postfixed = QString();
+			for (const auto ch : key) {
+				postfixed.append(ch).append(kPostfix);
+			}
+			RequireSame(table, tree, postfixed);
+		}
+		all.append(key);
+	}
+	REQUIRE(Walk(table, all) == Walk(tree, all));
+}
+
+std::chrono::microseconds Measure(Finder finder) {
+	const auto start = std::chrono::steady_clock::now();
+	auto found = 0;
+	for (auto i = 0; i != kBenchmarkIterations; ++i) {
+		for (const auto &text : Corpus()) {
+			for (const auto &[index, length] : Walk(finder, text)) {
+				found += index ? 1 : 0;
+			}
+		}
+	}
+	REQUIRE(found > 0);
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start);
+}
+
+} // namespace
+
+TEST_CASE("emoji table matcher agrees with the switch tree", "[emoji]") {
+	SECTION("every emoji is found the same way") {
+		RequireSameForKeys(FindTable, FindTree, FindKeys(), true);
+	}
+
+	SECTION("every replacement is found the same way") {
+		RequireSameForKeys(
+			FindReplaceTable,
+			FindReplaceTree,
+			FindReplaceKeys(),
+			false);
+	}
+
+	SECTION("mixed language messages are split the same way") {
+		for (const auto &text : Corpus()) {
+			REQUIRE(Walk(FindTable, text) == Walk(FindTree, text));
+			REQUIRE(Walk(FindReplaceTable, text)
+				== Walk(FindReplaceTree, text));
+		}
+	}
+
+	SECTION("benchmark") {
+		const auto tree = Measure(FindTree);
+		const auto table = Measure(FindTable);
+		WARN("emoji tree: " << tree.count() << "us, "
+			<< "table: " << table.count() << "us");
+	}
+}
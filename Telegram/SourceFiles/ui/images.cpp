@@ -7,6 +7,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "ui/images.h"
 
+#include "ui/paint_profiler.h"
+#include "core/stats.h"
 #include "mainwidget.h"
 #include "storage/localstorage.h"
 #include "storage/cache/storage_cache_database.h"
@@ -48,8 +50,73 @@ const QPixmap &circleMask(int width, int height) {
 	return i.value();
 }
 
+// Each output pixel is the average of a 2x2 block, the odd last
+// row and column are dropped. Two channels are summed at once.
+QImage HalveImage(const QImage &image) {
+	Expects(image.format() == QImage::Format_ARGB32_Premultiplied
+		|| image.format() == QImage::Format_RGB32);
+
+	const auto width = image.width() / 2;
+	const auto height = image.height() / 2;
+	auto result = QImage(width, height, image.format());
+	for (auto y = 0; y != height; ++y) {
+		const auto top = reinterpret_cast<const uint32*>(
+			image.constScanLine(y * 2));
+		const auto bottom = reinterpret_cast<const uint32*>(
+			image.constScanLine(y * 2 + 1));
+		const auto to = reinterpret_cast<uint32*>(result.scanLine(y));
+		for (auto x = 0; x != width; ++x) {
+			const auto a = top[x * 2];
+			const auto b = top[x * 2 + 1];
+			const auto c = bottom[x * 2];
+			const auto d = bottom[x * 2 + 1];
+			const auto rb = (a & 0x00FF00FFU)
+				+ (b & 0x00FF00FFU)
+				+ (c & 0x00FF00FFU)
+				+ (d & 0x00FF00FFU)
+				+ 0x00020002U;
+			const auto ag = ((a >> 8) & 0x00FF00FFU)
+				+ ((b >> 8) & 0x00FF00FFU)
+				+ ((c >> 8) & 0x00FF00FFU)
+				+ ((d >> 8) & 0x00FF00FFU)
+				+ 0x00020002U;
+			to[x] = ((rb >> 2) & 0x00FF00FFU)
+				| (((ag >> 2) & 0x00FF00FFU) << 8);
+		}
+	}
+	return result;
+}
+
 } // namespace
 
+QImage DownscaleToFit(const QImage &image, int size) {
+	Expects(size > 0);
+
+	const auto target = image.size().scaled(size, size, Qt::KeepAspectRatio);
+	if (target.width() >= image.width() || target.height() >= image.height()) {
+		return image;
+	}
+	auto result = image;
+	if (result.format() != QImage::Format_ARGB32_Premultiplied
+		&& result.format() != QImage::Format_RGB32) {
+		const auto format = result.hasAlphaChannel()
+			? QImage::Format_ARGB32_Premultiplied
+			: QImage::Format_RGB32;
+		result = std::move(result).convertToFormat(format);
+	}
+	while (result.width() >= target.width() * 2
+		&& result.height() >= target.height() * 2) {
+		result = HalveImage(result);
+	}
+	if (result.size() != target) {
+		result = result.scaled(
+			target,
+			Qt::IgnoreAspectRatio,
+			Qt::SmoothTransformation);
+	}
+	return result;
+}
+
 QPixmap PixmapFast(QImage &&image) {
 	Expects(image.format() == QImage::Format_ARGB32_Premultiplied
 		|| image.format() == QImage::Format_RGB32);
@@ -397,6 +464,63 @@ GeoPointImages geoPointImages;
 
 int64 globalAcquiredSize = 0;
 
+// Forgotten images are painted from this small copy while decoding.
+constexpr auto kPlaceholderSize = 32;
+
+std::atomic<int> decodesQueued = 0;
+std::atomic<int> decodesFinished = 0;
+std::atomic<TimeMs> decodeLatency = 0;
+std::atomic<TimeMs> decodeLatencyMax = 0;
+
+void DecodeFinished(TimeMs requested) {
+	const auto latency = getms() - requested;
+	decodeLatency = latency;
+	auto max = decodeLatencyMax.load();
+	while (latency > max
+		&& !decodeLatencyMax.compare_exchange_weak(max, latency)) {
+	}
+	++decodesFinished;
+	--decodesQueued;
+}
+
+// Forgotten images are decoded again on the worker threads.
+const auto StatsRegistered = Core::Stats::Register("images", [] {
+	return std::vector<Core::Stats::Row>{ { QString(), {
+		{ "decodes queued", decodesQueued.load() },
+		{ "decoded", decodesFinished.load() },
+		{ "last latency ms", decodeLatency.load() },
+		{ "max latency ms", decodeLatencyMax.load() },
+	} } };
+});
+
+QImage DecodeImage(QByteArray bytes, const QByteArray &format) {
+	QBuffer buffer(&bytes);
+	QImageReader reader(&buffer, format);
+#ifndef OS_MAC_OLD
+	reader.setAutoTransform(true);
+#endif // OS_MAC_OLD
+	auto result = reader.read();
+	if (result.isNull()
+		|| result.format() == QImage::Format_ARGB32_Premultiplied
+		|| result.format() == QImage::Format_RGB32) {
+		return result;
+	}
+	const auto target = result.hasAlphaChannel()
+		? QImage::Format_ARGB32_Premultiplied
+		: QImage::Format_RGB32;
+	return std::move(result).convertToFormat(target);
+}
+
+QByteArray EncodeImage(const QImage &image, const QByteArray &format) {
+	auto result = QByteArray();
+	QBuffer buffer(&result);
+	return image.save(&buffer, format.constData()) ? result : QByteArray();
+}
+
+int64 ImageSize(const QImage &image) {
+	return int64(image.width()) * image.height() * 4;
+}
+
 uint64 PixKey(int width, int height, Images::Options options) {
 	return static_cast<uint64>(width) | (static_cast<uint64>(height) << 24) | (static_cast<uint64>(options) << 48);
 }
@@ -789,10 +913,20 @@ QPixmap Image::pixNoCache(
 		int outerw,
 		int outerh,
 		const style::color *colored) const {
+	Ui::PaintProfiler::Count("image prepares");
 	if (!loading()) const_cast<Image*>(this)->load(origin);
 	restore();
 
-	if (_data.isNull()) {
+	if (_data.isNull() && !_placeholder.isNull()) {
+		return Images::pixmap(
+			_placeholder,
+			w,
+			h,
+			options | Images::Option::Blurred | Images::Option::Smooth,
+			outerw,
+			outerh,
+			colored);
+	} else if (_data.isNull()) {
 		if (h <= 0 && height() > 0) {
 			h = qRound(width() * w / float64(height()));
 		}
@@ -881,44 +1015,145 @@ QPixmap Image::pixBlurredColoredNoCache(
 	return App::pixmapFromImageInPlace(Images::prepareColored(add, img));
 }
 
+QImage Image::original() const {
+	checkload();
+	restoreNow();
+	return _data.toImage();
+}
+
 void Image::forget() const {
 	if (_forgot) return;
 
 	checkload();
 	if (_data.isNull()) return;
 
-	invalidateSizeCache();
-	/*if (hasLocalCopy()) {
-		_saved.clear();
-	} else */if (_saved.isEmpty()) {
-		QBuffer buffer(&_saved);
-		if (!_data.save(&buffer, _format)) {
-			if (_data.save(&buffer, "PNG")) {
-				_format = "PNG";
-			} else {
+	if (!_saved.isEmpty()) {
+		forgetData();
+		return;
+	} else if (_encoding.alive()) {
+		return;
+	}
+
+	// Encoding takes as long as decoding, so the image is encoded on
+	// a worker thread and forgotten when the bytes are ready.
+	auto [first, second] = base::make_binary_guard();
+	_encoding = std::move(first);
+	crl::async([
+		=,
+		image = _data.toImage(),
+		format = _format,
+		guard = std::move(second)
+	]() mutable {
+		auto bytes = EncodeImage(image, format);
+		if (bytes.isEmpty()) {
+			format = "PNG";
+			bytes = EncodeImage(image, format);
+		}
+		crl::on_main([
+			=,
+			bytes = std::move(bytes),
+			format = std::move(format),
+			guard = std::move(guard)
+		]() mutable {
+			if (!guard.alive()) {
 				return;
 			}
-		}
+			encoded(std::move(bytes), std::move(format));
+		});
+	});
+}
+
+void Image::encoded(QByteArray &&bytes, QByteArray &&format) const {
+	if (_forgot || !_saved.isEmpty() || _data.isNull() || bytes.isEmpty()) {
+		return;
 	}
+	_saved = std::move(bytes);
+	_format = std::move(format);
+	forgetData();
+}
+
+void Image::forgetData() const {
+	Expects(!_data.isNull());
+
+	invalidateSizeCache();
+	_placeholder = _data.scaled(
+		kPlaceholderSize,
+		kPlaceholderSize,
+		Qt::KeepAspectRatio,
+		Qt::FastTransformation).toImage();
+	globalAcquiredSize += ImageSize(_placeholder);
+	_forgotSize = _data.size();
 	globalAcquiredSize -= int64(_data.width()) * _data.height() * 4;
 	_data = QPixmap();
 	_forgot = true;
 }
 
 void Image::restore() const {
-	if (!_forgot) return;
+	if (!_forgot || _restoring.alive()) return;
+
+	Ui::PaintProfiler::Count("image restores");
+
+	auto [first, second] = base::make_binary_guard();
+	_restoring = std::move(first);
+	++decodesQueued;
+	crl::async([
+		=,
+		bytes = _saved,
+		format = _format,
+		requested = getms(),
+		guard = std::move(second)
+	]() mutable {
+		auto image = DecodeImage(std::move(bytes), format);
+		DecodeFinished(requested);
+		crl::on_main([
+			=,
+			image = std::move(image),
+			guard = std::move(guard)
+		]() mutable {
+			if (!guard.alive()) {
+				return;
+			}
+			restored(std::move(image));
+		});
+	});
+}
 
-	QBuffer buffer(&_saved);
-	QImageReader reader(&buffer, _format);
-#ifndef OS_MAC_OLD
-	reader.setAutoTransform(true);
-#endif // OS_MAC_OLD
-	_data = QPixmap::fromImageReader(&reader, Qt::ColorOnly);
+void Image::restoreNow() const {
+	if (!_forgot) {
+		return;
+	}
+	// A decode already queued is dropped by the restored() guard kill.
+	restored(DecodeImage(_saved, _format));
+}
 
+void Image::restored(QImage &&image) const {
+	if (!_forgot) {
+		return;
+	}
+	cancelRestore();
+	_data = image.isNull()
+		? QPixmap()
+		: Images::PixmapFast(std::move(image));
 	if (!_data.isNull()) {
 		globalAcquiredSize += int64(_data.width()) * _data.height() * 4;
 	}
 	_forgot = false;
+
+	// The sizes were prepared from the placeholder.
+	invalidateSizeCache();
+	if (AuthSession::Exists()) {
+		Auth().downloaderTaskFinished().notify();
+	}
+}
+
+void Image::cancelRestore() const {
+	_restoring.kill();
+	_encoding.kill();
+	if (!_placeholder.isNull()) {
+		globalAcquiredSize -= ImageSize(_placeholder);
+		_placeholder = QImage();
+	}
+	_forgotSize = QSize();
 }
 
 std::optional<Storage::Cache::Key> Image::cacheKey() const {
@@ -936,6 +1171,7 @@ void Image::invalidateSizeCache() const {
 
 Image::~Image() {
 	invalidateSizeCache();
+	cancelRestore();
 	if (!_data.isNull()) {
 		globalAcquiredSize -= int64(_data.width()) * _data.height() * 4;
 	}
@@ -990,6 +1226,7 @@ void RemoteImage::doCheckload() const {
 
 	destroyLoaderDelayed();
 
+	cancelRestore();
 	_forgot = false;
 }
 
@@ -1025,6 +1262,7 @@ void RemoteImage::setImageBytes(
 	}
 	_saved = bytes;
 	_format = fmt;
+	cancelRestore();
 	_forgot = false;
 
 	const auto location = this->location();
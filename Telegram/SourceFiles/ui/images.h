@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "base/flags.h"
+#include "base/binary_guard.h"
 #include "data/data_file_origin.h"
 
 namespace Storage {
@@ -27,6 +28,11 @@ namespace Images {
 
 QPixmap PixmapFast(QImage &&image);
 
+// Scales the image down to fit in a size x size square.
+// Large reductions are done by repeated 2x2 box filter halving
+// and only the last step uses the smooth transformation.
+QImage DownscaleToFit(const QImage &image, int size);
+
 QImage prepareBlur(QImage image);
 void prepareRound(
 	QImage &image,
@@ -410,6 +416,16 @@ public:
 
 	bool isNull() const;
 
+	// The full size image for saving, copying and viewing. Unlike pix*()
+	// it never gives a placeholder: a forgotten image is decoded here.
+	QImage original() const;
+
+	// False while a forgotten image is decoded, until then pix*() are
+	// prepared from a blurred placeholder and shouldn't be kept.
+	bool decoded() const {
+		return !_forgot;
+	}
+
 	void forget() const;
 
 	QByteArray savedFormat() const {
@@ -432,19 +448,20 @@ protected:
 	Image(QByteArray format = "PNG") : _format(format) {
 	}
 
+	// Starts decoding the saved bytes of the forgotten image, it is
+	// painted from a blurred placeholder until the decoding finishes.
 	void restore() const;
 	virtual void checkload() const {
 	}
 	void invalidateSizeCache() const;
+	void cancelRestore() const;
 
 	virtual int32 countWidth() const {
-		restore();
-		return _data.width();
+		return _forgot ? _forgotSize.width() : _data.width();
 	}
 
 	virtual int32 countHeight() const {
-		restore();
-		return _data.height();
+		return _forgot ? _forgotSize.height() : _data.height();
 	}
 
 	mutable QByteArray _saved, _format;
@@ -452,9 +469,19 @@ protected:
 	mutable QPixmap _data;
 
 private:
+	void forgetData() const;
+	void restoreNow() const;
+	void restored(QImage &&image) const;
+	void encoded(QByteArray &&bytes, QByteArray &&format) const;
+
 	using Sizes = QMap<uint64, QPixmap>;
 	mutable Sizes _sizesCache;
 
+	mutable QSize _forgotSize;
+	mutable QImage _placeholder;
+	mutable base::binary_guard _restoring;
+	mutable base::binary_guard _encoding;
+
 };
 
 typedef QPair<uint64, uint64> StorageKey;
@@ -0,0 +1,129 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/benchmark.h"
+
+#include "ui/images.h"
+
+namespace {
+
+constexpr auto kPhotoWidth = 1280;
+constexpr auto kPhotoHeight = 960;
+constexpr auto kThumbnailSize = 90;
+constexpr auto kThumbnailsCount = 50;
+constexpr auto kResizeFrom = 320;
+constexpr auto kResizeTill = 640;
+constexpr auto kResizeStep = 16;
+constexpr auto kCameraWidth = 4032;
+constexpr auto kCameraHeight = 3024;
+constexpr auto kJpegQuality = 87;
+
+// Deterministic picture with some detail so that smooth scaling
+// can't take any shortcuts.
+QImage GeneratePhoto(int width, int height) {
+	auto result = QImage(width, height, QImage::Format_ARGB32_Premultiplied);
+	for (auto y = 0; y != height; ++y) {
+		const auto line = reinterpret_cast<uint32*>(result.scanLine(y));
+		for (auto x = 0; x != width; ++x) {
+			const auto r = (x * 255) / width;
+			const auto g = (y * 255) / height;
+			const auto b = ((x ^ y) & 0xFF);
+			line[x] = 0xFF000000U | (r << 16) | (g << 8) | b;
+		}
+	}
+	return result;
+}
+
+QByteArray EncodeJpeg(const QImage &image) {
+	auto result = QByteArray();
+	QBuffer buffer(&result);
+	image.save(&buffer, "JPG", kJpegQuality);
+	return result;
+}
+
+QByteArray EncodeJpeg(const QPixmap &pixmap) {
+	auto result = QByteArray();
+	QBuffer buffer(&result);
+	pixmap.save(&buffer, "JPG", kJpegQuality);
+	return result;
+}
+
+} // namespace
+
+TDESKTOP_BENCHMARK(images_prepare) {
+	using Option = Images::Option;
+
+	const auto photo = GeneratePhoto(kPhotoWidth, kPhotoHeight);
+	const auto thumbnail = GeneratePhoto(kThumbnailSize, kThumbnailSize);
+
+	runner.step("scale photo to widths", [&] {
+		for (auto width = kResizeFrom; width <= kResizeTill; width += kResizeStep) {
+			base::benchmark::KeepAlive(Images::prepare(
+				photo,
+				width,
+				0,
+				Option::Smooth,
+				0,
+				0));
+		}
+	});
+	runner.step("blurred thumbnails", [&] {
+		for (auto i = 0; i != kThumbnailsCount; ++i) {
+			base::benchmark::KeepAlive(Images::prepare(
+				thumbnail,
+				kResizeTill,
+				0,
+				Option::Smooth | Option::Blurred,
+				0,
+				0));
+		}
+	});
+	runner.step("circled userpics", [&] {
+		for (auto i = 0; i != kThumbnailsCount; ++i) {
+			base::benchmark::KeepAlive(Images::prepare(
+				thumbnail,
+				kThumbnailSize / 2,
+				kThumbnailSize / 2,
+				Option::Smooth | Option::Circled,
+				0,
+				0));
+		}
+	});
+}
+
+// The peak heap reported for these steps is measured by the harness,
+// so it includes every intermediate image of each path: the ones made
+// inside QImage::scaled(), Images::DownscaleToFit() and QPixmap::save().
+TDESKTOP_BENCHMARK(images_send_photo) {
+	const auto photo = GeneratePhoto(kCameraWidth, kCameraHeight);
+
+	// As FileLoadTask::process() did it before: every size is scaled
+	// from the source photo, goes through a QPixmap and the full size
+	// is encoded right from that QPixmap.
+	runner.step("separate scales", [&] {
+		auto sizes = std::vector<QPixmap>();
+		for (const auto size : { 100, 320, 1280 }) {
+			sizes.push_back(App::pixmapFromImageInPlace(photo.scaled(
+				size,
+				size,
+				Qt::KeepAspectRatio,
+				Qt::SmoothTransformation)));
+		}
+		base::benchmark::KeepAlive(EncodeJpeg(sizes.back()));
+	});
+
+	runner.step("pyramid", [&] {
+		auto sizes = std::vector<QPixmap>();
+		auto full = Images::DownscaleToFit(photo, 1280);
+		base::benchmark::KeepAlive(EncodeJpeg(full));
+		auto medium = Images::DownscaleToFit(full, 320);
+		auto thumb = Images::DownscaleToFit(medium, 100);
+		sizes.push_back(App::pixmapFromImageInPlace(std::move(thumb)));
+		sizes.push_back(App::pixmapFromImageInPlace(std::move(medium)));
+		sizes.push_back(App::pixmapFromImageInPlace(std::move(full)));
+	});
+}
@@ -0,0 +1,388 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/paint_profiler.h"
+
+#include "base/timer.h"
+#include "core/stats.h"
+#include "styles/style_basic.h"
+
+#include <chrono>
+#include <typeindex>
+
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif // __GNUC__
+
+namespace Ui {
+namespace PaintProfiler {
+namespace {
+
+constexpr auto kTraceFramesLimit = 3600;
+constexpr auto kOverlayUpdateTimeout = TimeMs(1000);
+constexpr auto kOverlayWidgetsCount = 6;
+
+struct Event {
+	const char *name = nullptr;
+	int64 start = 0;
+	int64 duration = -1;
+	int depth = 0;
+};
+
+struct Frame {
+	int64 start = 0;
+	int64 finish = 0;
+	std::vector<Event> events;
+	base::flat_map<QByteArray, int64> counters;
+};
+
+class Overlay : public TWidget {
+public:
+	Overlay(QWidget *parent);
+
+protected:
+	void paintEvent(QPaintEvent *e) override;
+
+private:
+	void refresh();
+
+	base::Timer _timer;
+	QStringList _lines;
+
+};
+
+struct State {
+	bool enabled = false;
+	bool frameStarted = false;
+	int frameId = 0;
+	int depth = 0;
+	Frame current;
+	base::flat_map<QByteArray, int64> counters; // Till the frame ends.
+	std::deque<Frame> finished;
+	FramesStats stats;
+	FramesStats totals; // Since enabled, without the widgets.
+	base::flat_map<QByteArray, WidgetStats> widgets;
+	base::flat_map<std::type_index, QByteArray> typeNames;
+	QPointer<Overlay> overlay;
+};
+
+State &GetState() {
+	static auto result = State();
+	return result;
+}
+
+int64 Now() {
+	using namespace std::chrono;
+	static const auto start = steady_clock::now();
+	return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+void FinishFrame() {
+	auto &state = GetState();
+	if (!state.frameStarted) {
+		return;
+	}
+	auto &frame = state.current;
+	frame.finish = Now();
+
+	frame.counters = base::take(state.counters);
+	auto duration = int64(0);
+	for (const auto &event : frame.events) {
+		if (event.duration < 0) {
+			continue;
+		} else if (!event.depth) {
+			duration += event.duration;
+		}
+		const auto key = QByteArray::fromRawData(
+			event.name,
+			qstrlen(event.name));
+		auto &widget = state.widgets[key];
+		widget.name = event.name;
+		++widget.paints;
+		widget.duration += event.duration;
+	}
+	for (const auto stats : { &state.stats, &state.totals }) {
+		++stats->frames;
+		stats->duration += duration;
+		accumulate_max(stats->longestFrame, duration);
+		for (const auto &[name, value] : frame.counters) {
+			stats->counters[name] += value;
+		}
+	}
+
+	state.finished.push_back(base::take(frame));
+	if (state.finished.size() > kTraceFramesLimit) {
+		state.finished.pop_front();
+	}
+	state.frameStarted = false;
+	state.depth = 0;
+	++state.frameId;
+}
+
+Frame &CurrentFrame() {
+	auto &state = GetState();
+	if (!state.frameStarted) {
+		state.frameStarted = true;
+		state.current.start = Now();
+
+		// All paints of a window are done in one backing store flush,
+		// so the frame ends when we return to the main loop.
+		crl::on_main([] { FinishFrame(); });
+	}
+	return state.current;
+}
+
+QByteArray Demangle(const char *name) {
+#ifdef __GNUC__
+	auto status = 0;
+	if (const auto demangled = abi::__cxa_demangle(
+			name,
+			nullptr,
+			nullptr,
+			&status)) {
+		auto result = QByteArray(demangled);
+		free(demangled);
+		return result;
+	}
+	return QByteArray(name);
+#else // __GNUC__
+	// MSVC names are readable, but start with "class " or "struct ".
+	auto result = QByteArray(name);
+	const auto space = result.indexOf(' ');
+	return (space > 0) ? result.mid(space + 1) : result;
+#endif // __GNUC__
+}
+
+QByteArray SerializeName(const char *name) {
+	auto result = QByteArray(name);
+	result.replace('\\', "\\\\").replace('"', "\\\"");
+	return '"' + result + '"';
+}
+
+Overlay::Overlay(QWidget *parent)
+: TWidget(parent)
+, _timer([=] { refresh(); }) {
+	setAttribute(Qt::WA_TransparentForMouseEvents);
+	setAttribute(Qt::WA_OpaquePaintEvent);
+	_timer.callEach(kOverlayUpdateTimeout);
+	refresh();
+	show();
+}
+
+void Overlay::refresh() {
+	const auto stats = TakeStats();
+	const auto ms = [](int64 duration) {
+		return QString::number(duration / 1000., 'f', 1) + qsl(" ms");
+	};
+	_lines = QStringList();
+	_lines.push_back(qsl("frames: %1, paint: %2, longest: %3"
+		).arg(stats.frames
+		).arg(ms(stats.duration)
+		).arg(ms(stats.longestFrame)));
+	for (const auto &[name, value] : stats.counters) {
+		_lines.push_back(qsl("%1: %2"
+			).arg(QString::fromLatin1(name)
+			).arg(value));
+	}
+	const auto count = std::min(
+		int(stats.widgets.size()),
+		kOverlayWidgetsCount);
+	for (const auto &widget : ranges::view::take(stats.widgets, count)) {
+		_lines.push_back(qsl("%1: %2 (%3)"
+			).arg(widget.name
+			).arg(ms(widget.duration)
+			).arg(widget.paints));
+	}
+
+	const auto &font = st::normalFont;
+	auto width = 0;
+	for (const auto &line : _lines) {
+		accumulate_max(width, font->width(line));
+	}
+	const auto padding = font->height / 2;
+	resize(
+		width + 2 * padding,
+		_lines.size() * font->height + 2 * padding);
+	raise();
+	update();
+}
+
+void Overlay::paintEvent(QPaintEvent *e) {
+	Painter p(this);
+	p.fillRect(rect(), QColor(0, 0, 0));
+	p.setFont(st::normalFont);
+	p.setPen(QColor(255, 255, 255));
+
+	const auto &font = st::normalFont;
+	const auto padding = font->height / 2;
+	auto top = padding;
+	for (const auto &line : _lines) {
+		p.drawTextLeft(padding, top, width(), line);
+		top += font->height;
+	}
+}
+
+const auto StatsRegistered = Core::Stats::Register("paint", [] {
+	const auto &totals = GetState().totals;
+	if (!totals.frames) {
+		return std::vector<Core::Stats::Row>();
+	}
+	auto row = Core::Stats::Row();
+	row.values.push_back({ "frames", totals.frames });
+	row.values.push_back({ "paint mcs", totals.duration });
+	row.values.push_back({ "longest frame mcs", totals.longestFrame });
+	for (const auto &[name, value] : totals.counters) {
+		// The keys are made from the static names passed to Count().
+		row.values.push_back({ name.constData(), value });
+	}
+	return std::vector<Core::Stats::Row>{ std::move(row) };
+});
+
+} // namespace
+
+bool Enabled() {
+	return GetState().enabled;
+}
+
+void SetEnabled(bool enabled) {
+	auto &state = GetState();
+	if (state.enabled == enabled) {
+		return;
+	}
+	state.enabled = enabled;
+	if (enabled) {
+		state.totals = FramesStats();
+	} else {
+		FinishFrame();
+		state.counters.clear();
+		HideOverlay();
+	}
+}
+
+Scope::Scope(const char *name) {
+	if (!Enabled()) {
+		return;
+	}
+	auto &frame = CurrentFrame();
+	auto &state = GetState();
+	_frame = state.frameId;
+	_index = int(frame.events.size());
+	frame.events.push_back({ name, Now(), -1, state.depth++ });
+}
+
+Scope::~Scope() {
+	if (_index < 0) {
+		return;
+	}
+	auto &state = GetState();
+	if (!state.frameStarted || state.frameId != _frame) {
+		return;
+	}
+	auto &event = state.current.events[_index];
+	event.duration = Now() - event.start;
+	--state.depth;
+}
+
+const char *TypeName(const std::type_info &type) {
+	auto &names = GetState().typeNames;
+	const auto key = std::type_index(type);
+	auto i = names.find(key);
+	if (i == end(names)) {
+		i = names.emplace(key, Demangle(type.name())).first;
+	}
+
+	// The bytes are not moved when the map is reallocated.
+	return i->second.constData();
+}
+
+void Count(const char *name, int value) {
+	if (Enabled()) {
+		const auto key = QByteArray::fromRawData(name, qstrlen(name));
+		GetState().counters[key] += value;
+	}
+}
+
+FramesStats TakeStats() {
+	auto &state = GetState();
+	auto result = base::take(state.stats);
+	result.widgets.reserve(state.widgets.size());
+	for (const auto &[name, widget] : base::take(state.widgets)) {
+		result.widgets.push_back(widget);
+	}
+	ranges::sort(
+		result.widgets,
+		ranges::greater(),
+		&WidgetStats::duration);
+	return result;
+}
+
+bool ExportChromeTrace(const QString &path) {
+	auto &state = GetState();
+
+	auto result = QByteArray();
+	auto first = true;
+	const auto add = [&](const QByteArray &event) {
+		result.append(first ? "\n" : ",\n").append(event);
+		first = false;
+	};
+	const auto number = [](int64 value) {
+		return QByteArray::number(value);
+	};
+	result.append("{\"traceEvents\":[");
+	for (const auto &frame : state.finished) {
+		for (const auto &event : frame.events) {
+			if (event.duration < 0) {
+				continue;
+			}
+			add("{\"name\":" + SerializeName(event.name)
+				+ ",\"cat\":\"paint\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+				+ ",\"ts\":" + number(event.start)
+				+ ",\"dur\":" + number(event.duration) + "}");
+		}
+		auto args = QByteArray();
+		for (const auto &[name, value] : frame.counters) {
+			args.append(args.isEmpty() ? "" : ",");
+			args.append(SerializeName(name.constData()));
+			args.append(':').append(number(value));
+		}
+		add("{\"name\":\"frame\",\"ph\":\"C\",\"pid\":1,\"tid\":1"
+			",\"ts\":" + number(frame.start)
+			+ ",\"args\":{" + args + "}}");
+	}
+	result.append("\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly)) {
+		LOG(("Paint Profiler Error: could not open '%1' for writing."
+			).arg(path));
+		return false;
+	} else if (file.write(result) != result.size()) {
+		LOG(("Paint Profiler Error: could not write to '%1'.").arg(path));
+		return false;
+	}
+	return true;
+}
+
+void ShowOverlay(not_null<QWidget*> window) {
+	auto &state = GetState();
+	if (state.overlay) {
+		if (state.overlay->parentWidget() == window) {
+			return;
+		}
+		HideOverlay();
+	}
+	state.overlay = new Overlay(window);
+}
+
+void HideOverlay() {
+	if (const auto overlay = base::take(GetState().overlay)) {
+		delete overlay.data();
+	}
+}
+
+} // namespace PaintProfiler
+} // namespace Ui
@@ -0,0 +1,73 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <typeinfo>
+
+namespace Ui {
+namespace PaintProfiler {
+
+// Opt-in paint instrumentation. While disabled every hook is one check.
+//
+// A frame is everything painted between two main loop iterations.
+// For each frame we record the paint duration of each widget (nested)
+// and the named counters, counted during the frame or since the last
+// one, like Text::draw calls or image restores (decoding an image that
+// was forgotten, a cache miss). The totals since the profiler was
+// enabled are reported in the "paint" section of Core::Stats.
+bool Enabled();
+void SetEnabled(bool enabled);
+
+class Scope {
+public:
+	// The name must have static storage duration. Scopes with equal
+	// names are counted as one widget, even if the pointers differ.
+	explicit Scope(const char *name);
+	Scope(const Scope &other) = delete;
+	Scope &operator=(const Scope &other) = delete;
+	~Scope();
+
+private:
+	int _frame = 0;
+	int _index = -1;
+
+};
+
+// Readable name of a (dynamic) type, it is kept until the exit.
+const char *TypeName(const std::type_info &type);
+
+// The name must have static storage duration.
+void Count(const char *name, int value = 1);
+
+struct WidgetStats {
+	const char *name = nullptr;
+	int paints = 0;
+	int64 duration = 0; // mcs
+};
+
+struct FramesStats {
+	int frames = 0;
+	int64 duration = 0; // mcs, only top level paints
+	int64 longestFrame = 0; // mcs
+	base::flat_map<QByteArray, int64> counters;
+	std::vector<WidgetStats> widgets; // Sorted by duration.
+};
+
+// Sums up the frames that finished since the previous call.
+FramesStats TakeStats();
+
+// Writes the recorded frames in the Chrome trace event format,
+// it can be opened in chrome://tracing or in Perfetto.
+bool ExportChromeTrace(const QString &path);
+
+// Shows the last second stats above the given window contents.
+void ShowOverlay(not_null<QWidget*> window);
+void HideOverlay();
+
+} // namespace PaintProfiler
+} // namespace Ui
@@ -7,6 +7,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "ui/rp_widget.h"
 
+#include "ui/paint_profiler.h"
+
 namespace Ui {
 
 void ResizeFitChild(
@@ -107,6 +109,13 @@ bool RpWidgetMethods::handleEvent(QEvent *event) {
 				return true;
 			}
 		}
+		if (PaintProfiler::Enabled()) {
+			// Not metaObject()->className(), that is the name of
+			// the nearest class having a Q_OBJECT macro.
+			PaintProfiler::Scope scope(
+				PaintProfiler::TypeName(callGetType()));
+			return eventHook(event);
+		}
 		break;
 	}
 
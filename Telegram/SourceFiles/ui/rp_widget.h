@@ -12,6 +12,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <rpl/distinct_until_changed.h>
 #include "base/unique_qptr.h"
 
+#include <typeinfo>
+
 namespace Ui {
 namespace details {
 
@@ -126,6 +128,7 @@ private:
 	virtual QPointer<QObject> callCreateWeak() = 0;
 	virtual QRect callGetGeometry() const = 0;
 	virtual bool callIsHidden() const = 0;
+	virtual const std::type_info &callGetType() const = 0;
 
 	void visibilityChangedHook(bool wasVisible, bool nowVisible);
 	EventStreams &eventStreams() const;
@@ -180,6 +183,9 @@ private:
 	bool callIsHidden() const override {
 		return this->isHidden();
 	}
+	const std::type_info &callGetType() const override {
+		return typeid(*this);
+	}
 
 	Initer _initer = { this };
 
@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "ui/text/text_entity.h"
 
+#include "ui/text/text_entity_scanner.h"
 #include "auth_session.h"
 #include "lang/lang_tag.h"
 #include "base/qthelp_url.h"
@@ -14,6 +15,39 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace TextUtilities {
 namespace {
 
+using internal::EntityMatch;
+using internal::EntityMatcher;
+
+// Keeps the last match of one entity kind while ParseEntities goes on.
+// Matches are leftmost, so a match starting after the new search offset
+// is still the answer and we don't need to search the same text again.
+class CachedEntityMatch {
+public:
+	using Finder = EntityMatch(*)(const QString&, int, EntityMatcher);
+
+	CachedEntityMatch(Finder finder, EntityMatcher matcher)
+	: _finder(finder)
+	, _matcher(matcher) {
+	}
+
+	const EntityMatch &find(const QString &text, int from) {
+		if (_from < 0
+			|| from < _from
+			|| (_match && _match.matchStart < from)) {
+			_match = _finder(text, from, _matcher);
+			_from = from;
+		}
+		return _match;
+	}
+
+private:
+	Finder _finder = nullptr;
+	EntityMatcher _matcher = EntityMatcher::Scanner;
+	EntityMatch _match;
+	int _from = -1;
+
+};
+
 QString ExpressionMailNameAtEnd() {
 	// Matches email first part (before '@') at the end of the string.
 	// First we find a domain without protocol (like "gmail.com"), then
@@ -1560,8 +1594,22 @@ TextWithEntities ParseEntities(const QString &text, int32 flags) {
 	return result;
 }
 
-// Some code is duplicated in message_field.cpp!
 void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
+	internal::ParseEntities(
+		result,
+		flags,
+		rich,
+		internal::EntityMatcher::Scanner);
+}
+
+namespace internal {
+
+// Some code is duplicated in message_field.cpp!
+void ParseEntities(
+		TextWithEntities &result,
+		int32 flags,
+		bool rich,
+		EntityMatcher matcher) {
 	constexpr auto kNotFound = std::numeric_limits<int>::max();
 
 	auto newEntities = EntitiesInText();
@@ -1572,6 +1620,12 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 	int existingEntityIndex = 0, existingEntitiesCount = result.entities.size();
 	int existingEntityEnd = 0;
 
+	auto domains = CachedEntityMatch(FindDomain, matcher);
+	auto explicitDomains = CachedEntityMatch(FindDomainExplicit, matcher);
+	auto hashtags = CachedEntityMatch(FindHashtag, matcher);
+	auto mentions = CachedEntityMatch(FindMention, matcher);
+	auto botCommands = CachedEntityMatch(FindBotCommand, matcher);
+
 	int32 len = result.text.size(), commandOffset = rich ? 0 : len;
 	bool inLink = false, commandIsLink = false;
 	const QChar *start = result.text.constData(), *end = start + result.text.size();
@@ -1585,54 +1639,34 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 				}
 			}
 		}
-		auto mDomain = qthelp::RegExpDomain().match(result.text, matchOffset);
-		auto mExplicitDomain = qthelp::RegExpDomainExplicit().match(result.text, matchOffset);
-		auto mHashtag = withHashtags ? RegExpHashtag().match(result.text, matchOffset) : QRegularExpressionMatch();
-		auto mMention = withMentions ? RegExpMention().match(result.text, qMax(mentionSkip, matchOffset)) : QRegularExpressionMatch();
-		auto mBotCommand = withBotCommands ? RegExpBotCommand().match(result.text, matchOffset) : QRegularExpressionMatch();
+		auto mDomain = domains.find(result.text, matchOffset);
+		const auto &mExplicitDomain = explicitDomains.find(result.text, matchOffset);
+		const auto mHashtag = withHashtags ? hashtags.find(result.text, matchOffset) : EntityMatch();
+		auto mMention = withMentions ? mentions.find(result.text, qMax(mentionSkip, matchOffset)) : EntityMatch();
+		const auto mBotCommand = withBotCommands ? botCommands.find(result.text, matchOffset) : EntityMatch();
 
 		EntityInTextType lnkType = EntityInTextUrl;
 		int32 lnkStart = 0, lnkLength = 0;
-		auto domainStart = mDomain.hasMatch() ? mDomain.capturedStart() : kNotFound,
-			domainEnd = mDomain.hasMatch() ? mDomain.capturedEnd() : kNotFound,
-			explicitDomainStart = mExplicitDomain.hasMatch() ? mExplicitDomain.capturedStart() : kNotFound,
-			explicitDomainEnd = mExplicitDomain.hasMatch() ? mExplicitDomain.capturedEnd() : kNotFound,
-			hashtagStart = mHashtag.hasMatch() ? mHashtag.capturedStart() : kNotFound,
-			hashtagEnd = mHashtag.hasMatch() ? mHashtag.capturedEnd() : kNotFound,
-			mentionStart = mMention.hasMatch() ? mMention.capturedStart() : kNotFound,
-			mentionEnd = mMention.hasMatch() ? mMention.capturedEnd() : kNotFound,
-			botCommandStart = mBotCommand.hasMatch() ? mBotCommand.capturedStart() : kNotFound,
-			botCommandEnd = mBotCommand.hasMatch() ? mBotCommand.capturedEnd() : kNotFound;
-		auto hashtagIgnore = false;
+		auto domainStart = mDomain ? mDomain.start : kNotFound,
+			domainEnd = mDomain ? mDomain.end : kNotFound,
+			explicitDomainStart = mExplicitDomain ? mExplicitDomain.start : kNotFound,
+			explicitDomainEnd = mExplicitDomain ? mExplicitDomain.end : kNotFound,
+			hashtagStart = mHashtag ? mHashtag.start : kNotFound,
+			hashtagEnd = mHashtag ? mHashtag.end : kNotFound,
+			mentionStart = mMention ? mMention.start : kNotFound,
+			mentionEnd = mMention ? mMention.end : kNotFound,
+			botCommandStart = mBotCommand ? mBotCommand.start : kNotFound,
+			botCommandEnd = mBotCommand ? mBotCommand.end : kNotFound;
+		auto hashtagIgnore = mHashtag && mHashtag.ignore;
 		auto mentionIgnore = false;
 
-		if (mHashtag.hasMatch()) {
-			if (!mHashtag.capturedRef(1).isEmpty()) {
-				++hashtagStart;
-			}
-			if (!mHashtag.capturedRef(2).isEmpty()) {
-				--hashtagEnd;
-			}
-			if (RegExpHashtagExclude().match(
-				result.text.mid(
-					hashtagStart + 1,
-					hashtagEnd - hashtagStart - 1)).hasMatch()) {
-				hashtagIgnore = true;
-			}
-		}
-		while (mMention.hasMatch()) {
-			if (!mMention.capturedRef(1).isEmpty()) {
-				++mentionStart;
-			}
-			if (!mMention.capturedRef(2).isEmpty()) {
-				--mentionEnd;
-			}
+		while (mMention) {
 			if (!(start + mentionStart + 1)->isLetter() || !(start + mentionEnd - 1)->isLetterOrNumber()) {
 				mentionSkip = mentionEnd;
-				mMention = RegExpMention().match(result.text, qMax(mentionSkip, matchOffset));
-				if (mMention.hasMatch()) {
-					mentionStart = mMention.capturedStart();
-					mentionEnd = mMention.capturedEnd();
+				mMention = mentions.find(result.text, qMax(mentionSkip, matchOffset));
+				if (mMention) {
+					mentionStart = mMention.start;
+					mentionEnd = mMention.end;
 				} else {
 					mentionIgnore = true;
 				}
@@ -1640,19 +1674,11 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 				break;
 			}
 		}
-		if (mBotCommand.hasMatch()) {
-			if (!mBotCommand.capturedRef(1).isEmpty()) {
-				++botCommandStart;
-			}
-			if (!mBotCommand.capturedRef(3).isEmpty()) {
-				--botCommandEnd;
-			}
-		}
-		if (!mDomain.hasMatch()
-			&& !mExplicitDomain.hasMatch()
-			&& !mHashtag.hasMatch()
-			&& !mMention.hasMatch()
-			&& !mBotCommand.hasMatch()) {
+		if (!mDomain
+			&& !mExplicitDomain
+			&& !mHashtag
+			&& !mMention
+			&& !mBotCommand) {
 			break;
 		}
 
@@ -1733,19 +1759,16 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 				continue;
 			}
 
-			auto protocol = mDomain.captured(1).toLower();
-			auto topDomain = mDomain.captured(3).toLower();
+			auto protocol = (mDomain.protocolStart >= 0)
+				? result.text.mid(mDomain.protocolStart, mDomain.protocolEnd - mDomain.protocolStart).toLower()
+				: QString();
+			auto topDomain = result.text.mid(mDomain.topDomainStart, mDomain.topDomainEnd - mDomain.topDomainStart).toLower();
 			auto isProtocolValid = protocol.isEmpty() || IsValidProtocol(protocol);
 			auto isTopDomainValid = !protocol.isEmpty() || IsValidTopDomain(topDomain);
 
 			if (protocol.isEmpty() && domainStart > offset + 1 && *(start + domainStart - 1) == QChar('@')) {
-				auto forMailName = result.text.mid(offset, domainStart - offset - 1);
-				auto mMailName = RegExpMailNameAtEnd().match(forMailName);
-				if (mMailName.hasMatch()) {
-					auto mailStart = offset + mMailName.capturedStart();
-					if (mailStart < offset) {
-						mailStart = offset;
-					}
+				auto mailStart = FindMailNameAtEnd(result.text, offset, domainStart - 1, matcher);
+				if (mailStart >= 0) {
 					lnkType = EntityInTextEmail;
 					lnkStart = mailStart;
 					lnkLength = domainEnd - mailStart;
@@ -1759,7 +1782,7 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 				lnkStart = domainStart;
 
 				QStack<const QChar*> parenth;
-				const QChar *domainEnd = start + mDomain.capturedEnd(), *p = domainEnd;
+				const QChar *domainEnd = start + mDomain.end, *p = domainEnd;
 				for (; p < end; ++p) {
 					QChar ch(*p);
 					if (chIsLinkEnd(ch)) break; // link finished
@@ -1814,6 +1837,8 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 	}
 }
 
+} // namespace internal
+
 void MoveStringPart(TextWithEntities &result, int to, int from, int count) {
 	if (!count) return;
 	if (to != from) {
@@ -0,0 +1,447 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/text/text_entity_scanner.h"
+
+#include "ui/text/text_entity.h"
+#include "base/qthelp_url.h"
+
+namespace TextUtilities {
+namespace internal {
+namespace {
+
+constexpr auto kMaxDomainLabels = 10;
+constexpr auto kMinTopDomainLength = 2;
+constexpr auto kMaxTopDomainLength = 22;
+constexpr auto kMinHashtagLength = 2;
+constexpr auto kMaxHashtagLength = 64;
+constexpr auto kMinMentionLength = 1;
+constexpr auto kMaxMentionLength = 32;
+constexpr auto kMinBotCommandLength = 1;
+constexpr auto kMaxBotCommandLength = 64;
+constexpr auto kMinBotUsernameLength = 5;
+constexpr auto kMaxBotUsernameLength = 32;
+constexpr auto kMaxMailNameLength = 256;
+
+// Code point iteration, the expressions work with UTF-16 as code points.
+struct Code {
+	uint value = 0;
+	int size = 0;
+};
+
+Code CodeAt(const QChar *text, int position, int length) {
+	if (position >= length) {
+		return Code();
+	}
+	const auto ch = text[position];
+	if (ch.isHighSurrogate()
+		&& position + 1 < length
+		&& text[position + 1].isLowSurrogate()) {
+		return { QChar::surrogateToUcs4(ch, text[position + 1]), 2 };
+	}
+	return { ch.unicode(), 1 };
+}
+
+Code CodeBefore(const QChar *text, int position) {
+	if (position <= 0) {
+		return Code();
+	}
+	const auto ch = text[position - 1];
+	if (ch.isLowSurrogate()
+		&& position > 1
+		&& text[position - 2].isHighSurrogate()) {
+		return { QChar::surrogateToUcs4(text[position - 2], ch), 2 };
+	}
+	return { ch.unicode(), 1 };
+}
+
+// "\w" and "\d" with QRegularExpression::UseUnicodePropertiesOption.
+bool IsWordCode(uint code) {
+	return (code == '_') || QChar::isLetterOrNumber(code);
+}
+
+bool IsDigitCode(uint code) {
+	return (code >= '0' && code <= '9')
+		|| (code > 0x7F
+			&& QChar::category(code) == QChar::Number_DecimalDigit);
+}
+
+// "\s" with QRegularExpression::UseUnicodePropertiesOption.
+bool IsSpaceCode(uint code) {
+	return QChar::isSpace(code) || (code == 0x180E);
+}
+
+bool IsAsciiLetter(uint code) {
+	return (code >= 'a' && code <= 'z') || (code >= 'A' && code <= 'Z');
+}
+
+bool IsAsciiWord(uint code) {
+	return IsAsciiLetter(code) || (code >= '0' && code <= '9') || (code == '_');
+}
+
+// ExpressionSeparators() from text_entity.cpp.
+bool IsSeparatorCode(uint code, bool slashIsSeparator) {
+	switch (code) {
+	case '.': case ',': case ':': case ';': case '<': case '>':
+	case '|': case '\'': case '"': case '[': case ']': case '{':
+	case '}': case '~': case '!': case '?': case '%': case '^':
+	case '(': case ')': case '-': case '+': case '=': case 0x10:
+	case 0xAB: case 0xBB: case 0x201C: case 0x201D: case 0x2018:
+	case 0x2019: case 0x2026: case '`': case '*':
+		return true;
+	case '/':
+		return slashIsSeparator;
+	}
+	return IsSpaceCode(code);
+}
+
+// "[A-Za-zА-ЯЁа-яё0-9\-\_]" from ExpressionDomain().
+bool IsDomainLabelCode(uint code) {
+	return IsAsciiWord(code)
+		|| (code == '-')
+		|| (code >= 0x410 && code <= 0x44F)
+		|| (code == 0x401)
+		|| (code == 0x451);
+}
+
+// "[A-Za-zрф\-\d]" from ExpressionDomain().
+bool IsTopDomainCode(uint code) {
+	return IsAsciiLetter(code)
+		|| (code == '-')
+		|| (code == 0x440)
+		|| (code == 0x444)
+		|| IsDigitCode(code);
+}
+
+// "(?<![\w\$\-\_%=\.])" from ExpressionDomain().
+bool IsDomainBlockerCode(uint code) {
+	switch (code) {
+	case '$': case '-': case '_': case '%': case '=': case '.':
+		return true;
+	}
+	return IsWordCode(code);
+}
+
+bool IsMailNameCode(uint code) {
+	return IsAsciiWord(code) || (code == '-') || (code == '.');
+}
+
+int SkipAsciiWord(const QChar *text, int position, int length) {
+	while (position < length && IsAsciiWord(text[position].unicode())) {
+		++position;
+	}
+	return position;
+}
+
+bool IsWordEnd(const QChar *text, int position, int length) {
+	return (position == length)
+		|| !IsWordCode(CodeAt(text, position, length).value);
+}
+
+// Matches "(?:label\.){minLabels,10}(topdomain{2,22})(\:\d+)?" at "from".
+EntityMatch MatchHost(
+		const QChar *text,
+		int from,
+		int length,
+		int minLabels) {
+	int labelEnds[kMaxDomainLabels] = { 0 };
+	auto labels = 0;
+	for (auto position = from; labels != kMaxDomainLabels;) {
+		auto till = position;
+		while (till < length && IsDomainLabelCode(text[till].unicode())) {
+			++till;
+		}
+		if (till == position || till == length || text[till] != '.') {
+			break;
+		}
+		position = labelEnds[labels++] = till + 1;
+	}
+	for (; labels >= minLabels; --labels) {
+		const auto topDomainStart = labels ? labelEnds[labels - 1] : from;
+		auto topDomainEnd = topDomainStart;
+		auto topDomainLength = 0;
+		while (topDomainLength != kMaxTopDomainLength) {
+			const auto code = CodeAt(text, topDomainEnd, length);
+			if (!code.size || !IsTopDomainCode(code.value)) {
+				break;
+			}
+			topDomainEnd += code.size;
+			++topDomainLength;
+		}
+		if (topDomainLength < kMinTopDomainLength) {
+			continue;
+		}
+		auto result = EntityMatch();
+		result.topDomainStart = topDomainStart;
+		result.topDomainEnd = result.end = topDomainEnd;
+		if (topDomainEnd < length && text[topDomainEnd] == ':') {
+			auto port = topDomainEnd + 1;
+			for (auto code = CodeAt(text, port, length)
+				; code.size && IsDigitCode(code.value)
+				; code = CodeAt(text, port, length)) {
+				port += code.size;
+			}
+			if (port > topDomainEnd + 1) {
+				result.end = port;
+			}
+		}
+		return result;
+	}
+	return EntityMatch();
+}
+
+EntityMatch ScanDomain(const QString &text, int from, bool explicitProtocol) {
+	const auto data = text.constData();
+	const auto length = text.size();
+	for (auto position = from; position < length; ++position) {
+		const auto ch = data[position].unicode();
+		if (!IsDomainLabelCode(ch)
+			|| IsDomainBlockerCode(CodeBefore(data, position).value)) {
+			continue;
+		}
+		const auto protocolEnd = [&] {
+			auto till = position;
+			while (till < length && IsAsciiLetter(data[till].unicode())) {
+				++till;
+			}
+			return (till > position
+				&& till + 2 < length
+				&& data[till] == ':'
+				&& data[till + 1] == '/'
+				&& data[till + 2] == '/') ? till : -1;
+		}();
+		if (protocolEnd >= 0) {
+			auto result = MatchHost(
+				data,
+				protocolEnd + 3,
+				length,
+				explicitProtocol ? 0 : 1);
+			if (result) {
+				result.matchStart = result.start = position;
+				result.protocolStart = position;
+				result.protocolEnd = protocolEnd;
+				return result;
+			}
+		}
+		if (!explicitProtocol) {
+			if (auto result = MatchHost(data, position, length, 1)) {
+				result.matchStart = result.start = position;
+				return result;
+			}
+		}
+	}
+	return EntityMatch();
+}
+
+// Finds "(^|[separators])<prefix>" and calls "body" for the text after
+// the prefix. The body returns the end of the entity or -1 on failure.
+template <typename Body>
+EntityMatch ScanPrefixed(
+		const QString &text,
+		int from,
+		QChar prefix,
+		bool slashIsSeparator,
+		Body body) {
+	const auto data = text.constData();
+	const auto length = text.size();
+	for (auto position = from; position < length; ++position) {
+		if (data[position] != prefix) {
+			continue;
+		}
+		const auto matchStart = (position == 0)
+			? 0
+			: (position - 1 >= from
+				&& IsSeparatorCode(data[position - 1].unicode(), slashIsSeparator))
+			? (position - 1)
+			: -1;
+		if (matchStart < 0) {
+			continue;
+		}
+		const auto end = body(data, position + 1, length);
+		if (end < 0) {
+			continue;
+		}
+		auto result = EntityMatch();
+		result.matchStart = matchStart;
+		result.start = position;
+		result.end = end;
+		return result;
+	}
+	return EntityMatch();
+}
+
+EntityMatch ScanHashtag(const QString &text, int from) {
+	auto digitsOnly = true;
+	auto result = ScanPrefixed(text, from, '#', true, [&](
+			const QChar *data,
+			int position,
+			int length) {
+		auto count = 0;
+		digitsOnly = true;
+		for (auto code = CodeAt(data, position, length)
+			; code.size && IsWordCode(code.value)
+			; code = CodeAt(data, position, length)) {
+			if (++count > kMaxHashtagLength) {
+				return -1;
+			} else if (!IsDigitCode(code.value)) {
+				digitsOnly = false;
+			}
+			position += code.size;
+		}
+		return (count >= kMinHashtagLength) ? position : -1;
+	});
+	result.ignore = result && digitsOnly;
+	return result;
+}
+
+EntityMatch ScanMention(const QString &text, int from) {
+	return ScanPrefixed(text, from, '@', true, [](
+			const QChar *data,
+			int position,
+			int length) {
+		const auto end = SkipAsciiWord(data, position, length);
+		const auto count = end - position;
+		return (count >= kMinMentionLength
+			&& count <= kMaxMentionLength
+			&& IsWordEnd(data, end, length)) ? end : -1;
+	});
+}
+
+EntityMatch ScanBotCommand(const QString &text, int from) {
+	return ScanPrefixed(text, from, '/', false, [](
+			const QChar *data,
+			int position,
+			int length) {
+		const auto end = SkipAsciiWord(data, position, length);
+		const auto count = end - position;
+		if (count < kMinBotCommandLength || count > kMaxBotCommandLength) {
+			return -1;
+		}
+		if (end < length && data[end] == '@') {
+			const auto usernameEnd = SkipAsciiWord(data, end + 1, length);
+			const auto usernameLength = usernameEnd - end - 1;
+			if (usernameLength >= kMinBotUsernameLength
+				&& usernameLength <= kMaxBotUsernameLength
+				&& IsWordEnd(data, usernameEnd, length)) {
+				return usernameEnd;
+			}
+		}
+		return IsWordEnd(data, end, length) ? end : -1;
+	});
+}
+
+int ScanMailNameAtEnd(const QString &text, int from, int till) {
+	const auto data = text.constData();
+	auto result = till;
+	while (result > from
+		&& till - result < kMaxMailNameLength
+		&& IsMailNameCode(data[result - 1].unicode())) {
+		--result;
+	}
+	return (result < till) ? result : -1;
+}
+
+EntityMatch FromDomainRegExp(const QRegularExpressionMatch &match) {
+	auto result = EntityMatch();
+	if (match.hasMatch()) {
+		result.matchStart = result.start = match.capturedStart();
+		result.end = match.capturedEnd();
+		result.protocolStart = match.capturedStart(1);
+		result.protocolEnd = match.capturedEnd(1);
+		result.topDomainStart = match.capturedStart(3);
+		result.topDomainEnd = match.capturedEnd(3);
+	}
+	return result;
+}
+
+// Takes the entity bounds from the captures instead of adjusting the
+// whole match by one char, so a non-BMP char after it is not split.
+EntityMatch FromPrefixedRegExp(
+		const QRegularExpressionMatch &match,
+		int trailingGroup) {
+	auto result = EntityMatch();
+	if (match.hasMatch()) {
+		result.matchStart = match.capturedStart();
+		result.start = match.capturedEnd(1);
+		result.end = match.capturedStart(trailingGroup);
+	}
+	return result;
+}
+
+} // namespace
+
+EntityMatch FindDomain(
+		const QString &text,
+		int from,
+		EntityMatcher matcher) {
+	return (matcher == EntityMatcher::Scanner)
+		? ScanDomain(text, from, false)
+		: FromDomainRegExp(qthelp::RegExpDomain().match(text, from));
+}
+
+EntityMatch FindDomainExplicit(
+		const QString &text,
+		int from,
+		EntityMatcher matcher) {
+	return (matcher == EntityMatcher::Scanner)
+		? ScanDomain(text, from, true)
+		: FromDomainRegExp(qthelp::RegExpDomainExplicit().match(text, from));
+}
+
+EntityMatch FindHashtag(
+		const QString &text,
+		int from,
+		EntityMatcher matcher) {
+	if (matcher == EntityMatcher::Scanner) {
+		return ScanHashtag(text, from);
+	}
+	auto result = FromPrefixedRegExp(RegExpHashtag().match(text, from), 2);
+	if (result) {
+		result.ignore = RegExpHashtagExclude().match(
+			text.mid(result.start + 1, result.end - result.start - 1)
+		).hasMatch();
+	}
+	return result;
+}
+
+EntityMatch FindMention(
+		const QString &text,
+		int from,
+		EntityMatcher matcher) {
+	return (matcher == EntityMatcher::Scanner)
+		? ScanMention(text, from)
+		: FromPrefixedRegExp(RegExpMention().match(text, from), 2);
+}
+
+EntityMatch FindBotCommand(
+		const QString &text,
+		int from,
+		EntityMatcher matcher) {
+	return (matcher == EntityMatcher::Scanner)
+		? ScanBotCommand(text, from)
+		: FromPrefixedRegExp(RegExpBotCommand().match(text, from), 3);
+}
+
+int FindMailNameAtEnd(
+		const QString &text,
+		int from,
+		int till,
+		EntityMatcher matcher) {
+	if (matcher == EntityMatcher::Scanner) {
+		return ScanMailNameAtEnd(text, from, till);
+	}
+	const auto part = text.mid(from, till - from);
+	const auto match = RegExpMailNameAtEnd().match(part);
+
+	// "$" also matches before a final '\n', we want the exact end.
+	return (match.hasMatch() && match.capturedEnd() == part.size())
+		? (from + match.capturedStart())
+		: -1;
+}
+
+} // namespace internal
+} // namespace TextUtilities
@@ -0,0 +1,98 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+struct TextWithEntities;
+
+namespace TextUtilities {
+namespace internal {
+
+// Hand-written matchers for the entity expressions used in ParseEntities.
+// Each Find* returns the leftmost match found searching from "from",
+// exactly as the corresponding QRegularExpression would, with captures
+// already trimmed (no leading separator and no trailing non-word char).
+//
+// The RegExp variants are kept as a reference implementation for tests.
+enum class EntityMatcher {
+	Scanner,
+	RegExp,
+};
+
+struct EntityMatch {
+	// Position where the regular expression match itself starts,
+	// it can be one char before "start" because of the separator.
+	int matchStart = -1;
+	int start = -1;
+	int end = -1;
+
+	// Only for domains.
+	int protocolStart = -1;
+	int protocolEnd = -1;
+	int topDomainStart = -1;
+	int topDomainEnd = -1;
+
+	// Only for hashtags: true for a "#123" hashtag, that we skip.
+	bool ignore = false;
+
+	explicit operator bool() const {
+		return (start >= 0);
+	}
+};
+
+inline bool operator==(const EntityMatch &a, const EntityMatch &b) {
+	return (a.matchStart == b.matchStart)
+		&& (a.start == b.start)
+		&& (a.end == b.end)
+		&& (a.protocolStart == b.protocolStart)
+		&& (a.protocolEnd == b.protocolEnd)
+		&& (a.topDomainStart == b.topDomainStart)
+		&& (a.topDomainEnd == b.topDomainEnd)
+		&& (a.ignore == b.ignore);
+}
+inline bool operator!=(const EntityMatch &a, const EntityMatch &b) {
+	return !(a == b);
+}
+
+EntityMatch FindDomain(
+	const QString &text,
+	int from,
+	EntityMatcher matcher = EntityMatcher::Scanner);
+EntityMatch FindDomainExplicit(
+	const QString &text,
+	int from,
+	EntityMatcher matcher = EntityMatcher::Scanner);
+EntityMatch FindHashtag(
+	const QString &text,
+	int from,
+	EntityMatcher matcher = EntityMatcher::Scanner);
+EntityMatch FindMention(
+	const QString &text,
+	int from,
+	EntityMatcher matcher = EntityMatcher::Scanner);
+EntityMatch FindBotCommand(
+	const QString &text,
+	int from,
+	EntityMatcher matcher = EntityMatcher::Scanner);
+
+// Returns the start of an email name that ends right at "till" and
+// doesn't start before "from", or -1 if there is no such name.
+int FindMailNameAtEnd(
+	const QString &text,
+	int from,
+	int till,
+	EntityMatcher matcher = EntityMatcher::Scanner);
+
+// TextUtilities::ParseEntities() with a choice of the matchers.
+void ParseEntities(
+	TextWithEntities &result,
+	int32 flags,
+	bool rich,
+	EntityMatcher matcher);
+
+} // namespace internal
+} // namespace TextUtilities
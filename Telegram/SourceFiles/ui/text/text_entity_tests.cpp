@@ -0,0 +1,111 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "ui/text/text_entity.h"
+#include "ui/text/text_entity_scanner.h"
+
+#include <random>
+
+namespace {
+
+using namespace TextUtilities::internal;
+
+constexpr auto kFuzzIterations = 20000;
+constexpr auto kFuzzMaxLength = 48;
+
+const std::vector<QString> &Samples() {
+	static const auto result = std::vector<QString>{
+		QString::fromUtf8("see https://telegram.org/blog/ and tg://resolve?domain=x"),
+		QString::fromUtf8("mail me at some.name-1@example.co.uk, or not"),
+		QString::fromUtf8("#tag #123 #x (#yes) @durov @ab_c @1abc /start /start@SomeBot"),
+		QString::fromUtf8("\xD0\xBF\xD1\x80\xD0\xB5\xD0\xB7\xD0\xB8\xD0\xB4\xD0\xB5\xD0\xBD\xD1\x82.\xD1\x80\xD1\x84 and file.txt:8080/path"),
+		QString::fromUtf8("#\xD1\x82\xD0\xB5\xD0\xB3\xF0\x9F\x98\x80 @name\xF0\x9F\x98\x80 a.b.c.d.e.f.g.h.i.j.k.com"),
+	};
+	return result;
+}
+
+// Characters that matter for the expressions with a few ordinary ones.
+QString RandomText(std::mt19937 &generator) {
+	static const auto alphabet = QString::fromUtf8(
+		"aZ9_-.:/@#$%=?!()[]<>\"' \n`*"
+		"\xD1\x80\xD1\x84\xD0\x81\xC3\xA9\xC2\xAB\xE2\x80\xA6\xD9\xA3");
+	static const auto surrogates = QString::fromUtf8("\xF0\x9F\x98\x80");
+
+	auto length = std::uniform_int_distribution<int>(0, kFuzzMaxLength);
+	auto pick = std::uniform_int_distribution<int>(0, alphabet.size());
+	auto result = QString();
+	for (auto i = 0, count = length(generator); i != count; ++i) {
+		const auto index = pick(generator);
+		if (index == alphabet.size()) {
+			result += surrogates;
+		} else {
+			result += alphabet[index];
+		}
+	}
+	return result;
+}
+
+void CompareMatchers(const QString &text) {
+	for (auto from = 0; from <= text.size(); ++from) {
+		INFO(text.toStdString() << " from " << from);
+		REQUIRE(FindDomain(text, from, EntityMatcher::Scanner)
+			== FindDomain(text, from, EntityMatcher::RegExp));
+		REQUIRE(FindDomainExplicit(text, from, EntityMatcher::Scanner)
+			== FindDomainExplicit(text, from, EntityMatcher::RegExp));
+		REQUIRE(FindHashtag(text, from, EntityMatcher::Scanner)
+			== FindHashtag(text, from, EntityMatcher::RegExp));
+		REQUIRE(FindMention(text, from, EntityMatcher::Scanner)
+			== FindMention(text, from, EntityMatcher::RegExp));
+		REQUIRE(FindBotCommand(text, from, EntityMatcher::Scanner)
+			== FindBotCommand(text, from, EntityMatcher::RegExp));
+		for (auto till = from; till <= text.size(); ++till) {
+			REQUIRE(FindMailNameAtEnd(text, from, till, EntityMatcher::Scanner)
+				== FindMailNameAtEnd(text, from, till, EntityMatcher::RegExp));
+		}
+	}
+}
+
+void CompareParsing(const QString &text) {
+	const auto flags = TextParseLinks
+		| TextParseMentions
+		| TextParseHashtags
+		| TextParseBotCommands;
+	auto scanned = TextWithEntities{ text };
+	auto matched = TextWithEntities{ text };
+	ParseEntities(scanned, flags, false, EntityMatcher::Scanner);
+	ParseEntities(matched, flags, false, EntityMatcher::RegExp);
+
+	INFO(text.toStdString());
+	REQUIRE(scanned.entities.size() == matched.entities.size());
+	for (auto i = 0; i != scanned.entities.size(); ++i) {
+		REQUIRE(scanned.entities[i].type() == matched.entities[i].type());
+		REQUIRE(scanned.entities[i].offset() == matched.entities[i].offset());
+		REQUIRE(scanned.entities[i].length() == matched.entities[i].length());
+	}
+}
+
+} // namespace
+
+TEST_CASE("entity scanner agrees with regular expressions", "[entities]") {
+	SECTION("samples") {
+		for (const auto &text : Samples()) {
+			CompareMatchers(text);
+			CompareParsing(text);
+		}
+	}
+
+	SECTION("fuzz") {
+		auto generator = std::mt19937(20180925);
+		for (auto i = 0; i != kFuzzIterations; ++i) {
+			const auto text = RandomText(generator);
+			CompareMatchers(text);
+			CompareParsing(text);
+		}
+	}
+}
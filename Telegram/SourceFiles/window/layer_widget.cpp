@@ -1041,7 +1041,9 @@ QPixmap MediaPreviewWidget::currentImage() const {
 			if (_photo->full->loaded()) {
 				QSize s = currentDimensions();
 				_cache = _photo->full->pix(_origin, s.width(), s.height());
-				_cacheStatus = CacheLoaded;
+				if (_photo->full->decoded()) {
+					_cacheStatus = CacheLoaded;
+				}
 			} else {
 				if (_cacheStatus != CacheThumbLoaded && _photo->thumb->loaded()) {
 					QSize s = currentDimensions();
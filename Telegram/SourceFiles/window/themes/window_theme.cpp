@@ -25,6 +25,20 @@ constexpr auto kThemeBackgroundSizeLimit = 4 * 1024 * 1024;
 constexpr auto kThemeSchemeSizeLimit = 1024 * 1024;
 constexpr auto kMinimumTiledSize = 512;
 constexpr auto kNightThemeFile = str_const(":/gui/night.tdesktop-theme");
+constexpr auto kPrebakedThemesSizeLimit = 24 * 1024 * 1024;
+constexpr auto kPrebakedBackgroundTag = 0x47424454U; // "TDBG"
+constexpr auto kPrebakedBackgroundVersion = 1;
+constexpr auto kPrebakedBackgroundFormat = QImage::Format_ARGB32_Premultiplied;
+
+// Header of the background, prebaked as raw pixels in Cached::background.
+struct PrebakedBackground {
+	quint32 tag = 0;
+	qint32 version = 0;
+	qint32 width = 0;
+	qint32 height = 0;
+	qint32 bytesPerLine = 0;
+	qint32 reserved = 0;
+};
 
 struct Data {
 	struct Applying {
@@ -38,6 +52,10 @@ struct Data {
 
 	ChatBackground background;
 	Applying applying;
+
+	// Themes loaded during this session, most recently used last,
+	// limited by the summary size of their palettes and backgrounds.
+	std::vector<Cached> prebaked;
 };
 NeverFreedPointer<Data> instance;
 
@@ -198,7 +216,105 @@ void applyBackground(QImage &&background, bool tiled, Instance *out) {
 	}
 }
 
-bool loadThemeFromCache(const QByteArray &content, const Cached &cache) {
+QByteArray prebakeBackground(const QImage &image) {
+	Expects(image.format() == kPrebakedBackgroundFormat);
+
+	auto header = PrebakedBackground();
+	header.tag = kPrebakedBackgroundTag;
+	header.version = kPrebakedBackgroundVersion;
+	header.width = image.width();
+	header.height = image.height();
+	header.bytesPerLine = image.bytesPerLine();
+	const auto bytes = header.bytesPerLine * header.height;
+
+	auto result = QByteArray(sizeof(header) + bytes, Qt::Uninitialized);
+	memcpy(result.data(), &header, sizeof(header));
+	memcpy(result.data() + sizeof(header), image.constBits(), bytes);
+	return result;
+}
+
+// The result references the cache bytes instead of copying the pixels.
+QImage unbakeBackground(const QByteArray &data) {
+	auto header = PrebakedBackground();
+	if (data.size() >= int(sizeof(header))) {
+		memcpy(&header, data.constData(), sizeof(header));
+	}
+	if (header.tag != kPrebakedBackgroundTag) {
+		// Caches written before the prebaked format hold a BMP image.
+		auto result = QImage();
+		QDataStream stream(data);
+		QImageReader reader(stream.device());
+#ifndef OS_MAC_OLD
+		reader.setAutoTransform(true);
+#endif // OS_MAC_OLD
+		if (!reader.read(&result)) {
+			return QImage();
+		}
+		return result;
+	}
+	// The header comes from the disk, so a damaged one must not
+	// overflow the sizes checks.
+	const auto bytes = int64(header.bytesPerLine) * int64(header.height);
+	if (header.version != kPrebakedBackgroundVersion
+		|| header.width <= 0
+		|| header.height <= 0
+		|| int64(header.bytesPerLine) < int64(header.width) * 4
+		|| int64(data.size()) != int64(sizeof(header)) + bytes) {
+		return QImage();
+	}
+	const auto holder = new QByteArray(data);
+	return QImage(
+		reinterpret_cast<const uchar*>(holder->constData()) + sizeof(header),
+		header.width,
+		header.height,
+		header.bytesPerLine,
+		kPrebakedBackgroundFormat,
+		[](void *info) { delete static_cast<QByteArray*>(info); },
+		holder);
+}
+
+int64 prebakedSize(const Cached &cache) {
+	return int64(cache.colors.size()) + cache.background.size();
+}
+
+void rememberPrebaked(const Cached &cache) {
+	auto &list = instance->prebaked;
+	list.erase(ranges::remove(
+		list,
+		cache.contentChecksum,
+		&Cached::contentChecksum), end(list));
+
+	const auto size = prebakedSize(cache);
+	if (size > kPrebakedThemesSizeLimit) {
+		return;
+	}
+	auto total = size;
+	for (const auto &entry : list) {
+		total += prebakedSize(entry);
+	}
+	auto from = begin(list);
+	while (total > kPrebakedThemesSizeLimit) {
+		total -= prebakedSize(*from++);
+	}
+	list.erase(begin(list), from);
+	list.push_back(cache);
+}
+
+const Cached *findPrebaked(const QByteArray &content) {
+	const auto checksum = hashCrc32(content.constData(), content.size());
+	auto &list = instance->prebaked;
+	const auto i = ranges::find(list, checksum, &Cached::contentChecksum);
+	if (i == end(list)) {
+		return nullptr;
+	}
+	std::rotate(i, i + 1, end(list));
+	return &list.back();
+}
+
+bool loadThemeFromCache(
+		const QByteArray &content,
+		const Cached &cache,
+		Instance *out = nullptr) {
 	if (cache.paletteChecksum != style::palette::Checksum()) {
 		return false;
 	}
@@ -206,24 +322,25 @@ bool loadThemeFromCache(const QByteArray &content, const Cached &cache) {
 		return false;
 	}
 
-	QImage background;
+	auto background = QImage();
 	if (!cache.background.isEmpty()) {
-		QDataStream stream(cache.background);
-		QImageReader reader(stream.device());
-#ifndef OS_MAC_OLD
-		reader.setAutoTransform(true);
-#endif // OS_MAC_OLD
-		if (!reader.read(&background) || background.isNull()) {
+		background = unbakeBackground(cache.background);
+		if (background.isNull()) {
 			return false;
 		}
 	}
 
-	if (!style::main_palette::load(cache.colors)) {
+	if (out) {
+		if (!out->palette.load(cache.colors)) {
+			return false;
+		}
+		out->cached = cache;
+	} else if (!style::main_palette::load(cache.colors)) {
 		return false;
 	}
 	Background()->saveAdjustableColors();
 	if (!background.isNull()) {
-		applyBackground(std::move(background), cache.tiled, nullptr);
+		applyBackground(std::move(background), cache.tiled, out);
 	}
 
 	return true;
@@ -296,11 +413,9 @@ bool loadTheme(const QByteArray &content, Cached &cache, Instance *out = nullptr
 				LOG(("Theme Error: could not read background image in the theme file."));
 				return false;
 			}
-			QBuffer buffer(&cache.background);
-			if (!background.save(&buffer, "BMP")) {
-				LOG(("Theme Error: could not write background image as a BMP to cache."));
-				return false;
-			}
+			background = std::move(background).convertToFormat(
+				kPrebakedBackgroundFormat);
+			cache.background = prebakeBackground(background);
 			cache.tiled = backgroundTiled;
 
 			applyBackground(std::move(background), cache.tiled, out);
@@ -764,13 +879,17 @@ void ChatBackground::toggleNightMode(std::optional<QString> themePath) {
 		preview->pathRelative = std::move(read.pathRelative);
 		preview->content = std::move(read.content);
 		preview->instance.cached = std::move(read.cache);
-		const auto loaded = loadTheme(
+		const auto loaded = loadThemeFromCache(
 			preview->content,
 			preview->instance.cached,
-			&preview->instance);
+			&preview->instance) || loadTheme(
+				preview->content,
+				preview->instance.cached,
+				&preview->instance);
 		if (!loaded) {
 			return false;
 		}
+		rememberPrebaked(preview->instance.cached);
 		Apply(std::move(preview));
 		return true;
 	}();
@@ -821,6 +940,7 @@ bool Load(Saved &&saved) {
 
 	instance.createIfNull();
 	if (loadThemeFromCache(saved.content, saved.cache)) {
+		rememberPrebaked(saved.cache);
 		Background()->setThemeAbsolutePath(saved.pathAbsolute);
 		return true;
 	}
@@ -828,6 +948,7 @@ bool Load(Saved &&saved) {
 	if (!loadTheme(saved.content, saved.cache)) {
 		return false;
 	}
+	rememberPrebaked(saved.cache);
 	Local::writeTheme(saved);
 	Background()->setThemeAbsolutePath(saved.pathAbsolute);
 	return true;
@@ -962,7 +1083,17 @@ bool LoadFromFile(const QString &path, Instance *out, QByteArray *outContent) {
 		return false;
 	}
 
-	return loadTheme(*outContent,  out->cached, out);
+	instance.createIfNull();
+	if (const auto prebaked = findPrebaked(*outContent)) {
+		if (loadThemeFromCache(*outContent, *prebaked, out)) {
+			return true;
+		}
+	}
+	if (!loadTheme(*outContent, out->cached, out)) {
+		return false;
+	}
+	rememberPrebaked(out->cached);
+	return true;
 }
 
 bool IsPaletteTestingPath(const QString &path) {
@@ -10,118 +10,114 @@
   ],
   'targets': [{
     'target_name': 'Telegram',
-    'variables': {
-      'variables': {
-        'libs_loc': '../../../Libraries',
-      },
-      'libs_loc': '<(libs_loc)',
-      'src_loc': '../SourceFiles',
-      'res_loc': '../Resources',
-      'submodules_loc': '../ThirdParty',
-      'minizip_loc': '<(submodules_loc)/minizip',
-      'sp_media_key_tap_loc': '<(submodules_loc)/SPMediaKeyTap',
-      'emoji_suggestions_loc': '<(submodules_loc)/emoji_suggestions',
-      'style_files': [
-        '<(res_loc)/colors.palette',
-        '<(res_loc)/basic.style',
-        '<(src_loc)/boxes/boxes.style',
-        '<(src_loc)/dialogs/dialogs.style',
-        '<(src_loc)/export/view/export.style',
-        '<(src_loc)/history/history.style',
-        '<(src_loc)/info/info.style',
-        '<(src_loc)/intro/intro.style',
-        '<(src_loc)/media/view/mediaview.style',
-        '<(src_loc)/media/player/media_player.style',
-        '<(src_loc)/overview/overview.style',
-        '<(src_loc)/passport/passport.style',
-        '<(src_loc)/profile/profile.style',
-        '<(src_loc)/settings/settings.style',
-        '<(src_loc)/chat_helpers/chat_helpers.style',
-        '<(src_loc)/ui/widgets/widgets.style',
-        '<(src_loc)/window/window.style',
-      ],
-      'langpacks': [
-        'en',
-      ],
-      'build_defines%': '',
-      'list_sources_command': 'python <(DEPTH)/list_sources.py --input <(DEPTH)/telegram_sources.txt --replace src_loc=<(src_loc)',
-      'pch_source': '<(src_loc)/stdafx.cpp',
-      'pch_header': '<(src_loc)/stdafx.h',
-    },
     'includes': [
-      'common_executable.gypi',
-      'telegram_qrc.gypi',
-      'telegram_win.gypi',
-      'telegram_mac.gypi',
-      'telegram_linux.gypi',
-      'openssl.gypi',
-      'qt.gypi',
-      'qt_moc.gypi',
-      'qt_rcc.gypi',
+      'telegram_common.gypi',
       'codegen_rules.gypi',
-      'pch.gypi',
     ],
-
     'dependencies': [
-      'codegen.gyp:codegen_emoji',
-      'codegen.gyp:codegen_lang',
-      'codegen.gyp:codegen_numbers',
-      'codegen.gyp:codegen_style',
       'utils.gyp:Updater',
-      'crl.gyp:crl',
-      'lib_base.gyp:lib_base',
-      'lib_export.gyp:lib_export',
-      'lib_storage.gyp:lib_storage',
+      'tests.gyp:tests',
     ],
-
+    'conditions': [
+      [ '"<(official_build_target)" != ""', {
+        'dependencies': [
+          'utils.gyp:Packer',
+        ],
+      }],
+    ],
+  }, {
+    # Headless scenarios, see base/benchmark.h. The sources generated
+    # for Telegram are reused, so that codegen runs only once.
+    'target_name': 'Benchmarks',
+    'includes': [
+      'telegram_common.gypi',
+    ],
+    'dependencies': [
+      'Telegram',
+    ],
+    # MTP::Instance works without a Messenger and config loading there.
     'defines': [
-      'AL_LIBTYPE_STATIC',
-      'AL_ALEXT_PROTOTYPES',
-      'XXH_INLINE_ALL',
-      '<!@(python -c "for s in \'<(build_defines)\'.split(\',\'): print(s)")',
+      'TDESKTOP_BENCHMARKS',
+    ],
+    'sources': [
+      '<(SHARED_INTERMEDIATE_DIR)/emoji.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/emoji_suggestions_data.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/lang_auto.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/numbers.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/palette.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_basic.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_boxes.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_chat_helpers.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_dialogs.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_export.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_history.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_info.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_intro.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_media_player.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_mediaview.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_overview.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_passport.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_profile.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_settings.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_widgets.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_window.cpp',
+      '<(src_loc)/base/benchmark.h',
+      '<(src_loc)/base/benchmarks_main.cpp',
+      '<(src_loc)/history/history_benchmarks.cpp',
+      '<(src_loc)/mtproto/crypto_benchmarks.cpp',
+      '<(src_loc)/mtproto/loopback_benchmarks.cpp',
+      '<(src_loc)/mtproto/loopback_server.cpp',
+      '<(src_loc)/mtproto/loopback_server.h',
+      '<(src_loc)/rpl/event_stream_benchmarks.cpp',
+      '<(src_loc)/ui/images_benchmarks.cpp',
+    ],
+    'sources!': [
+      '<(src_loc)/main.cpp',
+    ],
+  }, {
+    # Tests for the code that can't be built without the application,
+    # they are linked with the Telegram sources the same way.
+    'target_name': 'tests_text_entities',
+    'includes': [
+      'telegram_common.gypi',
+    ],
+    'dependencies': [
+      'Telegram',
+    ],
+    # The application defines base::assertion::log() itself.
+    'defines': [
+      'TDESKTOP_APP_TESTS',
     ],
-
     'include_dirs': [
-      '<(src_loc)',
-      '<(SHARED_INTERMEDIATE_DIR)',
-      '<(libs_loc)/breakpad/src',
-      '<(libs_loc)/lzma/C',
-      '<(libs_loc)/zlib',
-      '<(libs_loc)/ffmpeg',
-      '<(libs_loc)/openal-soft/include',
-      '<(libs_loc)/opus/include',
-      '<(libs_loc)/range-v3/include',
-      '<(minizip_loc)',
-      '<(sp_media_key_tap_loc)',
-      '<(emoji_suggestions_loc)',
-      '<(submodules_loc)/GSL/include',
-      '<(submodules_loc)/variant/include',
-      '<(submodules_loc)/crl/src',
-      '<(submodules_loc)/xxHash',
+      '<(submodules_loc)/Catch/include',
     ],
     'sources': [
-      '<@(qrc_files)',
-      '<@(style_files)',
-      '<!@(<(list_sources_command) <(qt_moc_list_sources_arg))',
-      'telegram_sources.txt',
-	  '<(res_loc)/langs/cloud_lang.strings',
-      '<(res_loc)/export_html/css/style.css',
-      '<(res_loc)/export_html/js/script.js',
-      '<(res_loc)/export_html/images/back.png',
-      '<(res_loc)/export_html/images/back@2x.png',
+      '<(SHARED_INTERMEDIATE_DIR)/emoji.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/emoji_suggestions_data.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/lang_auto.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/numbers.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/palette.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_basic.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_boxes.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_chat_helpers.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_dialogs.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_export.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_history.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_info.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_intro.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_media_player.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_mediaview.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_overview.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_passport.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_profile.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_settings.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_widgets.cpp',
+      '<(SHARED_INTERMEDIATE_DIR)/styles/style_window.cpp',
+      '<(src_loc)/base/tests_main.cpp',
+      '<(src_loc)/ui/text/text_entity_tests.cpp',
     ],
     'sources!': [
-      '<!@(<(list_sources_command) <(qt_moc_list_sources_arg) --exclude_for <(build_os))',
-    ],
-    'conditions': [
-      [ '"<(official_build_target)" != ""', {
-        'defines': [
-          'CUSTOM_API_ID',
-        ],
-        'dependencies': [
-          'utils.gyp:Packer',
-        ],
-      }],
+      '<(src_loc)/main.cpp',
     ],
   }],
 }
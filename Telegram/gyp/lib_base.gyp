@@ -75,6 +75,8 @@
       '<(src_loc)/base/runtime_composer.h',
       '<(src_loc)/base/timer.cpp',
       '<(src_loc)/base/timer.h',
+      '<(src_loc)/base/timer_wheel.cpp',
+      '<(src_loc)/base/timer_wheel.h',
       '<(src_loc)/base/type_traits.h',
       '<(src_loc)/base/unique_any.h',
       '<(src_loc)/base/unique_function.h',
@@ -0,0 +1,171 @@
+# This file is part of Telegram Desktop,
+# the official desktop application for the Telegram messaging service.
+#
+# For license and copyright information please follow this link:
+# https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+
+{
+  'includes': [
+    'common.gypi',
+  ],
+  'targets': [{
+    'target_name': 'tests',
+    'type': 'none',
+    'dependencies': [
+      'tests_aes_ige',
+      'tests_audio_peak',
+      'tests_audio_ring_buffer',
+      'tests_concurrent_event_stream',
+      'tests_emoji',
+      'tests_received_buffers',
+      'tests_request_telemetry',
+      'tests_stickers_index',
+      'tests_streaming_file',
+      'tests_timer_wheel',
+    ],
+  }, {
+    'target_name': 'tests_aes_ige',
+    'includes': [
+      'common_test.gypi',
+      'openssl.gypi',
+    ],
+    'conditions': [[ 'build_linux', {
+      'libraries': [
+        'ssl',
+        'crypto',
+      ],
+    }]],
+    'sources': [
+      '<(src_loc)/mtproto/aes_ige.cpp',
+      '<(src_loc)/mtproto/aes_ige.h',
+      '<(src_loc)/mtproto/aes_ige_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_audio_peak',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/media/media_audio_peak.cpp',
+      '<(src_loc)/media/media_audio_peak.h',
+      '<(src_loc)/media/media_audio_peak_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_audio_ring_buffer',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/media/media_audio_ring_buffer.h',
+      '<(src_loc)/media/media_audio_ring_buffer_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_concurrent_event_stream',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'dependencies': [
+      'crl.gyp:crl',
+    ],
+    'include_dirs': [
+      '<(submodules_loc)/crl/src',
+    ],
+    'sources': [
+      '<(src_loc)/rpl/concurrent_event_stream.h',
+      '<(src_loc)/rpl/concurrent_event_stream_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_emoji',
+    'variables': {
+      'res_loc': '../Resources',
+    },
+    'includes': [
+      'common_test.gypi',
+    ],
+    'dependencies': [
+      'codegen.gyp:codegen_emoji',
+    ],
+    'include_dirs': [
+      '<(INTERMEDIATE_DIR)',
+    ],
+    'actions': [{
+      'action_name': 'codegen_emoji_reference',
+      'inputs': [
+        '<(PRODUCT_DIR)/codegen_emoji<(exe_ext)',
+        '<(res_loc)/emoji_autocomplete.json',
+      ],
+      'outputs': [
+        '<(INTERMEDIATE_DIR)/emoji_find_reference.cpp',
+        '<(INTERMEDIATE_DIR)/emoji_find_reference.h',
+      ],
+      'action': [
+        '<(PRODUCT_DIR)/codegen_emoji<(exe_ext)',
+        '<(res_loc)/emoji_autocomplete.json',
+        '-o', '<(INTERMEDIATE_DIR)',
+      ],
+      'message': 'codegen_emoji-ing reference matchers..',
+      'process_outputs_as_sources': 1,
+    }],
+    'sources': [
+      '<(src_loc)/ui/emoji_config_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_received_buffers',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/mtproto/received_buffers.cpp',
+      '<(src_loc)/mtproto/received_buffers.h',
+      '<(src_loc)/mtproto/received_buffers_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_request_telemetry',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/mtproto/request_telemetry_aggregator.cpp',
+      '<(src_loc)/mtproto/request_telemetry_aggregator.h',
+      '<(src_loc)/mtproto/request_telemetry_aggregator_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_stickers_index',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/chat_helpers/stickers_search_index.cpp',
+      '<(src_loc)/chat_helpers/stickers_search_index.h',
+      '<(src_loc)/chat_helpers/stickers_search_index_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_streaming_file',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'dependencies': [
+      'crl.gyp:crl',
+    ],
+    'include_dirs': [
+      '<(submodules_loc)/crl/src',
+    ],
+    'sources': [
+      '<(src_loc)/media/media_streaming_file.cpp',
+      '<(src_loc)/media/media_streaming_file.h',
+      '<(src_loc)/media/media_streaming_file_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_timer_wheel',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'dependencies': [
+      'lib_base.gyp:lib_base',
+    ],
+    'sources': [
+      '<(src_loc)/base/timer_wheel.h',
+      '<(src_loc)/base/timer_wheel_tests.cpp',
+    ],
+  }],
+}